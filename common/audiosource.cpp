@@ -0,0 +1,74 @@
+#include "audiosource.h"
+#include "mappedwavsource.h"
+#include "flacsource.h"
+#include "vorbissource.h"
+#include "opussource.h"
+#include <QFile>
+#include <QScopedPointer>
+#include <cstring>
+
+AudioSource *createAudioSource(const QString &path)
+{
+    // 확장자가 틀린 파일도 있으니 매직 바이트를 먼저 본다
+    // Ogg 는 첫 패킷(BOS 페이지 28 바이트 뒤)에서 코덱을 구분한다
+    char magic[36];
+    memset(magic, 0, sizeof magic);
+    QFile f(path);
+    if (f.open(QIODevice::ReadOnly)) {
+        f.read(magic, sizeof magic);
+        f.close();
+    }
+    if (memcmp(magic, "RIFF", 4) == 0 || memcmp(magic, "RF64", 4) == 0
+            || memcmp(magic, "BW64", 4) == 0)
+        return new MappedWavSource;
+    if (memcmp(magic, "fLaC", 4) == 0)
+        return new FlacSource;
+    if (memcmp(magic, "OggS", 4) == 0) {
+        if (memcmp(magic + 28, "\x01vorbis", 7) == 0)
+            return new VorbisSource;
+        if (memcmp(magic + 28, "OpusHead", 8) == 0)
+            return new OpusSource;
+    }
+
+    const QString lower = path.toLower();
+    if (lower.endsWith(".wav"))
+        return new MappedWavSource;
+    if (lower.endsWith(".flac"))
+        return new FlacSource;
+    if (lower.endsWith(".ogg") || lower.endsWith(".oga"))
+        return new VorbisSource;
+    if (lower.endsWith(".opus"))
+        return new OpusSource;
+    return nullptr;
+}
+
+bool probeAudioFile(const QString &path, AudioInfo *info, QString *error)
+{
+    QScopedPointer<AudioSource> src(createAudioSource(path));
+    if (!src) {
+        if (error) *error = "Unsupported file type";
+        return false;
+    }
+    if (!src->open(path)) {
+        if (error) *error = src->errorString();
+        return false;
+    }
+    *info = src->info();
+    return true;
+}
+
+QString audioFileFilter()
+{
+    return "Audio Files (*.wav *.flac *.ogg *.oga *.opus);;WAV Files (*.wav);;FLAC Files (*.flac);;"
+           "Ogg Vorbis Files (*.ogg *.oga);;Opus Files (*.opus)";
+}
+
+void floatToS16(const float *src, qint16 *dst, qint64 samples)
+{
+    for (qint64 i = 0; i < samples; ++i) {
+        float v = src[i] * 32768.0f;
+        if (v > 32767.0f) v = 32767.0f;
+        else if (v < -32768.0f) v = -32768.0f;
+        dst[i] = qint16(v);
+    }
+}
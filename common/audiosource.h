@@ -0,0 +1,71 @@
+#ifndef AUDIOSOURCE_H
+#define AUDIOSOURCE_H
+
+#include <QtGlobal>
+#include <QString>
+
+// 파일 하나에 대한 기본 정보 (포맷과 무관)
+struct AudioInfo
+{
+    QString codec;               // "wav", "flac", ...
+    quint32 sampleRate = 0;
+    int     channels = 0;
+    int     bitsPerSample = 0;   // 원본 해상도, 손실 압축이면 0
+    qint64  frameCount = -1;     // 모르면 -1
+    quint64 dataOffset = 0;      // 파일 안의 오디오 데이터 구간 (선읽기용)
+    quint64 dataSize = 0;
+
+    double durationSeconds() const
+    { return (sampleRate && frameCount > 0) ? double(frameCount) / sampleRate : 0.0; }
+    // 평균 바이트레이트 (압축 포맷은 추정치). 길이를 모르면 (FLAC total_samples 0,
+    // 끝을 모르는 스트림) 같은 포맷의 PCM 바이트레이트로 잡는다. 압축 포맷에는 넉넉한
+    // 값이라 선읽기 창이 작아지지 않는다
+    double bytesPerSecond() const
+    {
+        const double d = durationSeconds();
+        if (d > 0)
+            return double(dataSize) / d;
+        return double(sampleRate) * channels * (bitsPerSample > 0 ? bitsPerSample : 16) / 8.0;
+    }
+};
+
+// 분석기와 재생이 공통으로 쓰는 디코더 인터페이스.
+// 블록 포맷은 항상 인터리브 float (-1..1) 이다.
+class AudioSource
+{
+public:
+    virtual ~AudioSource() {}
+
+    virtual bool open(const QString &path) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    virtual QString errorString() const = 0;
+    virtual const AudioInfo &info() const = 0;
+
+    virtual qint64  position() const = 0;       // 프레임 단위
+    virtual quint64 bytePosition() const = 0;   // 다음에 읽을 파일 위치
+    virtual bool    seek(qint64 frame) = 0;     // 샘플 단위로 정확히
+
+    // 최대 maxFrames 를 dst 에 디코드. 읽은 프레임 수, 0 이면 끝 / -1 이면 에러
+    virtual qint64 readFloat(float *dst, qint64 maxFrames) = 0;
+
+    quint32 sampleRate() const    { return info().sampleRate; }
+    int     channels() const      { return info().channels; }
+    int     bitsPerSample() const { return info().bitsPerSample; }
+    qint64  frameCount() const    { return info().frameCount; }
+    bool    atEnd() const { return frameCount() >= 0 && position() >= frameCount(); }
+};
+
+// 확장자/매직 바이트로 알맞은 소스를 만든다 (열지는 않음). 모르는 포맷이면 nullptr
+AudioSource *createAudioSource(const QString &path);
+
+// 파일을 열어 헤더만 읽는다 (목록 표시, 재생 시간 계산용)
+bool probeAudioFile(const QString &path, AudioInfo *info, QString *error = nullptr);
+
+// 파일 선택 대화상자 등에 쓰는 필터 목록
+QString audioFileFilter();
+
+// float 블록 -> 16bit PCM (aplay / 네트워크 출력용)
+void floatToS16(const float *src, qint16 *dst, qint64 samples);
+
+#endif // AUDIOSOURCE_H
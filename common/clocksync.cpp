@@ -0,0 +1,196 @@
+#include "clocksync.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+namespace {
+
+const int    kFastProbes      = 8;                   // 처음에는 빨리 표본을 모은다
+const qint64 kFastIntervalNs  = 30 * 1000000LL;
+const qint64 kMinSpanNs       = 2000000000LL;        // drift 는 2초 이상 모였을 때만
+const double kMaxSlope        = 500e-6;              // 수정 발진기 허용 범위 밖은 잘라냄
+
+} // namespace
+
+ClockSync::ClockSync()
+    : m_fd(-1),
+      m_sequence(0),
+      m_probeIntervalMs(500),
+      m_probesSent(0),
+      m_nextProbeNs(0),
+      m_lastDelayNs(0),
+      m_minDelayNs(0),
+      m_baseNs(0),
+      m_offset(0.0),
+      m_slope(0.0)
+{
+}
+
+ClockSync::~ClockSync()
+{
+    close();
+}
+
+bool ClockSync::open(const QString &host, quint16 port)
+{
+    close();
+    addrinfo hints;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *res = nullptr;
+    const int rc = getaddrinfo(host.toLatin1().constData(),
+                               QByteArray::number(port).constData(), &hints, &res);
+    if (rc != 0 || !res) {
+        m_error = QString::fromLocal8Bit(gai_strerror(rc));
+        return false;
+    }
+    m_fd = socket(res->ai_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0 || ::connect(m_fd, res->ai_addr, res->ai_addrlen) != 0) {
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        freeaddrinfo(res);
+        close();
+        return false;
+    }
+    freeaddrinfo(res);
+
+    m_samples.clear();
+    m_probesSent = 0;
+    m_nextProbeNs = 0;
+    m_offset = m_slope = 0.0;
+    return true;
+}
+
+void ClockSync::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void ClockSync::setProbeIntervalMs(int ms)
+{
+    m_probeIntervalMs = qMax(10, ms);
+}
+
+void ClockSync::service(qint64 nowNs)
+{
+    if (m_fd < 0)
+        return;
+    readReplies();
+    if (nowNs >= m_nextProbeNs) {
+        sendProbe(nowNs);
+        m_nextProbeNs = nowNs + (m_probesSent < kFastProbes
+                                 ? kFastIntervalNs
+                                 : qint64(m_probeIntervalMs) * 1000000LL);
+    }
+}
+
+void ClockSync::sendProbe(qint64 nowNs)
+{
+    Q_UNUSED(nowNs);
+    uchar buf[StreamProtocol::ClockRequestSize];
+    qToLittleEndian<quint32>(StreamProtocol::ClockMagic, buf);
+    qToLittleEndian<quint32>(++m_sequence, buf + 4);
+    qToLittleEndian<qint64>(StreamProtocol::clockNs(), buf + 8);   // t1 은 보내기 직전
+    if (send(m_fd, buf, sizeof buf, MSG_DONTWAIT | MSG_NOSIGNAL) == ssize_t(sizeof buf))
+        ++m_probesSent;
+}
+
+void ClockSync::readReplies()
+{
+    uchar buf[64];
+    for (;;) {
+        const ssize_t n = recv(m_fd, buf, sizeof buf, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        const qint64 t4 = StreamProtocol::clockNs();
+        if (n < StreamProtocol::ClockReplySize
+                || qFromLittleEndian<quint32>(buf) != StreamProtocol::ClockMagic)
+            continue;
+        // 너무 늦게 온 응답은 지연이 커서 어차피 걸러지지만, 한참 전 것은 바로 버린다
+        if (m_sequence - qFromLittleEndian<quint32>(buf + 4) > 8)
+            continue;
+        const qint64 t1 = qFromLittleEndian<qint64>(buf + 8);
+        const qint64 t2 = qFromLittleEndian<qint64>(buf + 16);
+        const qint64 t3 = qFromLittleEndian<qint64>(buf + 24);
+        Sample s;
+        s.delayNs = (t4 - t1) - (t3 - t2);
+        if (s.delayNs < 0 || t4 < t1)
+            continue;
+        s.offsetNs = ((t2 - t1) + (t3 - t4)) / 2;
+        s.localNs = t1 + (t4 - t1) / 2;
+        addSample(s);
+    }
+}
+
+void ClockSync::addSample(const Sample &s)
+{
+    if (m_samples.size() >= WindowSize)
+        m_samples.remove(0);
+    m_samples.append(s);
+    m_lastDelayNs = s.delayNs;
+    refit();
+}
+
+void ClockSync::refit()
+{
+    // 큐잉 지연이 낀 표본은 오프셋이 한쪽으로 치우치므로 최소 지연 근처만 쓴다
+    qint64 minDelay = m_samples.at(0).delayNs;
+    for (int i = 1; i < m_samples.size(); ++i)
+        minDelay = qMin(minDelay, m_samples.at(i).delayNs);
+    m_minDelayNs = minDelay;
+    const qint64 limit = minDelay + qMax(minDelay / 2, 50000LL);
+
+    const qint64 base = m_samples.last().localNs;
+    double sx = 0, sy = 0;
+    int n = 0;
+    qint64 first = base;
+    for (int i = 0; i < m_samples.size(); ++i) {
+        const Sample &s = m_samples.at(i);
+        if (s.delayNs > limit)
+            continue;
+        sx += double(s.localNs - base);
+        sy += double(s.offsetNs);
+        first = qMin(first, s.localNs);
+        ++n;
+    }
+    const double mx = sx / n, my = sy / n;
+
+    double slope = 0.0;
+    if (n >= 3 && base - first >= kMinSpanNs) {
+        double sxx = 0, sxy = 0;
+        for (int i = 0; i < m_samples.size(); ++i) {
+            const Sample &s = m_samples.at(i);
+            if (s.delayNs > limit)
+                continue;
+            const double dx = double(s.localNs - base) - mx;
+            sxx += dx * dx;
+            sxy += dx * (double(s.offsetNs) - my);
+        }
+        if (sxx > 0)
+            slope = qBound(-kMaxSlope, sxy / sxx, kMaxSlope);
+    }
+    m_baseNs = base;
+    m_slope = slope;
+    m_offset = my - slope * mx;
+}
+
+qint64 ClockSync::offsetNs(qint64 localNs) const
+{
+    return qint64(m_offset + m_slope * double(localNs - m_baseNs));
+}
+
+qint64 ClockSync::toLocal(qint64 serverNs) const
+{
+    // 오프셋은 로컬 시각의 함수라 한 번 근사한 로컬 시각에서 다시 계산
+    const qint64 approx = serverNs - qint64(m_offset);
+    return serverNs - offsetNs(approx);
+}
@@ -0,0 +1,76 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include "streamprotocol.h"
+
+// 클라이언트 쪽 시계 동기. 서버에 UDP 로 시각 요청을 보내 NTP 와 같은 방식으로
+//   offset = ((t2 - t1) + (t3 - t4)) / 2      (서버 - 로컬)
+//   delay  = (t4 - t1) - (t3 - t2)
+// 를 재고, 최근 표본 중 지연이 작은 것들만 골라 offset(t) = a + b*t 로 직선
+// 맞춤한다 (b 가 두 수정 발진기의 drift). 이벤트 루프는 소켓이 읽기 가능해질 때와
+// nextServiceNs() 시각에 service() 를 불러 주면 된다 (스레드를 만들지 않음).
+class ClockSync
+{
+public:
+    struct Sample {
+        qint64 localNs;    // t4 와 t1 의 중간 (로컬 시계)
+        qint64 offsetNs;
+        qint64 delayNs;
+    };
+
+    enum { WindowSize = 64 };
+
+    ClockSync();
+    ~ClockSync();
+
+    bool open(const QString &host, quint16 port = StreamProtocol::DefaultPort);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    QString errorString() const { return m_error; }
+    int socketDescriptor() const { return m_fd; }
+
+    // 평상시 요청 간격. 처음 몇 번은 빨리 보내 빨리 맞춘다
+    void setProbeIntervalMs(int ms);
+
+    void   service(qint64 nowNs = StreamProtocol::clockNs());
+    qint64 nextServiceNs() const { return m_nextProbeNs; }
+
+    bool   isSynced() const { return m_samples.size() >= 4; }
+    qint64 offsetNs(qint64 localNs = StreamProtocol::clockNs()) const;   // 서버 - 로컬
+    double driftPpm() const { return m_slope * 1e6; }
+    qint64 lastDelayNs() const { return m_lastDelayNs; }
+    qint64 minDelayNs() const { return m_minDelayNs; }
+    int    sampleCount() const { return m_samples.size(); }
+
+    qint64 toLocal(qint64 serverNs) const;
+    qint64 toServer(qint64 localNs) const { return localNs + offsetNs(localNs); }
+
+private:
+    void sendProbe(qint64 nowNs);
+    void readReplies();
+    void addSample(const Sample &s);
+    void refit();
+
+    int     m_fd;
+    QString m_error;
+    quint32 m_sequence;
+    int     m_probeIntervalMs;
+    int     m_probesSent;
+    qint64  m_nextProbeNs;
+
+    QVector<Sample> m_samples;        // 최근 WindowSize 개 (오래된 것부터)
+    qint64  m_lastDelayNs;
+    qint64  m_minDelayNs;
+
+    // offset(t) = m_offset + m_slope * (t - m_baseNs)
+    qint64  m_baseNs;
+    double  m_offset;
+    double  m_slope;
+
+    Q_DISABLE_COPY(ClockSync)
+};
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# equlizer / 파형 뷰어 / server2 가 같이 쓰는 오디오 코드
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+SOURCES += $$PWD/wavformat.cpp \
+           $$PWD/audiosource.cpp \
+           $$PWD/mappedwavsource.cpp \
+           $$PWD/flacsource.cpp \
+           $$PWD/vorbissource.cpp \
+           $$PWD/opussource.cpp \
+           $$PWD/resampler.cpp \
+           $$PWD/readahead.cpp \
+           $$PWD/pcmcache.cpp \
+           $$PWD/libraryindex.cpp \
+           $$PWD/librarywatcher.cpp
+
+HEADERS += $$PWD/wavformat.h \
+           $$PWD/audiosource.h \
+           $$PWD/mappedwavsource.h \
+           $$PWD/flacsource.h \
+           $$PWD/vorbissource.h \
+           $$PWD/opussource.h \
+           $$PWD/resampler.h \
+           $$PWD/readahead.h \
+           $$PWD/pcmcache.h \
+           $$PWD/libraryindex.h \
+           $$PWD/librarywatcher.h
+
+# 디코더 라이브러리 (타깃용은 arm64_libs 에 있음)
+LIBS += -L$$PWD/../arm64_libs -lFLAC -lvorbisfile -lvorbis -lopus -logg
@@ -0,0 +1,130 @@
+#include "controlclient.h"
+#include <QJsonDocument>
+#include <QSocketNotifier>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+ControlClient::ControlClient(QObject *parent)
+    : QObject(parent),
+      m_fd(-1),
+      m_notifier(nullptr)
+{
+}
+
+ControlClient::~ControlClient()
+{
+    disconnectFromServer();
+}
+
+bool ControlClient::connectToServer(const QString &path)
+{
+    disconnectFromServer();
+    const QByteArray native = path.toLocal8Bit();
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (native.isEmpty() || native.size() >= int(sizeof addr.sun_path)) {
+        m_error = QString("Invalid control socket path: %1").arg(path);
+        return false;
+    }
+    memcpy(addr.sun_path, native.constData(), size_t(native.size()));
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0) {
+        m_error = QString("%1: %2").arg(path).arg(QString::fromLocal8Bit(strerror(errno)));
+        if (m_fd >= 0)
+            ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    m_path = path;
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadable()));
+    return true;
+}
+
+void ControlClient::disconnectFromServer()
+{
+    // onReadable() 안에서도 불리므로 알림 객체는 나중에 지운다
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_in.clear();
+    m_sent.clear();
+}
+
+// 명령은 짧고 상대는 같은 호스트라 블로킹 send 로 충분하다
+bool ControlClient::sendCommand(const QString &command, const QString &argument)
+{
+    if (m_fd < 0) {
+        m_error = "Not connected";
+        return false;
+    }
+    QByteArray line = command.toUtf8();
+    if (!argument.isEmpty())
+        line += ' ' + argument.toUtf8();
+    line += '\n';
+    int sent = 0;
+    while (sent < line.size()) {
+        const ssize_t n = ::send(m_fd, line.constData() + sent, size_t(line.size() - sent),
+                                 MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            fail(QString::fromLocal8Bit(strerror(errno)));
+            return false;
+        }
+        sent += int(n);
+    }
+    m_sent.append(command);
+    return true;
+}
+
+void ControlClient::onReadable()
+{
+    char buf[4096];
+    const ssize_t n = recv(m_fd, buf, sizeof buf, MSG_DONTWAIT);
+    if (n == 0) {
+        fail("Server closed the connection");
+        return;
+    }
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EINTR)
+            fail(QString::fromLocal8Bit(strerror(errno)));
+        return;
+    }
+    m_in.append(buf, int(n));
+
+    int start = 0;
+    for (;;) {
+        const int eol = m_in.indexOf('\n', start);
+        if (eol < 0)
+            break;
+        const QJsonObject message = QJsonDocument::fromJson(m_in.mid(start, eol - start)).object();
+        start = eol + 1;
+        if (message.contains("event"))
+            emit eventReceived(message);
+        else
+            emit replyReceived(m_sent.isEmpty() ? QString() : m_sent.takeFirst(), message);
+        if (m_fd < 0)                 // 시그널 핸들러에서 끊었음
+            return;
+    }
+    m_in.remove(0, start);
+}
+
+void ControlClient::fail(const QString &error)
+{
+    m_error = error;
+    disconnectFromServer();
+    emit disconnected();
+}
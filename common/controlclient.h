@@ -0,0 +1,53 @@
+#ifndef CONTROLCLIENT_H
+#define CONTROLCLIENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include "controlprotocol.h"
+
+class QSocketNotifier;
+
+// server2d 제어 소켓 클라이언트 (controlprotocol.h). GUI 스레드 이벤트 루프에서
+// 돈다. 응답은 보낸 순서대로 replyReceived() (어느 명령의 응답인지와 함께),
+// 구독 이벤트는 eventReceived().
+class ControlClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlClient(QObject *parent = nullptr);
+    ~ControlClient();
+
+    // 로컬 소켓이라 바로 끝난다 (블록하지 않음)
+    bool connectToServer(const QString &path = ControlProtocol::defaultSocketPath());
+    void disconnectFromServer();
+    bool isConnected() const { return m_fd >= 0; }
+    QString errorString() const { return m_error; }
+    QString socketPath() const { return m_path; }
+
+    bool sendCommand(const QString &command, const QString &argument = QString());
+
+signals:
+    void replyReceived(const QString &command, const QJsonObject &reply);
+    void eventReceived(const QJsonObject &event);
+    void disconnected();
+
+private slots:
+    void onReadable();
+
+private:
+    void fail(const QString &error);
+
+    int     m_fd;
+    QString m_path;
+    QString m_error;
+    QByteArray m_in;
+    QStringList m_sent;               // 응답을 아직 못 받은 명령 (보낸 순서)
+    QSocketNotifier *m_notifier;
+
+    Q_DISABLE_COPY(ControlClient)
+};
+
+#endif // CONTROLCLIENT_H
@@ -0,0 +1,71 @@
+#ifndef CONTROLPROTOCOL_H
+#define CONTROLPROTOCOL_H
+
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+// server2d 제어 소켓 프로토콜 (AF_UNIX stream, 줄 단위).
+//
+// 요청은 "명령 [인자]\n" 텍스트 한 줄. 인자는 줄 끝까지라 경로에 공백이 있어도
+// 된다. 사람이 직접 칠 수 있게 텍스트로 둔다:
+//   echo status | socat - UNIX-CONNECT:/tmp/server2d.sock
+//
+// 응답은 요청마다 JSON 객체 한 줄, 요청 순서대로 온다.
+//   {"ok":true,...}   /   {"ok":false,"error":"..."}
+// subscribe 한 연결에는 응답 사이에 이벤트 줄이 끼어든다 ("event" 키로 구분).
+//   {"event":"clientConnected","id":3,"peer":"10.0.0.7:40112"}
+//
+// 명령
+//   ping                        살아 있는지
+//   status                      재생 상태, 위치, 엔진 통계
+//   clients                     접속한 스트리밍 클라이언트
+//   list                        라이브러리의 파일 (저장된 색인, 하위 디렉터리 포함)
+//   rescan                      라이브러리를 다시 훑는다 (바뀐 것만, 끝나면 libraryChanged).
+//                               library/watch 를 켜 두면 파일이 바뀔 때 저절로 한다
+//   play <path>                 처음부터 재생
+//   stop
+//   seek <seconds>              재생 중인 트랙에서 위치 이동 (샘플 단위)
+//   multicast <group:port>|off  RTP 멀티캐스트 켜기 / 끄기
+//   distance <id|host> <m>|off  스피커에서 청취 위치까지 거리 (지연 자동 계산)
+//   delay <id|host> <ms>        측정한 지연 보정 (거리 지연에 더함)
+//   subscribe                   이 연결로 이벤트를 받는다
+//   shutdown                    데몬 종료
+namespace ControlProtocol {
+
+inline QString defaultSocketPath()
+{
+    return QStringLiteral("/tmp/server2d.sock");
+}
+
+inline QByteArray encode(const QJsonObject &message)
+{
+    return QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n';
+}
+
+inline QJsonObject ok()
+{
+    QJsonObject o;
+    o["ok"] = true;
+    return o;
+}
+
+inline QJsonObject error(const QString &message)
+{
+    QJsonObject o;
+    o["ok"] = false;
+    o["error"] = message;
+    return o;
+}
+
+inline QJsonObject event(const QString &name)
+{
+    QJsonObject o;
+    o["event"] = name;
+    return o;
+}
+
+} // namespace ControlProtocol
+
+#endif // CONTROLPROTOCOL_H
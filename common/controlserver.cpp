@@ -0,0 +1,247 @@
+#include "controlserver.h"
+#include <QSocketNotifier>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+
+const int kMaxLine    = 64 * 1024;        // 이보다 긴 요청 줄은 끊는다
+const int kMaxBacklog = 1024 * 1024;      // 안 읽어 가는 구독자는 끊는다
+
+bool makeAddress(const QString &path, sockaddr_un *addr)
+{
+    const QByteArray native = path.toLocal8Bit();
+    if (native.isEmpty() || native.size() >= int(sizeof addr->sun_path))
+        return false;
+    memset(addr, 0, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, native.constData(), size_t(native.size()));
+    return true;
+}
+
+} // namespace
+
+struct ControlServer::Connection
+{
+    int fd = -1;
+    QSocketNotifier *readNotifier = nullptr;
+    QSocketNotifier *writeNotifier = nullptr;
+    QByteArray in;
+    QByteArray out;                   // 소켓이 막혀 못 보낸 응답
+    bool subscribed = false;
+    bool dead = false;                // 처리 중에는 지우지 않고 표시만 한다
+};
+
+ControlServer::ControlServer(QObject *parent)
+    : QObject(parent),
+      m_listenFd(-1),
+      m_acceptNotifier(nullptr)
+{
+}
+
+ControlServer::~ControlServer()
+{
+    close();
+}
+
+bool ControlServer::listen(const QString &path)
+{
+    close();
+    sockaddr_un addr;
+    if (!makeAddress(path, &addr)) {
+        m_error = QString("Invalid control socket path: %1").arg(path);
+        return false;
+    }
+
+    // 남아 있는 소켓 파일: 누가 받으면 이미 실행 중, 아니면 지난번 찌꺼기
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        const bool alive = ::connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof addr) == 0;
+        ::close(probe);
+        if (alive) {
+            m_error = QString("%1 is in use (already running?)").arg(path);
+            return false;
+        }
+    }
+    unlink(addr.sun_path);
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0
+            || bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0
+            || ::listen(m_listenFd, 16) != 0) {
+        m_error = QString("%1: %2").arg(path).arg(QString::fromLocal8Bit(strerror(errno)));
+        if (m_listenFd >= 0)
+            ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    m_path = path;
+    m_acceptNotifier = new QSocketNotifier(m_listenFd, QSocketNotifier::Read, this);
+    connect(m_acceptNotifier, SIGNAL(activated(int)), this, SLOT(onAccept()));
+    return true;
+}
+
+void ControlServer::close()
+{
+    for (Connection *c : m_connections) {
+        delete c->readNotifier;
+        delete c->writeNotifier;
+        ::close(c->fd);
+        delete c;
+    }
+    m_connections.clear();
+    delete m_acceptNotifier;
+    m_acceptNotifier = nullptr;
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        unlink(m_path.toLocal8Bit().constData());
+    }
+    m_path.clear();
+}
+
+void ControlServer::onAccept()
+{
+    for (;;) {
+        const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        Connection *c = new Connection;
+        c->fd = fd;
+        c->readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        c->writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+        c->writeNotifier->setEnabled(false);
+        connect(c->readNotifier, SIGNAL(activated(int)), this, SLOT(onReadable(int)));
+        connect(c->writeNotifier, SIGNAL(activated(int)), this, SLOT(onWritable(int)));
+        m_connections.insert(fd, c);
+    }
+}
+
+void ControlServer::onReadable(int fd)
+{
+    Connection *c = m_connections.value(fd);
+    if (!c || c->dead)
+        return;
+    char buf[4096];
+    const ssize_t n = recv(fd, buf, sizeof buf, 0);
+    if (n <= 0) {
+        if (n == 0 || (errno != EAGAIN && errno != EINTR))
+            drop(c);
+        return;
+    }
+    c->in.append(buf, int(n));
+
+    int start = 0;
+    for (;;) {
+        const int eol = c->in.indexOf('\n', start);
+        if (eol < 0)
+            break;
+        const QString line = QString::fromUtf8(c->in.constData() + start, eol - start).trimmed();
+        start = eol + 1;
+        if (line.isEmpty())
+            continue;
+        const int space = line.indexOf(' ');
+        const QString command = space < 0 ? line : line.left(space);
+        const QString argument = space < 0 ? QString() : line.mid(space + 1).trimmed();
+        if (command == "subscribe") {
+            c->subscribed = true;
+            reply(fd, ControlProtocol::ok());
+        } else {
+            emit request(fd, command, argument);
+        }
+        if (c->dead)
+            break;
+    }
+    c->in.remove(0, start);
+    if (c->in.size() > kMaxLine)
+        drop(c);
+}
+
+void ControlServer::onWritable(int fd)
+{
+    Connection *c = m_connections.value(fd);
+    if (!c || c->dead)
+        return;
+    const QByteArray pending = c->out;
+    c->out.clear();
+    c->writeNotifier->setEnabled(false);
+    send(c, pending);
+}
+
+void ControlServer::reply(int connection, const QJsonObject &response)
+{
+    Connection *c = m_connections.value(connection);
+    if (c && !c->dead)
+        send(c, ControlProtocol::encode(response));
+}
+
+void ControlServer::publish(const QJsonObject &event)
+{
+    const QByteArray line = ControlProtocol::encode(event);
+    for (Connection *c : m_connections) {
+        if (c->subscribed && !c->dead)
+            send(c, line);
+    }
+}
+
+void ControlServer::send(Connection *c, const QByteArray &data)
+{
+    int sent = 0;
+    if (c->out.isEmpty()) {
+        while (sent < data.size()) {
+            const ssize_t n = ::send(c->fd, data.constData() + sent, size_t(data.size() - sent),
+                                     MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    drop(c);
+                    return;
+                }
+                break;
+            }
+            sent += int(n);
+        }
+    }
+    if (sent == data.size())
+        return;
+    c->out.append(data.constData() + sent, data.size() - sent);
+    if (c->out.size() > kMaxBacklog) {
+        drop(c);
+        return;
+    }
+    c->writeNotifier->setEnabled(true);
+}
+
+// 이벤트 처리 도중에 불릴 수 있으므로 여기서는 표시만 하고 알림을 끈다.
+// 실제 정리는 다음 이벤트 루프에서 reap()
+void ControlServer::drop(Connection *c)
+{
+    if (c->dead)
+        return;
+    c->dead = true;
+    c->readNotifier->setEnabled(false);
+    c->writeNotifier->setEnabled(false);
+    ::shutdown(c->fd, SHUT_RDWR);
+    QMetaObject::invokeMethod(this, "reap", Qt::QueuedConnection);
+}
+
+void ControlServer::reap()
+{
+    for (auto it = m_connections.begin(); it != m_connections.end();) {
+        Connection *c = it.value();
+        if (!c->dead) {
+            ++it;
+            continue;
+        }
+        it = m_connections.erase(it);
+        delete c->readNotifier;
+        delete c->writeNotifier;
+        ::close(c->fd);
+        delete c;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include "controlprotocol.h"
+
+class QSocketNotifier;
+
+// 제어 소켓 서버 (controlprotocol.h). 호출한 스레드의 이벤트 루프에서
+// QSocketNotifier 로 돈다 (스레드를 만들지 않음). 명령의 뜻은 모르고 줄을
+// 잘라 request() 로 넘기기만 한다. subscribe 만 여기서 처리한다.
+//
+// 핸들러는 request() 마다 reply() 를 정확히 한 번 불러야 한다 (응답 순서 = 요청 순서).
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(QObject *parent = nullptr);
+    ~ControlServer();
+
+    // 같은 경로에 살아 있는 서버가 있으면 실패, 죽은 소켓 파일은 지우고 연다
+    bool listen(const QString &path = ControlProtocol::defaultSocketPath());
+    void close();
+    QString errorString() const { return m_error; }
+    QString socketPath() const { return m_path; }
+    int connectionCount() const { return m_connections.size(); }
+
+    void reply(int connection, const QJsonObject &response);
+    void publish(const QJsonObject &event);   // subscribe 한 연결에만
+
+signals:
+    void request(int connection, const QString &command, const QString &argument);
+
+private slots:
+    void onAccept();
+    void onReadable(int fd);
+    void onWritable(int fd);
+    void reap();
+
+private:
+    struct Connection;
+
+    void send(Connection *c, const QByteArray &data);
+    void drop(Connection *c);
+
+    QString m_error;
+    QString m_path;
+    int     m_listenFd;
+    QSocketNotifier *m_acceptNotifier;
+    QHash<int, Connection *> m_connections;   // fd -> 연결
+
+    Q_DISABLE_COPY(ControlServer)
+};
+
+#endif // CONTROLSERVER_H
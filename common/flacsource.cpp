@@ -0,0 +1,190 @@
+#include "flacsource.h"
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+
+FlacSource::FlacSource()
+    : m_decoder(nullptr),
+      m_blockFrames(0),
+      m_blockPos(0),
+      m_pos(0),
+      m_hasSeekTable(false)
+{
+}
+
+FlacSource::~FlacSource()
+{
+    close();
+}
+
+bool FlacSource::open(const QString &path)
+{
+    close();
+    m_error.clear();
+    m_decoder = FLAC__stream_decoder_new();
+    if (!m_decoder) {
+        m_error = "Cannot create FLAC decoder";
+        return false;
+    }
+    FLAC__stream_decoder_set_md5_checking(m_decoder, false);
+    FLAC__stream_decoder_set_metadata_respond(m_decoder, FLAC__METADATA_TYPE_SEEKTABLE);
+
+    const FLAC__StreamDecoderInitStatus st = FLAC__stream_decoder_init_file(
+                m_decoder, QFile::encodeName(path).constData(),
+                &FlacSource::writeCallback, &FlacSource::metadataCallback,
+                &FlacSource::errorCallback, this);
+    if (st != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+        m_error = QString::fromLatin1(FLAC__StreamDecoderInitStatusString[st]);
+        close();
+        return false;
+    }
+    if (!FLAC__stream_decoder_process_until_end_of_metadata(m_decoder)
+            || m_info.sampleRate == 0 || m_info.channels == 0) {
+        if (m_error.isEmpty())
+            m_error = "Invalid FLAC stream";
+        close();
+        return false;
+    }
+
+    // 메타데이터 바로 뒤가 첫 오디오 프레임
+    FLAC__uint64 audioStart = 0;
+    FLAC__stream_decoder_get_decode_position(m_decoder, &audioStart);
+    const quint64 fileSize = quint64(QFileInfo(path).size());
+    m_info.codec      = "flac";
+    m_info.dataOffset = audioStart;
+    m_info.dataSize   = fileSize > audioStart ? fileSize - audioStart : 0;
+    return true;
+}
+
+void FlacSource::close()
+{
+    if (m_decoder) {
+        FLAC__stream_decoder_finish(m_decoder);
+        FLAC__stream_decoder_delete(m_decoder);
+        m_decoder = nullptr;
+    }
+    m_info = AudioInfo();
+    m_blockFrames = 0;
+    m_blockPos = 0;
+    m_pos = 0;
+    m_hasSeekTable = false;
+}
+
+quint64 FlacSource::bytePosition() const
+{
+    FLAC__uint64 pos = 0;
+    if (m_decoder)
+        FLAC__stream_decoder_get_decode_position(m_decoder, &pos);
+    return pos;
+}
+
+bool FlacSource::seek(qint64 frame)
+{
+    if (!m_decoder || frame < 0 || (m_info.frameCount >= 0 && frame > m_info.frameCount))
+        return false;
+
+    m_blockFrames = 0;
+    m_blockPos = 0;
+    // 끝 위치 (frameCount) 는 libFLAC 이 거부하므로 디코더는 그대로 두고 위치만
+    // 옮긴다. readFloat 가 m_pos 를 보고 0 을 돌려준다
+    if (frame == m_info.frameCount) {
+        m_pos = frame;
+        return true;
+    }
+
+    // seek_absolute 는 SEEKTABLE (없으면 이분 탐색) 으로 프레임을 찾은 뒤
+    // 목표 샘플부터 시작하도록 잘라서 writeCallback 을 한 번 부른다
+    if (!FLAC__stream_decoder_seek_absolute(m_decoder, FLAC__uint64(frame))) {
+        if (FLAC__stream_decoder_get_state(m_decoder) == FLAC__STREAM_DECODER_SEEK_ERROR)
+            FLAC__stream_decoder_flush(m_decoder);
+        m_blockFrames = 0;
+        m_error = "FLAC seek failed";
+        return false;
+    }
+    m_pos = frame;
+    return true;
+}
+
+qint64 FlacSource::readFloat(float *dst, qint64 maxFrames)
+{
+    if (!m_decoder)
+        return -1;
+    const int ch = m_info.channels;
+    qint64 done = 0;
+    while (done < maxFrames) {
+        if (m_blockPos >= m_blockFrames) {
+            if (FLAC__stream_decoder_get_state(m_decoder) == FLAC__STREAM_DECODER_END_OF_STREAM
+                    || (m_info.frameCount >= 0 && m_pos + done >= m_info.frameCount))
+                break;
+            m_blockFrames = 0;
+            m_blockPos = 0;
+            if (!FLAC__stream_decoder_process_single(m_decoder)) {
+                m_error = QString::fromLatin1(FLAC__StreamDecoderStateString[
+                        FLAC__stream_decoder_get_state(m_decoder)]);
+                if (done == 0)
+                    return -1;
+                break;
+            }
+            continue;
+        }
+        const qint64 n = qMin(maxFrames - done, m_blockFrames - m_blockPos);
+        memcpy(dst + done * ch, m_block.constData() + m_blockPos * ch,
+               size_t(n * ch) * sizeof(float));
+        m_blockPos += n;
+        done += n;
+    }
+    m_pos += done;
+    return done;
+}
+
+FLAC__StreamDecoderWriteStatus FlacSource::writeCallback(
+        const FLAC__StreamDecoder *, const FLAC__Frame *frame,
+        const FLAC__int32 *const buffer[], void *client)
+{
+    FlacSource *self = static_cast<FlacSource *>(client);
+    const int ch = qMin<int>(frame->header.channels, self->m_info.channels);
+    const int n  = int(frame->header.blocksize);
+    const float scale = 1.0f / float(1u << (frame->header.bits_per_sample - 1));
+
+    // STREAMINFO 의 최대 블록 크기로 미리 잡아 두므로 보통은 재할당 없음
+    if (self->m_block.size() < n * self->m_info.channels)
+        self->m_block.resize(n * self->m_info.channels);
+    // 프레임 채널이 STREAMINFO 보다 적으면 (잘못 만든 파일) 나머지 채널은 무음.
+    // 안 채우면 이전 블록의 샘플이 남아 섞인다
+    const int stride = self->m_info.channels;
+    float *out = self->m_block.data();
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < ch; ++c)
+            out[c] = buffer[c][i] * scale;
+        for (int c = ch; c < stride; ++c)
+            out[c] = 0.0f;
+        out += stride;
+    }
+    self->m_blockFrames = n;
+    self->m_blockPos = 0;
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+void FlacSource::metadataCallback(const FLAC__StreamDecoder *,
+                                  const FLAC__StreamMetadata *meta, void *client)
+{
+    FlacSource *self = static_cast<FlacSource *>(client);
+    if (meta->type == FLAC__METADATA_TYPE_STREAMINFO) {
+        const FLAC__StreamMetadata_StreamInfo &si = meta->data.stream_info;
+        self->m_info.sampleRate    = si.sample_rate;
+        self->m_info.channels      = int(si.channels);
+        self->m_info.bitsPerSample = int(si.bits_per_sample);
+        self->m_info.frameCount    = si.total_samples ? qint64(si.total_samples) : -1;
+        self->m_block.resize(int(si.max_blocksize) * int(si.channels));
+    } else if (meta->type == FLAC__METADATA_TYPE_SEEKTABLE) {
+        self->m_hasSeekTable = meta->data.seek_table.num_points > 0;
+    }
+}
+
+void FlacSource::errorCallback(const FLAC__StreamDecoder *,
+                               FLAC__StreamDecoderErrorStatus status, void *client)
+{
+    // 손상된 프레임은 libFLAC 이 건너뛰고 계속 진행한다. 마지막 에러만 기억
+    FlacSource *self = static_cast<FlacSource *>(client);
+    self->m_error = QString::fromLatin1(FLAC__StreamDecoderErrorStatusString[status]);
+}
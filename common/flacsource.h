@@ -0,0 +1,51 @@
+#ifndef FLACSOURCE_H
+#define FLACSOURCE_H
+
+#include "audiosource.h"
+#include <QVector>
+#include <FLAC/stream_decoder.h>
+
+// libFLAC 스트림 디코더 기반 소스.
+// FLAC 블록 하나씩 디코드해서 float 블록 버퍼에 두고 readFloat() 로 넘겨준다.
+// seek() 는 SEEKTABLE 이 있으면 그걸로 근처 프레임을 찾고, 샘플 단위로 맞춘다.
+class FlacSource : public AudioSource
+{
+public:
+    FlacSource();
+    ~FlacSource();
+
+    bool open(const QString &path) override;
+    void close() override;
+    bool isOpen() const override { return m_decoder != nullptr; }
+    QString errorString() const override { return m_error; }
+    const AudioInfo &info() const override { return m_info; }
+
+    qint64  position() const override { return m_pos; }
+    quint64 bytePosition() const override;
+    bool    seek(qint64 frame) override;
+    qint64  readFloat(float *dst, qint64 maxFrames) override;
+
+    bool hasSeekTable() const { return m_hasSeekTable; }
+
+private:
+    static FLAC__StreamDecoderWriteStatus writeCallback(
+            const FLAC__StreamDecoder *dec, const FLAC__Frame *frame,
+            const FLAC__int32 *const buffer[], void *client);
+    static void metadataCallback(const FLAC__StreamDecoder *dec,
+                                 const FLAC__StreamMetadata *meta, void *client);
+    static void errorCallback(const FLAC__StreamDecoder *dec,
+                              FLAC__StreamDecoderErrorStatus status, void *client);
+
+    FLAC__StreamDecoder *m_decoder;
+    AudioInfo      m_info;
+    QVector<float> m_block;        // 마지막으로 디코드한 FLAC 블록 (인터리브)
+    qint64         m_blockFrames;
+    qint64         m_blockPos;     // m_block 안에서 다음에 내보낼 프레임
+    qint64         m_pos;
+    bool           m_hasSeekTable;
+    QString        m_error;
+
+    Q_DISABLE_COPY(FlacSource)
+};
+
+#endif // FLACSOURCE_H
@@ -0,0 +1,335 @@
+#include "jitterbuffer.h"
+#include <cmath>
+#include <string.h>
+
+namespace {
+
+const qint64 kResyncNs      = 20 * 1000000LL;    // 이보다 크면 리샘플로 따라가지 않음
+const double kMaxRatioDev   = 1000e-6;           // 음정 변화 2센트 미만
+const double kKp            = 0.5;               // 1ms 오차 -> 500ppm
+const double kKi            = 0.1;               // 정상 상태 drift 를 적분으로 없앤다
+const double kErrorSmooth   = 0.05;              // pull 마다 오차 평활 계수
+const double kTargetFall    = 1.0 / 256;         // 목표 깊이는 빨리 올리고 천천히 내린다
+const double kDelaySlew     = 2000e-6;           // 지연 변경 속도 (음정 3.5센트)
+const qint64 kMaxDelayNs    = 1000 * 1000000LL;  // 343m
+const int    kDefaultMinMs  = 20;
+const int    kDefaultMaxMs  = 500;
+
+} // namespace
+
+QString JitterBuffer::Stats::toString() const
+{
+    return QString("%1 depth %2 ms (target %3), jitter %4 ms, error %5 ms, ratio %6 ppm, "
+                   "packets %7, late %8, reordered %9, lost %10 frames, concealed %11 frames, "
+                   "underruns %12, overflows %13, resyncs %14, delay %15 ms")
+            .arg(synced ? "synced" : "adaptive")
+            .arg(depthMs, 0, 'f', 1)
+            .arg(targetMs, 0, 'f', 1)
+            .arg(jitterMs, 0, 'f', 2)
+            .arg(errorMs, 0, 'f', 2)
+            .arg(ratioPpm, 0, 'f', 0)
+            .arg(packets)
+            .arg(latePackets)
+            .arg(reordered)
+            .arg(lostFrames)
+            .arg(concealedFrames)
+            .arg(underruns)
+            .arg(overflows)
+            .arg(resyncs)
+            .arg(delayMs, 0, 'f', 3);
+}
+
+JitterBuffer::JitterBuffer()
+    : m_rate(0),
+      m_channels(0),
+      m_capacity(0),
+      m_readFrame(0),
+      m_writeEnd(-1),
+      m_buffering(true),
+      m_playing(false),
+      m_ended(false),
+      m_haveRef(false),
+      m_refFrame(0),
+      m_refPresNs(0),
+      m_haveTransit(false),
+      m_lastTransitNs(0),
+      m_jitterNs(0.0),
+      m_minDepthNs(kDefaultMinMs * 1000000LL),
+      m_maxDepthNs(kDefaultMaxMs * 1000000LL),
+      m_targetNs(double(kDefaultMinMs) * 1e6),
+      m_errorNs(0.0),
+      m_integral(0.0),
+      m_ratio(1.0),
+      m_delayTargetNs(0),
+      m_delayNs(0.0)
+{
+}
+
+void JitterBuffer::setFormat(quint32 sampleRate, int channels)
+{
+    m_rate = sampleRate;
+    m_channels = qBound(1, channels, int(Resampler::MaxChannels));
+    // 최대 목표 깊이의 두 배 + 최대 지연 + 여유 (늦게 재생을 시작해도 넘치지 않게)
+    m_capacity = int(qint64(sampleRate) * (m_maxDepthNs * 2 + kMaxDelayNs) / 1000000000LL)
+            + int(sampleRate / 4);
+    m_ring.fill(0.0f, m_capacity * m_channels);
+    m_valid.fill(0, m_capacity);
+    m_resampler.setChannels(m_channels);
+    reset();
+}
+
+void JitterBuffer::setDepthLimits(int minMs, int maxMs)
+{
+    minMs = qMax(1, minMs);
+    maxMs = qMax(minMs, maxMs);
+    m_minDepthNs = qint64(minMs) * 1000000LL;
+    m_maxDepthNs = qint64(maxMs) * 1000000LL;
+    m_targetNs = qBound(double(m_minDepthNs), m_targetNs, double(m_maxDepthNs));
+    if (m_rate)
+        setFormat(m_rate, m_channels);
+}
+
+void JitterBuffer::reset()
+{
+    m_readFrame = 0;
+    m_writeEnd = -1;
+    m_buffering = true;
+    m_playing = false;
+    m_ended = false;
+    m_haveRef = false;
+    m_haveTransit = false;
+    m_jitterNs = 0.0;
+    m_targetNs = double(m_minDepthNs);
+    m_errorNs = 0.0;
+    m_integral = 0.0;
+    m_ratio = 1.0;
+    m_delayNs = double(m_delayTargetNs);    // 아직 아무것도 안 나갔으므로 바로
+    m_resampler.setRatio(1.0);
+    m_resampler.reset();
+    if (!m_valid.isEmpty())
+        memset(m_valid.data(), 0, size_t(m_valid.size()));
+    m_stats = Stats();
+}
+
+void JitterBuffer::setEnded()
+{
+    m_ended = true;
+}
+
+void JitterBuffer::setDelay(qint64 delayNs)
+{
+    m_delayTargetNs = qBound<qint64>(0, delayNs, kMaxDelayNs);
+    if (!m_playing || m_buffering)
+        m_delayNs = double(m_delayTargetNs);
+}
+
+qint64 JitterBuffer::framesToNs(qint64 frames) const
+{
+    const qint64 s = frames / m_rate;
+    return s * 1000000000LL + (frames - s * m_rate) * 1000000000LL / m_rate;
+}
+
+void JitterBuffer::push(qint64 firstFrame, const qint16 *pcm, int frames,
+                        qint64 arrivalNs, qint64 presentationNs)
+{
+    if (!m_rate || frames <= 0 || firstFrame < 0)
+        return;
+    ++m_stats.packets;
+
+    // RFC 3550 6.4.1: 도착 간격과 미디어 간격 차이의 평활값
+    const qint64 transit = arrivalNs - framesToNs(firstFrame);
+    if (m_haveTransit) {
+        const double d = std::fabs(double(transit - m_lastTransitNs));
+        m_jitterNs += (d - m_jitterNs) / 16.0;
+    }
+    m_lastTransitNs = transit;
+    m_haveTransit = true;
+
+    // 목표 깊이: 패킷 하나 + 지터 4배. 늘 때는 바로, 줄 때는 천천히
+    const double want = qBound(double(m_minDepthNs),
+                               double(framesToNs(frames)) + 4.0 * m_jitterNs,
+                               double(m_maxDepthNs));
+    m_targetNs = want > m_targetNs ? want : m_targetNs + (want - m_targetNs) * kTargetFall;
+
+    if (presentationNs >= 0) {
+        m_haveRef = true;
+        m_refFrame = firstFrame;
+        m_refPresNs = presentationNs;
+    }
+
+    if (m_writeEnd < 0) {
+        m_readFrame = firstFrame;
+        m_writeEnd = firstFrame;
+    }
+    const qint64 end = firstFrame + frames;
+    if (end <= m_readFrame) {
+        ++m_stats.latePackets;
+        return;
+    }
+    qint64 from = firstFrame;
+    if (from < m_readFrame) {       // 앞부분만 늦음
+        ++m_stats.latePackets;
+        from = m_readFrame;
+    }
+    if (end - m_readFrame > m_capacity) {
+        // 출력이 멈춰 있거나 한참 앞선 패킷: 오래된 것을 버린다
+        ++m_stats.overflows;
+        m_readFrame = end - m_capacity;
+        m_resampler.reset();
+        from = qMax(from, m_readFrame);
+    }
+
+    // 건너뛴 구간은 이전 바퀴의 데이터가 남아 있으므로 비운다.
+    // 늦게라도 오면 채워지고, 재생할 때까지 안 오면 그때 손실로 센다
+    if (from < m_writeEnd)
+        ++m_stats.reordered;
+    if (from > m_writeEnd) {
+        for (qint64 f = qMax(m_writeEnd, from - m_capacity); f < from; ++f)
+            m_valid[slot(f)] = 0;
+    }
+
+    const int ch = m_channels;
+    const qint16 *src = pcm + (from - firstFrame) * ch;
+    for (qint64 f = from; f < end; ++f) {
+        const int s = slot(f);
+        float *dst = m_ring.data() + s * ch;
+        for (int c = 0; c < ch; ++c)
+            dst[c] = float(src[c]) * (1.0f / 32768.0f);
+        m_valid[s] = 1;
+        src += ch;
+    }
+    if (end > m_writeEnd)
+        m_writeEnd = end;
+}
+
+void JitterBuffer::fillSilence(float *dst, int frames, bool conceal)
+{
+    if (frames <= 0)
+        return;
+    memset(dst, 0, size_t(frames) * size_t(m_channels) * sizeof(float));
+    if (conceal)
+        m_stats.concealedFrames += quint64(frames);
+}
+
+void JitterBuffer::pull(float *dst, int frames, qint64 playNs)
+{
+    if (frames <= 0)
+        return;
+    if (!m_rate || m_writeEnd < 0) {
+        memset(dst, 0, size_t(frames) * size_t(qMax(1, m_channels)) * sizeof(float));
+        return;
+    }
+    const int ch = m_channels;
+    const bool synced = m_haveRef;
+
+    // 지연 변경은 출력 중이면 시간당 kDelaySlew 만큼만 옮기고, 옮기는 속도만큼
+    // 리샘플 비율을 미리 빼 둔다 (늘리면 느리게 소비). PI 는 drift 만 따라간다
+    double feedForward = 0.0;
+    if (m_buffering) {
+        m_delayNs = double(m_delayTargetNs);
+    } else if (m_delayNs != double(m_delayTargetNs)) {
+        const double span = double(frames) * 1e9 / m_rate;
+        const double step = qBound(-kDelaySlew * span, double(m_delayTargetNs) - m_delayNs,
+                                   kDelaySlew * span);
+        m_delayNs += step;
+        feedForward = -step / span;
+    }
+
+    // 오차 (ns). 양수면 재생을 빨리 해야 한다
+    qint64 depthNs = framesToNs(m_writeEnd - m_readFrame);
+    const qint64 delayNs = qint64(m_delayNs);
+    qint64 err;
+    if (synced)
+        err = playNs - (m_refPresNs + framesToNs(m_readFrame - m_refFrame) + delayNs);
+    else
+        err = depthNs - qint64(m_targetNs) - delayNs;
+
+    if (m_buffering) {
+        if (err < 0 || m_readFrame >= m_writeEnd) {
+            // 처음 채우는 중이 아니라 끊겨서 다시 채우는 중이면 은닉으로 센다
+            fillSilence(dst, frames, m_playing && !m_ended);
+            return;
+        }
+        // 적분항(추정한 drift)은 끊겨도 유지한다
+        m_buffering = false;
+        m_errorNs = 0.0;
+    }
+
+    if (synced && (err > kResyncNs || err < -kResyncNs)) {
+        ++m_stats.resyncs;
+        m_resampler.reset();
+        m_errorNs = 0.0;
+        if (err > 0) {
+            // 늦었다: 재생 시각이 지난 만큼 건너뛴다
+            const qint64 skip = err * m_rate / 1000000000LL;
+            m_readFrame = qMin(m_readFrame + skip, m_writeEnd);
+        } else {
+            // 이르다: 그만큼 무음을 먼저 낸다
+            const int pad = int(qMin<qint64>(frames, -err * m_rate / 1000000000LL));
+            fillSilence(dst, pad, false);
+            dst += pad * ch;
+            frames -= pad;
+        }
+        err = 0;
+        depthNs = framesToNs(m_writeEnd - m_readFrame);
+    }
+
+    const double dt = double(frames) / m_rate;
+    m_errorNs += (double(err) - m_errorNs) * kErrorSmooth;
+    const double e = m_errorNs * 1e-9;
+    m_integral = qBound(-kMaxRatioDev / kKi, m_integral + e * dt, kMaxRatioDev / kKi);
+    m_ratio = 1.0 + qBound(-kMaxRatioDev, kKp * e + kKi * m_integral, kMaxRatioDev) + feedForward;
+    m_resampler.setRatio(m_ratio);
+
+    m_stats.synced = synced;
+    m_stats.depthMs = depthNs / 1e6;
+    m_stats.targetMs = m_targetNs / 1e6;
+    m_stats.jitterMs = m_jitterNs / 1e6;
+    m_stats.errorMs = m_errorNs / 1e6;
+    m_stats.ratioPpm = (m_ratio - 1.0) * 1e6;
+    m_stats.delayMs = m_delayNs / 1e6;
+    m_stats.delayTargetMs = m_delayTargetNs / 1e6;
+
+    if (frames <= 0)
+        return;
+
+    // 리샘플러 입력 모으기 (빠진 프레임은 0)
+    const qint64 avail = m_writeEnd - m_readFrame;
+    const int want = int(qMin<qint64>(avail, qint64(std::ceil(frames * m_ratio)) + 4));
+    if (m_scratch.size() < want * ch)
+        m_scratch.resize(want * ch);
+    float *in = m_scratch.data();
+    for (int i = 0; i < want; ++i) {
+        const int s = slot(m_readFrame + i);
+        if (m_valid[s])
+            memcpy(in + i * ch, m_ring.constData() + s * ch, size_t(ch) * sizeof(float));
+        else
+            memset(in + i * ch, 0, size_t(ch) * sizeof(float));
+    }
+
+    qint64 used = 0, made = 0;
+    m_resampler.process(in, want, &used, dst, frames, &made);
+    for (qint64 f = m_readFrame; f < m_readFrame + used; ++f) {
+        if (!m_valid[slot(f)]) {
+            ++m_stats.lostFrames;          // 실제로 소비한 빈 프레임만
+            ++m_stats.concealedFrames;
+        }
+    }
+    m_readFrame += used;
+    if (made > 0)
+        m_playing = true;
+
+    if (made < frames) {
+        // 버퍼가 비었다. 끝난 스트림이면 정상, 아니면 다시 채울 때까지 기다린다
+        const bool drained = m_ended;
+        fillSilence(dst + made * ch, int(frames - made), !drained);
+        if (!drained)
+            ++m_stats.underruns;
+        m_buffering = true;
+    }
+}
+
+JitterBuffer::Stats JitterBuffer::stats() const
+{
+    return m_stats;
+}
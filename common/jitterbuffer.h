@@ -0,0 +1,109 @@
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include "resampler.h"
+
+// 네트워크 수신용 지터 버퍼. 패킷은 미디어 프레임 번호 위치에 바로 쓰고
+// (순서가 바뀌거나 빠진 패킷도 처리), 출력 장치는 pull() 로 꺼내 간다.
+//
+// 두 가지 기준으로 재생 속도를 맞춘다.
+//  - 동기 모드: 패킷에 (로컬 시계로 바꾼) 재생 시각이 있으면, 지금 내보낼
+//    프레임의 재생 시각과 실제 출력 시각의 차이를 0 으로 만든다 (여러 방 동기).
+//  - 적응 모드: 재생 시각이 없으면, 버퍼 깊이를 측정된 지터에 맞춘 목표 깊이로.
+// 오차는 PI 제어로 리샘플 비율을 최대 +-1000ppm 만 움직여 따라간다.
+// 샘플을 버리거나 복제하지 않으므로 송신 측 시계 drift 가 들리지 않는다.
+// 오차가 너무 크면 (시작, 긴 끊김) 한 번에 건너뛰거나 기다린다.
+//
+// setDelay() 는 재생 시각 (적응 모드면 목표 깊이) 에 더할 지연이다 (스피커 거리 보정).
+// 재생 중에 바꾸면 한 번에 옮기지 않고 리샘플 비율로 천천히 따라가므로
+// (최대 2000ppm, 1ms 옮기는 데 0.5초) 건너뛰거나 다시 버퍼링하지 않는다.
+class JitterBuffer
+{
+public:
+    struct Stats {
+        double  depthMs = 0;          // 지금 쌓여 있는 양
+        double  targetMs = 0;         // 적응 모드 목표 깊이
+        double  jitterMs = 0;         // 도착 지터 (RFC 3550 방식)
+        double  errorMs = 0;          // 제어 오차 (동기: 늦은 정도, 적응: 깊이 - 목표)
+        double  ratioPpm = 0;         // 리샘플 비율 - 1
+        double  delayMs = 0;          // 지금 적용 중인 지연 (목표로 옮겨 가는 중일 수 있음)
+        double  delayTargetMs = 0;
+        bool    synced = false;       // 재생 시각 기준으로 맞추는 중
+        quint64 packets = 0;
+        quint64 latePackets = 0;      // 이미 재생 위치를 지나서 도착
+        quint64 reordered = 0;        // 앞선 패킷보다 늦게 왔지만 제때 도착
+        quint64 lostFrames = 0;       // 재생할 때까지 오지 않은 프레임
+        quint64 concealedFrames = 0;  // 데이터 없이 채운 출력 (손실 + 끊김)
+        quint64 underruns = 0;
+        quint64 overflows = 0;
+        quint64 resyncs = 0;
+
+        QString toString() const;
+    };
+
+    JitterBuffer();
+
+    void setFormat(quint32 sampleRate, int channels);   // 버퍼를 비운다
+    void setDepthLimits(int minMs, int maxMs);          // 적응 목표 범위, 기본 20..500
+    void reset();
+    void setEnded();        // 서버가 보낼 것이 끝남: 남은 것 재생 후 무음 (손실 아님)
+    void setDelay(qint64 delayNs);    // 0..1초, reset() 후에도 유지
+    qint64 delay() const { return m_delayTargetNs; }
+
+    quint32 sampleRate() const { return m_rate; }
+    int     channels() const { return m_channels; }
+
+    // arrivalNs 는 로컬 도착 시각, presentationNs 는 로컬 시계의 재생 시각 (모르면 -1)
+    void push(qint64 firstFrame, const qint16 *pcm, int frames,
+              qint64 arrivalNs, qint64 presentationNs);
+    // dst 의 첫 프레임이 스피커에서 나오는 로컬 시각이 playNs
+    void pull(float *dst, int frames, qint64 playNs);
+
+    Stats stats() const;
+
+private:
+    qint64 framesToNs(qint64 frames) const;
+    int    slot(qint64 frame) const { return int(frame % m_capacity); }
+    void   fillSilence(float *dst, int frames, bool conceal);
+
+    quint32 m_rate;
+    int     m_channels;
+    int     m_capacity;               // 링 크기 (프레임)
+    QVector<float>  m_ring;
+    QVector<quint8> m_valid;          // 프레임별 수신 여부
+    QVector<float>  m_scratch;        // 리샘플러 입력
+    Resampler m_resampler;
+
+    qint64  m_readFrame;              // 다음에 리샘플러로 넣을 프레임
+    qint64  m_writeEnd;               // 받은 가장 뒤 프레임 + 1, 아직 없으면 -1
+    bool    m_buffering;              // 재생 전 또는 끊긴 뒤 채우는 중
+    bool    m_playing;                // reset 이후 한 번이라도 출력함
+    bool    m_ended;
+
+    bool    m_haveRef;                // 재생 시각 기준점 (가장 최근 패킷)
+    qint64  m_refFrame;
+    qint64  m_refPresNs;
+
+    bool    m_haveTransit;
+    qint64  m_lastTransitNs;
+    double  m_jitterNs;
+    qint64  m_minDepthNs;
+    qint64  m_maxDepthNs;
+    double  m_targetNs;
+
+    double  m_errorNs;                // 평활한 제어 오차
+    double  m_integral;               // 초 * 초
+    double  m_ratio;
+
+    qint64  m_delayTargetNs;
+    double  m_delayNs;                // 적용 중인 지연 (목표로 slew)
+
+    Stats   m_stats;
+
+    Q_DISABLE_COPY(JitterBuffer)
+};
+
+#endif // JITTERBUFFER_H
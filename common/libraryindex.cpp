@@ -0,0 +1,524 @@
+#include "libraryindex.h"
+#include "audiosource.h"
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QWaitCondition>
+#include <algorithm>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+namespace {
+
+const quint32 kMagic   = 0x57534c49;   // "WSLI"
+const quint32 kVersion = 1;
+
+// QDataStream 으로 쓴 레코드 하나의 최소 크기 (문자열이 모두 비었을 때).
+// 파일에 적힌 개수를 믿고 reserve 하지 않도록 파일 크기로 상한을 건다
+const qint64 kMinDirBytes   = 4 + 8 + 8 + 4 + 4;
+const qint64 kMinEntryBytes = 4 + 8 + 8 + 4 + 4 + 4 + 4 + 8;
+
+inline qint64 mtimeNs(const struct stat &st)
+{
+    return qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+inline qint64 wallClockNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+void LibraryIndex::setRoot(const QString &root)
+{
+    if (root != m_root) {
+        clear();
+        m_root = root;
+    }
+}
+
+void LibraryIndex::clear()
+{
+    m_root.clear();
+    m_entries.clear();
+    m_lookup.clear();
+    m_dirs.clear();
+}
+
+const LibraryEntry *LibraryIndex::find(const QString &path) const
+{
+    const QHash<QString, int>::const_iterator it = m_lookup.constFind(path);
+    return it == m_lookup.constEnd() ? nullptr : &m_entries.at(it.value());
+}
+
+int LibraryIndex::indexOf(const QString &path) const
+{
+    return m_lookup.value(path, -1);
+}
+
+void LibraryIndex::setMetadata(int i, const AudioInfo &info)
+{
+    LibraryEntry &e = m_entries[i];
+    e.codec = info.codec;
+    e.sampleRate = info.sampleRate;
+    e.channels = info.channels;
+    e.bitsPerSample = info.bitsPerSample;
+    e.frameCount = info.frameCount;
+}
+
+// 둘 다 경로 순이라 한 번씩만 훑는다
+void LibraryIndex::mergeMetadata(const LibraryIndex &from)
+{
+    const QVector<LibraryEntry> &other = from.m_entries;
+    int j = 0;
+    for (int i = 0; i < m_entries.size() && j < other.size(); ++i) {
+        if (!m_entries.at(i).codec.isEmpty())
+            continue;
+        while (j < other.size() && other.at(j).path < m_entries.at(i).path)
+            ++j;
+        if (j == other.size())
+            break;
+        const LibraryEntry &o = other.at(j);
+        if (o.codec.isEmpty() || o.path != m_entries.at(i).path)
+            continue;
+        LibraryEntry &e = m_entries[i];
+        if (o.size == e.size && o.mtimeNs == e.mtimeNs) {
+            e.codec = o.codec;
+            e.sampleRate = o.sampleRate;
+            e.channels = o.channels;
+            e.bitsPerSample = o.bitsPerSample;
+            e.frameCount = o.frameCount;
+        }
+    }
+}
+
+bool LibraryIndex::isAudioFile(const QString &name)
+{
+    const int dot = name.lastIndexOf('.');
+    if (dot < 0)
+        return false;
+    const QString ext = name.mid(dot + 1).toLower();
+    return ext == "wav" || ext == "flac" || ext == "ogg" || ext == "oga" || ext == "opus";
+}
+
+QString LibraryIndex::defaultPath()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (dir.isEmpty())
+        dir = QDir::tempPath();
+    return dir + "/library.index";
+}
+
+bool LibraryIndex::load(const QString &file, QString *error)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = f.errorString();
+        return false;
+    }
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion) {
+        if (error)
+            *error = QString("%1: not a library index (or an old version)").arg(file);
+        return false;
+    }
+
+    LibraryIndex index;
+    quint32 dirs, entries;
+    in >> index.m_root >> dirs;
+    index.m_dirs.reserve(int(qMin<qint64>(dirs, f.size() / kMinDirBytes)));
+    for (quint32 i = 0; i < dirs && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Directory d;
+        in >> path >> d.mtimeNs >> d.scannedNs >> d.subdirs >> d.files;
+        index.m_dirs.insert(path, d);
+    }
+    in >> entries;
+    if (in.status() == QDataStream::Ok)
+        index.m_entries.reserve(int(qMin<qint64>(entries, f.size() / kMinEntryBytes)));
+    for (quint32 i = 0; i < entries && in.status() == QDataStream::Ok; ++i) {
+        LibraryEntry e;
+        qint32 channels, bits;
+        in >> e.path >> e.size >> e.mtimeNs >> e.codec >> e.sampleRate >> channels >> bits
+           >> e.frameCount;
+        e.channels = channels;
+        e.bitsPerSample = bits;
+        index.m_entries.append(e);
+    }
+    if (in.status() != QDataStream::Ok) {
+        if (error)
+            *error = QString("%1: truncated").arg(file);
+        return false;
+    }
+    index.m_lookup.reserve(index.m_entries.size());
+    for (int i = 0; i < index.m_entries.size(); ++i)
+        index.m_lookup.insert(index.m_entries.at(i).path, i);
+    *this = index;
+    return true;
+}
+
+bool LibraryIndex::save(const QString &file, QString *error) const
+{
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    QSaveFile f(file);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = f.errorString();
+        return false;
+    }
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << kMagic << kVersion << m_root << quint32(m_dirs.size());
+    for (QHash<QString, Directory>::const_iterator it = m_dirs.constBegin();
+         it != m_dirs.constEnd(); ++it) {
+        const Directory &d = it.value();
+        out << it.key() << d.mtimeNs << d.scannedNs << d.subdirs << d.files;
+    }
+    out << quint32(m_entries.size());
+    for (const LibraryEntry &e : m_entries) {
+        out << e.path << e.size << e.mtimeNs << e.codec << e.sampleRate
+            << qint32(e.channels) << qint32(e.bitsPerSample) << e.frameCount;
+    }
+    if (!f.commit()) {
+        if (error)
+            *error = f.errorString();
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+
+QString LibraryScanner::Stats::toString() const
+{
+    return QString("%1 ms, dirs %2 read / %3 unchanged, files %4 checked / %5 probed, "
+                   "+%6 ~%7 -%8, errors %9")
+            .arg(elapsedMs).arg(dirsRead).arg(dirsReused).arg(filesChecked).arg(filesProbed)
+            .arg(added).arg(changed).arg(removed).arg(errors);
+}
+
+// 스캔 한 번 동안 작업 스레드가 같이 쓰는 상태 (mutex 로 보호)
+struct LibraryScanner::Work
+{
+    const LibraryIndex *previous = nullptr;
+    qint64  startNs = 0;
+    qint64  settleNs = 0;
+    const QSet<QString> *dirty = nullptr;
+
+    QMutex  mutex;
+    QWaitCondition wake;
+    QStringList queue;                  // 읽을 디렉터리
+    int     busy = 0;                   // 디렉터리를 읽고 있는 스레드 수
+    QVector<LibraryEntry> entries;
+    QHash<QString, LibraryIndex::Directory> dirs;
+    Stats   stats;
+};
+
+class ScanWorker : public QThread
+{
+public:
+    ScanWorker(LibraryScanner *scanner, LibraryScanner::Work *work)
+        : m_scanner(scanner), m_work(work) {}
+
+protected:
+    void run() override { m_scanner->work(m_work); }
+
+private:
+    LibraryScanner *m_scanner;
+    LibraryScanner::Work *m_work;
+};
+
+LibraryScanner::LibraryScanner(QObject *parent)
+    : QThread(parent),
+      m_threads(8),
+      m_settleSeconds(120),
+      m_probeFiles(true)
+{
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    cancel();
+    wait();
+}
+
+void LibraryScanner::setThreads(int n)
+{
+    m_threads = qBound(1, n, 64);
+}
+
+void LibraryScanner::setSettleSeconds(int sec)
+{
+    m_settleSeconds = qMax(0, sec);
+}
+
+void LibraryScanner::setProbeFiles(bool probe)
+{
+    m_probeFiles = probe;
+}
+
+void LibraryScanner::setIndexFile(const QString &file)
+{
+    QMutexLocker lock(&m_mutex);
+    m_indexFile = file;
+}
+
+bool LibraryScanner::scan(const QString &root, const LibraryIndex &previous,
+                          const QStringList &dirty)
+{
+    if (isRunning())
+        return false;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_root = QDir(root).absolutePath();
+        m_dirty = QSet<QString>(dirty.begin(), dirty.end());
+        m_saveError.clear();
+        m_previous = previous;
+        m_previous.setRoot(m_root);
+        m_result = m_previous;
+        m_stats = Stats();
+    }
+    m_cancel.store(0);
+    start(QThread::LowPriority);
+    return true;
+}
+
+void LibraryScanner::cancel()
+{
+    m_cancel.store(1);
+}
+
+LibraryIndex LibraryScanner::result() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_result;
+}
+
+LibraryScanner::Stats LibraryScanner::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
+
+QString LibraryScanner::saveError() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_saveError;
+}
+
+void LibraryScanner::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+    Work w;
+    w.previous = &m_previous;
+    w.startNs = wallClockNs();
+    w.settleNs = qint64(m_settleSeconds) * 1000000000LL;
+    w.dirty = &m_dirty;
+    w.queue.append(m_root);
+    w.entries.reserve(m_previous.size());
+
+    QList<ScanWorker *> workers;
+    for (int i = 1; i < m_threads; ++i) {
+        ScanWorker *t = new ScanWorker(this, &w);
+        t->start();
+        workers.append(t);
+    }
+    work(&w);
+    for (ScanWorker *t : workers) {
+        t->wait();
+        delete t;
+    }
+    if (m_cancel.load())
+        return;
+
+    LibraryIndex index;
+    index.m_root = m_root;
+    index.m_dirs.swap(w.dirs);
+    std::sort(w.entries.begin(), w.entries.end(),
+              [](const LibraryEntry &a, const LibraryEntry &b) { return a.path < b.path; });
+    index.m_entries.swap(w.entries);
+    index.m_lookup.reserve(index.m_entries.size());
+    for (int i = 0; i < index.m_entries.size(); ++i)
+        index.m_lookup.insert(index.m_entries.at(i).path, i);
+
+    w.stats.removed = m_previous.size() - (index.size() - w.stats.added);
+    w.stats.elapsedMs = timer.elapsed();
+
+    QString indexFile, saveError;
+    {
+        QMutexLocker lock(&m_mutex);
+        indexFile = m_indexFile;
+    }
+    if (!indexFile.isEmpty())
+        index.save(indexFile, &saveError);
+    QMutexLocker lock(&m_mutex);
+    m_result = index;
+    m_stats = w.stats;
+    m_saveError = saveError;
+}
+
+// 큐에서 디렉터리를 하나씩 가져가 읽는다. 큐가 비고 읽는 스레드도 없으면 끝
+void LibraryScanner::work(Work *w)
+{
+    for (;;) {
+        QString dir;
+        {
+            QMutexLocker lock(&w->mutex);
+            while (w->queue.isEmpty() && w->busy > 0)
+                w->wake.wait(&w->mutex);
+            if (w->queue.isEmpty() || m_cancel.load()) {
+                w->wake.wakeAll();
+                return;
+            }
+            dir = w->queue.takeLast();      // 깊이 우선: 큐가 커지지 않게
+            ++w->busy;
+        }
+        scanDirectory(w, dir);
+        QMutexLocker lock(&w->mutex);
+        --w->busy;
+        w->wake.wakeAll();
+    }
+}
+
+void LibraryScanner::scanDirectory(Work *w, const QString &dir)
+{
+    const LibraryIndex &previous = *w->previous;
+    LibraryIndex::Directory d;
+    QVector<LibraryEntry> entries;
+    Stats stats;
+
+    // 지난번에 읽을 때 이미 자리 잡은 (settle 이 지난) 상태면 믿는다
+    const QHash<QString, LibraryIndex::Directory>::const_iterator old = previous.m_dirs.constFind(dir);
+    const bool known = old != previous.m_dirs.constEnd();
+    struct stat st;
+    const QByteArray dirName = QFile::encodeName(dir);
+    DIR *dp = nullptr;
+    bool trusted = false;
+    int err = 0;
+    if (::stat(dirName.constData(), &st) != 0)
+        err = errno;
+    else if (!S_ISDIR(st.st_mode))
+        err = ENOTDIR;
+    if (!err) {
+        d.mtimeNs = mtimeNs(st);
+        d.scannedNs = w->startNs;
+        trusted = known && old->mtimeNs == d.mtimeNs && d.mtimeNs < old->scannedNs - w->settleNs
+                && !w->dirty->contains(dir);
+        if (!trusted && !(dp = opendir(dirName.constData())))
+            err = errno;
+    }
+    const bool failed = err != 0;
+    if (failed) {
+        const bool gone = err == ENOENT || err == ENOTDIR;
+        if (gone || !known) {
+            QMutexLocker lock(&w->mutex);
+            if (!gone)
+                ++w->stats.errors;
+            return;
+        }
+        // 잠깐 못 읽는 것 (NFS 타임아웃 등): 지난 목록을 그대로 둔다
+        ++stats.errors;
+        d = *old;
+        trusted = true;
+    } else if (trusted) {
+        ++stats.dirsReused;
+        d.subdirs = old->subdirs;
+        d.files = old->files;
+    } else {
+        ++stats.dirsRead;
+        while (dirent *de = readdir(dp)) {
+            if (de->d_name[0] == '.')
+                continue;
+            const QString name = QFile::decodeName(de->d_name);
+            bool isDir = de->d_type == DT_DIR;
+            bool isFile = de->d_type == DT_REG;
+            if (de->d_type == DT_UNKNOWN || de->d_type == DT_LNK) {
+                // 링크된 디렉터리는 따라가지 않는다 (순환 방지). 링크된 파일은 따라감
+                struct stat lst;
+                if (fstatat(dirfd(dp), de->d_name, &lst, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                isDir = S_ISDIR(lst.st_mode);
+                isFile = S_ISREG(lst.st_mode) || S_ISLNK(lst.st_mode);
+            }
+            if (isDir)
+                d.subdirs.append(name);
+            else if (isFile && LibraryIndex::isAudioFile(name))
+                d.files.append(name);
+        }
+        closedir(dp);
+    }
+
+    // 못 읽은 디렉터리면 파일도 그대로, 아니면 settle 전에 바뀐 파일만 다시 본다
+    const qint64 settledNs = failed ? Q_INT64_C(0x7fffffffffffffff)
+                                    : known ? old->scannedNs - w->settleNs : 0;
+    for (const QString &name : d.files) {
+        if (m_cancel.load())
+            return;
+        const QString path = dir + '/' + name;
+        const LibraryEntry *prev = previous.find(path);
+        if (trusted && prev && prev->mtimeNs < settledNs) {
+            entries.append(*prev);
+            continue;
+        }
+        if (::stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;                       // 그 사이에 지워짐
+        ++stats.filesChecked;
+        if (prev && prev->size == qint64(st.st_size) && prev->mtimeNs == mtimeNs(st)) {
+            entries.append(*prev);
+            continue;
+        }
+        LibraryEntry e;
+        e.path = path;
+        e.size = qint64(st.st_size);
+        e.mtimeNs = mtimeNs(st);
+        if (m_probeFiles) {
+            AudioInfo info;
+            ++stats.filesProbed;
+            if (probeAudioFile(path, &info)) {
+                e.codec = info.codec;
+                e.sampleRate = info.sampleRate;
+                e.channels = info.channels;
+                e.bitsPerSample = info.bitsPerSample;
+                e.frameCount = info.frameCount;
+            } else {
+                ++stats.errors;
+            }
+        }
+        if (prev)
+            ++stats.changed;
+        else
+            ++stats.added;
+        entries.append(e);
+    }
+
+    QMutexLocker lock(&w->mutex);
+    w->entries += entries;
+    for (const QString &name : d.subdirs)
+        w->queue.append(dir + '/' + name);
+    w->dirs.insert(dir, d);
+    w->stats.dirsRead += stats.dirsRead;
+    w->stats.dirsReused += stats.dirsReused;
+    w->stats.filesChecked += stats.filesChecked;
+    w->stats.filesProbed += stats.filesProbed;
+    w->stats.added += stats.added;
+    w->stats.changed += stats.changed;
+    w->stats.errors += stats.errors;
+}
@@ -0,0 +1,146 @@
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+struct AudioInfo;
+
+// 라이브러리의 파일 하나 (stat 과 헤더에서 읽은 정보)
+struct LibraryEntry
+{
+    QString path;                // 절대 경로
+    qint64  size = 0;
+    qint64  mtimeNs = 0;
+    QString codec;               // 비면 헤더를 못 읽은 파일 (목록에는 그대로 보인다)
+    quint32 sampleRate = 0;
+    int     channels = 0;
+    int     bitsPerSample = 0;
+    qint64  frameCount = -1;
+
+    double durationSeconds() const
+    { return (sampleRate && frameCount > 0) ? double(frameCount) / sampleRate : 0.0; }
+};
+
+// 라이브러리 디렉터리 (하위 포함) 의 오디오 파일 색인. 파일로 저장해 두고 다음
+// 시작 때 그대로 읽으므로 NFS 를 다시 훑기 전에 목록이 바로 뜬다.
+// 다시 훑는 일은 LibraryScanner 가 한다.
+class LibraryIndex
+{
+public:
+    struct Directory {
+        qint64      mtimeNs = 0;
+        qint64      scannedNs = 0;   // 이 디렉터리를 읽은 스캔의 시작 시각 (벽시계)
+        QStringList subdirs;         // 이름만
+        QStringList files;           // 오디오 파일 이름만
+    };
+
+    QString root() const { return m_root; }
+    void setRoot(const QString &root);          // 지금과 다르면 비운다
+    void clear();
+
+    const QVector<LibraryEntry> &entries() const { return m_entries; }   // 경로 순
+    int size() const { return m_entries.size(); }
+    QStringList directories() const { return m_dirs.keys(); }    // 읽은 디렉터리 (절대 경로)
+    const LibraryEntry *find(const QString &path) const;
+    int indexOf(const QString &path) const;     // 없으면 -1
+    void setMetadata(int i, const AudioInfo &info);   // 나중에 읽은 헤더 정보
+    // 헤더 정보가 없는 항목은 from 에서 같은 파일 (경로, 크기, mtime) 의 것을 가져온다
+    void mergeMetadata(const LibraryIndex &from);
+
+    bool load(const QString &file, QString *error = nullptr);
+    bool save(const QString &file, QString *error = nullptr) const;    // 원자적으로 바꿔 쓴다
+
+    static bool isAudioFile(const QString &name);
+    static QString defaultPath();               // 캐시 디렉터리의 library.index
+
+private:
+    friend class LibraryScanner;
+
+    QString m_root;
+    QVector<LibraryEntry> m_entries;
+    QHash<QString, int> m_lookup;               // 경로 -> m_entries 위치
+    QHash<QString, Directory> m_dirs;           // 절대 경로 -> 마지막으로 읽은 상태
+};
+
+// 라이브러리를 여러 스레드로 다시 훑는다. 일은 디렉터리 단위로 나눠 NFS 왕복
+// 지연 (readdir / stat / 헤더 읽기) 을 겹친다. 이전 색인과 비교해
+//  - 디렉터리 mtime 이 그대로면 readdir 없이 이전 이름 목록을 쓰고
+//    파일도 stat 하지 않는다
+//  - 파일 크기와 mtime 이 그대로면 헤더를 다시 읽지 않는다.
+// 파일 내용만 바뀌면 디렉터리 mtime 은 그대로라 (녹음 중인 파일), 읽을 때 막
+// 바뀐 (settleSeconds 안) 디렉터리와 파일은 다음 스캔에서도 다시 본다.
+class LibraryScanner : public QThread
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        int    dirsRead = 0;         // readdir 한 디렉터리
+        int    dirsReused = 0;       // mtime 이 같아 이전 목록을 쓴 디렉터리
+        int    filesChecked = 0;     // stat 한 파일
+        int    filesProbed = 0;      // 헤더를 (다시) 읽은 파일
+        int    added = 0;
+        int    changed = 0;
+        int    removed = 0;
+        int    errors = 0;           // 못 연 디렉터리, 헤더를 못 읽은 파일
+        qint64 elapsedMs = 0;
+
+        bool modified() const { return added || changed || removed; }
+        QString toString() const;
+    };
+
+    explicit LibraryScanner(QObject *parent = nullptr);
+    ~LibraryScanner();
+
+    void setThreads(int n);          // 기본 8 (NFS 는 CPU 보다 왕복 지연이 병목)
+    void setSettleSeconds(int sec);  // 기본 120
+    // false 면 새 파일은 stat 만 하고 헤더는 읽지 않는다 (필요할 때 따로 읽는 경우)
+    void setProbeFiles(bool probe);  // 기본 true
+
+    // 끝나면 결과를 이 파일에 저장한다 (큰 색인을 GUI 스레드에서 쓰지 않게). 기본은 안 함
+    void setIndexFile(const QString &file);
+
+    // previous 를 기준으로 root 를 다시 훑기 시작한다. 이미 돌고 있으면 false.
+    // dirty 의 디렉터리는 mtime 이 그대로여도 다시 읽는다 (감시로 바뀐 줄 아는 곳).
+    // 끝나면 QThread::finished() 뒤에 result() 로 가져간다
+    bool scan(const QString &root, const LibraryIndex &previous,
+              const QStringList &dirty = QStringList());
+    void cancel();                   // 취소하면 result() 는 previous 그대로
+
+    LibraryIndex result() const;
+    Stats stats() const;
+    QString saveError() const;       // setIndexFile 에 저장하지 못했으면 이유
+
+protected:
+    void run() override;
+
+private:
+    struct Work;
+    friend class ScanWorker;
+
+    void work(Work *w);
+    void scanDirectory(Work *w, const QString &dir);
+
+    mutable QMutex m_mutex;
+    QString      m_root;
+    QString      m_indexFile;
+    QString      m_saveError;
+    QSet<QString> m_dirty;
+    LibraryIndex m_previous;
+    LibraryIndex m_result;
+    Stats        m_stats;
+    int          m_threads;
+    int          m_settleSeconds;
+    bool         m_probeFiles;
+    QAtomicInt   m_cancel;
+
+    Q_DISABLE_COPY(LibraryScanner)
+};
+
+#endif // LIBRARYINDEX_H
@@ -0,0 +1,213 @@
+#include "librarywatcher.h"
+#include "libraryindex.h"
+#include <QFile>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+
+namespace {
+
+const int kMaxDelayMs = 2000;       // 이벤트가 이어져도 이만큼 안에는 알림
+
+// 파일이 들고 나는 것만 (IN_MODIFY 는 녹음 중에 쏟아지므로 닫힐 때만 본다)
+const uint32_t kMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+                     | IN_ONLYDIR | IN_DONT_FOLLOW;
+
+// 다른 호스트에서 바꾼 것은 inotify 로 오지 않는 파일 시스템
+bool isRemoteFs(const QString &path)
+{
+    struct statfs fs;
+    if (statfs(QFile::encodeName(path).constData(), &fs) != 0)
+        return false;
+    switch (quint32(fs.f_type)) {
+    case 0x6969u:           // NFS
+    case 0x517bu:           // SMB
+    case 0xff534d42u:       // CIFS
+    case 0xfe534d42u:       // SMB2
+    case 0x65735546u:       // FUSE (sshfs 등)
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+LibraryWatcher::LibraryWatcher(QObject *parent)
+    : QObject(parent),
+      m_mode(Off),
+      m_fd(-1),
+      m_pollSeconds(10),
+      m_delayMs(500),
+      m_notifier(nullptr),
+      m_timer(new QTimer(this))
+{
+    connect(m_timer, &QTimer::timeout, this, &LibraryWatcher::onTimer);
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    stop();
+}
+
+void LibraryWatcher::setPollSeconds(int sec)
+{
+    m_pollSeconds = qMax(1, sec);
+}
+
+void LibraryWatcher::setDelayMs(int ms)
+{
+    m_delayMs = qBound(0, ms, kMaxDelayMs);
+}
+
+LibraryWatcher::Mode LibraryWatcher::start(const QString &root, const LibraryIndex &index)
+{
+    stop();
+    m_root = root;
+    m_pollReason.clear();
+    if (isRemoteFs(root)) {
+        startPolling("network file system");
+        return m_mode;
+    }
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        startPolling(QString("inotify: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return m_mode;
+    }
+    m_mode = Inotify;
+    m_timer->setSingleShot(true);
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadable()));
+    // 색인이 비어 있어도 (처음) 루트는 본다
+    if (addWatch(root))
+        update(index);
+    return m_mode;
+}
+
+void LibraryWatcher::stop()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+    m_dirs.clear();
+    m_watches.clear();
+    m_dirty.clear();
+    m_firstDirty.invalidate();
+    m_timer->stop();
+    m_mode = Off;
+}
+
+void LibraryWatcher::update(const LibraryIndex &index)
+{
+    if (m_mode != Inotify)
+        return;
+    const QStringList dirs = index.directories();
+    for (const QString &dir : dirs) {
+        if (!m_watches.contains(dir) && !addWatch(dir))
+            return;
+    }
+}
+
+QStringList LibraryWatcher::takeDirty()
+{
+    const QStringList out(m_dirty.begin(), m_dirty.end());
+    m_dirty.clear();
+    return out;
+}
+
+// 한도에 걸리면 false (폴링으로 바뀜). 그 사이에 지워진 디렉터리는 스캔이 알아서 뺀다
+bool LibraryWatcher::addWatch(const QString &dir)
+{
+    const int wd = inotify_add_watch(m_fd, QFile::encodeName(dir).constData(), kMask);
+    if (wd < 0) {
+        if (errno == ENOSPC || errno == ENOMEM) {
+            startPolling("inotify watch limit reached (fs.inotify.max_user_watches)");
+            return false;
+        }
+        return true;
+    }
+    m_dirs.insert(wd, dir);
+    m_watches.insert(dir, wd);
+    return true;
+}
+
+void LibraryWatcher::startPolling(const QString &why)
+{
+    const QString root = m_root;
+    stop();
+    m_root = root;
+    m_pollReason = why;
+    m_mode = Polling;
+    m_timer->setSingleShot(false);
+    m_timer->start(m_pollSeconds * 1000);
+}
+
+void LibraryWatcher::markDirty(const QString &dir)
+{
+    m_dirty.insert(dir);
+    if (!m_firstDirty.isValid())
+        m_firstDirty.start();
+    const int left = int(qMax<qint64>(0, kMaxDelayMs - m_firstDirty.elapsed()));
+    m_timer->start(qMin(m_delayMs, left));
+}
+
+void LibraryWatcher::onReadable()
+{
+    alignas(struct inotify_event) char buf[16384];
+    while (m_mode == Inotify) {
+        const ssize_t n = ::read(m_fd, buf, sizeof buf);
+        if (n <= 0)
+            return;
+        for (const char *p = buf; p < buf + n && m_mode == Inotify;) {
+            const struct inotify_event *ev = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // 놓친 이벤트가 있다: 보고 있는 곳을 전부 다시 읽는다
+                for (const QString &dir : m_dirs)
+                    markDirty(dir);
+                continue;
+            }
+            const QString dir = m_dirs.value(ev->wd);
+            if (dir.isEmpty())
+                continue;
+            if (ev->mask & IN_IGNORED) {        // 지워진 디렉터리
+                m_dirs.remove(ev->wd);
+                if (m_watches.value(dir) == ev->wd)
+                    m_watches.remove(dir);
+                continue;
+            }
+            const QString name = ev->len ? QFile::decodeName(ev->name) : QString();
+            if (ev->mask & IN_ISDIR) {
+                const QString sub = dir + '/' + name;
+                // 옮겨 간 디렉터리의 감시는 옛 경로를 달고 있으므로 떼고 새 경로로 다시 건다
+                if (ev->mask & IN_MOVED_FROM) {
+                    const int wd = m_watches.take(sub);
+                    if (wd) {
+                        m_dirs.remove(wd);
+                        inotify_rm_watch(m_fd, wd);
+                    }
+                }
+                // 스캔이 읽기 전에 감시를 걸어야 그 안에 바로 생긴 파일을 놓치지 않는다
+                if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && !addWatch(sub))
+                    return;
+                markDirty(dir);
+            } else if (LibraryIndex::isAudioFile(name)) {
+                markDirty(dir);
+            }
+        }
+    }
+}
+
+void LibraryWatcher::onTimer()
+{
+    if (m_mode == Inotify)
+        m_firstDirty.invalidate();
+    emit changed();
+}
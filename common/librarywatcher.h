@@ -0,0 +1,71 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+
+class QSocketNotifier;
+class QTimer;
+class LibraryIndex;
+
+// 라이브러리 디렉터리가 바뀌면 알려 준다. 로컬 파일 시스템은 디렉터리마다 inotify
+// 로 보고, NFS / SMB 처럼 다른 호스트의 변경이 inotify 로 오지 않는 곳이나 감시
+// 수 한도 (max_user_watches) 에 걸리면 pollSeconds 마다 알리는 것으로 바꾼다.
+// 이벤트는 delayMs 동안 모아서 한 번 알린다 (녹음 중인 파일이 계속 써도 2초
+// 안에는 알림). 어디가 바뀌었는지는 takeDirty() 로 가져가 LibraryScanner::scan 에 준다.
+// 호출한 스레드의 이벤트 루프에서 돈다.
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode { Off, Inotify, Polling };
+
+    explicit LibraryWatcher(QObject *parent = nullptr);
+    ~LibraryWatcher();
+
+    void setPollSeconds(int sec);    // 기본 10
+    void setDelayMs(int ms);         // 기본 500
+
+    // index 의 디렉터리들을 보기 시작한다
+    Mode start(const QString &root, const LibraryIndex &index);
+    void stop();
+    void update(const LibraryIndex &index);   // 스캔 뒤: 새 디렉터리도 본다
+    Mode mode() const { return m_mode; }
+    QString pollReason() const { return m_pollReason; }   // 폴링으로 바꾼 이유
+    int watchCount() const { return m_dirs.size(); }
+
+    QStringList takeDirty();         // 폴링이면 비어 있다 (전체를 mtime 으로 본다)
+
+signals:
+    void changed();
+
+private slots:
+    void onReadable();
+    void onTimer();
+
+private:
+    bool addWatch(const QString &dir);
+    void startPolling(const QString &why);
+    void markDirty(const QString &dir);
+
+    Mode    m_mode;
+    QString m_root;
+    QString m_pollReason;
+    int     m_fd;
+    int     m_pollSeconds;
+    int     m_delayMs;
+    QSocketNotifier *m_notifier;
+    QTimer *m_timer;
+    QHash<int, QString> m_dirs;      // watch descriptor -> 디렉터리
+    QHash<QString, int> m_watches;
+    QSet<QString> m_dirty;
+    QElapsedTimer m_firstDirty;      // 알리지 않은 첫 이벤트부터
+
+    Q_DISABLE_COPY(LibraryWatcher)
+};
+
+#endif // LIBRARYWATCHER_H
@@ -0,0 +1,174 @@
+#include "mappedwavsource.h"
+#include <QtEndian>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedWavSource::MappedWavSource()
+    : m_map(nullptr),
+      m_mapSize(0),
+      m_data(nullptr),
+      m_channels(0),
+      m_sampleRate(0),
+      m_bitsPerSample(0),
+      m_blockAlign(0),
+      m_frameCount(0),
+      m_pos(0)
+{
+}
+
+MappedWavSource::~MappedWavSource()
+{
+    close();
+}
+
+bool MappedWavSource::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_mapSize = m_file.size();
+    m_map = m_file.map(0, m_mapSize);
+    if (!m_map) {
+        m_error = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    if (!parseHeader()) {
+        close();
+        return false;
+    }
+    // 재생은 순차 접근이 대부분: 커널 read-ahead 를 키우고 지나간 페이지는 빨리 버리게 한다
+    advise(0, m_frameCount, 0);
+    return true;
+}
+
+void MappedWavSource::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    if (m_file.isOpen())
+        m_file.close();
+    m_mapSize = 0;
+    m_data = nullptr;
+    m_channels = 0;
+    m_sampleRate = 0;
+    m_bitsPerSample = 0;
+    m_blockAlign = 0;
+    m_frameCount = 0;
+    m_pos = 0;
+    m_format = WavFormat();
+    m_info = AudioInfo();
+}
+
+bool MappedWavSource::seek(qint64 frame)
+{
+    if (!m_data || frame < 0 || frame > m_frameCount)
+        return false;
+    m_pos = frame;
+    // 점프한 위치 앞쪽 1초 분량을 미리 읽어 두도록 요청 (블록하지 않음)
+    advise(frame, m_sampleRate, 1);
+    return true;
+}
+
+// advice: 0 = 순차 접근, 1 = 곧 필요함
+void MappedWavSource::advise(qint64 frame, qint64 frames, int advice) const
+{
+#ifdef Q_OS_UNIX
+    if (!m_data || frames <= 0)
+        return;
+    const qint64 page = sysconf(_SC_PAGESIZE);
+    qint64 begin = (m_data - m_map) + frame * m_blockAlign;
+    qint64 end   = qMin(m_mapSize, begin + frames * m_blockAlign);
+    begin -= begin % page;   // madvise 는 페이지 정렬 주소만 받는다
+    if (end <= begin)
+        return;
+    madvise(m_map + begin, size_t(end - begin),
+            advice == 0 ? MADV_SEQUENTIAL : MADV_WILLNEED);
+#else
+    Q_UNUSED(frame) Q_UNUSED(frames) Q_UNUSED(advice)
+#endif
+}
+
+bool MappedWavSource::parseHeader()
+{
+    // 매핑된 메모리를 그대로 파서에 넘긴다 (RF64/EXTENSIBLE 포함)
+    if (!parseWavHeader(m_map, m_mapSize, &m_format, &m_error))
+        return false;
+    if (m_format.sampleType() == WavFormat::UnknownType) {
+        m_error = "Unsupported WAV sample format";
+        return false;
+    }
+    m_channels      = m_format.channels;
+    m_sampleRate    = m_format.sampleRate;
+    m_bitsPerSample = quint16(m_format.containerBits());
+    m_blockAlign    = m_format.blockAlign;
+    m_data          = m_map + m_format.dataOffset;
+    m_frameCount    = qint64(m_format.frameCount());
+
+    m_info.codec         = "wav";
+    m_info.sampleRate    = m_sampleRate;
+    m_info.channels      = m_channels;
+    m_info.bitsPerSample = m_format.validBitsPerSample;
+    m_info.frameCount    = m_frameCount;
+    m_info.dataOffset    = m_format.dataOffset;
+    m_info.dataSize      = quint64(m_frameCount) * m_blockAlign;
+    return true;
+}
+
+qint64 MappedWavSource::readFloat(float *dst, qint64 maxFrames)
+{
+    if (!m_data)
+        return -1;
+    const qint64 frames = qMin(maxFrames, m_frameCount - m_pos);
+    if (frames <= 0)
+        return 0;
+
+    // 샘플 폭별로 매핑된 바이트를 바로 변환 (blockAlign 에 패딩이 있을 수 있음)
+    const int width = m_bitsPerSample / 8;
+    const bool isFloat = m_format.sampleType() == WavFormat::FloatType;
+    const uchar *frame = m_data + m_pos * m_blockAlign;
+    for (qint64 f = 0; f < frames; ++f, frame += m_blockAlign) {
+        const uchar *p = frame;
+        for (int ch = 0; ch < m_channels; ++ch, p += width) {
+            float v;
+            switch (width) {
+            case 1:
+                v = (int(p[0]) - 128) / 128.0f;
+                break;
+            case 2:
+                v = qFromLittleEndian<qint16>(p) / 32768.0f;
+                break;
+            case 3:
+                v = qint32(quint32(p[0]) << 8 | quint32(p[1]) << 16 | quint32(p[2]) << 24)
+                        / 2147483648.0f;
+                break;
+            case 4:
+                if (isFloat) {
+                    quint32 bits = qFromLittleEndian<quint32>(p);
+                    memcpy(&v, &bits, sizeof v);
+                } else {
+                    v = qFromLittleEndian<qint32>(p) / 2147483648.0f;
+                }
+                break;
+            default: {   // 64bit float
+                quint64 bits = qFromLittleEndian<quint64>(p);
+                double d;
+                memcpy(&d, &bits, sizeof d);
+                v = float(d);
+            }
+            }
+            *dst++ = v;
+        }
+    }
+    m_pos += frames;
+    return frames;
+}
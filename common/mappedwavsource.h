@@ -0,0 +1,105 @@
+#ifndef MAPPEDWAVSOURCE_H
+#define MAPPEDWAVSOURCE_H
+
+#include <QFile>
+#include <QString>
+#include "wavformat.h"
+#include "audiosource.h"
+
+// 매핑된 파일 안의 인터리브 샘플을 가리키는 뷰 (복사본 아님)
+template <typename T>
+struct SampleSpan {
+    const T *data = nullptr;
+    qint64   frames = 0;
+    int      channels = 0;
+
+    bool   isEmpty() const { return frames == 0; }
+    qint64 sampleCount() const { return frames * channels; }
+    qint64 byteCount() const { return sampleCount() * qint64(sizeof(T)); }
+    const T &at(qint64 frame, int ch) const { return data[frame * channels + ch]; }
+};
+
+// QFile::map 기반 WAV 소스.
+// data 청크를 통째로 매핑해 두고 read()/peek() 는 페이지 캐시를 직접 가리키는
+// SampleSpan 만 돌려준다 (할당도 복사도 없음). 샘플 형식을 그대로 쓸 수 있는
+// 곳 (equlizer 의 16bit aplay 출력) 은 이쪽을 쓴다.
+// readFloat() 는 AudioSource 공통 경로로, 매핑된 샘플을 바로 float 로 변환한다
+// (중간 버퍼 없음).
+class MappedWavSource : public AudioSource
+{
+public:
+    MappedWavSource();
+    ~MappedWavSource();
+
+    bool open(const QString &path) override;
+    void close() override;
+    bool isOpen() const override { return m_data != nullptr; }
+    QString errorString() const override { return m_error; }
+    const AudioInfo &info() const override { return m_info; }
+    QString fileName() const { return m_file.fileName(); }
+
+    const WavFormat &format() const { return m_format; }
+    int     bytesPerFrame() const { return m_blockAlign; }
+
+    qint64  position() const override { return m_pos; }      // 프레임 단위
+    quint64 bytePosition() const override
+    { return m_format.dataOffset + quint64(m_pos) * m_blockAlign; }
+    bool    seek(qint64 frame) override;
+    qint64  readFloat(float *dst, qint64 maxFrames) override;
+
+    // frame 부터 최대 maxFrames 를 가리키는 span. 위치는 바뀌지 않는다.
+    template <typename T>
+    SampleSpan<T> peek(qint64 frame, qint64 maxFrames) const;
+
+    // 현재 위치부터 최대 maxFrames 를 돌려주고 위치를 전진시킨다.
+    template <typename T>
+    SampleSpan<T> read(qint64 maxFrames)
+    {
+        SampleSpan<T> s = peek<T>(m_pos, maxFrames);
+        m_pos += s.frames;
+        return s;
+    }
+
+    // data 청크 시작 (raw PCM 바이트)
+    const uchar *rawData() const { return m_data; }
+    qint64 dataSize() const { return m_frameCount * m_blockAlign; }
+
+private:
+    bool parseHeader();
+    void advise(qint64 frame, qint64 frames, int advice) const;
+
+    QFile        m_file;
+    uchar       *m_map;
+    qint64       m_mapSize;
+    const uchar *m_data;
+    quint16      m_channels;
+    quint32      m_sampleRate;
+    quint16      m_bitsPerSample;     // 컨테이너 폭 (12bit PCM 이면 16)
+    quint16      m_blockAlign;
+    qint64       m_frameCount;
+    qint64       m_pos;
+    WavFormat    m_format;
+    AudioInfo    m_info;
+    QString      m_error;
+
+    Q_DISABLE_COPY(MappedWavSource)
+};
+
+template <typename T>
+SampleSpan<T> MappedWavSource::peek(qint64 frame, qint64 maxFrames) const
+{
+    SampleSpan<T> s;
+    // 요청 타입이 실제 샘플 폭과 맞지 않거나, 프레임에 패딩이 있거나 (span 은 빈틈
+    // 없는 인터리브), 앞 청크 때문에 data 가 T 경계에 있지 않으면 빈 span
+    // (readFloat() 를 쓸 것)
+    if (!m_data || sizeof(T) * 8 != m_bitsPerSample || frame < 0 || frame >= m_frameCount
+            || m_blockAlign != m_channels * sizeof(T)
+            || reinterpret_cast<quintptr>(m_data) % alignof(T) != 0)
+        return s;
+    s.channels = m_channels;
+    s.frames   = qMin(maxFrames, m_frameCount - frame);
+    s.data     = reinterpret_cast<const T *>(m_data + frame * m_blockAlign);
+    return s;
+}
+
+#endif // MAPPEDWAVSOURCE_H
@@ -0,0 +1,173 @@
+#include "opusencoder.h"
+#include <opus/opus.h>
+#include <cstring>
+#include <time.h>
+
+namespace {
+
+const int kFrameSizes[] = { 120, 240, 480, 960, 1920, 2880 };   // 2.5 ~ 60 ms
+
+qint64 threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+} // namespace
+
+OpusStreamEncoder::OpusStreamEncoder()
+    : m_encoder(nullptr),
+      m_bitrate(128000),
+      m_frameSize(960),
+      m_complexity(5),
+      m_maxPacketBytes(1275),
+      m_channels(0),
+      m_lookaheadNs(0),
+      m_resample(false),
+      m_pending(0),
+      m_pendingNs(0),
+      m_nextFrame(0)
+{
+}
+
+OpusStreamEncoder::~OpusStreamEncoder()
+{
+    close();
+}
+
+void OpusStreamEncoder::setBitrate(int bitsPerSecond)
+{
+    m_bitrate = qBound(6000, bitsPerSecond, 510000);
+}
+
+void OpusStreamEncoder::setFrameMilliseconds(double ms)
+{
+    const int want = qRound(ms * SampleRate / 1000.0);
+    m_frameSize = kFrameSizes[0];
+    for (int size : kFrameSizes) {
+        if (qAbs(size - want) < qAbs(m_frameSize - want))
+            m_frameSize = size;
+    }
+}
+
+void OpusStreamEncoder::setComplexity(int complexity)
+{
+    m_complexity = qBound(0, complexity, 10);
+}
+
+void OpusStreamEncoder::setMaxPacketBytes(int bytes)
+{
+    m_maxPacketBytes = qBound(64, bytes, 1275 * 3);
+}
+
+bool OpusStreamEncoder::supports(quint32 sampleRate, int channels)
+{
+    return sampleRate >= 8000 && sampleRate <= quint32(SampleRate) && channels >= 1 && channels <= 2;
+}
+
+bool OpusStreamEncoder::open(quint32 inputRate, int channels)
+{
+    close();
+    if (!supports(inputRate, channels)) {
+        m_error = QString("Opus: unsupported format %1 Hz / %2 ch").arg(inputRate).arg(channels);
+        return false;
+    }
+    int err = OPUS_OK;
+    m_encoder = opus_encoder_create(SampleRate, channels, OPUS_APPLICATION_AUDIO, &err);
+    if (!m_encoder) {
+        m_error = QString("Opus: %1").arg(QString::fromLatin1(opus_strerror(err)));
+        return false;
+    }
+    opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_bitrate));
+    opus_encoder_ctl(m_encoder, OPUS_SET_COMPLEXITY(m_complexity));
+    opus_encoder_ctl(m_encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC));
+    // 패킷 크기가 크게 튀지 않게 (클라이언트 큐 / RTP MTU)
+    opus_encoder_ctl(m_encoder, OPUS_SET_VBR_CONSTRAINT(1));
+    opus_int32 lookahead = 0;
+    opus_encoder_ctl(m_encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+    m_lookaheadNs = qint64(lookahead) * 1000000000LL / SampleRate;
+
+    m_channels = channels;
+    m_resample = inputRate != quint32(SampleRate);
+    m_resampler.setChannels(channels);
+    m_resampler.setRatio(double(inputRate) / SampleRate);
+    m_resampler.reset();
+    m_frame.resize(m_frameSize * channels);
+    m_out.resize(m_maxPacketBytes);
+    m_pending = 0;
+    m_nextFrame = 0;
+    m_error.clear();
+    return true;
+}
+
+void OpusStreamEncoder::close()
+{
+    if (m_encoder)
+        opus_encoder_destroy(m_encoder);
+    m_encoder = nullptr;
+    m_pending = 0;
+}
+
+void OpusStreamEncoder::push(const float *pcm, qint64 frames, qint64 presentationNs,
+                             QList<Packet> *out)
+{
+    if (!m_encoder || frames <= 0)
+        return;
+    const int ch = m_channels;
+    qint64 n = frames;
+    if (m_resample) {
+        const qint64 room = m_resampler.outputFramesFor(frames) + 4;
+        if (m_resampled.size() < room * ch)
+            m_resampled.resize(int(room * ch));
+        qint64 used = 0, made = 0;
+        m_resampler.process(pcm, frames, &used, m_resampled.data(), room, &made);
+        pcm = m_resampled.constData();
+        n = made;
+    }
+    qint64 done = 0;
+    while (done < n) {
+        if (m_pending == 0)
+            m_pendingNs = presentationNs + done * 1000000000LL / SampleRate;
+        const int take = int(qMin<qint64>(n - done, m_frameSize - m_pending));
+        memcpy(m_frame.data() + m_pending * ch, pcm + done * ch, size_t(take * ch) * sizeof(float));
+        m_pending += take;
+        done += take;
+        if (m_pending == m_frameSize)
+            encodePending(out);
+    }
+}
+
+void OpusStreamEncoder::flush(QList<Packet> *out)
+{
+    if (!m_encoder || m_pending == 0)
+        return;
+    const int ch = m_channels;
+    memset(m_frame.data() + m_pending * ch, 0, size_t((m_frameSize - m_pending) * ch) * sizeof(float));
+    encodePending(out);
+}
+
+void OpusStreamEncoder::encodePending(QList<Packet> *out)
+{
+    const qint64 t0 = threadCpuNs();
+    const opus_int32 bytes = opus_encode_float(m_encoder, m_frame.constData(), m_frameSize,
+                                               reinterpret_cast<unsigned char *>(m_out.data()),
+                                               m_maxPacketBytes);
+    m_stats.cpuNs += threadCpuNs() - t0;
+    m_pending = 0;
+    if (bytes < 0) {
+        m_error = QString("Opus: %1").arg(QString::fromLatin1(opus_strerror(bytes)));
+        m_nextFrame += m_frameSize;         // 그 자리는 클라이언트가 손실로 처리
+        return;
+    }
+    Packet p;
+    p.data = QByteArray(m_out.constData(), bytes);
+    p.firstFrame = m_nextFrame;
+    p.presentationNs = m_pendingNs - m_lookaheadNs;
+    p.frames = m_frameSize;
+    out->append(p);
+    m_nextFrame += m_frameSize;
+    ++m_stats.packets;
+    m_stats.bytes += quint64(bytes);
+    m_stats.frames += m_frameSize;
+}
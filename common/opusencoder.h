@@ -0,0 +1,96 @@
+#ifndef OPUSENCODER_H
+#define OPUSENCODER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "resampler.h"
+
+struct OpusEncoder;
+
+// 스트리밍용 Opus 인코더 (libopus, 1~2 채널). 엔진이 틱마다 넘기는 PCM 을 프레임
+// 길이만큼 모아 패킷 하나씩 만든다. 스트림마다 하나만 두고 나온 패킷을 모든
+// 클라이언트와 RTP 가 같이 쓴다. Opus 는 48 kHz 로 돌리므로 그보다 낮은 레이트
+// (44.1 kHz 등) 는 올려서 넣고, 더 높은 레이트는 supports() 가 false 다.
+//
+// 패킷의 firstFrame 은 트랙 시작부터의 48 kHz 프레임, presentationNs 는 디코더
+// 출력 첫 샘플의 재생 시각 (인코더 lookahead 만큼 당겨 둠).
+class OpusStreamEncoder
+{
+public:
+    enum { SampleRate = 48000 };
+
+    struct Packet {
+        QByteArray data;
+        qint64 firstFrame = 0;
+        qint64 presentationNs = 0;
+        int    frames = 0;           // 48 kHz 프레임
+    };
+
+    struct Stats {
+        quint64 packets = 0;
+        quint64 bytes = 0;
+        qint64  frames = 0;          // 인코드한 오디오 (48 kHz 프레임)
+        qint64  cpuNs = 0;           // 인코더에 쓴 스레드 CPU 시간
+
+        // 실시간 대비 CPU (스트림 하나가 코어 하나의 몇 % 를 쓰는지)
+        double cpuPercent() const
+        { return frames > 0 ? 100.0 * cpuNs / (frames * (1e9 / SampleRate)) : 0.0; }
+        double kbps() const
+        { return frames > 0 ? bytes * 8.0 * SampleRate / frames / 1000.0 : 0.0; }
+    };
+
+    OpusStreamEncoder();
+    ~OpusStreamEncoder();
+
+    // open() 전에 설정
+    void setBitrate(int bitsPerSecond);      // 기본 128 kbit/s (스테레오 음악)
+    void setFrameMilliseconds(double ms);    // 2.5 / 5 / 10 / 20 / 40 / 60 중 가까운 것, 기본 20
+    void setComplexity(int complexity);      // 0..10, 기본 5 (arm64 타깃에서 여유 있게)
+    void setMaxPacketBytes(int bytes);       // RTP 한 패킷에 들어가게, 기본 1275
+    int    bitrate() const { return m_bitrate; }
+    double frameMilliseconds() const { return m_frameSize * 1000.0 / SampleRate; }
+    int    frameSize() const { return m_frameSize; }
+
+    static bool supports(quint32 sampleRate, int channels);
+
+    // 트랙마다 연다 (firstFrame 은 0 부터). 실패하면 errorString()
+    bool open(quint32 inputRate, int channels);
+    void close();
+    bool isOpen() const { return m_encoder != nullptr; }
+    QString errorString() const { return m_error; }
+    int channels() const { return m_channels; }
+
+    // 인터리브 float (입력 레이트). presentationNs 는 pcm 첫 프레임의 재생 시각
+    void push(const float *pcm, qint64 frames, qint64 presentationNs, QList<Packet> *out);
+    void flush(QList<Packet> *out);          // 모자란 프레임은 무음으로 채워 내보냄
+
+    Stats stats() const { return m_stats; }
+
+private:
+    void encodePending(QList<Packet> *out);
+
+    OpusEncoder *m_encoder;
+    QString  m_error;
+    int      m_bitrate;
+    int      m_frameSize;                    // 48 kHz 프레임
+    int      m_complexity;
+    int      m_maxPacketBytes;
+    int      m_channels;
+    qint64   m_lookaheadNs;
+    bool     m_resample;
+    Resampler m_resampler;
+    QVector<float> m_resampled;
+    QVector<float> m_frame;                  // 모으는 중인 프레임 (인터리브)
+    int      m_pending;                      // m_frame 에 모인 프레임 수
+    qint64   m_pendingNs;                    // 그 첫 프레임의 재생 시각
+    qint64   m_nextFrame;
+    QByteArray m_out;
+    Stats    m_stats;
+
+    Q_DISABLE_COPY(OpusStreamEncoder)
+};
+
+#endif // OPUSENCODER_H
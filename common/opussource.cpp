@@ -0,0 +1,440 @@
+#include "opussource.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const int    kReadSize      = 64 * 1024;
+const qint64 kBisectWindow  = 64 * 1024;   // 이 이하로 좁혀지면 선형 탐색
+const qint64 kPreRoll       = 3840;        // 80ms @ 48k
+const int    kMaxPacket48k  = 5760;        // 120ms @ 48k
+
+bool isOpusRate(quint32 rate)
+{
+    return rate == 8000 || rate == 12000 || rate == 16000 || rate == 24000 || rate == 48000;
+}
+
+} // namespace
+
+OpusSource::OpusSource()
+    : m_fileSize(0),
+      m_streamInit(false),
+      m_serial(0),
+      m_pageOffset(0),
+      m_dataStart(0),
+      m_decoder(nullptr),
+      m_outputRate(48000),
+      m_decodeRate(48000),
+      m_factor(1),
+      m_preSkip(0),
+      m_endGranule(-1),
+      m_packetCount(0),
+      m_packetIndex(0),
+      m_granule(0),
+      m_discardUntil(0),
+      m_pcmFrames(0),
+      m_pcmPos(0),
+      m_resample(false),
+      m_primePending(false),
+      m_primeFrac(0.0),
+      m_tailDone(false),
+      m_pos(0)
+{
+    ogg_sync_init(&m_sync);
+}
+
+OpusSource::~OpusSource()
+{
+    close();
+    ogg_sync_clear(&m_sync);
+}
+
+void OpusSource::setOutputRate(quint32 rate)
+{
+    if (rate > 0)
+        m_outputRate = rate;
+}
+
+bool OpusSource::fail(const QString &why)
+{
+    m_error = why;
+    close();
+    return false;
+}
+
+bool OpusSource::open(const QString &path)
+{
+    close();
+    m_error.clear();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_fileSize = m_file.size();
+
+    // 지원 레이트면 디코더가 직접, 아니면 48k 로 디코드 후 리샘플
+    m_decodeRate = isOpusRate(m_outputRate) ? int(m_outputRate) : 48000;
+    m_factor = 48000 / m_decodeRate;
+    m_resample = quint32(m_decodeRate) != m_outputRate;
+
+    if (!readHeaders())
+        return false;
+
+    m_endGranule = findEndGranule();
+    if (m_endGranule < 0)
+        return fail("No Opus audio pages");
+
+    m_pcm.resize(kMaxPacket48k / m_factor * m_info.channels);
+    m_resampler.setChannels(m_info.channels);
+    m_resampler.setRatio(double(m_decodeRate) / m_outputRate);
+
+    const qint64 total48 = qMax<qint64>(0, m_endGranule - m_preSkip);
+    m_info.codec      = "opus";
+    m_info.sampleRate = m_outputRate;
+    m_info.frameCount = total48 * m_outputRate / 48000;
+    m_info.dataOffset = quint64(m_dataStart);
+    m_info.dataSize   = quint64(m_fileSize - m_dataStart);
+
+    seekRaw(m_dataStart);
+    resetDecodeState();
+    m_granule = 0;
+    m_discardUntil = m_preSkip;
+    return true;
+}
+
+void OpusSource::close()
+{
+    if (m_decoder) {
+        opus_multistream_decoder_destroy(m_decoder);
+        m_decoder = nullptr;
+    }
+    if (m_streamInit) {
+        ogg_stream_clear(&m_stream);
+        m_streamInit = false;
+    }
+    ogg_sync_reset(&m_sync);
+    if (m_file.isOpen())
+        m_file.close();
+    m_info = AudioInfo();
+    m_packetCount = m_packetIndex = 0;
+    m_pcmFrames = m_pcmPos = 0;
+    m_pos = 0;
+}
+
+void OpusSource::seekRaw(qint64 offset)
+{
+    m_file.seek(offset);
+    ogg_sync_reset(&m_sync);
+    m_pageOffset = offset;
+}
+
+bool OpusSource::readPage(ogg_page *og, qint64 *pageOffset)
+{
+    for (;;) {
+        const long ret = ogg_sync_pageseek(&m_sync, og);
+        if (ret > 0) {
+            if (pageOffset)
+                *pageOffset = m_pageOffset;
+            m_pageOffset += ret;
+            return true;
+        }
+        if (ret < 0) {
+            m_pageOffset -= ret;   // 동기를 못 잡은 바이트는 건너뜀
+            continue;
+        }
+        char *buf = ogg_sync_buffer(&m_sync, kReadSize);
+        const qint64 n = m_file.read(buf, kReadSize);
+        if (n <= 0)
+            return false;
+        ogg_sync_wrote(&m_sync, long(n));
+    }
+}
+
+bool OpusSource::readHeaders()
+{
+    seekRaw(0);
+    ogg_page og;
+    if (!readPage(&og, nullptr) || !ogg_page_bos(&og))
+        return fail("Not an Ogg stream");
+
+    m_serial = ogg_page_serialno(&og);
+    ogg_stream_init(&m_stream, m_serial);
+    m_streamInit = true;
+    ogg_stream_pagein(&m_stream, &og);
+
+    ogg_packet op;
+    if (ogg_stream_packetout(&m_stream, &op) != 1 || op.bytes < 19
+            || memcmp(op.packet, "OpusHead", 8) != 0)
+        return fail("Not an Opus stream");
+
+    // OpusHead: version(1) channels(1) pre-skip(2) input rate(4) gain(2) family(1) ...
+    const uchar *h = op.packet;
+    if ((h[8] >> 4) != 0)
+        return fail("Unsupported Opus header version");
+    const int channels = h[9];
+    m_preSkip = qFromLittleEndian<quint16>(h + 10);
+    const qint16 gain = qFromLittleEndian<qint16>(h + 16);
+    const int family = h[18];
+
+    int streams = 1, coupled = 0;
+    unsigned char mapping[255] = {0, 1};
+    if (family == 0) {
+        if (channels < 1 || channels > 2)
+            return fail("Invalid Opus channel count");
+        coupled = channels - 1;
+    } else {
+        if (channels < 1 || op.bytes < 21 + channels)
+            return fail("Invalid Opus channel mapping");
+        streams = h[19];
+        coupled = h[20];
+        memcpy(mapping, h + 21, size_t(channels));
+    }
+    if (channels > Resampler::MaxChannels)
+        return fail("Too many Opus channels");
+
+    int err = OPUS_OK;
+    m_decoder = opus_multistream_decoder_create(m_decodeRate, channels, streams, coupled,
+                                                mapping, &err);
+    if (err != OPUS_OK || !m_decoder) {
+        m_decoder = nullptr;
+        return fail(QString::fromLatin1(opus_strerror(err)));
+    }
+    if (gain != 0)
+        opus_multistream_decoder_ctl(m_decoder, OPUS_SET_GAIN(gain));
+    m_info.channels = channels;
+
+    // OpusTags 는 여러 페이지에 걸칠 수 있고 반드시 페이지 끝에서 끝난다
+    for (;;) {
+        const int r = ogg_stream_packetout(&m_stream, &op);
+        if (r == 1)
+            break;
+        if (r < 0 || !readPage(&og, nullptr))
+            return fail("Missing OpusTags");
+        if (ogg_page_serialno(&og) == m_serial)
+            ogg_stream_pagein(&m_stream, &og);
+    }
+    m_dataStart = m_pageOffset;
+    return true;
+}
+
+// 파일 끝에서부터 창을 넓혀 가며 마지막 granule 을 찾는다 (전체 길이 계산용)
+qint64 OpusSource::findEndGranule()
+{
+    qint64 window = kReadSize;
+    for (;;) {
+        const qint64 start = qMax(m_dataStart, m_fileSize - window);
+        seekRaw(start);
+        qint64 last = -1;
+        ogg_page og;
+        while (readPage(&og, nullptr)) {
+            if (ogg_page_serialno(&og) == m_serial && ogg_page_granulepos(&og) >= 0)
+                last = ogg_page_granulepos(&og);
+        }
+        if (last >= 0 || start == m_dataStart)
+            return last;
+        window *= 4;
+    }
+}
+
+void OpusSource::resetDecodeState()
+{
+    ogg_stream_reset(&m_stream);
+    opus_multistream_decoder_ctl(m_decoder, OPUS_RESET_STATE);
+    m_resampler.reset();
+    m_primePending = m_resample;
+    m_primeFrac = 0.0;
+    memset(m_primeFrame, 0, sizeof m_primeFrame);
+    m_tailDone = false;
+    m_packetCount = m_packetIndex = 0;
+    m_pcmFrames = m_pcmPos = 0;
+}
+
+bool OpusSource::loadNextPage()
+{
+    ogg_page og;
+    for (;;) {
+        if (!readPage(&og, nullptr))
+            return false;
+        if (ogg_page_serialno(&og) != m_serial)
+            continue;
+        ogg_stream_pagein(&m_stream, &og);
+
+        // 패킷 포인터는 다음 pagein 전까지 유효하므로 이 페이지 분량만 모아 둔다
+        m_packetCount = m_packetIndex = 0;
+        ogg_packet op;
+        int r;
+        while (m_packetCount < 255 && (r = ogg_stream_packetout(&m_stream, &op)) != 0) {
+            if (r > 0)
+                m_packets[m_packetCount++] = op;   // r < 0 은 구멍(누락 조각)
+        }
+        if (m_packetCount == 0)
+            continue;
+
+        if (m_granule < 0) {
+            // seek 직후: 페이지 끝 granule 에서 이 페이지 패킷 길이를 빼면 시작 위치
+            qint64 dur = 0;
+            for (int i = 0; i < m_packetCount; ++i) {
+                const int n = opus_packet_get_nb_samples(m_packets[i].packet,
+                                                         opus_int32(m_packets[i].bytes), 48000);
+                dur += qMax(0, n);
+            }
+            m_granule = ogg_page_granulepos(&og) - dur;
+        }
+        return true;
+    }
+}
+
+// 다음 패킷의 디코드 프레임 수 (m_decodeRate), 스트림 끝이면 -1
+int OpusSource::nextPacketFrames()
+{
+    if (m_packetIndex >= m_packetCount && !loadNextPage())
+        return -1;
+    const ogg_packet &op = m_packets[m_packetIndex];
+    return opus_packet_get_nb_samples(op.packet, opus_int32(op.bytes), m_decodeRate);
+}
+
+// 패킷 하나를 out 에 디코드하고 내보낼 구간을 out 기준 [m_pcmPos, m_pcmFrames) 로 둔다
+bool OpusSource::decodeNextPacket(float *out, int maxFrames)
+{
+    if (m_packetIndex >= m_packetCount && !loadNextPage()) {
+        // 리샘플러는 입력 2프레임을 앞서 보므로 끝에서 무음으로 창을 비운다
+        if (!m_resample || m_tailDone)
+            return false;
+        m_tailDone = true;
+        memset(out, 0, sizeof(float) * 3 * m_info.channels);
+        m_pcmPos = 0;
+        m_pcmFrames = 3;
+        return true;
+    }
+    const ogg_packet &op = m_packets[m_packetIndex++];
+
+    const int n = opus_multistream_decode_float(m_decoder, op.packet, opus_int32(op.bytes),
+                                                out, maxFrames, 0);
+    m_pcmFrames = m_pcmPos = 0;
+    if (n < 0) {
+        // 손상된 패킷: 시간축만 진행하고 출력은 건너뜀
+        const int dur = opus_packet_get_nb_samples(op.packet, opus_int32(op.bytes), 48000);
+        m_granule += qMax(0, dur);
+        return true;
+    }
+
+    // 48k 단위로 [start, end) 중 pre-skip/seek 앞부분과 스트림 끝 뒤를 잘라낸다
+    const qint64 start = m_granule;
+    const qint64 end = start + qint64(n) * m_factor;
+    m_granule = end;
+    const qint64 from = qMax(start, m_discardUntil);
+    const qint64 to = qMin(end, m_endGranule);
+    if (to > from) {
+        m_pcmPos = (from - start) / m_factor;
+        m_pcmFrames = (to - start) / m_factor;
+    }
+
+    if (m_primePending) {
+        // 리샘플은 48k 디코드라 m_factor 가 1 이다. 목표 바로 앞 프레임으로 창을 채운다
+        const int ch = m_info.channels;
+        if (to > from) {
+            m_resampler.prime(m_pcmPos > 0 ? out + (m_pcmPos - 1) * ch : m_primeFrame,
+                              m_primeFrac);
+            m_primePending = false;
+        } else if (n > 0 && end <= from) {
+            memcpy(m_primeFrame, out + (n - 1) * ch, sizeof(float) * ch);
+        }
+    }
+    return true;
+}
+
+bool OpusSource::seek(qint64 frame)
+{
+    if (!m_decoder || frame < 0 || frame > m_info.frameCount)
+        return false;
+
+    const qint64 target48 = frame * 48000;
+    const qint64 target = target48 / m_outputRate + m_preSkip;
+    const qint64 preRoll = qMax<qint64>(0, target - kPreRoll);
+
+    // 1) 이분 탐색: preRoll 전에 끝나는 페이지 근처까지 좁힌다
+    qint64 lo = m_dataStart, hi = m_fileSize;
+    ogg_page og;
+    while (hi - lo > kBisectWindow) {
+        const qint64 mid = lo + (hi - lo) / 2;
+        seekRaw(mid);
+        qint64 off = 0, gp = -1;
+        while (readPage(&og, &off) && off < hi) {
+            if (ogg_page_serialno(&og) == m_serial && ogg_page_granulepos(&og) >= 0) {
+                gp = ogg_page_granulepos(&og);
+                break;
+            }
+        }
+        if (gp >= 0 && off < hi && gp < preRoll)
+            lo = off + og.header_len + og.body_len;
+        else
+            hi = mid;
+    }
+
+    // 2) 선형 탐색: preRoll 전에 끝나는 마지막 페이지 바로 뒤에서 시작
+    qint64 startOffset = lo;
+    seekRaw(lo);
+    qint64 off = 0;
+    while (readPage(&og, &off)) {
+        if (ogg_page_serialno(&og) != m_serial || ogg_page_granulepos(&og) < 0)
+            continue;
+        if (ogg_page_granulepos(&og) >= preRoll)
+            break;
+        startOffset = off + og.header_len + og.body_len;
+    }
+
+    seekRaw(startOffset);
+    resetDecodeState();
+    m_granule = startOffset == m_dataStart ? 0 : -1;   // 중간이면 첫 페이지에서 계산
+    m_discardUntil = target;
+    m_primeFrac = double(target48 % m_outputRate) / m_outputRate;
+    m_pos = frame;
+    return true;
+}
+
+qint64 OpusSource::readFloat(float *dst, qint64 maxFrames)
+{
+    if (!m_decoder)
+        return -1;
+    const int ch = m_info.channels;
+    maxFrames = qMin(maxFrames, m_info.frameCount - m_pos);
+    qint64 done = 0;
+    while (done < maxFrames) {
+        if (m_pcmPos >= m_pcmFrames) {
+            // 지원 레이트에서 패킷이 통째로 들어가면 호출자 버퍼에 바로 디코드
+            const int n = m_resample ? -1 : nextPacketFrames();
+            if (n > 0 && n <= maxFrames - done) {
+                float *out = dst + done * ch;
+                if (!decodeNextPacket(out, n))
+                    break;
+                // pre-skip/seek 로 앞을 버린 패킷이면 남길 부분을 당겨 온다
+                const qint64 keep = m_pcmFrames - m_pcmPos;
+                if (m_pcmPos > 0 && keep > 0)
+                    memmove(out, out + m_pcmPos * ch, size_t(keep * ch) * sizeof(float));
+                done += keep;
+                m_pcmFrames = m_pcmPos = 0;
+                continue;
+            }
+            if (!decodeNextPacket(m_pcm.data(), kMaxPacket48k / m_factor))
+                break;
+            continue;
+        }
+        const float *src = m_pcm.constData() + m_pcmPos * ch;
+        const qint64 avail = m_pcmFrames - m_pcmPos;
+        if (!m_resample) {
+            const qint64 n = qMin(avail, maxFrames - done);
+            memcpy(dst + done * ch, src, size_t(n * ch) * sizeof(float));
+            m_pcmPos += n;
+            done += n;
+        } else {
+            // 패킷 버퍼에서 호출자 버퍼로 바로 리샘플
+            qint64 used = 0, made = 0;
+            m_resampler.process(src, avail, &used, dst + done * ch, maxFrames - done, &made);
+            m_pcmPos += used;
+            done += made;
+        }
+    }
+    m_pos += done;
+    return done;
+}
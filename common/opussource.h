@@ -0,0 +1,94 @@
+#ifndef OPUSSOURCE_H
+#define OPUSSOURCE_H
+
+#include "audiosource.h"
+#include "resampler.h"
+#include <QFile>
+#include <QVector>
+#include <ogg/ogg.h>
+#include <opus/opus_multistream.h>
+
+// libogg 로 직접 디먹스하고 libopus 로 디코드하는 Ogg Opus 소스.
+//
+// 출력 레이트: setOutputRate() 가 Opus 가 지원하는 레이트(8/12/16/24/48k)면
+// 디코더가 그 레이트로 바로 내보내므로 추가 복사가 없다. 그 외(44.1k 등)는
+// 48k 로 디코드한 패킷 버퍼에서 호출자 버퍼로 바로 리샘플한다.
+// 지원 레이트에서 호출자 버퍼에 패킷 하나가 통째로 들어가면 디코더가 거기에
+// 바로 쓴다 (패킷 버퍼를 거치지 않음).
+//
+// seek() 는 페이지 granule position 을 이분 탐색해 80ms 앞에서 디코드를 다시
+// 시작하고 (RFC 7845 권장 pre-roll), 목표 샘플 전까지는 버린다. 리샘플할 때는
+// 버리는 마지막 샘플로 리샘플러 창을 채우므로 처음부터 디코드한 것과 같은
+// 출력이 나온다 (페이드 인이나 시간축 밀림 없음).
+class OpusSource : public AudioSource
+{
+public:
+    OpusSource();
+    ~OpusSource();
+
+    // open() 전에 호출. 기본 48000
+    void    setOutputRate(quint32 rate);
+    quint32 outputRate() const { return m_outputRate; }
+
+    bool open(const QString &path) override;
+    void close() override;
+    bool isOpen() const override { return m_decoder != nullptr; }
+    QString errorString() const override { return m_error; }
+    const AudioInfo &info() const override { return m_info; }
+
+    qint64  position() const override { return m_pos; }
+    quint64 bytePosition() const override { return quint64(m_file.pos()); }
+    bool    seek(qint64 frame) override;
+    qint64  readFloat(float *dst, qint64 maxFrames) override;
+
+private:
+    bool   fail(const QString &why);
+    bool   readHeaders();
+    bool   readPage(ogg_page *og, qint64 *pageOffset);
+    void   seekRaw(qint64 offset);
+    qint64 findEndGranule();
+    bool   loadNextPage();
+    int    nextPacketFrames();
+    bool   decodeNextPacket(float *out, int maxFrames);
+    void   resetDecodeState();
+
+    QFile            m_file;
+    qint64           m_fileSize;
+    ogg_sync_state   m_sync;
+    ogg_stream_state m_stream;
+    bool             m_streamInit;
+    int              m_serial;
+    qint64           m_pageOffset;     // ogg_sync 가 다음에 돌려줄 페이지의 파일 위치
+    qint64           m_dataStart;      // 첫 오디오 페이지
+    OpusMSDecoder   *m_decoder;
+
+    quint32 m_outputRate;
+    int     m_decodeRate;
+    int     m_factor;                  // 48000 / m_decodeRate
+    int     m_preSkip;                 // 48k 단위
+    qint64  m_endGranule;              // 마지막 페이지 granule (48k)
+
+    ogg_packet m_packets[255];         // 현재 페이지에서 완성된 패킷들
+    int     m_packetCount;
+    int     m_packetIndex;
+    qint64  m_granule;                 // 다음 패킷의 시작 granule, 모르면 -1
+    qint64  m_discardUntil;            // 이 granule 전 샘플은 버림 (pre-skip, seek)
+
+    QVector<float> m_pcm;              // 패킷 하나 디코드 결과 (m_decodeRate)
+    qint64  m_pcmFrames;
+    qint64  m_pcmPos;
+    bool      m_resample;
+    Resampler m_resampler;
+    bool      m_primePending;          // 리샘플러 창을 아직 안 채웠다 (open/seek 직후)
+    double    m_primeFrac;             // 목표 위치의 48k 이하 소수부
+    float     m_primeFrame[Resampler::MaxChannels];   // 지금까지 버린 마지막 프레임
+    bool      m_tailDone;              // 끝에서 창을 비우는 무음을 넣었다
+
+    AudioInfo m_info;
+    qint64    m_pos;
+    QString   m_error;
+
+    Q_DISABLE_COPY(OpusSource)
+};
+
+#endif // OPUSSOURCE_H
@@ -0,0 +1,226 @@
+#include "pcmcache.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+inline int costOf(const QVector<float> &pcm)
+{
+    return qMax(1, int(pcm.size() * sizeof(float) / 1024));
+}
+
+} // namespace
+
+QString PcmCache::Stats::toString() const
+{
+    const quint64 lookups = hits + misses;
+    return QString("%1 segments / %2 MB, hits %3 (%4%), misses %5, evictions %6")
+            .arg(segments)
+            .arg(bytes / (1024 * 1024))
+            .arg(hits)
+            .arg(lookups ? int(hits * 100 / lookups) : 0)
+            .arg(misses)
+            .arg(evictions);
+}
+
+PcmCache::PcmCache(qint64 capacityBytes)
+{
+    setCapacity(capacityBytes);
+}
+
+void PcmCache::setCapacity(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.setMaxCost(int(qBound<qint64>(0, bytes / 1024, INT_MAX)));
+    m_stats.bytes = qint64(m_cache.totalCost()) * 1024;
+    m_stats.segments = m_cache.count();
+}
+
+qint64 PcmCache::capacity() const
+{
+    QMutexLocker lock(&m_mutex);
+    return qint64(m_cache.maxCost()) * 1024;
+}
+
+QString PcmCache::fileKey(const QString &path)
+{
+    const QFileInfo fi(path);
+    if (!fi.exists())
+        return QString();
+    return QString("%1:%2:%3").arg(fi.size()).arg(fi.lastModified().toMSecsSinceEpoch())
+            .arg(fi.absoluteFilePath());
+}
+
+QVector<float> PcmCache::find(const QString &file, qint64 segment)
+{
+    QMutexLocker lock(&m_mutex);
+    const QVector<float> *pcm = m_cache.object(Key(file, segment));
+    if (!pcm) {
+        ++m_stats.misses;
+        return QVector<float>();
+    }
+    ++m_stats.hits;
+    return *pcm;
+}
+
+bool PcmCache::contains(const QString &file, qint64 segment) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.contains(Key(file, segment));
+}
+
+void PcmCache::insert(const QString &file, qint64 segment, const QVector<float> &pcm)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_cache.maxCost() == 0 || pcm.isEmpty())
+        return;
+    const Key key(file, segment);
+    const int before = m_cache.count() - (m_cache.contains(key) ? 1 : 0);
+    // 실패하면 (구간 하나가 용량보다 큼) QCache 가 지운다
+    m_cache.insert(key, new QVector<float>(pcm), costOf(pcm));
+    m_stats.evictions += quint64(qMax(0, before + 1 - m_cache.count()));
+    m_stats.bytes = qint64(m_cache.totalCost()) * 1024;
+    m_stats.segments = m_cache.count();
+}
+
+PcmCache::Stats PcmCache::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
+
+// ---------------------------------------------------------------------------
+
+CachedAudioSource::CachedAudioSource(AudioSource *inner, const QString &fileKey, PcmCache *cache)
+    : m_inner(inner),
+      m_key(fileKey),
+      m_cache(cache),
+      m_position(inner->position()),
+      m_segment(-1)
+{
+}
+
+CachedAudioSource::~CachedAudioSource()
+{
+    delete m_inner;
+}
+
+bool CachedAudioSource::open(const QString &path)
+{
+    m_position = 0;
+    m_segment = -1;
+    m_pcm.clear();
+    m_error.clear();
+    return m_inner->open(path);
+}
+
+void CachedAudioSource::close()
+{
+    m_inner->close();
+    m_segment = -1;
+    m_pcm.clear();
+}
+
+bool CachedAudioSource::isOpen() const
+{
+    return m_inner->isOpen();
+}
+
+QString CachedAudioSource::errorString() const
+{
+    return m_error.isEmpty() ? m_inner->errorString() : m_error;
+}
+
+const AudioInfo &CachedAudioSource::info() const
+{
+    return m_inner->info();
+}
+
+quint64 CachedAudioSource::bytePosition() const
+{
+    const AudioInfo &i = info();
+    if (i.frameCount <= 0 || i.dataSize == 0)
+        return m_inner->bytePosition();
+    return i.dataOffset + quint64(double(i.dataSize) * m_position / i.frameCount);
+}
+
+bool CachedAudioSource::seek(qint64 frame)
+{
+    const qint64 total = frameCount();
+    if (frame < 0 || (total >= 0 && frame > total)) {
+        m_error = QString("Seek out of range: %1").arg(frame);
+        return false;
+    }
+    m_error.clear();
+    m_position = frame;
+    return true;
+}
+
+bool CachedAudioSource::isCached(qint64 frame, qint64 frames) const
+{
+    const qint64 first = frame / PcmCache::SegmentFrames;
+    const qint64 last = (frame + qMax<qint64>(1, frames) - 1) / PcmCache::SegmentFrames;
+    for (qint64 s = first; s <= last; ++s) {
+        if (s != m_segment && !m_cache->contains(m_key, s))
+            return false;
+    }
+    return true;
+}
+
+qint64 CachedAudioSource::readFloat(float *dst, qint64 maxFrames)
+{
+    const int ch = channels();
+    qint64 done = 0;
+    while (done < maxFrames) {
+        const qint64 segment = m_position / PcmCache::SegmentFrames;
+        if (segment != m_segment && !loadSegment(segment))
+            return done > 0 ? done : -1;
+        const qint64 offset = m_position - segment * PcmCache::SegmentFrames;
+        const qint64 avail = m_pcm.size() / ch - offset;
+        if (avail <= 0)
+            break;                      // 마지막 구간의 끝
+        const qint64 n = qMin(avail, maxFrames - done);
+        memcpy(dst + done * ch, m_pcm.constData() + offset * ch, size_t(n * ch) * sizeof(float));
+        done += n;
+        m_position += n;
+    }
+    return done;
+}
+
+// 캐시에 없으면 안쪽 소스로 구간 하나를 디코드해 넣는다. 끝을 지났으면 빈 구간
+bool CachedAudioSource::loadSegment(qint64 segment)
+{
+    m_pcm = m_cache->find(m_key, segment);
+    m_segment = segment;
+    if (!m_pcm.isEmpty())
+        return true;
+
+    const qint64 start = segment * PcmCache::SegmentFrames;
+    const qint64 total = frameCount();
+    if (total >= 0 && start >= total)
+        return true;
+    if (m_inner->position() != start && !m_inner->seek(start)) {
+        m_segment = -1;
+        return false;
+    }
+    const int ch = channels();
+    QVector<float> pcm(int(PcmCache::SegmentFrames * ch));
+    qint64 got = 0;
+    while (got < PcmCache::SegmentFrames) {
+        const qint64 n = m_inner->readFloat(pcm.data() + got * ch, PcmCache::SegmentFrames - got);
+        if (n < 0) {
+            m_segment = -1;
+            return false;
+        }
+        if (n == 0)
+            break;
+        got += n;
+    }
+    pcm.resize(int(got * ch));
+    m_cache->insert(m_key, segment, pcm);
+    m_pcm = pcm;
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef PCMCACHE_H
+#define PCMCACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "audiosource.h"
+
+// 디코드한 PCM 을 프로세스 안에서 같이 쓰는 LRU 캐시. 파일 (경로 + 크기 + mtime)
+// 과 SegmentFrames 단위 구간으로 찾는다. 구간은 읽기 전용 QVector<float> 로
+// 내주므로 (암시적 공유) 몇 곳이 읽든 복사가 없고, 캐시에서 밀려나도 들고 있는
+// 쪽이 놓을 때까지 남는다. 자주 트는 트랙은 NFS 에서 다시 읽지도, 다시
+// 디코드하지도 않는다. 어느 스레드에서나 부를 수 있다.
+class PcmCache
+{
+public:
+    enum { SegmentFrames = 16384 };     // 48 kHz 에서 0.34 초
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;          // 자리가 모자라 밀려난 구간
+        qint64  bytes = 0;              // 지금 들고 있는 양
+        int     segments = 0;
+
+        QString toString() const;
+    };
+
+    explicit PcmCache(qint64 capacityBytes = 256 * 1024 * 1024);
+
+    void setCapacity(qint64 bytes);     // 0 이면 끔 (들고 있던 것은 버린다)
+    qint64 capacity() const;
+
+    // 같은 내용의 파일에 같은 키 (다시 쓴 파일은 다른 키). 파일이 없으면 빈 문자열
+    static QString fileKey(const QString &path);
+
+    // 없으면 빈 QVector. 있으면 최근에 쓴 것으로 옮긴다
+    QVector<float> find(const QString &file, qint64 segment);
+    bool contains(const QString &file, qint64 segment) const;   // 통계 / 순서는 그대로
+    void insert(const QString &file, qint64 segment, const QVector<float> &pcm);
+
+    Stats stats() const;
+
+private:
+    typedef QPair<QString, qint64> Key;
+
+    mutable QMutex m_mutex;
+    QCache<Key, QVector<float> > m_cache;   // 비용은 KB 단위 (int 를 넘지 않게)
+    Stats m_stats;
+
+    Q_DISABLE_COPY(PcmCache)
+};
+
+// PcmCache 를 거쳐 읽는 소스. 캐시에 없는 구간만 안쪽 소스로 디코드해 넣는다.
+// 안쪽 소스는 넘겨받는다 (소유). seek 은 위치만 바꾸고 디코더는 필요할 때 옮긴다.
+// bytePosition() 은 재생 위치에 해당하는 파일 위치의 추정치다 (선읽기용).
+class CachedAudioSource : public AudioSource
+{
+public:
+    CachedAudioSource(AudioSource *inner, const QString &fileKey, PcmCache *cache);
+    ~CachedAudioSource();
+
+    bool open(const QString &path) override;
+    void close() override;
+    bool isOpen() const override;
+    QString errorString() const override;
+    const AudioInfo &info() const override;
+
+    qint64  position() const override { return m_position; }
+    quint64 bytePosition() const override;
+    bool    seek(qint64 frame) override;
+    qint64  readFloat(float *dst, qint64 maxFrames) override;
+
+    // [frame, frame+frames) 가 모두 캐시에 있는가 (선읽기를 기다릴 필요가 없음)
+    bool isCached(qint64 frame, qint64 frames) const;
+
+private:
+    bool loadSegment(qint64 segment);
+
+    AudioSource   *m_inner;
+    QString        m_key;
+    PcmCache      *m_cache;
+    qint64         m_position;
+    qint64         m_segment;     // m_pcm 의 구간 (-1 이면 없음)
+    QVector<float> m_pcm;         // 읽고 있는 구간 (캐시와 공유)
+    QString        m_error;
+
+    Q_DISABLE_COPY(CachedAudioSource)
+};
+
+#endif // PCMCACHE_H
@@ -0,0 +1,232 @@
+#include "readahead.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+const quint64 kAlign = 4096;   // 페이지/NFS rsize 정렬 단위
+
+inline quint64 alignDown(quint64 v) { return v - v % kAlign; }
+inline quint64 alignUp(quint64 v)   { return alignDown(v + kAlign - 1); }
+
+} // namespace
+
+double ReadAhead::Stats::latencyBucketMs(int i) const
+{
+    return 0.25 * double(1u << i);
+}
+
+QString ReadAhead::Stats::toString() const
+{
+    QString s = QString("buffered %1s (%2%), reads %3, %4 KB, underruns %5, errors %6, latency")
+            .arg(bufferedSeconds, 0, 'f', 2)
+            .arg(int(fill * 100))
+            .arg(reads)
+            .arg(bytesRead / 1024)
+            .arg(underruns)
+            .arg(readErrors);
+    for (int i = 0; i < LatencyBuckets; ++i) {
+        if (latency[i] == 0)
+            continue;
+        if (i == LatencyBuckets - 1)
+            s += QString(" >=%1ms:%2").arg(latencyBucketMs(i - 1)).arg(latency[i]);
+        else
+            s += QString(" <%1ms:%2").arg(latencyBucketMs(i)).arg(latency[i]);
+    }
+    return s;
+}
+
+ReadAhead::ReadAhead(QObject *parent)
+    : QThread(parent),
+      m_fd(-1),
+      m_begin(0),
+      m_end(0),
+      m_bytesPerSecond(0),
+      m_aheadSeconds(4.0),
+      m_blockSize(1 << 20),
+      m_playhead(0),
+      m_readyBegin(0),
+      m_readyEnd(0),
+      m_dropped(0),
+      m_generation(0),
+      m_stop(true)
+{
+}
+
+ReadAhead::~ReadAhead()
+{
+    close();
+}
+
+bool ReadAhead::open(const QString &path, quint64 dataOffset, quint64 dataSize,
+                     quint32 bytesPerSecond)
+{
+    close();
+    m_fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        return false;
+    // 커널에도 순차 접근임을 알려 NFS read-ahead 창을 키운다
+    posix_fadvise(m_fd, off_t(dataOffset), off_t(dataSize), POSIX_FADV_SEQUENTIAL);
+
+    m_begin = dataOffset;
+    m_end = dataOffset + dataSize;
+    // 0 이면 ahead 가 0 이 되어 아무것도 미리 읽지 않는다
+    m_bytesPerSecond = bytesPerSecond ? bytesPerSecond : quint32(FallbackBytesPerSecond);
+    m_playhead = dataOffset;
+    m_readyBegin = m_readyEnd = m_dropped = alignDown(dataOffset);
+    m_stats = Stats();
+    m_stop = false;
+    start();
+    return true;
+}
+
+void ReadAhead::close()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+    wait();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void ReadAhead::setAheadSeconds(double sec)
+{
+    QMutexLocker lock(&m_mutex);
+    m_aheadSeconds = qMax(0.1, sec);
+    m_wake.wakeAll();
+}
+
+double ReadAhead::aheadSeconds() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_aheadSeconds;
+}
+
+void ReadAhead::setBlockSize(int bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_blockSize = int(qMax<quint64>(kAlign, alignUp(quint64(bytes))));
+}
+
+void ReadAhead::setPlayhead(quint64 fileOffset)
+{
+    QMutexLocker lock(&m_mutex);
+    m_playhead = qBound(m_begin, fileOffset, m_end);
+    if (m_playhead < m_readyBegin || m_playhead > m_readyEnd) {
+        // 준비 구간 밖으로 seek: 새 위치부터 다시 채운다. 진행 중인 pread 결과는 버림
+        m_readyBegin = m_readyEnd = m_dropped = alignDown(m_playhead);
+        ++m_generation;
+    }
+    m_wake.wakeAll();
+}
+
+bool ReadAhead::isReady(quint64 fileOffset, quint64 len)
+{
+    QMutexLocker lock(&m_mutex);
+    const quint64 end = qMin(fileOffset + len, m_end);
+    const bool ready = fileOffset >= m_readyBegin && end <= m_readyEnd;
+    if (!ready)
+        ++m_stats.underruns;
+    return ready;
+}
+
+ReadAhead::Stats ReadAhead::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    Stats s = m_stats;
+    const quint64 ready = qMin(m_readyEnd, m_end);
+    s.bufferedBytes = ready > m_playhead ? ready - m_playhead : 0;
+    s.bufferedSeconds = m_bytesPerSecond ? double(s.bufferedBytes) / m_bytesPerSecond : 0.0;
+    s.fill = m_aheadSeconds > 0 ? qMin(1.0, s.bufferedSeconds / m_aheadSeconds) : 0.0;
+    return s;
+}
+
+int ReadAhead::latencyBucket(qint64 usec)
+{
+    qint64 limit = 250;
+    int i = 0;
+    while (i < LatencyBuckets - 1 && usec >= limit) {
+        limit *= 2;
+        ++i;
+    }
+    return i;
+}
+
+// 한참 지나간 구간은 페이지 캐시에서 내린다 (짧은 뒤로 seek 용으로 ahead 만큼은 남김).
+// mmap 으로 매핑 중인 페이지는 커널이 알아서 건너뛴다. m_mutex 를 잡고 부른다.
+// 내린 구간은 준비 구간에서도 빼서, 그리로 뒤로 seek 하면 isReady() 가 false 가 되고
+// setPlayhead() 가 거기서부터 다시 채우게 한다 (소비자가 NFS 에서 직접 읽지 않게)
+void ReadAhead::dropBehind(int fd, quint64 playhead)
+{
+    const quint64 keep = quint64(m_aheadSeconds * m_bytesPerSecond);
+    if (playhead < keep)
+        return;
+    const quint64 upTo = alignDown(playhead - keep);
+    if (upTo >= m_dropped + quint64(m_blockSize)) {
+        posix_fadvise(fd, off_t(m_dropped), off_t(upTo - m_dropped), POSIX_FADV_DONTNEED);
+        m_dropped = upTo;
+        m_readyBegin = qMax(m_readyBegin, m_dropped);
+    }
+}
+
+void ReadAhead::run()
+{
+    QMutexLocker lock(&m_mutex);
+    const int fd = m_fd;
+    const int blockSize = m_blockSize;
+    void *buf = nullptr;
+    if (posix_memalign(&buf, kAlign, size_t(blockSize)) != 0)
+        return;
+
+    while (!m_stop) {
+        const quint64 ahead = quint64(m_aheadSeconds * m_bytesPerSecond);
+        const quint64 target = qMin(m_end, m_playhead + ahead);
+        if (m_readyEnd >= target) {
+            m_wake.wait(&m_mutex, 200);
+            continue;
+        }
+
+        const quint64 from = m_readyEnd;
+        const quint64 len = qMin<quint64>(quint64(blockSize), alignUp(m_end) - from);
+        const quint64 gen = m_generation;
+        lock.unlock();
+
+        // 다음 블록은 커널에 비동기로 요청해 두고, 이번 블록은 직접 읽는다
+        posix_fadvise(fd, off_t(from + len), off_t(len), POSIX_FADV_WILLNEED);
+        QElapsedTimer t;
+        t.start();
+        const ssize_t n = pread(fd, buf, size_t(len), off_t(from));
+        const int err = errno;
+        const qint64 usec = t.nsecsElapsed() / 1000;
+
+        lock.relock();
+        if (n < 0) {
+            if (err == EINTR)
+                continue;
+            // NFS 일시 장애: 잠깐 쉬고 같은 위치부터 재시도
+            ++m_stats.readErrors;
+            m_wake.wait(&m_mutex, 500);
+            continue;
+        }
+        ++m_stats.reads;
+        m_stats.bytesRead += quint64(n);
+        ++m_stats.latency[latencyBucket(usec)];
+        if (gen != m_generation)
+            continue;   // 읽는 동안 seek 됨
+        // n == 0 이면 파일이 data 크기보다 짧은 것: 끝까지 준비된 것으로 본다
+        m_readyEnd = n > 0 ? from + quint64(n) : alignUp(m_end);
+        dropBehind(fd, m_playhead);
+    }
+    free(buf);
+}
@@ -0,0 +1,78 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+
+// NFS 위의 파일을 GUI 스레드 대신 전용 I/O 스레드가 미리 읽어 두는 레이어.
+// 재생 위치(playhead) 앞쪽 aheadSeconds 만큼을 큰 정렬 단위 pread 로 페이지
+// 캐시에 올려 두고, 소비자는 isReady() 로 확인한 뒤 mmap/read 로 가져간다.
+// 준비가 안 됐으면 블록하지 말고 그 틱을 건너뛰면 된다.
+class ReadAhead : public QThread
+{
+    Q_OBJECT
+public:
+    enum { LatencyBuckets = 16 };   // 250us, 500us, 1ms ... 8s 이상
+    enum { FallbackBytesPerSecond = 1 << 20 };
+
+    struct Stats {
+        quint64 bufferedBytes = 0;   // playhead 앞으로 준비된 바이트
+        double  bufferedSeconds = 0;
+        double  fill = 0;            // bufferedSeconds / aheadSeconds (0..1)
+        quint64 reads = 0;
+        quint64 bytesRead = 0;
+        quint64 underruns = 0;       // isReady() 가 false 였던 횟수
+        quint64 readErrors = 0;
+        quint32 latency[LatencyBuckets] = {};
+
+        double latencyBucketMs(int i) const;   // 버킷 i 의 상한 (ms)
+        QString toString() const;
+    };
+
+    explicit ReadAhead(QObject *parent = nullptr);
+    ~ReadAhead();
+
+    // [dataOffset, dataOffset+dataSize) 를 bytesPerSecond 기준으로 미리 읽는다.
+    // bytesPerSecond 가 0 (모름) 이면 FallbackBytesPerSecond 로 잡는다
+    bool open(const QString &path, quint64 dataOffset, quint64 dataSize,
+              quint32 bytesPerSecond);
+    void close();
+
+    void   setAheadSeconds(double sec);
+    double aheadSeconds() const;
+    void   setBlockSize(int bytes);     // 한 번의 pread 크기 (4KB 배수로 맞춤)
+
+    // 소비자의 현재 파일 위치. 준비 구간 밖으로 점프하면 그 위치부터 다시 읽는다
+    void setPlayhead(quint64 fileOffset);
+    // [fileOffset, fileOffset+len) 이 이미 읽혀 있는가 (블록하지 않음)
+    bool isReady(quint64 fileOffset, quint64 len);
+
+    Stats stats() const;
+
+protected:
+    void run() override;
+
+private:
+    static int latencyBucket(qint64 usec);
+    void dropBehind(int fd, quint64 playhead);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    int      m_fd;
+    quint64  m_begin;          // data 청크 범위
+    quint64  m_end;
+    quint32  m_bytesPerSecond;
+    double   m_aheadSeconds;
+    int      m_blockSize;
+    quint64  m_playhead;
+    quint64  m_readyBegin;     // 페이지 캐시에 올라온 구간
+    quint64  m_readyEnd;
+    quint64  m_dropped;        // 여기까지는 DONTNEED 처리함
+    quint64  m_generation;     // seek 할 때마다 증가
+    bool     m_stop;
+    Stats    m_stats;
+};
+
+#endif // READAHEAD_H
@@ -0,0 +1,199 @@
+#include "relayupstream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace {
+
+const int kReadChunk = 64 * 1024;
+
+} // namespace
+
+RelayUpstream::RelayUpstream()
+    : m_resolved(false),
+      m_fd(-1),
+      m_established(false),
+      m_inUsed(0),
+      m_haveSequence(false),
+      m_nextSequence(0)
+{
+    memset(&m_addr, 0, sizeof m_addr);
+}
+
+RelayUpstream::~RelayUpstream()
+{
+    close();
+    m_clock.close();
+}
+
+bool RelayUpstream::setServer(const QString &host, quint16 port)
+{
+    close();
+    m_clock.close();
+    m_resolved = false;
+    m_server = QString("%1:%2").arg(host).arg(port);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    const int rc = getaddrinfo(host.toLatin1().constData(),
+                               QByteArray::number(port).constData(), &hints, &res);
+    if (rc != 0 || !res) {
+        m_error = QString("%1: %2").arg(host).arg(QString::fromLocal8Bit(gai_strerror(rc)));
+        return false;
+    }
+    memcpy(&m_addr, res->ai_addr, sizeof m_addr);
+    freeaddrinfo(res);
+
+    // 다시 연결할 때 DNS 를 타지 않게 숫자 주소로 연다. 연결이 끊겨도 유지한다
+    char numeric[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &m_addr.sin_addr, numeric, sizeof numeric);
+    if (!m_clock.open(QString::fromLatin1(numeric), port)) {
+        m_error = m_clock.errorString();
+        return false;
+    }
+    m_resolved = true;
+    m_error.clear();
+    return true;
+}
+
+bool RelayUpstream::connectToServer()
+{
+    close();
+    if (!m_resolved)
+        return false;
+    m_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+    const int one = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    if (::connect(m_fd, reinterpret_cast<const sockaddr *>(&m_addr), sizeof m_addr) != 0
+            && errno != EINPROGRESS) {
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool RelayUpstream::finishConnect()
+{
+    int err = 0;
+    socklen_t len = sizeof err;
+    if (getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+        err = errno;
+    if (err != 0) {
+        m_error = QString::fromLocal8Bit(strerror(err));
+        return false;
+    }
+    m_established = true;
+    m_in.resize(2 * kReadChunk);
+    m_inUsed = 0;
+    m_haveSequence = false;
+    ++m_stats.connects;
+    m_error.clear();
+    return true;
+}
+
+void RelayUpstream::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_established = false;
+    m_inUsed = 0;
+}
+
+bool RelayUpstream::read(QList<QByteArray> *out)
+{
+    for (;;) {
+        if (m_in.size() - m_inUsed < kReadChunk)
+            m_in.resize(m_inUsed + 2 * kReadChunk);
+        const ssize_t n = recv(m_fd, m_in.data() + m_inUsed, size_t(m_in.size() - m_inUsed),
+                               MSG_DONTWAIT);
+        if (n == 0) {
+            m_error = QString("Connection closed by %1").arg(m_server);
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            m_error = QString::fromLocal8Bit(strerror(errno));
+            return false;
+        }
+        m_inUsed += int(n);
+    }
+
+    const uchar *p = reinterpret_cast<const uchar *>(m_in.constData());
+    int pos = 0;
+    while (m_inUsed - pos >= StreamProtocol::HeaderSize) {
+        StreamProtocol::Header h;
+        if (!StreamProtocol::readHeader(p + pos, &h)) {
+            m_error = QString("Protocol error from %1").arg(m_server);
+            return false;
+        }
+        const qint64 total = qint64(h.headerSize) + h.payloadSize;
+        if (m_inUsed - pos < total)
+            break;
+        forward(h, p + pos + h.headerSize, out);
+        pos += int(total);
+    }
+    if (pos > 0) {
+        memmove(m_in.data(), m_in.constData() + pos, size_t(m_inUsed - pos));
+        m_inUsed -= pos;
+    }
+    return true;
+}
+
+// 상위가 헤더를 늘렸어도 하위에는 이 버전의 헤더로 다시 쓴다 (payload 는 그대로)
+void RelayUpstream::forward(const StreamProtocol::Header &h, const uchar *payload,
+                            QList<QByteArray> *out)
+{
+    switch (h.type) {
+    case StreamProtocol::Format:
+        if (h.payloadSize < StreamProtocol::FormatPayloadSize)
+            return;
+        break;
+    case StreamProtocol::Audio: {
+        if (h.payloadSize < StreamProtocol::AudioPrefixSize)
+            return;
+        if (m_haveSequence && h.sequence != m_nextSequence)
+            m_stats.gaps += quint64(h.sequence - m_nextSequence);
+        m_haveSequence = true;
+        m_nextSequence = h.sequence + 1;
+        if (!m_clock.isSynced()) {
+            // 재생 시각을 옮길 수 없다. 틀린 시각으로 넘기느니 버린다 (처음 수십 ms)
+            ++m_stats.unsynced;
+            return;
+        }
+        break;
+    }
+    case StreamProtocol::End:
+        break;
+    default:
+        return;             // Delay, 모르는 패킷
+    }
+
+    QByteArray packet(StreamProtocol::HeaderSize + int(h.payloadSize), Qt::Uninitialized);
+    uchar *d = reinterpret_cast<uchar *>(packet.data());
+    StreamProtocol::writeHeader(d, h.type, h.payloadSize, 0);
+    memcpy(d + StreamProtocol::HeaderSize, payload, h.payloadSize);
+    if (h.type == StreamProtocol::Audio) {
+        uchar *at = d + StreamProtocol::HeaderSize + 8;
+        qToLittleEndian<qint64>(m_clock.toLocal(qFromLittleEndian<qint64>(at)), at);
+        ++m_stats.packets;
+    }
+    out->append(packet);
+}
@@ -0,0 +1,80 @@
+#ifndef RELAYUPSTREAM_H
+#define RELAYUPSTREAM_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <netinet/in.h>
+#include "clocksync.h"
+#include "streamprotocol.h"
+
+// 릴레이 (edge) 모드의 상위 연결. StreamClient 와 같은 TCP 스트림과 시계 동기를
+// 쓰지만 스레드를 만들지 않고 서버 엔진의 epoll 안에서 돈다 (ClockSync 처럼 fd 와
+// 시각만 넘겨받음). 연결도 논블로킹이라 상위가 죽어 있어도 엔진이 막히지 않는다.
+//
+// 받은 패킷은 디코드하지 않는다. 오디오 패킷은 presentationNs 만 이 호스트 시계로
+// 바꿔 그대로 내보내므로 하위 클라이언트 (이 릴레이에 시계를 맞춤) 는 원본 서버의
+// 청취자와 같은 순간에 재생한다. 단마다 더해지는 것은 전달 지연뿐이고, 그만큼
+// 원본 서버의 playout 여유가 줄어든다. Delay 패킷은 이 릴레이 자신에게 온 것이라
+// 버린다 (하위 스피커 지연은 이 릴레이가 따로 보낸다).
+class RelayUpstream
+{
+public:
+    struct Stats {
+        quint64 packets = 0;          // 넘긴 오디오 패킷
+        quint64 gaps = 0;             // 상위에서 빠진 패킷 (sequence 로 감지)
+        quint64 unsynced = 0;         // 시계가 맞기 전이라 버린 패킷
+        quint64 connects = 0;
+    };
+
+    RelayUpstream();
+    ~RelayUpstream();
+
+    // 주소 해석 (DNS) 은 여기서만 한다. 엔진 스레드를 시작하기 전에 부를 것
+    bool setServer(const QString &host, quint16 port);
+    QString server() const { return m_server; }
+    QString errorString() const { return m_error; }
+
+    // 논블로킹 연결 시작. 소켓이 쓰기 가능해지면 finishConnect().
+    // finishConnect() / read() 가 false 면 close() 하고 나중에 다시 연결할 것
+    bool connectToServer();
+    bool finishConnect();
+    void close();
+    int  socketDescriptor() const { return m_fd; }
+    bool isConnecting() const { return m_fd >= 0 && !m_established; }
+    bool isConnected() const { return m_fd >= 0 && m_established; }
+
+    // 읽을 수 있는 만큼 읽어 넘길 패킷을 out 에 붙인다 (헤더 16 바이트로 맞춘
+    // Format / Audio / End, 오디오의 sequence 는 0). 끊겼거나 프로토콜 오류면 false
+    bool read(QList<QByteArray> *out);
+
+    // 시계 동기 (상위 서버와 같은 포트의 UDP)
+    int    clockDescriptor() const { return m_clock.socketDescriptor(); }
+    void   serviceClock(qint64 nowNs) { m_clock.service(nowNs); }
+    qint64 nextClockNs() const { return m_clock.nextServiceNs(); }
+    bool   isSynced() const { return m_clock.isSynced(); }
+    qint64 clockOffsetNs() const { return m_clock.offsetNs(); }
+
+    Stats stats() const { return m_stats; }
+
+private:
+    void forward(const StreamProtocol::Header &h, const uchar *payload, QList<QByteArray> *out);
+
+    QString     m_server;             // host:port (표시용)
+    QString     m_error;
+    sockaddr_in m_addr;
+    bool        m_resolved;
+    int         m_fd;
+    bool        m_established;
+    ClockSync   m_clock;
+    QByteArray  m_in;
+    int         m_inUsed;
+    bool        m_haveSequence;
+    quint32     m_nextSequence;
+    Stats       m_stats;
+
+    Q_DISABLE_COPY(RelayUpstream)
+};
+
+#endif // RELAYUPSTREAM_H
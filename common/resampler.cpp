@@ -0,0 +1,78 @@
+#include "resampler.h"
+#include <cstring>
+#include <cmath>
+
+Resampler::Resampler(int channels)
+    : m_channels(1),
+      m_ratio(1.0),
+      m_frac(0.0)
+{
+    setChannels(channels);
+}
+
+void Resampler::setChannels(int channels)
+{
+    m_channels = qBound(1, channels, int(MaxChannels));
+    reset();
+}
+
+void Resampler::setRatio(double ratio)
+{
+    // 비율만 바꾸고 창/위상은 유지 -> 런타임 변경에도 끊김 없음
+    if (ratio > 0.0)
+        m_ratio = ratio;
+}
+
+void Resampler::reset()
+{
+    m_frac = 0.0;
+    memset(m_window, 0, sizeof m_window);
+}
+
+void Resampler::prime(const float *prev, double frac)
+{
+    // 입력 세 프레임을 먼저 밀어 넣게 해 창이 [prev, in0, in1, in2] 에서 시작한다
+    memset(m_window, 0, sizeof m_window);
+    if (prev)
+        memcpy(m_window + 3 * m_channels, prev, sizeof(float) * m_channels);
+    m_frac = 3.0 + qBound(0.0, frac, 0.999999);
+}
+
+qint64 Resampler::outputFramesFor(qint64 inFrames) const
+{
+    return qint64(std::ceil(double(inFrames) / m_ratio)) + 1;
+}
+
+void Resampler::process(const float *in, qint64 inFrames, qint64 *inUsed,
+                        float *out, qint64 outFrames, qint64 *outMade)
+{
+    const int ch = m_channels;
+    qint64 used = 0;
+    qint64 made = 0;
+    float *w = m_window;
+
+    while (made < outFrames) {
+        // x0..x1 구간을 벗어났으면 입력을 한 프레임씩 창에 밀어 넣는다
+        while (m_frac >= 1.0) {
+            if (used >= inFrames)
+                goto done;
+            memmove(w, w + ch, sizeof(float) * 3 * ch);
+            memcpy(w + 3 * ch, in + used * ch, sizeof(float) * ch);
+            ++used;
+            m_frac -= 1.0;
+        }
+        const float t = float(m_frac);
+        for (int c = 0; c < ch; ++c) {
+            const float xm1 = w[c], x0 = w[ch + c], x1 = w[2 * ch + c], x2 = w[3 * ch + c];
+            const float c1 = 0.5f * (x1 - xm1);
+            const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+            const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+            out[made * ch + c] = ((c3 * t + c2) * t + c1) * t + x0;
+        }
+        ++made;
+        m_frac += m_ratio;
+    }
+done:
+    if (inUsed) *inUsed = used;
+    if (outMade) *outMade = made;
+}
@@ -0,0 +1,43 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QtGlobal>
+
+// 인터리브 float 용 스트리밍 리샘플러 (4점 Hermite 보간).
+// 입력 버퍼에서 출력 버퍼로 바로 써서 중간 복사가 없다.
+// Opus(20kHz 대역 제한) 48k -> 44.1k 변환이나, 수신측 클럭 드리프트 보정처럼
+// 비율이 1 에 아주 가까운 경우에 쓰는 용도. 큰 폭의 다운샘플링용 필터는 없다.
+class Resampler
+{
+public:
+    enum { MaxChannels = 8 };
+
+    explicit Resampler(int channels = 2);
+
+    void   setChannels(int channels);
+    int    channels() const { return m_channels; }
+    // 입력 샘플레이트 / 출력 샘플레이트. 1.0 이면 그대로 통과 (reset() 뒤 지연 3프레임)
+    void   setRatio(double ratio);
+    double ratio() const { return m_ratio; }
+    void   reset();
+    // reset() 대신 쓰면 지연이 없다: 다음 입력 첫 프레임에서 frac (0..1) 만큼 뒤가
+    // 첫 출력이 된다. prev 는 그 앞 입력 프레임 (없으면 nullptr = 무음).
+    // 대신 끝에서 입력 2프레임이 더 있어야 마지막 출력이 나온다
+    void   prime(const float *prev, double frac = 0.0);
+
+    // in 에서 최대 inFrames 를 소비하며 out 에 최대 outFrames 를 쓴다.
+    // 실제로 소비/생산한 프레임 수를 *inUsed / *outMade 에 돌려준다.
+    void process(const float *in, qint64 inFrames, qint64 *inUsed,
+                 float *out, qint64 outFrames, qint64 *outMade);
+
+    // inFrames 를 넣었을 때 나올 출력 프레임 수 (대략, 버퍼 크기 계산용)
+    qint64 outputFramesFor(qint64 inFrames) const;
+
+private:
+    int    m_channels;
+    double m_ratio;
+    double m_frac;                         // x0 과 x1 사이 위치 (0..1)
+    float  m_window[4 * MaxChannels];      // x-1, x0, x1, x2 (프레임 단위)
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,319 @@
+#include "rtpfec.h"
+#include <QtEndian>
+#include <string.h>
+
+namespace {
+
+const int kMaxPacket  = 1500;
+const int kMaxPending = 64;             // 기다리는 FEC 패킷 수 상한
+
+// seq 비교 (16비트 wrap)
+inline int seqDiff(quint16 a, quint16 b)
+{
+    return qint16(quint16(a - b));
+}
+
+// 8바이트씩 (정렬이 안 맞을 수 있어 memcpy 로 읽고 쓴다)
+void xorInto(uchar *dst, const uchar *src, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        quint64 a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < n; ++i)
+        dst[i] ^= src[i];
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+RtpFecEncoder::RtpFecEncoder()
+    : m_groupSize(0),
+      m_interleave(1),
+      m_haveBase(false),
+      m_blockBase(0),
+      m_ssrc(0),
+      m_sequence(0),
+      m_count(0)
+{
+}
+
+void RtpFecEncoder::setParameters(int groupSize, int interleave)
+{
+    m_groupSize = groupSize > 0 ? qMin(groupSize, int(MaxGroupSize)) : 0;
+    m_interleave = qBound(1, interleave, int(MaxInterleave));
+    m_columns = QVector<Column>(m_groupSize > 0 ? m_interleave : 0);
+    for (Column &c : m_columns)
+        c.parity = QByteArray(kMaxPacket, '\0');
+    m_held.clear();
+    m_haveBase = false;
+}
+
+void RtpFecEncoder::reset()
+{
+    for (Column &c : m_columns)
+        c.count = 0;
+    m_held.clear();
+    m_haveBase = false;
+}
+
+void RtpFecEncoder::add(const uchar *packet, int size, QList<QByteArray> *fec)
+{
+    if (m_groupSize <= 0 || size < RtpHeaderSize || size > kMaxPacket)
+        return;
+    const quint16 seq = qFromBigEndian<quint16>(packet + 2);
+    const int blockSize = m_groupSize * m_interleave;
+    if (m_haveBase && quint16(seq - m_blockBase) >= blockSize)
+        flush(fec);         // seq 가 건너뛰었으면 남은 열을 닫고 새 블록
+    if (!m_haveBase) {
+        m_blockBase = seq;
+        m_haveBase = true;
+    }
+    m_ssrc = qFromBigEndian<quint32>(packet + 8);
+    ++m_count;
+    while (!m_held.isEmpty() && m_held.first().due <= m_count)
+        fec->append(m_held.takeFirst().packet);
+
+    const int j = quint16(seq - m_blockBase);
+    Column &c = m_columns[j % m_interleave];
+    const int body = size - RtpHeaderSize;
+    uchar *parity = reinterpret_cast<uchar *>(c.parity.data());
+    c.lastTimestamp = qFromBigEndian<quint32>(packet + 4);
+    if (c.count == 0) {
+        // 첫 패킷은 그대로 복사. parity 의 c.size 뒤는 항상 0 으로 둔다
+        c.snBase = seq;
+        c.length = quint16(body);
+        c.byte0 = packet[0];
+        c.byte1 = packet[1];
+        c.timestamp = c.lastTimestamp;
+        memcpy(parity, packet + RtpHeaderSize, size_t(body));
+        if (c.size > body)
+            memset(parity + body, 0, size_t(c.size - body));
+        c.size = body;
+    } else {
+        c.length ^= quint16(body);
+        c.byte0 ^= packet[0];
+        c.byte1 ^= packet[1];
+        c.timestamp ^= c.lastTimestamp;
+        c.size = qMax(c.size, body);
+        xorInto(parity, packet + RtpHeaderSize, body);
+    }
+    ++c.count;
+
+    if (j / m_interleave == m_groupSize - 1)
+        emitColumn(&c);
+    if (j == blockSize - 1)
+        m_blockBase = quint16(seq + 1);
+}
+
+void RtpFecEncoder::flush(QList<QByteArray> *fec)
+{
+    for (Column &c : m_columns) {
+        if (c.count > 0)
+            emitColumn(&c);
+    }
+    while (!m_held.isEmpty())
+        fec->append(m_held.takeFirst().packet);
+    m_haveBase = false;
+}
+
+void RtpFecEncoder::emitColumn(Column *c)
+{
+    QByteArray out(RtpHeaderSize + FecHeaderSize + c->size, Qt::Uninitialized);
+    uchar *h = reinterpret_cast<uchar *>(out.data());
+    h[0] = 0x80;                                   // V=2
+    h[1] = uchar(PayloadType);
+    qToBigEndian<quint16>(m_sequence++, h + 2);
+    qToBigEndian<quint32>(c->lastTimestamp, h + 4);
+    qToBigEndian<quint32>(m_ssrc, h + 8);
+
+    uchar *f = h + RtpHeaderSize;
+    qToBigEndian<quint16>(c->snBase, f);
+    f[2] = uchar(c->count);
+    f[3] = uchar(m_interleave);
+    qToBigEndian<quint16>(c->length, f + 4);
+    f[6] = c->byte0;
+    f[7] = c->byte1;
+    qToBigEndian<quint32>(c->timestamp, f + 8);
+    memcpy(f + FecHeaderSize, c->parity.constData(), size_t(c->size));
+    Held held;
+    held.due = m_count + quint64(m_interleave);
+    held.packet = out;
+    m_held.append(held);
+    c->count = 0;
+}
+
+// ---------------------------------------------------------------------------
+
+RtpFecDecoder::RtpFecDecoder()
+    : m_slots(Window),
+      m_haveNewest(false),
+      m_newest(0)
+{
+}
+
+void RtpFecDecoder::reset()
+{
+    for (Slot &s : m_slots)
+        s.valid = false;
+    m_pending.clear();
+    m_recovered.clear();
+    m_haveNewest = false;
+    m_stats = Stats();
+}
+
+const RtpFecDecoder::Slot *RtpFecDecoder::find(quint16 seq) const
+{
+    const Slot &s = m_slots.at(seq % Window);
+    return s.valid && s.seq == seq ? &s : nullptr;
+}
+
+void RtpFecDecoder::store(quint16 seq, const uchar *packet, int size)
+{
+    Slot &s = m_slots[seq % Window];
+    s.valid = true;
+    s.seq = seq;
+    // 같은 크기면 메모리를 다시 쓴다 (대부분의 패킷 길이가 같음)
+    s.data.resize(size);
+    memcpy(s.data.data(), packet, size_t(size));
+    if (!m_haveNewest || seqDiff(seq, m_newest) > 0) {
+        m_newest = seq;
+        m_haveNewest = true;
+    }
+}
+
+bool RtpFecDecoder::addMedia(const uchar *packet, int size)
+{
+    if (size < RtpFecEncoder::RtpHeaderSize || (packet[0] >> 6) != 2)
+        return false;
+    const quint16 seq = qFromBigEndian<quint16>(packet + 2);
+    if (find(seq)) {
+        ++m_stats.duplicates;
+        return false;
+    }
+    ++m_stats.media;
+    store(seq, packet, size);
+
+    // 이 패킷을 기다리던 FEC 가 있으면 다시 본다
+    for (int i = 0; i < m_pending.size();) {
+        const Pending &f = m_pending.at(i);
+        const int d = quint16(seq - f.snBase);
+        if (d % f.interleave == 0 && d / f.interleave < f.count && tryRecover(f))
+            m_pending.removeAt(i);
+        else
+            ++i;
+    }
+    expire();
+    return true;
+}
+
+void RtpFecDecoder::addFec(const uchar *packet, int size)
+{
+    const int headers = RtpFecEncoder::RtpHeaderSize + RtpFecEncoder::FecHeaderSize;
+    if (size < headers || (packet[0] >> 6) != 2)
+        return;
+    const uchar *f = packet + RtpFecEncoder::RtpHeaderSize;
+    Pending p;
+    p.snBase = qFromBigEndian<quint16>(f);
+    p.count = f[2];
+    p.interleave = f[3];
+    if (p.count < 1 || p.count > RtpFecEncoder::MaxGroupSize
+            || p.interleave < 1 || p.interleave > RtpFecEncoder::MaxInterleave)
+        return;
+    ++m_stats.fec;
+    p.packet = QByteArray(reinterpret_cast<const char *>(packet), size);
+    if (!tryRecover(p)) {
+        if (m_pending.size() >= kMaxPending)
+            m_pending.removeFirst();
+        m_pending.append(p);
+    }
+    expire();
+}
+
+bool RtpFecDecoder::tryRecover(const Pending &f)
+{
+    int missing = 0;
+    quint16 missingSeq = 0;
+    for (int i = 0; i < f.count; ++i) {
+        const quint16 s = quint16(f.snBase + i * f.interleave);
+        if (!find(s)) {
+            ++missing;
+            missingSeq = s;
+        }
+    }
+    if (missing == 0)
+        return true;
+    if (missing > 1)
+        return false;
+
+    const uchar *h = reinterpret_cast<const uchar *>(f.packet.constData());
+    const uchar *fh = h + RtpFecEncoder::RtpHeaderSize;
+    quint16 length = qFromBigEndian<quint16>(fh + 4);
+    uchar byte0 = fh[6];
+    uchar byte1 = fh[7];
+    quint32 timestamp = qFromBigEndian<quint32>(fh + 8);
+    const int paritySize = f.packet.size() - RtpFecEncoder::RtpHeaderSize
+            - RtpFecEncoder::FecHeaderSize;
+
+    QByteArray out(RtpFecEncoder::RtpHeaderSize + paritySize, Qt::Uninitialized);
+    uchar *o = reinterpret_cast<uchar *>(out.data());
+    memcpy(o + RtpFecEncoder::RtpHeaderSize, fh + RtpFecEncoder::FecHeaderSize, size_t(paritySize));
+    for (int i = 0; i < f.count; ++i) {
+        const Slot *s = find(quint16(f.snBase + i * f.interleave));
+        if (!s)
+            continue;
+        const uchar *p = reinterpret_cast<const uchar *>(s->data.constData());
+        const int body = s->data.size() - RtpFecEncoder::RtpHeaderSize;
+        if (body > paritySize)
+            return true;            // 이 FEC 로 보호하는 패킷이 아니다 (다른 스트림)
+        length ^= quint16(body);
+        byte0 ^= p[0];
+        byte1 ^= p[1];
+        timestamp ^= qFromBigEndian<quint32>(p + 4);
+        xorInto(o + RtpFecEncoder::RtpHeaderSize, p + RtpFecEncoder::RtpHeaderSize, body);
+    }
+    if (length > paritySize || (byte0 >> 6) != 2)
+        return true;
+
+    o[0] = byte0;
+    o[1] = byte1;
+    qToBigEndian<quint16>(missingSeq, o + 2);
+    qToBigEndian<quint32>(timestamp, o + 4);
+    memcpy(o + 8, h + 8, 4);                       // SSRC 는 FEC 패킷과 같다
+    out.resize(RtpFecEncoder::RtpHeaderSize + length);
+    store(missingSeq, o, out.size());
+    m_recovered.append(out);
+    ++m_stats.recovered;
+    return true;
+}
+
+// 열의 마지막 패킷이 창 절반보다 오래됐으면 더 기다려도 소용없다
+void RtpFecDecoder::expire()
+{
+    if (!m_haveNewest)
+        return;
+    while (!m_pending.isEmpty()) {
+        const Pending &f = m_pending.first();
+        const quint16 last = quint16(f.snBase + (f.count - 1) * f.interleave);
+        if (seqDiff(m_newest, last) < Window / 2)
+            break;
+        for (int i = 0; i < f.count; ++i) {
+            if (!find(quint16(f.snBase + i * f.interleave)))
+                ++m_stats.unrecoverable;
+        }
+        m_pending.removeFirst();
+    }
+}
+
+bool RtpFecDecoder::takeRecovered(QByteArray *packet)
+{
+    if (m_recovered.isEmpty())
+        return false;
+    *packet = m_recovered.takeFirst();
+    return true;
+}
@@ -0,0 +1,141 @@
+#ifndef RTPFEC_H
+#define RTPFEC_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+// RTP 손실 복구용 XOR FEC (RFC 5109 과 같은 방식, 헤더는 줄임).
+//
+// 미디어 패킷을 interleave 간격으로 건너뛰며 groupSize 개씩 묶어 (열) 패리티
+// 패킷 하나를 만든다. groupSize * interleave 개 블록에서 seq 가 j 인 패킷은
+// j % interleave 열에 들어간다.
+//
+//   seq   0  1  2  3  4  5  6  7  8  9 10 11     (groupSize 3, interleave 4)
+//   열    0  1  2  3  0  1  2  3  0  1  2  3  -> 8..11 뒤에 FEC 0..3
+//
+// 열마다 하나까지 복구되므로 연속으로 interleave 개를 잃어도 (Wi-Fi 버스트)
+// 모두 살린다. FEC 패킷은 열이 찬 뒤 미디어 패킷 interleave 개만큼 늦게 내보낸다.
+// 바로 보내면 열의 마지막 패킷과 붙어 있어 같은 burst 에 같이 잃기 쉽다.
+// 오버헤드는 1 / groupSize, 복구 지연은 최대 (groupSize + 1) * interleave 패킷.
+//
+// FEC 패킷은 RTP 헤더 (PT 97, 자체 seq) 뒤에 다음 헤더와 XOR 페이로드가 붙는다.
+//   u16 snBase  u8 count  u8 interleave  u16 length^  u8 byte0^  u8 byte1^  u32 ts^
+// (^ 는 보호하는 패킷들 값의 XOR, length 는 RTP 고정 헤더 뒤 길이)
+// 페이로드는 각 패킷의 RTP 고정 헤더 뒤 (확장 + 오디오) 를 가장 긴 것에 맞춰 XOR.
+class RtpFecEncoder
+{
+public:
+    enum {
+        PayloadType   = 97,
+        RtpHeaderSize = 12,
+        FecHeaderSize = 12,
+        MaxGroupSize  = 16,
+        MaxInterleave = 16
+    };
+
+    RtpFecEncoder();
+
+    // groupSize 0 이면 끈다
+    void setParameters(int groupSize, int interleave);
+    bool isEnabled() const { return m_groupSize > 0; }
+    int  groupSize() const { return m_groupSize; }
+    int  interleave() const { return m_interleave; }
+
+    // 보낸 (보내려다 실패한 것도) 미디어 패킷 전체. 열이 차면 FEC 패킷이 fec 에 붙는다
+    void add(const uchar *packet, int size, QList<QByteArray> *fec);
+    // 다 차지 않은 열도 지금까지 받은 것으로 FEC 를 만들고 새 블록을 시작 (트랙 끝)
+    void flush(QList<QByteArray> *fec);
+    void reset();
+
+private:
+    struct Column {
+        int        count = 0;
+        quint16    snBase = 0;
+        quint16    length = 0;
+        uchar      byte0 = 0;
+        uchar      byte1 = 0;
+        quint32    timestamp = 0;
+        quint32    lastTimestamp = 0;
+        int        size = 0;            // parity 에서 쓰는 길이
+        QByteArray parity;
+    };
+
+    struct Held {
+        quint64    due;                 // 이 수만큼 미디어 패킷이 지나면 내보냄
+        QByteArray packet;
+    };
+
+    void emitColumn(Column *c);
+
+    int     m_groupSize;
+    int     m_interleave;
+    bool    m_haveBase;
+    quint16 m_blockBase;                 // 지금 블록 첫 seq
+    quint32 m_ssrc;
+    quint16 m_sequence;                  // FEC 스트림 seq
+    QVector<Column> m_columns;
+    QList<Held> m_held;
+    quint64 m_count;                     // add() 한 미디어 패킷 수
+
+    Q_DISABLE_COPY(RtpFecEncoder)
+};
+
+// 수신 쪽. 최근 미디어 패킷을 seq 로 기억해 두었다가 FEC 패킷의 열에서
+// 하나만 빠졌으면 나머지와 XOR 해 되살린다. FEC 가 먼저 오고 빠진 패킷이
+// 나중에 도착해도 (순서 바뀜) 다시 확인한다.
+class RtpFecDecoder
+{
+public:
+    enum { Window = 512 };            // 기억하는 미디어 패킷 수 (>= 블록 길이)
+
+    struct Stats {
+        quint64 media = 0;            // 받은 미디어 패킷
+        quint64 fec = 0;              // 받은 FEC 패킷
+        quint64 recovered = 0;
+        quint64 unrecoverable = 0;    // 열에서 둘 이상 빠져 못 살린 패킷
+        quint64 duplicates = 0;       // 복구한 뒤에 원본이 도착
+    };
+
+    RtpFecDecoder();
+
+    void reset();
+    // 받은 미디어 패킷. 이미 받았거나 복구한 seq 면 false (버리면 된다)
+    bool addMedia(const uchar *packet, int size);
+    void addFec(const uchar *packet, int size);
+    // 복구한 미디어 패킷 (RTP 패킷 전체) 을 하나씩 꺼낸다
+    bool takeRecovered(QByteArray *packet);
+
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Slot {
+        bool       valid = false;
+        quint16    seq = 0;
+        QByteArray data;
+    };
+    struct Pending {
+        quint16    snBase;
+        int        count;
+        int        interleave;
+        QByteArray packet;            // FEC 패킷 전체
+    };
+
+    const Slot *find(quint16 seq) const;
+    void store(quint16 seq, const uchar *packet, int size);
+    // 복구했거나 더 볼 필요가 없으면 true
+    bool tryRecover(const Pending &f);
+    void expire();
+
+    QVector<Slot>  m_slots;
+    QList<Pending> m_pending;
+    QList<QByteArray> m_recovered;
+    bool    m_haveNewest;
+    quint16 m_newest;                 // 가장 앞선 미디어 seq
+    Stats   m_stats;
+
+    Q_DISABLE_COPY(RtpFecDecoder)
+};
+
+#endif // RTPFEC_H
@@ -0,0 +1,410 @@
+#include "rtpsender.h"
+#include <QtEndian>
+#include <random>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103               // Linux 4.18
+#endif
+
+namespace {
+
+const int kSlotSize = RtpSender::PayloadOffset + RtpSender::MaxPayload;
+// 커널이 GSO 한 번에 받는 세그먼트 수 (UDP_MAX_SEGMENTS, 오래된 커널 기준)
+const int kMaxGsoSegments = 64;
+
+// 목적지에 connect 한 멀티캐스트 송신 소켓. 실패하면 -1
+int udpSocket(const sockaddr_in &dst, unsigned char ttl, const in_addr *ifa)
+{
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    const unsigned char loop = 1;   // 같은 호스트의 수신기도 받도록
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof ttl);
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof loop);
+    if (ifa)
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, ifa, sizeof *ifa);
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&dst), sizeof dst) != 0) {
+        const int e = errno;
+        ::close(fd);
+        errno = e;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+RtpSender::RtpSender()
+    : m_fd(-1),
+      m_fecFd(-1),
+      m_port(0),
+      m_ttl(1),
+      m_ssrc(0),
+      m_sequence(0),
+      m_timestamp(0),
+      m_marker(true),
+      m_sampleRate(0),
+      m_channels(0),
+      m_opus(false),
+      m_opusFrames(0),
+      m_packetMs(5.0),
+      m_packetFrames(0),
+      m_pendingFrames(0),
+      m_pendingPresentationNs(0),
+      m_queued(0),
+      m_gso(false),
+      m_packets(0),
+      m_bytes(0),
+      m_errors(0),
+      m_fecPackets(0)
+{
+    // SSRC 와 시작 seq/timestamp 는 임의값 (RFC 3550 5.1)
+    std::random_device rd;
+    m_ssrc = rd();
+    m_sequence = quint16(rd());
+    m_timestamp = rd();
+    m_packet.resize(kSlotSize);
+    m_queue.resize(MaxQueued * kSlotSize);
+}
+
+RtpSender::~RtpSender()
+{
+    close();
+}
+
+bool RtpSender::open(const QString &group, quint16 port, int ttl,
+                     const QString &interfaceAddress)
+{
+    close();
+    sockaddr_in dst;
+    memset(&dst, 0, sizeof dst);
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    if (inet_pton(AF_INET, group.toLatin1().constData(), &dst.sin_addr) != 1) {
+        m_error = QString("Invalid RTP destination: %1").arg(group);
+        return false;
+    }
+    in_addr ifa;
+    ifa.s_addr = htonl(INADDR_ANY);
+    if (!interfaceAddress.isEmpty()
+            && inet_pton(AF_INET, interfaceAddress.toLatin1().constData(), &ifa) != 1) {
+        m_error = QString("Invalid interface address: %1").arg(interfaceAddress);
+        return false;
+    }
+
+    const unsigned char ttl8 = (unsigned char)qBound(0, ttl, 255);
+    const in_addr *ifp = interfaceAddress.isEmpty() ? nullptr : &ifa;
+    m_fd = udpSocket(dst, ttl8, ifp);
+    if (m_fd < 0) {
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+    int segment = 0;
+    socklen_t len = sizeof segment;
+    m_gso = getsockopt(m_fd, SOL_UDP, UDP_SEGMENT, &segment, &len) == 0;
+    if (m_fec.isEnabled()) {
+        dst.sin_port = htons(quint16(port + 2));
+        m_fecFd = udpSocket(dst, ttl8, ifp);
+        if (m_fecFd < 0) {
+            m_error = QString::fromLocal8Bit(strerror(errno));
+            close();
+            return false;
+        }
+    }
+    m_group = group;
+    m_port = port;
+    m_ttl = ttl8;
+    return true;
+}
+
+void RtpSender::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (m_fecFd >= 0) {
+        ::close(m_fecFd);
+        m_fecFd = -1;
+    }
+    m_pendingFrames = 0;
+    m_queued = 0;
+    m_fec.reset();
+    m_fecOut.clear();
+}
+
+void RtpSender::setPacketMilliseconds(double ms)
+{
+    m_packetMs = qBound(0.5, ms, 100.0);
+    if (m_channels > 0)
+        startTrack(m_sampleRate, m_channels, m_opus ? m_opusFrames : 0);
+}
+
+void RtpSender::setFec(int groupSize, int interleave)
+{
+    m_fec.setParameters(groupSize, interleave);
+}
+
+void RtpSender::startTrack(quint32 sampleRate, int channels, int opusFrames)
+{
+    flush();
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    m_opus = opusFrames > 0;
+    m_opusFrames = opusFrames;
+    const int maxFrames = qMax(1, maxPayload() / (channels * 2));
+    m_packetFrames = qBound(1, qRound(sampleRate * m_packetMs / 1000.0), maxFrames);
+    m_marker = true;
+}
+
+// FEC 패킷은 FEC 헤더만큼 더 크므로 미디어를 그만큼 줄여 MTU 를 지킨다
+int RtpSender::maxPayload() const
+{
+    return MaxPayload - (m_fec.isEnabled() ? int(RtpFecEncoder::FecHeaderSize) : 0);
+}
+
+void RtpSender::push(const qint16 *pcm, qint64 frames, qint64 presentationNs)
+{
+    if (m_fd < 0 || m_channels <= 0)
+        return;
+    const int ch = m_channels;
+    qint64 done = 0;
+    while (frames > 0) {
+        if (m_pendingFrames == 0)
+            m_pendingPresentationNs = presentationNs + done * 1000000000LL / m_sampleRate;
+        const int n = int(qMin<qint64>(frames, m_packetFrames - m_pendingFrames));
+        uchar *dst = reinterpret_cast<uchar *>(m_packet.data()) + PayloadOffset
+                + m_pendingFrames * ch * 2;
+        for (int i = 0; i < n * ch; ++i)
+            qToBigEndian<qint16>(pcm[i], dst + 2 * i);
+        pcm += n * ch;
+        frames -= n;
+        done += n;
+        m_pendingFrames += n;
+        if (m_pendingFrames == m_packetFrames)
+            sendPending(m_pendingFrames * ch * 2);
+    }
+}
+
+void RtpSender::pushEncoded(const QByteArray &packet, int frames, qint64 presentationNs)
+{
+    if (m_fd < 0 || !m_opus || packet.size() > maxPayload())
+        return;
+    memcpy(m_packet.data() + PayloadOffset, packet.constData(), size_t(packet.size()));
+    m_pendingFrames = frames;
+    m_pendingPresentationNs = presentationNs;
+    sendPending(packet.size());
+}
+
+void RtpSender::flush()
+{
+    if (m_fd >= 0 && m_pendingFrames > 0 && !m_opus)
+        sendPending(m_pendingFrames * m_channels * 2);
+    if (m_fecFd >= 0)
+        m_fec.flush(&m_fecOut);
+    sendQueued();
+}
+
+void RtpSender::sendQueued()
+{
+    if (m_queued > 0)
+        sendMedia();
+    if (!m_fecOut.isEmpty())
+        sendFec();
+}
+
+void RtpSender::sendPending(int payloadBytes)
+{
+    uchar *h = reinterpret_cast<uchar *>(m_packet.data());
+    h[0] = 0x90;                                   // V=2, P=0, X=1, CC=0
+    h[1] = uchar((m_marker ? 0x80 : 0) | PayloadType);
+    qToBigEndian<quint16>(m_sequence, h + 2);
+    qToBigEndian<quint32>(m_timestamp, h + 4);
+    qToBigEndian<quint32>(m_ssrc, h + 8);
+
+    // 헤더 확장: 재생 시각
+    uchar *x = h + HeaderSize;
+    qToBigEndian<quint16>(0xBEDE, x);
+    qToBigEndian<quint16>((ExtensionSize - 4) / 4, x + 2);
+    x[4] = uchar((PresentationExtId << 4) | (8 - 1));
+    qToBigEndian<qint64>(m_pendingPresentationNs, x + 5);
+    x[13] = x[14] = x[15] = 0;
+
+    const int len = PayloadOffset + payloadBytes;
+    if (m_queued == MaxQueued)
+        sendMedia();
+    memcpy(m_queue.data() + m_queued * kSlotSize, h, size_t(len));
+    m_queueSizes[m_queued++] = len;
+    // 못 보내도 seq/timestamp 는 진행 -> 수신 측에서 손실로 처리된다.
+    // FEC 에는 넣으므로 수신 측이 복구할 수 있다
+    if (m_fecFd >= 0)
+        m_fec.add(h, len, &m_fecOut);
+    ++m_sequence;
+    m_timestamp += quint32(m_pendingFrames);
+    m_marker = false;
+    m_pendingFrames = 0;
+}
+
+// 모은 미디어 패킷을 보낸다. 크기가 같은 패킷이 이어지면 (PCM) GSO 로 한 번에
+// 넘기고 (마지막 하나만 짧아도 됨), 나머지는 sendmmsg() 로 한꺼번에
+void RtpSender::sendMedia()
+{
+    mmsghdr msgs[MaxQueued];
+    iovec iov[MaxQueued];
+    memset(msgs, 0, sizeof msgs);
+    char *base = m_queue.data();
+    const int count = m_queued;
+    m_queued = 0;
+
+    int i = 0;
+    while (m_gso && i < count) {
+        const int size = m_queueSizes[i];
+        const int limit = qMin(kMaxGsoSegments, 65000 / size);
+        int n = 1;
+        while (i + n < count && n < limit && m_queueSizes[i + n] <= size) {
+            const bool last = m_queueSizes[i + n] < size;
+            ++n;
+            if (last)
+                break;
+        }
+        if (n == 1)
+            break;              // 한 개면 sendmmsg 에 맡긴다
+        union {
+            cmsghdr align;
+            char    buf[CMSG_SPACE(sizeof(quint16))];
+        } control;
+        memset(&control, 0, sizeof control);
+        msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        int total = 0;
+        for (int k = 0; k < n; ++k) {
+            iov[k].iov_base = base + (i + k) * kSlotSize;
+            iov[k].iov_len = size_t(m_queueSizes[i + k]);
+            total += m_queueSizes[i + k];
+        }
+        msg.msg_iov = iov;
+        msg.msg_iovlen = size_t(n);
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof control.buf;
+        cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(quint16));
+        const quint16 segment = quint16(size);
+        memcpy(CMSG_DATA(cm), &segment, sizeof segment);
+        ssize_t w;
+        do {
+            w = sendmsg(m_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (w < 0 && errno == EINTR);
+        if (w < 0 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT)) {
+            m_gso = false;      // 체크섬 오프로드가 없는 인터페이스 등. 이번 것부터 sendmmsg 로
+            break;
+        }
+        if (w < 0) {
+            m_errors += quint64(n);
+        } else {
+            m_packets += quint64(n);
+            m_bytes += quint64(total);
+        }
+        i += n;
+    }
+
+    const int n = count - i;
+    for (int k = 0; k < n; ++k) {
+        iov[k].iov_base = base + (i + k) * kSlotSize;
+        iov[k].iov_len = size_t(m_queueSizes[i + k]);
+        msgs[k].msg_hdr.msg_iov = &iov[k];
+        msgs[k].msg_hdr.msg_iovlen = 1;
+    }
+    m_packets += quint64(sendBatch(m_fd, msgs, n));
+}
+
+void RtpSender::sendFec()
+{
+    mmsghdr msgs[MaxQueued];
+    iovec iov[MaxQueued];
+    memset(msgs, 0, sizeof msgs);
+    while (!m_fecOut.isEmpty()) {
+        const int n = qMin(m_fecOut.size(), int(MaxQueued));
+        for (int k = 0; k < n; ++k) {
+            const QByteArray &p = m_fecOut.at(k);
+            iov[k].iov_base = const_cast<char *>(p.constData());
+            iov[k].iov_len = size_t(p.size());
+            msgs[k].msg_hdr.msg_iov = &iov[k];
+            msgs[k].msg_hdr.msg_iovlen = 1;
+        }
+        m_fecPackets += quint64(sendBatch(m_fecFd, msgs, n));
+        m_fecOut.erase(m_fecOut.begin(), m_fecOut.begin() + n);
+    }
+}
+
+// 보낸 패킷 수. 버퍼가 차는 등으로 못 보낸 패킷은 건너뛰고 오류로 센다
+int RtpSender::sendBatch(int fd, mmsghdr *msgs, int count)
+{
+    int sent = 0;
+    int i = 0;
+    while (i < count) {
+        const int n = sendmmsg(fd, msgs + i, unsigned(count - i), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ++m_errors;         // 맨 앞 패킷이 실패했다
+            ++i;
+            continue;
+        }
+        for (int k = i; k < i + n; ++k)
+            m_bytes += quint64(msgs[k].msg_len);
+        sent += n;
+        i += n;
+    }
+    return sent;
+}
+
+QString RtpSender::sdp() const
+{
+    in_addr a;
+    const bool multicast = inet_pton(AF_INET, m_group.toLatin1().constData(), &a) == 1
+            && IN_MULTICAST(ntohl(a.s_addr));
+    const QString conn = multicast ? QString("%1/%2").arg(m_group).arg(m_ttl) : m_group;
+    // FEC 는 별도 m= 줄 (모르는 수신기는 무시한다)
+    QString fec;
+    if (m_fec.isEnabled())
+        fec = QString("m=application %1 RTP/AVP %2\r\n"
+                      "a=rtpmap:%2 x-wavstreamer-xorfec/%3\r\n"
+                      "a=fmtp:%2 group=%4;interleave=%5\r\n")
+                .arg(m_port + 2).arg(int(RtpFecEncoder::PayloadType)).arg(m_sampleRate)
+                .arg(m_fec.groupSize()).arg(m_fec.interleave());
+    // RFC 7587: Opus 는 채널 수와 상관없이 opus/48000/2, 스테레오인지는 fmtp 로
+    const QString rtpmap = m_opus
+            ? QString("opus/48000/2\r\na=fmtp:%1 sprop-stereo=%2")
+              .arg(int(PayloadType)).arg(m_channels == 2 ? 1 : 0)
+            : QString("L16/%1/%2").arg(m_sampleRate).arg(m_channels);
+    const double ptime = (m_opus ? m_opusFrames : m_packetFrames) * 1000.0
+            / qMax<quint32>(1, m_sampleRate);
+    return QString("v=0\r\n"
+                   "o=- %1 1 IN IP4 0.0.0.0\r\n"
+                   "s=WAV Streamer\r\n"
+                   "c=IN IP4 %2\r\n"
+                   "t=0 0\r\n"
+                   "m=audio %3 RTP/AVP %4\r\n"
+                   "a=rtpmap:%4 %5\r\n"
+                   "a=ptime:%6\r\n"
+                   "a=extmap:%7 urn:x-wavstreamer:presentation-time\r\n"
+                   "%8")
+            .arg(m_ssrc)
+            .arg(conn)
+            .arg(m_port)
+            .arg(int(PayloadType))
+            .arg(rtpmap)
+            .arg(QString::number(ptime))
+            .arg(int(PresentationExtId))
+            .arg(fec);
+}
@@ -0,0 +1,124 @@
+#ifndef RTPSENDER_H
+#define RTPSENDER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include "rtpfec.h"
+
+struct mmsghdr;
+
+// RTP/UDP 멀티캐스트 송신기 (RFC 3550 + RFC 3551 L16, 또는 RFC 7587 Opus).
+// 청취자 수와 상관없이 패킷 하나를 한 번만 보낸다. 포맷은 SDP 로 알린다.
+//
+// push() 로 받은 PCM 을 packetMilliseconds 단위로 잘라 보내며, 자투리는 다음
+// push() 와 이어 붙인다. timestamp 는 샘플 단위로 연속이고 트랙이 바뀐 첫
+// 패킷에는 marker 비트를 세운다. 페이로드는 MTU 안에 들어가도록 자른다.
+//
+// 모든 패킷에 RFC 8285 one-byte 헤더 확장 (id 1) 으로 첫 샘플의 재생 시각
+// (서버 시계 ns, big endian 8바이트) 을 싣는다. SDP 의 a=extmap 참고.
+//
+// Opus 트랙은 엔진이 인코드한 패킷을 pushEncoded() 로 하나씩 그대로 보낸다
+// (timestamp 는 48 kHz, packetMilliseconds 는 쓰지 않음).
+//
+// setFec() 를 켜면 XOR FEC 패킷 (rtpfec.h) 을 port + 2 로 따로 보낸다.
+// FEC 를 모르는 수신기는 미디어 포트만 받으므로 영향이 없다.
+//
+// 만든 패킷은 바로 보내지 않고 모았다가 sendQueued() 에서 소켓마다 sendmmsg()
+// 한 번으로 보낸다 (엔진 틱마다 한 번). 크기가 같은 PCM 패킷은 커널이 UDP GSO 를
+// 지원하면 sendmsg() 하나로 넘겨 커널이 자른다. 2.5 ms 패킷에 FEC 까지 켜면
+// 패킷마다 부르던 send() 가 틱마다 한두 번으로 준다.
+class RtpSender
+{
+public:
+    enum {
+        PayloadType   = 96,          // 동적 (a=rtpmap 으로 L16 지정)
+        HeaderSize    = 12,
+        ExtensionSize = 16,          // 0xBEDE + 길이 + (id/len 1 + 8 + 패딩 3)
+        PresentationExtId = 1,
+        PayloadOffset = HeaderSize + ExtensionSize,
+        MaxPayload    = 1440,        // IPv4/UDP/RTP 헤더 포함 1500 MTU 안쪽
+        MaxQueued     = 32           // sendQueued() 전에 모으는 최대 패킷 수 (넘치면 바로 보냄)
+    };
+
+    RtpSender();
+    ~RtpSender();
+
+    // group 이 멀티캐스트가 아니어도 (유니캐스트 주소) 동작한다
+    bool open(const QString &group, quint16 port, int ttl = 1,
+              const QString &interfaceAddress = QString());
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    QString errorString() const { return m_error; }
+
+    void   setPacketMilliseconds(double ms);   // 기본 5ms
+    // open() 전에. overhead 1/groupSize, interleave 는 연속 손실을 견디는 길이.
+    // groupSize 0 이면 끈다
+    void   setFec(int groupSize, int interleave = 1);
+    int    fecGroupSize() const { return m_fec.groupSize(); }
+    int    fecInterleave() const { return m_fec.interleave(); }
+    double packetMilliseconds() const { return m_packetMs; }
+
+    // opusFrames 가 0 이 아니면 Opus 트랙 (패킷 하나의 길이, sampleRate 는 48000)
+    void startTrack(quint32 sampleRate, int channels, int opusFrames = 0);
+    // 페이로드 최대 크기 (FEC 헤더만큼 줄인 값). Opus 인코더 패킷 상한으로 쓴다
+    int  maxPayload() const;
+    // 호스트 순서 S16 인터리브. 네트워크 순서(big endian)로 바꿔 쌓는다.
+    // presentationNs 는 pcm 첫 프레임의 재생 시각
+    void push(const qint16 *pcm, qint64 frames, qint64 presentationNs);
+    // Opus 패킷 하나 (frames 는 48 kHz 프레임). maxPayload() 보다 크면 버린다
+    void pushEncoded(const QByteArray &packet, int frames, qint64 presentationNs);
+    void flush();                       // 남은 샘플을 짧은 패킷으로 만들고 모두 보냄
+    // push() / pushEncoded() 로 만든 패킷 (과 FEC) 을 보낸다
+    void sendQueued();
+
+    QString sdp() const;
+
+    quint64 packetsSent() const { return m_packets; }
+    quint64 bytesSent() const   { return m_bytes; }
+    quint64 sendErrors() const  { return m_errors; }
+    quint64 fecPacketsSent() const { return m_fecPackets; }
+
+private:
+    void sendPending(int payloadBytes);
+    void sendMedia();
+    void sendFec();
+    int  sendBatch(int fd, mmsghdr *msgs, int count);
+
+    int      m_fd;
+    int      m_fecFd;
+    QString  m_group;
+    quint16  m_port;
+    int      m_ttl;
+    QString  m_error;
+
+    quint32  m_ssrc;
+    quint16  m_sequence;
+    quint32  m_timestamp;              // 다음 패킷 첫 샘플의 timestamp
+    bool     m_marker;
+    quint32  m_sampleRate;
+    int      m_channels;
+    bool     m_opus;
+    int      m_opusFrames;             // Opus 패킷 하나의 프레임 수 (SDP ptime)
+    double   m_packetMs;
+    int      m_packetFrames;
+    QByteArray m_packet;               // 헤더 + 쌓는 중인 페이로드
+    int      m_pendingFrames;
+    qint64   m_pendingPresentationNs;  // 쌓는 중인 패킷 첫 샘플의 재생 시각
+    QByteArray m_queue;                // 보낼 패킷 (MaxQueued 칸, 칸마다 PayloadOffset + MaxPayload)
+    int      m_queueSizes[MaxQueued];
+    int      m_queued;
+    bool     m_gso;                    // 커널이 UDP_SEGMENT 를 받음 (안 되면 끔)
+
+    quint64  m_packets;
+    quint64  m_bytes;
+    quint64  m_errors;
+
+    RtpFecEncoder     m_fec;
+    QList<QByteArray> m_fecOut;
+    quint64  m_fecPackets;
+
+    Q_DISABLE_COPY(RtpSender)
+};
+
+#endif // RTPSENDER_H
@@ -0,0 +1,267 @@
+#include "shmring.h"
+#include <QAtomicInteger>
+#include <new>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+namespace {
+
+const quint32 kMagic = 0x31525357;        // "WSR1"
+
+QString systemError(const char *what)
+{
+    return QString("%1: %2").arg(QString::fromLatin1(what))
+            .arg(QString::fromLocal8Bit(strerror(errno)));
+}
+
+} // namespace
+
+// 첫 페이지. head / tail 은 누적 바이트 (넘치지 않음), 위치는 capacity 로 나눈 나머지.
+// 생산자와 소비자가 쓰는 값을 다른 캐시 라인에 둔다
+struct ShmRing::Shared
+{
+    quint32 magic;
+    quint32 capacity;
+    alignas(64) QAtomicInteger<quint64> head;     // 생산자만 쓴다
+    alignas(64) QAtomicInteger<quint64> tail;     // 소비자만 쓴다
+    QAtomicInt waiting;                           // 소비자가 eventfd 를 기다리는 중
+};
+
+ShmRing::ShmRing()
+    : m_shared(nullptr),
+      m_data(nullptr),
+      m_capacity(0),
+      m_mapSize(0),
+      m_memFd(-1),
+      m_eventFd(-1)
+{
+}
+
+ShmRing::~ShmRing()
+{
+    close();
+}
+
+bool ShmRing::create(int capacity)
+{
+    close();
+    m_error.clear();
+    const int page = int(sysconf(_SC_PAGESIZE));
+    capacity = (qMax(capacity, page) + page - 1) / page * page;
+    m_memFd = memfd_create("server2-stream", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // 크기를 봉인해 소비자가 줄여서 서버에 SIGBUS 를 내지 못하게 한다
+    if (m_memFd < 0 || m_eventFd < 0
+            || ftruncate(m_memFd, off_t(page) + capacity) != 0
+            || fcntl(m_memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        m_error = systemError("memfd");
+        close();
+        return false;
+    }
+    if (!map(m_memFd, capacity, true))
+        return false;
+    new (m_shared) Shared;
+    m_shared->magic = kMagic;
+    m_shared->capacity = quint32(capacity);
+    m_shared->head.storeRelease(0);
+    m_shared->tail.storeRelease(0);
+    m_shared->waiting.storeRelease(0);
+    return true;
+}
+
+// 생산자는 데이터 영역을 읽고 쓰고, 소비자는 읽기만 한다
+bool ShmRing::map(int memFd, int capacity, bool writer)
+{
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    const size_t cap = size_t(capacity);
+    m_mapSize = page + 2 * cap;
+    void *base = mmap(nullptr, m_mapSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        m_error = systemError("mmap");
+        m_mapSize = 0;
+        close();
+        return false;
+    }
+    uchar *b = static_cast<uchar *>(base);
+    const int prot = writer ? PROT_READ | PROT_WRITE : PROT_READ;
+    if (mmap(b, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memFd, 0) == MAP_FAILED
+            || mmap(b + page, cap, prot, MAP_SHARED | MAP_FIXED, memFd, off_t(page)) == MAP_FAILED
+            || mmap(b + page + cap, cap, prot, MAP_SHARED | MAP_FIXED, memFd, off_t(page))
+               == MAP_FAILED) {
+        m_error = systemError("mmap");
+        munmap(base, m_mapSize);
+        m_mapSize = 0;
+        close();
+        return false;
+    }
+    m_shared = reinterpret_cast<Shared *>(b);
+    m_data = b + page;
+    m_capacity = capacity;
+    return true;
+}
+
+void ShmRing::close()
+{
+    if (m_mapSize)
+        munmap(m_shared, m_mapSize);
+    m_shared = nullptr;
+    m_data = nullptr;
+    m_mapSize = 0;
+    m_capacity = 0;
+    if (m_memFd >= 0) {
+        ::close(m_memFd);
+        m_memFd = -1;
+    }
+    if (m_eventFd >= 0) {
+        ::close(m_eventFd);
+        m_eventFd = -1;
+    }
+}
+
+bool ShmRing::sendTo(int socket) const
+{
+    char tag = 'R';
+    iovec iov;
+    iov.iov_base = &tag;
+    iov.iov_len = 1;
+    union {
+        cmsghdr align;
+        char    buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof control);
+    msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+    cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    const int fds[2] = { m_memFd, m_eventFd };
+    memcpy(CMSG_DATA(cm), fds, sizeof fds);
+    ssize_t n;
+    do {
+        n = sendmsg(socket, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == 1;
+}
+
+bool ShmRing::attach(int socket)
+{
+    close();
+    m_error.clear();
+    char tag = 0;
+    iovec iov;
+    iov.iov_base = &tag;
+    iov.iov_len = 1;
+    union {
+        cmsghdr align;
+        char    buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+    ssize_t n;
+    do {
+        n = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        m_error = systemError("recvmsg");
+        return false;
+    }
+    const cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    if (n != 1 || tag != 'R' || !cm || cm->cmsg_level != SOL_SOCKET
+            || cm->cmsg_type != SCM_RIGHTS || cm->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        m_error = QString("Shared memory handshake failed");
+        return false;
+    }
+    int fds[2];
+    memcpy(fds, CMSG_DATA(cm), sizeof fds);
+    m_memFd = fds[0];
+    m_eventFd = fds[1];
+
+    struct stat st;
+    const qint64 page = sysconf(_SC_PAGESIZE);
+    const qint64 capacity = fstat(m_memFd, &st) == 0 ? qint64(st.st_size) - page : -1;
+    if (capacity <= 0 || capacity % page != 0 || capacity > (1 << 30)) {
+        m_error = QString("Shared memory ring has a bad size");
+        close();
+        return false;
+    }
+    if (!map(m_memFd, int(capacity), false))
+        return false;
+    if (m_shared->magic != kMagic || m_shared->capacity != quint32(capacity)) {
+        m_error = QString("Shared memory ring has a bad header");
+        close();
+        return false;
+    }
+    return true;
+}
+
+// 소비자가 tail 을 이상하게 써도 생산자는 링 밖에 쓰지 않는다
+int ShmRing::freeBytes() const
+{
+    const quint64 used = m_shared->head.load() - m_shared->tail.loadAcquire();
+    return used >= quint64(m_capacity) ? 0 : m_capacity - int(used);
+}
+
+bool ShmRing::write(const char *data, int size)
+{
+    if (size > freeBytes())
+        return false;
+    const quint64 head = m_shared->head.load();
+    memcpy(m_data + head % quint64(m_capacity), data, size_t(size));
+    m_shared->head.storeRelease(head + quint64(size));
+    return true;
+}
+
+// waiting 을 양쪽이 같은 변수에 대한 교환 (acq_rel) 으로 다루므로, 소비자가
+// 잠들기 전에 head 를 못 봤다면 생산자는 반드시 waiting 을 보고 깨운다
+void ShmRing::notify()
+{
+    if (m_shared->waiting.fetchAndStoreOrdered(0)) {
+        const quint64 one = 1;
+        ssize_t n = ::write(m_eventFd, &one, sizeof one);
+        Q_UNUSED(n);
+    }
+}
+
+const uchar *ShmRing::peek(int *size) const
+{
+    const quint64 tail = m_shared->tail.load();
+    const quint64 avail = m_shared->head.loadAcquire() - tail;
+    *size = int(qMin<quint64>(avail, quint64(m_capacity)));
+    return m_data + tail % quint64(m_capacity);
+}
+
+void ShmRing::consume(int size)
+{
+    m_shared->tail.storeRelease(m_shared->tail.load() + quint64(size));
+}
+
+bool ShmRing::prepareWait()
+{
+    m_shared->waiting.fetchAndStoreOrdered(1);
+    if (m_shared->head.loadAcquire() == m_shared->tail.load())
+        return true;
+    m_shared->waiting.fetchAndStoreOrdered(0);
+    return false;
+}
+
+void ShmRing::clearEvent()
+{
+    quint64 counter;
+    while (::read(m_eventFd, &counter, sizeof counter) > 0) {}
+}
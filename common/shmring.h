@@ -0,0 +1,63 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <QtGlobal>
+#include <QString>
+
+// 같은 호스트 클라이언트용 공유 메모리 링 (memfd + eventfd). 생산자 하나 (서버
+// 엔진), 소비자 하나 (StreamClient). 스트림 패킷을 TCP 와 같은 바이트 그대로
+// 이어 쓰므로 세션 규칙 (Format / Audio / End / Delay) 은 네트워크와 같다.
+//
+// 데이터 영역을 가상 주소에 두 번 이어 매핑해 링 끝을 넘는 패킷도 연속으로
+// 보인다. 소비자는 복사 없이 링 안의 패킷을 바로 읽고 다 쓴 뒤에 consume() 한다.
+// 생산자는 소비자가 잠들어 있을 때만 eventfd 를 쓰므로, 소비자가 깨어 있는 동안은
+// 시스템 콜이 없다.
+//
+// fd 는 연결된 unix 소켓으로 SCM_RIGHTS 를 써서 넘긴다 (sendTo / attach).
+class ShmRing
+{
+public:
+    ShmRing();
+    ~ShmRing();
+
+    // 생산자: capacity 는 페이지 단위로 올림
+    bool create(int capacity);
+    bool sendTo(int socket) const;
+    // 소비자: 소켓에서 fd 를 받아 매핑 (블로킹)
+    bool attach(int socket);
+    void close();
+
+    bool    isOpen() const { return m_shared != nullptr; }
+    QString errorString() const { return m_error; }
+    int     capacity() const { return m_capacity; }
+    int     eventFd() const { return m_eventFd; }
+
+    // 생산자. 자리가 모자라면 아무것도 쓰지 않고 false
+    int  freeBytes() const;
+    bool write(const char *data, int size);
+    void notify();                          // write() 를 모아 한 번만
+
+    // 소비자. 읽을 수 있는 연속 구간 (없으면 *size 0)
+    const uchar *peek(int *size) const;
+    void consume(int size);
+    // 잠들기 직전에 부른다. 그 사이 들어온 데이터가 있으면 false (자지 말 것)
+    bool prepareWait();
+    void clearEvent();
+
+private:
+    struct Shared;
+
+    bool map(int memFd, int capacity, bool writer);
+
+    Shared *m_shared;
+    uchar  *m_data;
+    int     m_capacity;
+    size_t  m_mapSize;
+    int     m_memFd;
+    int     m_eventFd;
+    QString m_error;
+
+    Q_DISABLE_COPY(ShmRing)
+};
+
+#endif // SHMRING_H
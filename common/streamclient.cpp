@@ -0,0 +1,545 @@
+#include "streamclient.h"
+#include <QMutexLocker>
+#include <opus/opus.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+
+const int kReadChunk     = 64 * 1024;
+const int kMaxPollMs     = 1000;
+const int kMaxOpusFrames = 5760;      // 120 ms @ 48 kHz (Opus 패킷 하나의 최대 길이)
+
+} // namespace
+
+StreamClient::StreamClient(QObject *parent)
+    : QThread(parent),
+      m_port(StreamProtocol::DefaultPort),
+      m_quit(false),
+      m_connected(false),
+      m_useClock(true),
+      m_clockSynced(false),
+      m_clockOffsetNs(0),
+      m_serverDelayNs(0),
+      m_localDelayNs(0),
+      m_distance(-1),
+      m_fd(-1),
+      m_wakeFd(-1),
+      m_sameClock(false),
+      m_inUsed(0),
+      m_opus(nullptr)
+{
+}
+
+StreamClient::~StreamClient()
+{
+    disconnectFromServer();
+}
+
+void StreamClient::connectToServer(const QString &host, quint16 port)
+{
+    startConnection(host, port, QString());
+}
+
+void StreamClient::connectToLocal(const QString &socketPath)
+{
+    startConnection(QString(), StreamProtocol::DefaultPort, socketPath);
+}
+
+void StreamClient::startConnection(const QString &host, quint16 port, const QString &localPath)
+{
+    disconnectFromServer();
+    {
+        QMutexLocker lock(&m_mutex);
+        m_host = host;
+        m_port = port;
+        m_localPath = localPath;
+        m_error.clear();
+        m_quit = false;
+        m_clockSynced = false;
+        m_clockOffsetNs = 0;
+        m_serverDelayNs = 0;          // 새 서버가 Delay 를 다시 보낸다
+        m_distance = -1;
+        m_buffer.setDelay(m_localDelayNs);
+    }
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    start();
+}
+
+void StreamClient::disconnectFromServer()
+{
+    if (isRunning()) {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_quit = true;
+        }
+        if (m_wakeFd >= 0) {
+            const quint64 one = 1;
+            ssize_t n = write(m_wakeFd, &one, sizeof one);
+            Q_UNUSED(n);
+        }
+        wait();
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+bool StreamClient::isConnected() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_connected;
+}
+
+QString StreamClient::errorString() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_error;
+}
+
+void StreamClient::setClockSync(bool on)
+{
+    QMutexLocker lock(&m_mutex);
+    m_useClock = on;
+}
+
+void StreamClient::setDepthLimits(int minMs, int maxMs)
+{
+    QMutexLocker lock(&m_mutex);
+    m_buffer.setDepthLimits(minMs, maxMs);
+}
+
+void StreamClient::setLocalDelay(double ms)
+{
+    QMutexLocker lock(&m_mutex);
+    m_localDelayNs = qint64(ms * 1e6);
+    m_buffer.setDelay(m_serverDelayNs + m_localDelayNs);
+}
+
+double StreamClient::delayMs() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_buffer.delay() / 1e6;
+}
+
+double StreamClient::speakerDistance() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_distance;
+}
+
+quint32 StreamClient::sampleRate() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_buffer.sampleRate();
+}
+
+int StreamClient::channels() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_buffer.channels();
+}
+
+void StreamClient::read(float *dst, int frames, qint64 playNs)
+{
+    QMutexLocker lock(&m_mutex);
+    m_buffer.pull(dst, frames, playNs);
+}
+
+JitterBuffer::Stats StreamClient::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_buffer.stats();
+}
+
+bool StreamClient::isClockSynced() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_clockSynced;
+}
+
+qint64 StreamClient::clockOffsetNs() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_clockOffsetNs;
+}
+
+bool StreamClient::openSocket()
+{
+    QString host;
+    quint16 port;
+    bool useClock;
+    {
+        QMutexLocker lock(&m_mutex);
+        host = m_host;
+        port = m_port;
+        useClock = m_useClock;
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    const int rc = getaddrinfo(host.toLatin1().constData(),
+                               QByteArray::number(port).constData(), &hints, &res);
+    if (rc != 0 || !res) {
+        QMutexLocker lock(&m_mutex);
+        m_error = QString::fromLocal8Bit(gai_strerror(rc));
+        return false;
+    }
+    // 연결까지는 블로킹 (이 스레드 안이라 UI 는 막지 않음)
+    m_fd = socket(res->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0 || ::connect(m_fd, res->ai_addr, res->ai_addrlen) != 0) {
+        QMutexLocker lock(&m_mutex);
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        freeaddrinfo(res);
+        closeSockets();
+        return false;
+    }
+    freeaddrinfo(res);
+    const int one = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+    // 시계 동기는 실패해도 적응 모드로 재생은 된다
+    if (useClock && !m_clock.open(host, port)) {
+        QMutexLocker lock(&m_mutex);
+        m_error = m_clock.errorString();
+    }
+    m_in.resize(2 * kReadChunk);
+    m_inUsed = 0;
+    return true;
+}
+
+// unix 소켓으로 붙으면 서버가 바로 링의 fd 를 보낸다. 이후 소켓은 끊김 감지용
+bool StreamClient::openLocal()
+{
+    QString path;
+    bool useClock;
+    {
+        QMutexLocker lock(&m_mutex);
+        path = m_localPath;
+        useClock = m_useClock;
+    }
+    const QByteArray native = path.toLocal8Bit();
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (native.size() >= int(sizeof addr.sun_path)) {
+        QMutexLocker lock(&m_mutex);
+        m_error = QString("Invalid local socket path: %1").arg(path);
+        return false;
+    }
+    memcpy(addr.sun_path, native.constData(), size_t(native.size()));
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    // 링을 주지 않는 상대에게 오래 막히지 않게
+    const timeval timeout = { 2, 0 };
+    if (m_fd >= 0)
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0) {
+        QMutexLocker lock(&m_mutex);
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        closeSockets();
+        return false;
+    }
+    if (!m_ring.attach(m_fd)) {
+        QMutexLocker lock(&m_mutex);
+        m_error = m_ring.errorString();
+        closeSockets();
+        return false;
+    }
+    // 같은 CLOCK_MONOTONIC 이라 오프셋은 0 (시계 동기를 껐으면 적응 모드)
+    m_sameClock = useClock;
+    QMutexLocker lock(&m_mutex);
+    m_clockSynced = useClock;
+    m_clockOffsetNs = 0;
+    return true;
+}
+
+void StreamClient::closeSockets()
+{
+    m_clock.close();
+    m_ring.close();
+    m_sameClock = false;
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (m_opus) {
+        opus_decoder_destroy(m_opus);
+        m_opus = nullptr;
+    }
+}
+
+bool StreamClient::readStream()
+{
+    for (;;) {
+        if (m_in.size() - m_inUsed < kReadChunk)
+            m_in.resize(m_inUsed + 2 * kReadChunk);
+        const ssize_t n = recv(m_fd, m_in.data() + m_inUsed, size_t(m_in.size() - m_inUsed),
+                               MSG_DONTWAIT);
+        if (n == 0) {
+            QMutexLocker lock(&m_mutex);
+            m_error = QString("Connection closed by server");
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            QMutexLocker lock(&m_mutex);
+            m_error = QString::fromLocal8Bit(strerror(errno));
+            return false;
+        }
+        m_inUsed += int(n);
+    }
+
+    // 도착 시각은 이번에 읽은 패킷 모두 같게 본다 (지터 측정용)
+    const qint64 arrivalNs = StreamProtocol::clockNs();
+    const uchar *p = reinterpret_cast<const uchar *>(m_in.constData());
+    int pos = 0;
+    while (m_inUsed - pos >= StreamProtocol::HeaderSize) {
+        StreamProtocol::Header h;
+        if (!StreamProtocol::readHeader(p + pos, &h)) {
+            QMutexLocker lock(&m_mutex);
+            m_error = QString("Protocol error");
+            return false;
+        }
+        const qint64 total = qint64(h.headerSize) + h.payloadSize;
+        if (m_inUsed - pos < total)
+            break;
+        if (!handlePacket(h, p + pos + h.headerSize, arrivalNs)) {
+            QMutexLocker lock(&m_mutex);
+            if (m_error.isEmpty())
+                m_error = QString("Protocol error");
+            return false;
+        }
+        pos += int(total);
+    }
+    if (pos > 0) {
+        memmove(m_in.data(), m_in.constData() + pos, size_t(m_inUsed - pos));
+        m_inUsed -= pos;
+    }
+    return true;
+}
+
+// 링 안의 패킷을 복사 없이 바로 처리하고, 다 쓴 뒤에 서버에 자리를 돌려준다
+bool StreamClient::readRing()
+{
+    const qint64 arrivalNs = StreamProtocol::clockNs();
+    for (;;) {
+        int avail;
+        const uchar *p = m_ring.peek(&avail);
+        if (avail < StreamProtocol::HeaderSize)
+            return true;
+        StreamProtocol::Header h;
+        const bool valid = StreamProtocol::readHeader(p, &h);
+        const qint64 total = qint64(h.headerSize) + h.payloadSize;
+        if (!valid || total > m_ring.capacity()) {
+            QMutexLocker lock(&m_mutex);
+            m_error = QString("Protocol error");
+            return false;
+        }
+        if (avail < total)
+            return true;        // 서버는 패킷 단위로 쓰므로 오지 않는 경우
+        if (!handlePacket(h, p + h.headerSize, arrivalNs)) {
+            QMutexLocker lock(&m_mutex);
+            if (m_error.isEmpty())
+                m_error = QString("Protocol error");
+            return false;
+        }
+        m_ring.consume(int(total));
+    }
+}
+
+bool StreamClient::handlePacket(const StreamProtocol::Header &h, const uchar *payload,
+                                qint64 arrivalNs)
+{
+    switch (h.type) {
+    case StreamProtocol::Format: {
+        if (h.payloadSize < StreamProtocol::FormatPayloadSize)
+            return false;
+        const quint32 rate = qFromLittleEndian<quint32>(payload);
+        const int ch = qFromLittleEndian<quint16>(payload + 4);
+        const int bits = qFromLittleEndian<quint16>(payload + 6);
+        const quint32 codec = h.payloadSize >= StreamProtocol::FormatCodecPayloadSize
+                ? qFromLittleEndian<quint32>(payload + 16) : quint32(StreamProtocol::CodecPcm);
+        const bool opus = codec == StreamProtocol::CodecOpus && rate == 48000 && ch <= 2;
+        if (rate == 0 || ch < 1 || ch > Resampler::MaxChannels
+                || !(opus || (codec == StreamProtocol::CodecPcm && bits == 16))) {
+            QMutexLocker lock(&m_mutex);
+            m_error = QString("Unsupported stream format");
+            return false;
+        }
+        if (m_opus) {
+            opus_decoder_destroy(m_opus);
+            m_opus = nullptr;
+        }
+        if (opus) {
+            int err = OPUS_OK;
+            m_opus = opus_decoder_create(48000, ch, &err);
+            if (!m_opus) {
+                QMutexLocker lock(&m_mutex);
+                m_error = QString("Opus: %1").arg(QString::fromLatin1(opus_strerror(err)));
+                return false;
+            }
+        }
+        {
+            QMutexLocker lock(&m_mutex);
+            m_buffer.setFormat(rate, ch);
+        }
+        emit formatChanged(rate, ch);
+        return true;
+    }
+    case StreamProtocol::Audio: {
+        if (h.payloadSize < StreamProtocol::AudioPrefixSize)
+            return false;
+        const qint64 firstFrame = qFromLittleEndian<qint64>(payload);
+        const qint64 presentationNs = qFromLittleEndian<qint64>(payload + 8);
+        const uchar *data = payload + StreamProtocol::AudioPrefixSize;
+        const int bytes = int(h.payloadSize - StreamProtocol::AudioPrefixSize);
+        int frames = -1;              // 모르면 샘플 수 / 채널
+        if (m_opus) {
+            if (m_pcm.size() < 2 * kMaxOpusFrames)
+                m_pcm.resize(2 * kMaxOpusFrames);
+            frames = opus_decode(m_opus, data, bytes, m_pcm.data(), kMaxOpusFrames, 0);
+            if (frames <= 0)
+                return true;          // 깨진 패킷은 손실로 본다 (지터 버퍼가 메움)
+        } else {
+            // 페이로드는 정렬이 안 맞을 수 있어 한 번 풀어 놓는다
+            const int samples = bytes / 2;
+            if (m_pcm.size() < samples)
+                m_pcm.resize(samples);
+            for (int i = 0; i < samples; ++i)
+                m_pcm[i] = qFromLittleEndian<qint16>(data + 2 * i);
+        }
+
+        const qint64 localNs = m_sameClock ? presentationNs
+                : m_clock.isOpen() && m_clock.isSynced() ? m_clock.toLocal(presentationNs) : -1;
+        QMutexLocker lock(&m_mutex);
+        const int ch = m_buffer.channels();
+        if (ch > 0)
+            m_buffer.push(firstFrame, m_pcm.constData(), frames >= 0 ? frames : bytes / 2 / ch,
+                          arrivalNs, localNs);
+        return true;
+    }
+    case StreamProtocol::End:
+        {
+            QMutexLocker lock(&m_mutex);
+            m_buffer.setEnded();
+        }
+        emit streamEnded();
+        return true;
+    case StreamProtocol::Delay: {
+        if (h.payloadSize < StreamProtocol::DelayPayloadSize)
+            return false;
+        const qint64 delayNs = qFromLittleEndian<qint64>(payload);
+        const qint32 distanceMm = qFromLittleEndian<qint32>(payload + 8);
+        double total;
+        {
+            QMutexLocker lock(&m_mutex);
+            m_serverDelayNs = delayNs;
+            m_distance = distanceMm >= 0 ? distanceMm / 1000.0 : -1.0;
+            m_buffer.setDelay(m_serverDelayNs + m_localDelayNs);
+            total = m_buffer.delay() / 1e6;
+        }
+        emit delayChanged(total, distanceMm >= 0 ? distanceMm / 1000.0 : -1.0);
+        return true;
+    }
+    default:
+        return true;        // 모르는 패킷은 건너뛴다 (상위 호환)
+    }
+}
+
+void StreamClient::run()
+{
+    bool local;
+    {
+        QMutexLocker lock(&m_mutex);
+        local = !m_localPath.isEmpty();
+    }
+    if (!(local ? openLocal() : openSocket())) {
+        emit disconnected();
+        return;
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        m_connected = true;
+    }
+    emit connected();
+
+    for (;;) {
+        pollfd fds[3];
+        int n = 0;
+        fds[n].fd = m_fd;      fds[n].events = POLLIN; fds[n].revents = 0; ++n;
+        fds[n].fd = m_wakeFd;  fds[n].events = POLLIN; fds[n].revents = 0; ++n;
+        const bool ring = m_ring.isOpen();
+        const bool clock = m_clock.isOpen();
+        if (ring || clock) {
+            fds[n].fd = ring ? m_ring.eventFd() : m_clock.socketDescriptor();
+            fds[n].events = POLLIN;
+            fds[n].revents = 0;
+            ++n;
+        }
+
+        int timeoutMs = kMaxPollMs;
+        if (ring && !m_ring.prepareWait()) {
+            timeoutMs = 0;      // 잠들기 직전에 들어온 패킷
+        } else if (clock) {
+            const qint64 wait = m_clock.nextServiceNs() - StreamProtocol::clockNs();
+            timeoutMs = int(qBound<qint64>(0, (wait + 999999) / 1000000, kMaxPollMs));
+        }
+        const int ready = poll(fds, nfds_t(n), timeoutMs);
+        if (ready < 0 && errno != EINTR)
+            break;
+
+        if (ring) {
+            m_ring.clearEvent();
+            if (!readRing())
+                break;
+            // 서버는 링을 넘긴 뒤로 소켓에 쓰지 않는다. 읽을 것이 생기면 끊긴 것
+            if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+                QMutexLocker lock(&m_mutex);
+                m_error = QString("Connection closed by server");
+                break;
+            }
+        } else if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (!readStream())
+                break;
+        }
+        if (fds[1].revents & POLLIN) {
+            quint64 counter;
+            while (::read(m_wakeFd, &counter, sizeof counter) > 0) {}
+        }
+        {
+            QMutexLocker lock(&m_mutex);
+            if (m_quit)
+                break;
+        }
+        if (clock) {
+            m_clock.service(StreamProtocol::clockNs());
+            QMutexLocker lock(&m_mutex);
+            m_clockSynced = m_clock.isSynced();
+            m_clockOffsetNs = m_clock.offsetNs();
+        }
+    }
+
+    closeSockets();
+    {
+        QMutexLocker lock(&m_mutex);
+        m_connected = false;
+    }
+    emit disconnected();
+}
@@ -0,0 +1,112 @@
+#ifndef STREAMCLIENT_H
+#define STREAMCLIENT_H
+
+#include <QThread>
+#include <QMutex>
+#include <QByteArray>
+#include <QVector>
+#include <QString>
+#include "streamprotocol.h"
+#include "clocksync.h"
+#include "jitterbuffer.h"
+#include "shmring.h"
+
+struct OpusDecoder;
+
+// StreamServer 수신 클라이언트. 전용 스레드에서 TCP 스트림을 읽어 지터 버퍼에
+// 넣고, 같은 포트의 UDP 로 서버 시계를 따라간다. 시계가 맞으면 패킷의 재생
+// 시각을 로컬 시계로 바꿔 넣으므로 여러 클라이언트가 같은 순간에 재생한다.
+//
+// 출력 쪽 (오디오 장치 스레드) 은 read() 로 원하는 만큼 꺼내 간다. 장치 시계와
+// 서버 시계 차이는 지터 버퍼가 리샘플 비율로 흡수한다.
+//
+// 스피커 지연은 서버가 배치 (거리) 로 계산해 보낸 값에 setLocalDelay() 를 더한 것.
+// 재생 중에 바뀌어도 지터 버퍼가 천천히 옮겨 가므로 끊기지 않는다.
+//
+// connectToLocal() 은 같은 호스트의 서버에 공유 메모리 링으로 붙는다. 패킷을 링
+// 안에서 바로 읽고 (수신 복사 없음), 서버와 시계가 같으므로 시계 동기도 없다.
+//
+// 서버가 Opus 로 보내면 (Format 의 codec) 받은 스레드에서 디코드해 같은 지터
+// 버퍼에 넣는다. 출력 쪽에서는 PCM 스트림과 구별되지 않는다.
+class StreamClient : public QThread
+{
+    Q_OBJECT
+public:
+    explicit StreamClient(QObject *parent = nullptr);
+    ~StreamClient();
+
+    // 연결은 스레드 안에서 한다. 결과는 connected() / disconnected() 시그널
+    void connectToServer(const QString &host, quint16 port = StreamProtocol::DefaultPort);
+    void connectToLocal(const QString &socketPath = StreamProtocol::defaultLocalSocketPath());
+    void disconnectFromServer();
+    bool isConnected() const;
+    QString errorString() const;
+
+    // 시계 동기를 끄면 적응 모드로만 재생한다 (다른 클라이언트와 맞추지 않음)
+    void setClockSync(bool on);
+    void setDepthLimits(int minMs, int maxMs);
+    void setLocalDelay(double ms);    // 이 스피커에서 측정한 보정 (서버 값에 더함)
+
+    double delayMs() const;           // 적용할 전체 지연
+    double speakerDistance() const;   // 서버에 설정된 거리 (m), 모르면 -1
+
+    quint32 sampleRate() const;
+    int     channels() const;
+
+    // playNs (로컬 CLOCK_MONOTONIC) 에 스피커로 나갈 frames 를 dst 에 채운다.
+    // 포맷을 받기 전이면 무음. dst 는 channels() 인터리브 float
+    void read(float *dst, int frames, qint64 playNs);
+
+    JitterBuffer::Stats stats() const;
+    bool   isClockSynced() const;
+    qint64 clockOffsetNs() const;     // 서버 - 로컬
+
+signals:
+    void connected();
+    void disconnected();
+    void formatChanged(quint32 sampleRate, int channels);
+    void streamEnded();
+    void delayChanged(double delayMs, double distanceMeters);
+
+protected:
+    void run() override;
+
+private:
+    void startConnection(const QString &host, quint16 port, const QString &localPath);
+    bool openSocket();
+    bool openLocal();
+    bool readStream();
+    bool readRing();
+    bool handlePacket(const StreamProtocol::Header &h, const uchar *payload, qint64 arrivalNs);
+    void closeSockets();
+
+    mutable QMutex m_mutex;
+    QString  m_host;
+    quint16  m_port;
+    QString  m_localPath;             // 비어 있지 않으면 공유 메모리 연결
+    QString  m_error;
+    bool     m_quit;
+    bool     m_connected;
+    bool     m_useClock;
+    JitterBuffer m_buffer;
+    bool     m_clockSynced;
+    qint64   m_clockOffsetNs;
+    qint64   m_serverDelayNs;
+    qint64   m_localDelayNs;
+    double   m_distance;
+
+    // 수신 스레드 전용
+    int        m_fd;
+    int        m_wakeFd;
+    ClockSync  m_clock;
+    ShmRing    m_ring;                // 로컬 연결일 때만 열림
+    bool       m_sameClock;           // 로컬 연결: 재생 시각을 그대로 쓴다
+    QByteArray m_in;                  // 아직 처리하지 못한 수신 데이터
+    int        m_inUsed;
+    QVector<qint16> m_pcm;            // 정렬을 맞춘 수신 샘플 (Opus 면 디코드한 샘플)
+    OpusDecoder *m_opus;              // Opus 스트림일 때만
+
+    Q_DISABLE_COPY(StreamClient)
+};
+
+#endif // STREAMCLIENT_H
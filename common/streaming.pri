@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# 네트워크 스트리밍 (server2 엔진 + 수신 클라이언트 + 프로토콜 + 제어 소켓)
+# common.pri 와 같이 include 한다
+#
+#-------------------------------------------------
+
+SOURCES += $$PWD/streamserver.cpp \
+           $$PWD/rtpsender.cpp \
+           $$PWD/opusencoder.cpp \
+           $$PWD/shmring.cpp \
+           $$PWD/relayupstream.cpp \
+           $$PWD/rtpfec.cpp \
+           $$PWD/timinghistogram.cpp \
+           $$PWD/clocksync.cpp \
+           $$PWD/jitterbuffer.cpp \
+           $$PWD/streamclient.cpp \
+           $$PWD/controlserver.cpp \
+           $$PWD/controlclient.cpp
+
+HEADERS += $$PWD/streamprotocol.h \
+           $$PWD/streamserver.h \
+           $$PWD/rtpsender.h \
+           $$PWD/opusencoder.h \
+           $$PWD/shmring.h \
+           $$PWD/relayupstream.h \
+           $$PWD/rtpfec.h \
+           $$PWD/timinghistogram.h \
+           $$PWD/clocksync.h \
+           $$PWD/jitterbuffer.h \
+           $$PWD/streamclient.h \
+           $$PWD/controlprotocol.h \
+           $$PWD/controlserver.h \
+           $$PWD/controlclient.h
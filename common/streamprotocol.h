@@ -0,0 +1,121 @@
+#ifndef STREAMPROTOCOL_H
+#define STREAMPROTOCOL_H
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <QString>
+#include <time.h>
+
+// server2 스트리밍 프로토콜 (TCP). 정수는 모두 little endian.
+//
+//   패킷 = 헤더 + payload
+//     u32 magic ("WSP1")  u8 type  u8 flags  u16 headerSize
+//     u32 payloadSize     u32 sequence
+//
+//   sequence 는 오디오 패킷 순번 (큐에서 버려진 패킷 감지용), 다른 타입은 0
+//
+//   Format : u32 sampleRate  u16 channels  u16 bitsPerSample  i64 frameCount  [u32 codec]
+//            codec 이 있고 CodecOpus 면 bitsPerSample 은 0 (모르는 클라이언트는 거절),
+//            sampleRate 는 48000, frameCount 는 48 kHz 기준
+//   Audio  : i64 firstFrame  i64 presentationNs  + S16LE 인터리브 PCM
+//            (CodecOpus 면 PCM 대신 Opus 패킷 하나)
+//   End    : payload 없음 (트랙 끝 또는 정지)
+//   Delay  : i64 delayNs  i32 distanceMm (-1 = 모름)
+//            이 클라이언트만의 추가 재생 지연 (스피커 거리 보정). 트랙과 무관하게
+//            바뀔 때마다 온다. 오디오 패킷은 모든 클라이언트가 같은 것을 받는다
+//
+// presentationNs 는 firstFrame 이 스피커에서 나와야 하는 시각 (서버 시계, clockNs()).
+// 클라이언트는 아래 시계 동기로 자기 시계로 바꿔 그 시각에 재생한다.
+//
+// 시계 동기 (UDP, TCP 와 같은 포트). NTP 처럼 왕복 4개 시각으로 오프셋/지연 계산
+//   요청 : u32 magic ("WSC1")  u32 seq  i64 t1 (클라이언트 송신)
+//   응답 : 요청 16바이트 그대로 + i64 t2 (서버 수신)  i64 t3 (서버 송신)
+//
+// 새 필드는 헤더 뒤에 붙이고 headerSize 를 늘린다. 받는 쪽은 headerSize 만큼 건너뛴다.
+//
+// raw 포트 (TCP, 기본 5701) 는 위 프레이밍 없이 WAV 스트림을 그대로 보낸다.
+// 트랙마다 44바이트 WAV 헤더 (크기 0xFFFFFFFF) 뒤에 PCM 이 이어진다. 원본이 WAV 면
+// data 청크 바이트 그대로 (원본 포맷), 아니면 S16LE. `nc host 5701 | aplay` 로 들을 수 있다.
+//
+// 같은 호스트 클라이언트는 unix 소켓 (defaultLocalSocketPath) 에 붙으면 공유 메모리
+// 링 (shmring.h) 의 fd 를 받는다. 링에는 위 패킷이 TCP 와 같은 바이트로 이어지고,
+// 서버와 같은 CLOCK_MONOTONIC 이라 시계 동기가 필요 없다. 소켓은 연결 종료 감지용.
+namespace StreamProtocol {
+
+enum { DefaultPort = 5700, DefaultRawPort = 5701 };
+
+const quint32 Magic = 0x31505357;   // "WSP1"
+const quint32 ClockMagic = 0x31435357;   // "WSC1"
+
+enum {
+    HeaderSize        = 16,
+    FormatPayloadSize = 16,
+    FormatCodecPayloadSize = 20,
+    AudioPrefixSize   = 16,
+    DelayPayloadSize  = 12,
+    MaxPayloadSize    = 1 << 20,
+    ClockRequestSize  = 16,
+    ClockReplySize    = 32
+};
+
+enum PacketType {
+    Format = 1,
+    Audio  = 2,
+    End    = 3,
+    Delay  = 4
+};
+
+enum Codec {
+    CodecPcm  = 0,
+    CodecOpus = 1
+};
+
+struct Header
+{
+    quint8  type;
+    quint8  flags;
+    quint16 headerSize;
+    quint32 payloadSize;
+    quint32 sequence;
+};
+
+inline void writeHeader(uchar *p, quint8 type, quint32 payloadSize, quint32 sequence)
+{
+    qToLittleEndian<quint32>(Magic, p);
+    p[4] = type;
+    p[5] = 0;
+    qToLittleEndian<quint16>(HeaderSize, p + 6);
+    qToLittleEndian<quint32>(payloadSize, p + 8);
+    qToLittleEndian<quint32>(sequence, p + 12);
+}
+
+// p 는 최소 HeaderSize 바이트. 매직이나 크기가 이상하면 false (연결을 끊을 것)
+inline bool readHeader(const uchar *p, Header *h)
+{
+    if (qFromLittleEndian<quint32>(p) != Magic)
+        return false;
+    h->type        = p[4];
+    h->flags       = p[5];
+    h->headerSize  = qFromLittleEndian<quint16>(p + 6);
+    h->payloadSize = qFromLittleEndian<quint32>(p + 8);
+    h->sequence    = qFromLittleEndian<quint32>(p + 12);
+    return h->headerSize >= HeaderSize && h->payloadSize <= MaxPayloadSize;
+}
+
+inline QString defaultLocalSocketPath()
+{
+    return QStringLiteral("/tmp/server2-stream.sock");
+}
+
+// 미디어 타임라인 시계. NTP 로 시각이 튀지 않게 CLOCK_MONOTONIC 을 쓴다
+// (기준점은 호스트마다 다르므로 다른 호스트 값과는 시계 동기로만 비교)
+inline qint64 clockNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+} // namespace StreamProtocol
+
+#endif // STREAMPROTOCOL_H
@@ -0,0 +1,1793 @@
+#include "streamserver.h"
+#include "audiosource.h"
+#include "readahead.h"
+#include "rtpsender.h"
+#include "mappedwavsource.h"
+#include "pcmcache.h"
+#include "relayupstream.h"
+#include "shmring.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <climits>
+#include <opus/opus.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+namespace {
+
+const int    kMaxEvents   = 256;
+const int    kMaxIov      = 64;
+const int    kMaxCatchUp  = 8;                     // 한 번 깼을 때 따라잡을 최대 패킷 수
+const int    kClockBatch  = 64;                    // 시계 요청을 한 번에 받는 수
+const qint64 kPublishNs   = 250 * 1000000LL;       // 통계/클라이언트 목록 갱신 주기
+const qint64 kAcceptRetryNs = 100 * 1000000LL;
+// 커널 송신 버퍼가 크면 느린 클라이언트의 밀린 데이터가 커널에 쌓여
+// 큐 상한/드롭이 늦게 걸린다. 지연은 사용자 공간 큐에서 관리한다
+const int    kSendBuffer  = 128 * 1024;
+// 로컬 클라이언트 링. TCP 의 커널 송신 버퍼와 비슷한 역할 (넘치면 사용자 공간 큐)
+const int    kShmRingBytes = 256 * 1024;
+const qint64 kUpstreamRetryNs = 1000 * 1000000LL;  // 상위가 끊기면 이만큼 쉬고 다시 연결
+// 릴레이하는 Opus 는 비트레이트를 모르므로 최대치 (510 kbit/s) 로 큐 상한을 잡는다
+const int    kMaxOpusBytesPerSecond = 510000 / 8;
+
+// 긴 트랙에서도 넘치지 않게 초/나머지로 나눠 계산
+qint64 framesToNs(qint64 frames, quint32 rate)
+{
+    return (frames / rate) * 1000000000LL + (frames % rate) * 1000000000LL / rate;
+}
+
+QString peerName(const sockaddr_storage &sa)
+{
+    char host[INET6_ADDRSTRLEN] = "?";
+    quint16 port = 0;
+    if (sa.ss_family == AF_INET) {
+        const sockaddr_in *in = reinterpret_cast<const sockaddr_in *>(&sa);
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof host);
+        port = ntohs(in->sin_port);
+    } else if (sa.ss_family == AF_INET6) {
+        const sockaddr_in6 *in6 = reinterpret_cast<const sockaddr_in6 *>(&sa);
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof host);
+        port = ntohs(in6->sin6_port);
+    }
+    return QString("%1:%2").arg(QString::fromLatin1(host)).arg(port);
+}
+
+QString peerHost(const QString &peer)
+{
+    return peer.left(peer.lastIndexOf(':'));
+}
+
+// raw 클라이언트용 스트리밍 WAV 헤더 (길이를 모르므로 크기 필드는 0xFFFFFFFF)
+enum { RawHeaderSize = 44 };
+
+QByteArray rawWavHeader(quint16 tag, int channels, quint32 rate, int bits, int blockAlign)
+{
+    QByteArray h(RawHeaderSize, Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(h.data());
+    memcpy(p, "RIFF", 4);
+    qToLittleEndian<quint32>(0xFFFFFFFFu, p + 4);
+    memcpy(p + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, p + 16);
+    qToLittleEndian<quint16>(tag, p + 20);
+    qToLittleEndian<quint16>(quint16(channels), p + 22);
+    qToLittleEndian<quint32>(rate, p + 24);
+    qToLittleEndian<quint32>(rate * quint32(blockAlign), p + 28);
+    qToLittleEndian<quint16>(quint16(blockAlign), p + 32);
+    qToLittleEndian<quint16>(quint16(bits), p + 34);
+    memcpy(p + 36, "data", 4);
+    qToLittleEndian<quint32>(0xFFFFFFFFu, p + 40);
+    return h;
+}
+
+bool isRawHeader(const QByteArray &p)
+{
+    return p.size() == RawHeaderSize && p.startsWith("RIFF");
+}
+
+} // namespace
+
+struct StreamServer::Client
+{
+    int     id = 0;
+    int     fd = -1;
+    QString peer;
+    QList<QByteArray> queue;      // 보낼 패킷 (다른 클라이언트와 데이터 공유)
+    int     headOffset = 0;       // queue.first() 에서 이미 보낸 바이트
+    quint64 queuedBytes = 0;
+    bool    wantWrite = false;    // EPOLLOUT 등록 여부
+    bool    needFormat = true;    // 다음 오디오 앞에 Format (raw 면 WAV 헤더) 을 보내야 함
+    bool    raw = false;          // raw 포트로 들어온 클라이언트
+    ShmRing *ring = nullptr;      // 로컬 (unix 소켓) 클라이언트면 공유 메모리 링 (소유)
+    quint64 rawOffset = 0;        // 다음에 sendfile 할 파일 오프셋
+    qint64  overSinceNs = 0;      // 큐 상한을 넘기 시작한 시각 (0 = 정상)
+    quint64 bytesSent = 0;
+    quint64 dropped = 0;
+    QString host;                 // 스피커 배치 키
+    qint64  delayNs = 0;          // 마지막으로 보낸 Delay
+    double  distance = -1;
+};
+
+QString StreamServer::Stats::toString() const
+{
+    return QString("clients %1 (accepted %2, kicked %3), packets %4, sent %5 KB, "
+                   "dropped %6, stalls %7, late wakeups %8")
+            .arg(clients)
+            .arg(accepted)
+            .arg(kicked)
+            .arg(packets)
+            .arg(bytesSent / 1024)
+            .arg(droppedPackets)
+            .arg(stalls)
+            .arg(lateWakeups)
+            + (sendLateMaxUs > 0
+               ? QString(", send late p50 %1 / p99 %2 / p99.9 %3 / max %4 us")
+                 .arg(sendLateP50Us, 0, 'f', 0).arg(sendLateP99Us, 0, 'f', 0)
+                 .arg(sendLateP999Us, 0, 'f', 0).arg(sendLateMaxUs, 0, 'f', 0)
+               : QString())
+            + (clockRequests ? QString(", clock requests %1").arg(clockRequests) : QString())
+            + (zeroCopyBytes ? QString(", zero-copy %1 KB").arg(zeroCopyBytes / 1024) : QString())
+            + (sharedMemoryBytes ? QString(", shared memory %1 KB").arg(sharedMemoryBytes / 1024)
+                                 : QString())
+            + (rtpPackets || rtpErrors
+               ? QString(", rtp %1 packets / %2 KB / %3 errors")
+                 .arg(rtpPackets).arg(rtpBytes / 1024).arg(rtpErrors)
+               : QString())
+            + (rtpFecPackets ? QString(", fec %1 packets").arg(rtpFecPackets) : QString())
+            + (opusPackets ? QString(", opus %1 packets / %2 KB / cpu %3%")
+                             .arg(opusPackets).arg(opusBytes / 1024).arg(opusCpuPercent, 0, 'f', 2)
+                           : QString())
+            + (upstreamConnected || relayPackets
+               ? QString(", relay %1 packets / %2 gaps / %3 late, headroom %4 ms%5")
+                 .arg(relayPackets).arg(relayGaps).arg(relayLate).arg(relayHeadroomMs, 0, 'f', 1)
+                 .arg(upstreamConnected ? QString() : QString(" (upstream down)"))
+               : QString());
+}
+
+StreamServer::StreamServer(QObject *parent)
+    : QThread(parent),
+      m_pendingSource(nullptr),
+      m_pendingPlay(false),
+      m_pendingStop(false),
+      m_pendingSeek(-1),
+      m_pendingRtp(nullptr),
+      m_pendingRtpSet(false),
+      m_pendingSpeed(343.0),
+      m_speakersChanged(false),
+      m_quit(false),
+      m_playing(false),
+      m_position(0),
+      m_positionNs(0),
+      m_positionFloor(0),
+      m_positionRate(0),
+      m_packetMs(10),
+      m_maxQueueSeconds(2.0),
+      m_kickSeconds(5.0),
+      m_playoutNs(200 * 1000000LL),
+      m_rawPort(StreamProtocol::DefaultRawPort),
+      m_zeroCopy(true),
+      m_localPath(StreamProtocol::defaultLocalSocketPath()),
+      m_fecGroup(0),
+      m_fecInterleave(1),
+      m_pcmCache(nullptr),
+      m_opusBitrate(0),
+      m_opusFrameMs(20),
+      m_opusComplexity(5),
+      m_upstream(nullptr),
+      m_listenFd(-1),
+      m_rawListenFd(-1),
+      m_localListenFd(-1),
+      m_clockFd(-1),
+      m_epollFd(-1),
+      m_wakeFd(-1),
+      m_timerFd(-1),
+      m_timerNs(0),
+      m_nextId(0),
+      m_rawClients(0),
+      m_source(nullptr),
+      m_cached(nullptr),
+      m_readAhead(new ReadAhead(this)),
+      m_readAheadOn(false),
+      m_rtp(nullptr),
+      m_rawFd(-1),
+      m_rawEnd(0),
+      m_rawLimit(0),
+      m_rawBlockAlign(0),
+      m_sequence(0),
+      m_framesSent(0),
+      m_trackFrame(0),
+      m_packetFrames(0),
+      m_packetBytes(0),
+      m_anchorNs(0),
+      m_maxQueueBytes(0),
+      m_nowNs(0),
+      m_acceptRetryNs(0),
+      m_lastPublishNs(0),
+      m_speedOfSound(343.0),
+      m_upstreamRetryNs(0),
+      m_relaying(false),
+      m_relayRate(0),
+      m_relayChannels(0),
+      m_relayOpus(false),
+      m_relayRtpStarted(false),
+      m_relayLeadNs(LLONG_MAX)
+{
+    m_endPacket.resize(StreamProtocol::HeaderSize);
+    StreamProtocol::writeHeader(reinterpret_cast<uchar *>(m_endPacket.data()),
+                                StreamProtocol::End, 0, 0);
+}
+
+StreamServer::~StreamServer()
+{
+    close();
+    delete m_pendingSource;
+    delete m_pendingRtp;
+    delete m_rtp;
+    delete m_upstream;
+}
+
+bool StreamServer::listen(quint16 port, const QString &address)
+{
+    close();
+
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (!address.isEmpty()
+            && inet_pton(AF_INET, address.toLatin1().constData(), &sa.sin_addr) != 1) {
+        m_error = QString("Invalid listen address: %1").arg(address);
+        return false;
+    }
+
+    m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    m_clockFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    m_timerNs = 0;
+    const int one = 1;
+    if (m_listenFd >= 0)
+        setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    if (m_listenFd < 0 || m_clockFd < 0 || m_epollFd < 0 || m_wakeFd < 0 || m_timerFd < 0
+            || bind(m_listenFd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0
+            || bind(m_clockFd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0
+            || ::listen(m_listenFd, SOMAXCONN) != 0) {
+        m_error = QString::fromLocal8Bit(strerror(errno));
+        close();
+        return false;
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = m_listenFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev);
+    ev.data.fd = m_wakeFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+    ev.data.fd = m_timerFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_timerFd, &ev);
+    ev.data.fd = m_clockFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_clockFd, &ev);
+
+    if (m_rawPort) {
+        sa.sin_port = htons(m_rawPort);
+        m_rawListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_rawListenFd >= 0)
+            setsockopt(m_rawListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        if (m_rawListenFd < 0
+                || bind(m_rawListenFd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0
+                || ::listen(m_rawListenFd, SOMAXCONN) != 0) {
+            m_error = QString("Raw port %1: %2").arg(m_rawPort)
+                    .arg(QString::fromLocal8Bit(strerror(errno)));
+            close();
+            return false;
+        }
+        ev.data.fd = m_rawListenFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_rawListenFd, &ev);
+    }
+
+    if (!m_localPath.isEmpty()) {
+        const QByteArray native = m_localPath.toLocal8Bit();
+        sockaddr_un un;
+        memset(&un, 0, sizeof un);
+        un.sun_family = AF_UNIX;
+        if (native.size() >= int(sizeof un.sun_path)) {
+            m_error = QString("Invalid local socket path: %1").arg(m_localPath);
+            close();
+            return false;
+        }
+        memcpy(un.sun_path, native.constData(), size_t(native.size()));
+        // 남아 있는 소켓 파일: 누가 받으면 이미 실행 중, 아니면 지난번 찌꺼기
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe >= 0) {
+            const bool alive = ::connect(probe, reinterpret_cast<sockaddr *>(&un), sizeof un) == 0;
+            ::close(probe);
+            if (alive) {
+                m_error = QString("%1 is in use (already running?)").arg(m_localPath);
+                close();
+                return false;
+            }
+        }
+        unlink(un.sun_path);
+        m_localListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_localListenFd < 0
+                || bind(m_localListenFd, reinterpret_cast<sockaddr *>(&un), sizeof un) != 0
+                || ::listen(m_localListenFd, 16) != 0) {
+            m_error = QString("%1: %2").arg(m_localPath)
+                    .arg(QString::fromLocal8Bit(strerror(errno)));
+            close();
+            return false;
+        }
+        ev.data.fd = m_localListenFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_localListenFd, &ev);
+    }
+
+    // 상위 TCP 연결은 엔진이 시작하면서 건다. 시계 동기 소켓은 setUpstream() 에서 열림
+    if (m_upstream) {
+        ev.data.fd = m_upstream->clockDescriptor();
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    }
+
+    m_quit = false;
+    m_error.clear();
+    start();
+    return true;
+}
+
+void StreamServer::close()
+{
+    if (isRunning()) {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_quit = true;
+        }
+        wake();
+        wait();
+    }
+    if (m_listenFd >= 0) { ::close(m_listenFd); m_listenFd = -1; }
+    if (m_rawListenFd >= 0) { ::close(m_rawListenFd); m_rawListenFd = -1; }
+    if (m_localListenFd >= 0) {
+        ::close(m_localListenFd);
+        m_localListenFd = -1;
+        unlink(m_localPath.toLocal8Bit().constData());
+    }
+    if (m_clockFd >= 0)  { ::close(m_clockFd);  m_clockFd = -1; }
+    if (m_wakeFd >= 0)   { ::close(m_wakeFd);   m_wakeFd = -1; }
+    if (m_timerFd >= 0)  { ::close(m_timerFd);  m_timerFd = -1; }
+    if (m_epollFd >= 0)  { ::close(m_epollFd);  m_epollFd = -1; }
+}
+
+QString StreamServer::errorString() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_error;
+}
+
+void StreamServer::play(AudioSource *source, const QString &path)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        delete m_pendingSource;
+        m_pendingSource = source;
+        m_pendingPath = path;
+        m_pendingPlay = true;
+        m_pendingStop = false;
+        m_pendingSeek = -1;
+    }
+    wake();
+}
+
+void StreamServer::stop()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        delete m_pendingSource;
+        m_pendingSource = nullptr;
+        m_pendingPlay = false;
+        m_pendingStop = true;
+        m_pendingSeek = -1;
+    }
+    wake();
+}
+
+void StreamServer::seek(qint64 frame)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_pendingSeek = qMax<qint64>(0, frame);
+    }
+    wake();
+}
+
+bool StreamServer::isPlaying() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_playing;
+}
+
+qint64 StreamServer::position() const
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_playing || m_positionRate == 0)
+        return m_position;
+    // 보낸 프레임은 재생 시각이 올 때까지 아직 안 들린다
+    const qint64 aheadNs = qMax<qint64>(0, m_positionNs - StreamProtocol::clockNs());
+    const qint64 frame = m_position - aheadNs * m_positionRate / 1000000000;
+    return qMax(frame, m_positionFloor);
+}
+
+void StreamServer::setPacketMilliseconds(int ms)
+{
+    m_packetMs = qBound(1, ms, 100);
+}
+
+void StreamServer::setMaxQueueSeconds(double sec)
+{
+    m_maxQueueSeconds = qMax(0.05, sec);
+}
+
+void StreamServer::setKickSeconds(double sec)
+{
+    m_kickSeconds = qMax(0.1, sec);
+}
+
+void StreamServer::setPlayoutDelay(int ms)
+{
+    m_playoutNs = qint64(qBound(0, ms, 10000)) * 1000000LL;
+}
+
+void StreamServer::setRawPort(quint16 port)
+{
+    m_rawPort = port;
+}
+
+void StreamServer::setZeroCopy(bool on)
+{
+    m_zeroCopy = on;
+}
+
+void StreamServer::setLocalSocket(const QString &path)
+{
+    m_localPath = path;
+}
+
+void StreamServer::setPcmCache(PcmCache *cache)
+{
+    m_pcmCache = cache;
+}
+
+void StreamServer::setOpus(int bitsPerSecond, double frameMs, int complexity)
+{
+    m_opusBitrate = qMax(0, bitsPerSecond);
+    m_opusFrameMs = frameMs;
+    m_opusComplexity = complexity;
+}
+
+bool StreamServer::setUpstream(const QString &host, quint16 port)
+{
+    delete m_upstream;
+    m_upstream = nullptr;
+    if (host.isEmpty())
+        return true;
+    m_upstream = new RelayUpstream;
+    if (!m_upstream->setServer(host, port)) {
+        m_error = m_upstream->errorString();
+        delete m_upstream;
+        m_upstream = nullptr;
+        return false;
+    }
+    return true;
+}
+
+QString StreamServer::upstream() const
+{
+    return m_upstream ? m_upstream->server() : QString();
+}
+
+bool StreamServer::setMulticast(const QString &group, quint16 port, int ttl, double packetMs,
+                                const QString &interfaceAddress)
+{
+    // 소켓은 여기서 열고 (에러를 바로 돌려주려고) 엔진 스레드에 넘긴다
+    RtpSender *rtp = nullptr;
+    if (!group.isEmpty()) {
+        rtp = new RtpSender;
+        rtp->setPacketMilliseconds(packetMs);
+        rtp->setFec(m_fecGroup, m_fecInterleave);
+        if (!rtp->open(group, port, ttl, interfaceAddress)) {
+            QMutexLocker lock(&m_mutex);
+            m_error = rtp->errorString();
+            delete rtp;
+            return false;
+        }
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        delete m_pendingRtp;
+        m_pendingRtp = rtp;
+        m_pendingRtpSet = true;
+    }
+    wake();   // listen() 전이면 엔진이 시작할 때 적용된다
+    return true;
+}
+
+void StreamServer::setSpeakerDistance(const QString &host, double meters)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        Speaker &s = m_pendingSpeakers[host];
+        s.distance = meters >= 0 ? meters : -1;
+        if (s.distance < 0 && s.offsetMs == 0)
+            m_pendingSpeakers.remove(host);
+        m_speakersChanged = true;
+    }
+    wake();
+}
+
+void StreamServer::setSpeakerOffset(const QString &host, double ms)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        Speaker &s = m_pendingSpeakers[host];
+        s.offsetMs = ms;
+        if (s.distance < 0 && s.offsetMs == 0)
+            m_pendingSpeakers.remove(host);
+        m_speakersChanged = true;
+    }
+    wake();
+}
+
+void StreamServer::setSpeedOfSound(double metersPerSecond)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_pendingSpeed = qBound(300.0, metersPerSecond, 400.0);
+        m_speakersChanged = true;
+    }
+    wake();
+}
+
+void StreamServer::setMulticastFec(double overheadPercent, int interleave)
+{
+    // 오버헤드 1/groupSize. 100% 면 같은 패킷을 두 번 보내는 것과 같다
+    m_fecGroup = overheadPercent > 0 ? qBound(1, qRound(100.0 / overheadPercent),
+                                              int(RtpFecEncoder::MaxGroupSize)) : 0;
+    m_fecInterleave = qBound(1, interleave, int(RtpFecEncoder::MaxInterleave));
+}
+
+QString StreamServer::multicastSdp() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_sdp;
+}
+
+QList<StreamServer::ClientInfo> StreamServer::clients() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_clientInfo;
+}
+
+StreamServer::Stats StreamServer::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
+
+void StreamServer::wake()
+{
+    if (m_wakeFd >= 0) {
+        const quint64 one = 1;
+        ssize_t n = write(m_wakeFd, &one, sizeof one);
+        Q_UNUSED(n);
+    }
+}
+
+void StreamServer::handleCommands()
+{
+    quint64 counter;
+    while (read(m_wakeFd, &counter, sizeof counter) > 0) {}
+
+    AudioSource *source = nullptr;
+    RtpSender *rtp = nullptr;
+    QString path;
+    qint64 seek;
+    bool play, stop, rtpSet, speakers;
+    {
+        QMutexLocker lock(&m_mutex);
+        speakers = m_speakersChanged;
+        if (speakers) {
+            m_speakers = m_pendingSpeakers;
+            m_speedOfSound = m_pendingSpeed;
+            m_speakersChanged = false;
+        }
+        source = m_pendingSource;
+        path = m_pendingPath;
+        play = m_pendingPlay;
+        stop = m_pendingStop;
+        seek = m_pendingSeek;
+        rtp = m_pendingRtp;
+        rtpSet = m_pendingRtpSet;
+        m_pendingSource = nullptr;
+        m_pendingRtp = nullptr;
+        m_pendingPlay = m_pendingStop = m_pendingRtpSet = false;
+        m_pendingSeek = -1;
+    }
+    if (play && m_upstream) {
+        // 릴레이는 상위가 트는 것만 내보낸다
+        delete source;
+        play = false;
+    }
+    if (rtpSet) {
+        if (m_rtp)
+            m_rtp->flush();
+        delete m_rtp;
+        m_rtp = rtp;
+        if (m_rtp && m_source && m_opus.isOpen())
+            m_rtp->startTrack(OpusStreamEncoder::SampleRate, m_opus.channels(), m_opus.frameSize());
+        else if (m_rtp && m_source)
+            m_rtp->startTrack(m_source->sampleRate(), m_source->channels());
+        m_relayRtpStarted = false;    // 릴레이는 다음 오디오 패킷에서 시작
+        QMutexLocker lock(&m_mutex);
+        m_sdp = m_rtp && m_source ? m_rtp->sdp() : QString();
+    }
+    if (speakers)
+        applyDelays();
+    if (stop)
+        endTrack(false);
+    if (play) {
+        endTrack(false);
+        startTrack(source, path);
+    }
+    if (seek >= 0 && m_source)
+        seekTrack(seek);
+}
+
+void StreamServer::acceptClients(int listenFd, bool raw)
+{
+    for (;;) {
+        sockaddr_storage sa;
+        socklen_t len = sizeof sa;
+        const int fd = accept4(listenFd, reinterpret_cast<sockaddr *>(&sa), &len,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // 리슨 소켓이 계속 깨우지 않도록 잠시 accept 를 멈춘다
+                pauseAccept(true);
+                m_acceptRetryNs = m_nowNs + kAcceptRetryNs;
+            }
+            return;
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &kSendBuffer, sizeof kSendBuffer);
+
+        Client *c = new Client;
+        c->id = ++m_nextId;
+        c->fd = fd;
+        c->peer = peerName(sa);
+        c->raw = raw;
+        c->host = peerHost(c->peer);
+        if (raw)
+            ++m_rawClients;
+        addClient(c);
+    }
+}
+
+// 같은 호스트 클라이언트: 링을 만들어 fd 를 넘긴다. 소켓은 끊김 감지에만 쓴다
+void StreamServer::acceptLocal()
+{
+    for (;;) {
+        const int fd = accept4(m_localListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                pauseAccept(true);
+                m_acceptRetryNs = m_nowNs + kAcceptRetryNs;
+            }
+            return;
+        }
+        ShmRing *ring = new ShmRing;
+        if (!ring->create(kShmRingBytes) || !ring->sendTo(fd)) {
+            delete ring;
+            ::close(fd);
+            continue;
+        }
+        ucred cred;
+        socklen_t len = sizeof cred;
+        const bool known = getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0;
+
+        Client *c = new Client;
+        c->id = ++m_nextId;
+        c->fd = fd;
+        c->ring = ring;
+        c->peer = known ? QString("local:%1").arg(cred.pid) : QString("local");
+        c->host = QStringLiteral("127.0.0.1");   // 스피커 배치는 루프백 TCP 와 같은 키
+        addClient(c);
+    }
+}
+
+void StreamServer::addClient(Client *c)
+{
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = c->fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, c->fd, &ev);
+    m_clients.insert(c->fd, c);
+    ++m_local.accepted;
+    emit clientConnected(c->id, c->peer);
+    // 배치가 있는 스피커면 첫 오디오보다 먼저 지연을 알려 준다
+    if (!c->raw && !sendDelay(c))
+        dropClient(c);
+}
+
+qint64 StreamServer::speakerDelayNs(const QString &host, double *distance) const
+{
+    *distance = -1;
+    auto it = m_speakers.constFind(host);
+    if (it == m_speakers.constEnd())
+        return 0;
+    double ms = it->offsetMs;
+    if (it->distance >= 0) {
+        double farthest = 0;
+        for (const Speaker &s : m_speakers)
+            farthest = qMax(farthest, s.distance);
+        ms += (farthest - it->distance) / m_speedOfSound * 1000.0;
+        *distance = it->distance;
+    }
+    return qMax<qint64>(0, qint64(ms * 1e6 + 0.5));
+}
+
+// 지연이 바뀐 경우에만 보낸다. 보내다 끊겼으면 false
+bool StreamServer::sendDelay(Client *c)
+{
+    double distance;
+    const qint64 delayNs = speakerDelayNs(c->host, &distance);
+    if (delayNs == c->delayNs && distance == c->distance)
+        return true;
+    c->delayNs = delayNs;
+    c->distance = distance;
+
+    QByteArray packet(StreamProtocol::HeaderSize + StreamProtocol::DelayPayloadSize,
+                      Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(packet.data());
+    StreamProtocol::writeHeader(p, StreamProtocol::Delay, StreamProtocol::DelayPayloadSize, 0);
+    qToLittleEndian<qint64>(delayNs, p + StreamProtocol::HeaderSize);
+    qToLittleEndian<qint32>(distance >= 0 ? qint32(distance * 1000.0 + 0.5) : -1,
+                            p + StreamProtocol::HeaderSize + 8);
+    if (!enqueue(c, packet))
+        return false;
+    return c->wantWrite || flush(c);
+}
+
+// 가장 먼 스피커가 바뀌면 모두의 지연이 바뀌므로 전체를 다시 계산한다
+void StreamServer::applyDelays()
+{
+    QList<Client *> dead;
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it) {
+        Client *c = it.value();
+        if (!c->raw && !sendDelay(c))
+            dead.append(c);
+    }
+    for (Client *c : dead)
+        dropClient(c);
+}
+
+// 시계 동기 요청: t2 는 깨어난 직후, t3 는 보내기 직전에 찍는다.
+// 요청 쪽 경로에 epoll 깨우는 지연이 더해지지만 수십 us 수준이다.
+// 청취자가 많으면 요청이 몰려 오므로 recvmmsg() / sendmmsg() 로 한 번에 kClockBatch 개씩.
+// 같이 받은 요청은 t2 가 같고 t3 도 같다 (응답 안에서 t3 - t2 가 빠지므로 오차 없음)
+void StreamServer::answerClock()
+{
+    uchar buf[kClockBatch][64];
+    sockaddr_storage from[kClockBatch];
+    iovec iov[kClockBatch];
+    mmsghdr in[kClockBatch], out[kClockBatch];
+    memset(in, 0, sizeof in);
+    for (int i = 0; i < kClockBatch; ++i) {
+        iov[i].iov_base = buf[i];
+        iov[i].iov_len = sizeof buf[i];
+        in[i].msg_hdr.msg_iov = &iov[i];
+        in[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (;;) {
+        for (int i = 0; i < kClockBatch; ++i) {
+            in[i].msg_hdr.msg_name = &from[i];
+            in[i].msg_hdr.msg_namelen = sizeof from[i];
+        }
+        const int n = recvmmsg(m_clockFd, in, kClockBatch, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        const qint64 t2 = StreamProtocol::clockNs();
+        int replies = 0;
+        for (int i = 0; i < n; ++i) {
+            if (in[i].msg_len < unsigned(StreamProtocol::ClockRequestSize)
+                    || qFromLittleEndian<quint32>(buf[i]) != StreamProtocol::ClockMagic)
+                continue;
+            qToLittleEndian<qint64>(t2, buf[i] + 16);
+            iov[i].iov_len = StreamProtocol::ClockReplySize;
+            out[replies] = in[i];
+            ++replies;
+        }
+        if (replies > 0) {
+            const qint64 t3 = StreamProtocol::clockNs();
+            for (int i = 0; i < replies; ++i) {
+                uchar *reply = static_cast<uchar *>(out[i].msg_hdr.msg_iov->iov_base);
+                qToLittleEndian<qint64>(t3, reply + 24);
+            }
+            // 소켓 버퍼가 차서 못 보낸 응답은 버린다 (클라이언트가 다시 묻는다)
+            int done = 0;
+            while (done < replies) {
+                const int w = sendmmsg(m_clockFd, out + done, unsigned(replies - done),
+                                       MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                done += w > 0 ? w : 1;
+            }
+            m_local.clockRequests += quint64(replies);
+        }
+        for (int i = 0; i < n; ++i)
+            iov[i].iov_len = sizeof buf[i];
+        if (n < kClockBatch)
+            return;
+    }
+}
+
+void StreamServer::pauseAccept(bool paused)
+{
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = paused ? 0u : quint32(EPOLLIN);
+    ev.data.fd = m_listenFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_listenFd, &ev);
+    if (m_rawListenFd >= 0) {
+        ev.data.fd = m_rawListenFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_rawListenFd, &ev);
+    }
+    if (m_localListenFd >= 0) {
+        ev.data.fd = m_localListenFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_localListenFd, &ev);
+    }
+}
+
+// 지금은 클라이언트가 보내는 것이 없다. 읽어서 버리고 연결 종료만 감지한다
+bool StreamServer::readClient(Client *c)
+{
+    char buf[4096];
+    for (;;) {
+        const ssize_t n = recv(c->fd, buf, sizeof buf, MSG_DONTWAIT);
+        if (n > 0)
+            continue;
+        if (n == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+void StreamServer::dropClient(Client *c, bool kicked)
+{
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+    ::close(c->fd);
+    m_clients.remove(c->fd);
+    if (c->raw)
+        --m_rawClients;
+    if (kicked)
+        ++m_local.kicked;
+    emit clientDisconnected(c->id);
+    delete c->ring;
+    delete c;
+}
+
+bool StreamServer::enqueue(Client *c, const QByteArray &packet)
+{
+    c->queue.append(packet);
+    c->queuedBytes += quint64(packet.size());
+    if (c->queuedBytes <= m_maxQueueBytes) {
+        c->overSinceNs = 0;
+        return true;
+    }
+
+    // 보내는 중인 맨 앞 패킷과 방금 넣은 패킷은 두고, 오래된 오디오부터 버린다
+    int i = c->headOffset > 0 ? 1 : 0;
+    while (c->queuedBytes > m_maxQueueBytes && i < c->queue.size() - 1) {
+        const QByteArray &p = c->queue.at(i);
+        if (c->raw ? isRawHeader(p) : uchar(p.at(4)) != StreamProtocol::Audio) {
+            ++i;
+            continue;
+        }
+        c->queuedBytes -= quint64(p.size());
+        c->queue.removeAt(i);
+        ++c->dropped;
+        ++m_local.droppedPackets;
+    }
+    if (c->overSinceNs == 0)
+        c->overSinceNs = m_nowNs;
+    return m_nowNs - c->overSinceNs < qint64(m_kickSeconds * 1e9);
+}
+
+bool StreamServer::flush(Client *c)
+{
+    if (c->ring)
+        return flushRing(c);
+    while (!c->queue.isEmpty()) {
+        iovec iov[kMaxIov];
+        int n = 0;
+        for (; n < c->queue.size() && n < kMaxIov; ++n) {
+            const QByteArray &p = c->queue.at(n);
+            const int skip = n == 0 ? c->headOffset : 0;
+            iov[n].iov_base = const_cast<char *>(p.constData()) + skip;
+            iov[n].iov_len = size_t(p.size() - skip);
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = size_t(n);
+        const ssize_t w = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                setWantWrite(c, true);
+                return true;
+            }
+            return false;
+        }
+        c->bytesSent += quint64(w);
+        c->queuedBytes -= quint64(w);
+        m_local.bytesSent += quint64(w);
+
+        // 다 나간 패킷은 큐에서 뺀다 (마지막 것은 일부만 나갔을 수 있음)
+        qint64 left = w;
+        while (left > 0) {
+            const int rest = c->queue.first().size() - c->headOffset;
+            if (left >= rest) {
+                left -= rest;
+                c->queue.removeFirst();
+                c->headOffset = 0;
+            } else {
+                c->headOffset += int(left);
+                left = 0;
+            }
+        }
+    }
+
+    // raw 클라이언트: 보낼 때가 된 data 청크를 페이지 캐시에서 소켓으로 바로.
+    // 디코더가 이미 지나간 구간이라 선읽기로 캐시에 올라와 있다 (NFS 에서도 막히지 않음)
+    while (c->raw && !c->needFormat && m_rawFd >= 0 && c->rawOffset < m_rawEnd) {
+        const size_t want = size_t(m_rawEnd - c->rawOffset);
+        ssize_t w;
+        if (m_zeroCopy) {
+            off_t off = off_t(c->rawOffset);
+            w = sendfile(c->fd, m_rawFd, &off, want);
+        } else {
+            // 기준선: 읽어서 보낸다. 다 못 나간 나머지는 다음에 다시 읽는다
+            if (m_rawCopy.isEmpty())
+                m_rawCopy.resize(64 * 1024);
+            const ssize_t r = pread(m_rawFd, m_rawCopy.data(),
+                                    qMin(want, size_t(m_rawCopy.size())), off_t(c->rawOffset));
+            if (r < 0 && errno == EINTR)
+                continue;
+            w = r <= 0 ? r : ::send(c->fd, m_rawCopy.constData(), size_t(r),
+                                    MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                setWantWrite(c, true);
+                return true;
+            }
+            return false;
+        }
+        if (w == 0)
+            break;      // 파일이 줄어들었다
+        c->rawOffset += quint64(w);
+        c->bytesSent += quint64(w);
+        m_local.bytesSent += quint64(w);
+        if (m_zeroCopy)
+            m_local.zeroCopyBytes += quint64(w);
+    }
+    setWantWrite(c, false);
+    return true;
+}
+
+// 링에 자리가 있는 만큼 옮겨 쓴다. 모자라면 큐에 남겨 두고 다음 broadcast 때
+// 다시 한다 (EPOLLOUT 같은 알림은 없다). 소비자를 깨우는 것은 한 번만
+bool StreamServer::flushRing(Client *c)
+{
+    bool wrote = false;
+    while (!c->queue.isEmpty()) {
+        const QByteArray &p = c->queue.first();
+        if (!c->ring->write(p.constData(), p.size()))
+            break;
+        const quint64 n = quint64(p.size());
+        c->bytesSent += n;
+        c->queuedBytes -= n;
+        m_local.bytesSent += n;
+        m_local.sharedMemoryBytes += n;
+        c->queue.removeFirst();
+        wrote = true;
+    }
+    if (wrote)
+        c->ring->notify();
+    return true;
+}
+
+void StreamServer::setWantWrite(Client *c, bool on)
+{
+    if (c->wantWrite == on)
+        return;
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN | EPOLLRDHUP | (on ? quint32(EPOLLOUT) : 0u);
+    ev.data.fd = c->fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->wantWrite = on;
+}
+
+void StreamServer::startTrack(AudioSource *source, const QString &path)
+{
+    if (!source || !source->isOpen() || source->sampleRate() == 0) {
+        delete source;
+        return;
+    }
+    const MappedWavSource *wav = dynamic_cast<const MappedWavSource *>(source);
+    m_cached = nullptr;
+    if (m_pcmCache && !wav && m_pcmCache->capacity() > 0) {
+        const QString key = PcmCache::fileKey(path);
+        if (!key.isEmpty())
+            source = m_cached = new CachedAudioSource(source, key, m_pcmCache);
+    }
+    m_source = source;
+    const AudioInfo &info = source->info();
+    const int ch = info.channels;
+
+    m_packetFrames = qMax<qint64>(1, qint64(info.sampleRate) * m_packetMs / 1000);
+    m_packetBytes = quint64(info.bytesPerSecond() * m_packetMs / 1000.0);
+    m_block.resize(int(m_packetFrames * ch));
+    const quint64 pcmQueueBytes = qMax<quint64>(64 * 1024,
+            quint64(m_maxQueueSeconds * info.sampleRate * ch * sizeof(qint16)));
+    m_maxQueueBytes = pcmQueueBytes;
+
+    // Opus 는 트랙마다 새로 연다 (RTP 한 패킷에 들어가게)
+    if (m_opusBitrate > 0 && OpusStreamEncoder::supports(info.sampleRate, ch)) {
+        m_opus.setBitrate(m_opusBitrate);
+        m_opus.setFrameMilliseconds(m_opusFrameMs);
+        m_opus.setComplexity(m_opusComplexity);
+        m_opus.setMaxPacketBytes(m_rtp ? m_rtp->maxPayload() : 1275);
+        if (m_opus.open(info.sampleRate, ch)) {
+            const double packetsPerSecond = 1000.0 / m_opus.frameMilliseconds();
+            m_maxQueueBytes = qMax<quint64>(8 * 1024, quint64(m_maxQueueSeconds
+                    * (m_opus.bitrate() / 8.0 + packetsPerSecond
+                       * (StreamProtocol::HeaderSize + StreamProtocol::AudioPrefixSize))));
+        } else {
+            QMutexLocker lock(&m_mutex);
+            m_error = m_opus.errorString();
+        }
+    }
+    const bool opus = m_opus.isOpen();
+    const qint64 opusFrames = info.frameCount >= 0
+            ? qint64(double(info.frameCount) * OpusStreamEncoder::SampleRate / info.sampleRate)
+            : info.frameCount;
+
+    m_formatPacket.resize(StreamProtocol::HeaderSize + StreamProtocol::FormatCodecPayloadSize);
+    uchar *p = reinterpret_cast<uchar *>(m_formatPacket.data());
+    StreamProtocol::writeHeader(p, StreamProtocol::Format,
+                                StreamProtocol::FormatCodecPayloadSize, 0);
+    p += StreamProtocol::HeaderSize;
+    qToLittleEndian<quint32>(opus ? quint32(OpusStreamEncoder::SampleRate) : info.sampleRate, p);
+    qToLittleEndian<quint16>(quint16(ch), p + 4);
+    qToLittleEndian<quint16>(opus ? 0 : 16, p + 6);
+    qToLittleEndian<qint64>(opus ? opusFrames : info.frameCount, p + 8);
+    qToLittleEndian<quint32>(opus ? StreamProtocol::CodecOpus : StreamProtocol::CodecPcm, p + 16);
+
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it)
+        it.value()->needFormat = true;
+
+    // raw 포트: 원본이 PCM WAV 면 data 청크를 그대로 (zero-copy), 아니면 디코드한 S16
+    m_rawFd = -1;
+    if (m_rawListenFd >= 0) {
+        const WavFormat::SampleType type = wav ? wav->format().sampleType()
+                                               : WavFormat::UnknownType;
+        if (type != WavFormat::UnknownType)
+            m_rawFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+        if (m_rawFd >= 0) {
+            const WavFormat &f = wav->format();
+            m_rawHeader = rawWavHeader(type == WavFormat::FloatType ? WavFormat::TagIeeeFloat
+                                                                    : WavFormat::TagPcm,
+                                       ch, info.sampleRate, f.bitsPerSample, f.blockAlign);
+            m_rawBlockAlign = f.blockAlign;
+            m_rawEnd = source->bytePosition();
+            m_rawLimit = qMax<quint64>(64 * 1024,
+                    quint64(m_maxQueueSeconds * info.sampleRate) * f.blockAlign);
+        } else {
+            m_rawHeader = rawWavHeader(WavFormat::TagPcm, ch, info.sampleRate, 16, ch * 2);
+            m_rawBlockAlign = ch * 2;
+            m_rawEnd = 0;
+            m_rawLimit = pcmQueueBytes;
+        }
+    }
+
+    // NFS 에서 읽다가 루프가 막히지 않게 선읽기 스레드를 앞세운다. 트랙이 통째로
+    // 캐시에 있으면 파일을 읽을 일이 없다
+    m_readAheadOn = m_packetBytes > 0
+            && !(m_cached && info.frameCount > 0 && m_cached->isCached(0, info.frameCount))
+            && m_readAhead->open(path, info.dataOffset, info.dataSize,
+                                 quint32(info.bytesPerSecond()));
+    if (m_rtp && opus)
+        m_rtp->startTrack(OpusStreamEncoder::SampleRate, ch, m_opus.frameSize());
+    else if (m_rtp)
+        m_rtp->startTrack(info.sampleRate, ch);
+    m_framesSent = 0;
+    m_trackFrame = source->position();
+    m_anchorNs = StreamProtocol::clockNs();
+
+    QMutexLocker lock(&m_mutex);
+    m_playing = true;
+    m_position = m_trackFrame;
+    m_positionNs = m_anchorNs + m_playoutNs;
+    m_positionFloor = 0;
+    m_positionRate = info.sampleRate;
+    m_sdp = m_rtp ? m_rtp->sdp() : QString();
+}
+
+void StreamServer::endTrack(bool notify)
+{
+    if (!m_source)
+        return;
+    if (m_opus.isOpen()) {
+        // 모아 두던 마지막 프레임까지 내보낸다
+        QList<OpusStreamEncoder::Packet> packets;
+        m_opus.flush(&packets);
+        sendOpus(packets);
+        m_opus.close();
+    }
+    broadcast(m_endPacket);
+    if (m_rtp)
+        m_rtp->flush();
+    // raw 클라이언트는 다음 트랙에 새 헤더부터 받는다 (밀려 있던 파일 구간은 버림)
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it) {
+        if (it.value()->raw)
+            it.value()->needFormat = true;
+    }
+    if (m_rawFd >= 0) {
+        ::close(m_rawFd);
+        m_rawFd = -1;
+    }
+    m_rawEnd = 0;
+    delete m_source;
+    m_source = nullptr;
+    m_cached = nullptr;
+    if (m_readAheadOn) {
+        m_readAhead->close();
+        m_readAheadOn = false;
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        m_playing = false;
+        m_sdp.clear();
+    }
+    if (notify)
+        emit trackFinished();
+}
+
+// 네트워크 타임라인 (m_framesSent, m_anchorNs) 은 그대로 두고 읽을 위치만 옮긴다.
+// 다음 패킷부터 새 위치의 샘플이 이어 나가므로 클라이언트 지터 버퍼는 그대로 돌고,
+// 이미 보낸 playout 만큼 재생된 뒤 새 위치가 들린다 (packetMs + playoutDelay 안).
+void StreamServer::seekTrack(qint64 frame)
+{
+    const qint64 total = m_source->frameCount();
+    if (total >= 0)
+        frame = qMin(frame, total);
+    if (!m_source->seek(frame)) {
+        // 디코더 위치를 믿을 수 없으니 이 트랙은 끝낸다
+        {
+            QMutexLocker lock(&m_mutex);
+            m_error = m_source->errorString();
+        }
+        endTrack(true);
+        return;
+    }
+    m_trackFrame = m_source->position();
+    if (m_rawFd >= 0) {
+        // zero-copy raw 클라이언트도 새 위치부터 (아직 못 보낸 예전 구간은 버림).
+        // 프레임 중간까지 보낸 클라이언트는 모자란 바이트만큼 앞에서 시작해 정렬을 지킨다
+        const quint64 oldEnd = m_rawEnd;
+        const quint64 align = quint64(qMax(1, m_rawBlockAlign));
+        m_rawEnd = m_source->bytePosition();
+        for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+             it != m_clients.constEnd(); ++it) {
+            Client *c = it.value();
+            if (!c->raw || c->needFormat)
+                continue;
+            const quint64 partial = c->rawOffset < oldEnd ? (oldEnd - c->rawOffset) % align : 0;
+            c->rawOffset = m_rawEnd - qMin(partial, m_rawEnd);
+            c->overSinceNs = 0;
+        }
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_position = m_positionFloor = m_trackFrame;
+    m_positionNs = m_anchorNs + framesToNs(m_framesSent, m_source->sampleRate()) + m_playoutNs;
+}
+
+// 미디어 시간상 보낼 때가 된 패킷을 내보낸다. 보낼 시각은 기준 시각에서 보낸
+// 프레임 수로만 정하므로 깨어난 시각의 오차가 다음 패킷으로 쌓이지 않는다
+void StreamServer::pump()
+{
+    if (!m_source)
+        return;
+    const quint32 rate = m_source->sampleRate();
+    int sent = 0;
+    while (m_source && m_nowNs >= m_anchorNs + framesToNs(m_framesSent, rate)) {
+        if (sent == kMaxCatchUp) {
+            // 한참 밀렸으면 몰아 보내지 말고 기준 시각을 옮긴다
+            m_anchorNs = m_nowNs - framesToNs(m_framesSent, rate);
+            break;
+        }
+        // 깨어난 뒤 다른 이벤트를 처리한 시간까지 포함한다
+        const qint64 lateNs = StreamProtocol::clockNs()
+                - (m_anchorNs + framesToNs(m_framesSent, rate));
+        if (!sendPacket())
+            break;
+        m_sendLate.add(lateNs);
+        ++sent;
+    }
+    // 이번 틱에 만든 RTP 패킷을 한꺼번에
+    if (m_rtp)
+        m_rtp->sendQueued();
+    if (sent > 1)
+        ++m_local.lateWakeups;
+    if (sent > 0) {
+        QMutexLocker lock(&m_mutex);
+        m_position = m_trackFrame;
+        m_positionNs = m_anchorNs + framesToNs(m_framesSent, rate) + m_playoutNs;
+    }
+}
+
+bool StreamServer::sendPacket()
+{
+    if (m_readAheadOn && !(m_cached && m_cached->isCached(m_cached->position(), m_packetFrames))) {
+        const quint64 off = m_source->bytePosition();
+        m_readAhead->setPlayhead(off);
+        if (!m_readAhead->isReady(off, m_packetBytes)) {
+            // 아직 안 읽힌 구간: 루프를 막지 말고 타임라인을 그만큼 멈춘다
+            ++m_local.stalls;
+            m_anchorNs = m_nowNs - framesToNs(m_framesSent, m_source->sampleRate());
+            return false;
+        }
+    }
+
+    const quint64 rawFrom = m_rawEnd;
+    const qint64 got = m_source->readFloat(m_block.data(), m_packetFrames);
+    if (got <= 0) {
+        endTrack(true);
+        return false;
+    }
+    if (m_rawFd >= 0)
+        m_rawEnd = m_source->bytePosition();
+
+    const int ch = m_source->channels();
+    const int pcmBytes = int(got * ch * sizeof(qint16));
+    // 재생 시각 = 이 패킷을 보내야 했던 시각 + playout 지연 (보낸 실제 시각과 무관)
+    const qint64 presentationNs = m_anchorNs + framesToNs(m_framesSent, m_source->sampleRate())
+            + m_playoutNs;
+    const bool rawCopy = m_rawClients > 0 && m_rawFd < 0;
+    QByteArray rawPcm;                // zero-copy 가 안 되는 raw 클라이언트가 공유하는 S16
+
+    if (m_opus.isOpen()) {
+        // 프레임 길이만큼 모일 때마다 패킷이 나온다 (틱마다 0 개 이상)
+        QList<OpusStreamEncoder::Packet> packets;
+        m_opus.push(m_block.constData(), got, presentationNs, &packets);
+        sendOpus(packets);
+        if (rawCopy) {
+            rawPcm.resize(pcmBytes);
+            floatToS16(m_block.constData(), reinterpret_cast<qint16 *>(rawPcm.data()), got * ch);
+        }
+    } else {
+        // 패킷은 한 번만 만들고 모든 클라이언트 큐가 같은 버퍼를 참조한다
+        const int payload = StreamProtocol::AudioPrefixSize + pcmBytes;
+        QByteArray packet(StreamProtocol::HeaderSize + payload, Qt::Uninitialized);
+        uchar *p = reinterpret_cast<uchar *>(packet.data());
+        StreamProtocol::writeHeader(p, StreamProtocol::Audio, quint32(payload), m_sequence++);
+        qToLittleEndian<qint64>(m_framesSent, p + StreamProtocol::HeaderSize);
+        qToLittleEndian<qint64>(presentationNs, p + StreamProtocol::HeaderSize + 8);
+        // 타깃(arm64)과 x86 모두 little endian 이라 S16 을 그대로 쓴다
+        qint16 *pcm = reinterpret_cast<qint16 *>(p + StreamProtocol::HeaderSize
+                                                 + StreamProtocol::AudioPrefixSize);
+        floatToS16(m_block.constData(), pcm, got * ch);
+        ++m_local.packets;
+        broadcast(packet);
+        if (rawCopy)
+            rawPcm = QByteArray(reinterpret_cast<const char *>(pcm), pcmBytes);
+        // 멀티캐스트는 청취자 수와 상관없이 한 번만
+        if (m_rtp)
+            m_rtp->push(pcm, got, presentationNs);
+    }
+
+    m_framesSent += got;
+    m_trackFrame += got;
+    if (m_rawClients > 0)
+        feedRaw(rawFrom, rawPcm);
+    return true;
+}
+
+// 인코드한 패킷 하나가 오디오 패킷 하나. TCP 클라이언트와 RTP 가 같은 바이트를 쓴다
+void StreamServer::sendOpus(const QList<OpusStreamEncoder::Packet> &packets)
+{
+    for (const OpusStreamEncoder::Packet &op : packets) {
+        const int payload = StreamProtocol::AudioPrefixSize + op.data.size();
+        QByteArray packet(StreamProtocol::HeaderSize + payload, Qt::Uninitialized);
+        uchar *p = reinterpret_cast<uchar *>(packet.data());
+        StreamProtocol::writeHeader(p, StreamProtocol::Audio, quint32(payload), m_sequence++);
+        qToLittleEndian<qint64>(op.firstFrame, p + StreamProtocol::HeaderSize);
+        qToLittleEndian<qint64>(op.presentationNs, p + StreamProtocol::HeaderSize + 8);
+        memcpy(p + StreamProtocol::HeaderSize + StreamProtocol::AudioPrefixSize,
+               op.data.constData(), size_t(op.data.size()));
+        ++m_local.packets;
+        broadcast(packet);
+        if (m_rtp)
+            m_rtp->pushEncoded(op.data, op.frames, op.presentationNs);
+    }
+}
+
+void StreamServer::broadcast(const QByteArray &packet)
+{
+    const bool isEnd = uchar(packet.at(4)) == StreamProtocol::End;
+    QList<Client *> dead, kicked;
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it) {
+        Client *c = it.value();
+        if (c->raw)
+            continue;
+        bool ok = true;
+        if (isEnd) {
+            // Format 을 받은 클라이언트만 End 를 받는다
+            if (c->needFormat)
+                continue;
+            c->needFormat = true;
+        } else if (c->needFormat) {
+            c->needFormat = false;
+            ok = enqueue(c, m_formatPacket);
+        }
+        if (!ok || !enqueue(c, packet)) {
+            kicked.append(c);
+            continue;
+        }
+        // 이미 EPOLLOUT 대기 중이면 쓰기 가능 이벤트 때 한꺼번에 보낸다
+        if (!c->wantWrite && !flush(c))
+            dead.append(c);
+    }
+    for (Client *c : kicked)
+        dropClient(c, true);
+    for (Client *c : dead)
+        dropClient(c);
+}
+
+// from 은 이번 패킷 앞의 data 청크 오프셋 (새로 붙은 raw 클라이언트의 시작점)
+void StreamServer::feedRaw(quint64 from, const QByteArray &pcm)
+{
+    QList<Client *> dead, kicked;
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it) {
+        Client *c = it.value();
+        if (!c->raw)
+            continue;
+        bool ok = true;
+        if (c->needFormat) {
+            c->needFormat = false;
+            c->rawOffset = from;
+            ok = enqueue(c, m_rawHeader);
+        }
+        if (ok)
+            ok = m_rawFd >= 0 ? checkRawLag(c) : enqueue(c, pcm);
+        if (!ok) {
+            kicked.append(c);
+            continue;
+        }
+        if (!c->wantWrite && !flush(c))
+            dead.append(c);
+    }
+    for (Client *c : kicked)
+        dropClient(c, true);
+    for (Client *c : dead)
+        dropClient(c);
+}
+
+// sendfile 경로는 큐가 없으므로 밀린 양을 파일 오프셋 차이로 본다.
+// 상한을 넘으면 프레임 단위로 건너뛰고, 계속 넘으면 끊는다 (enqueue 와 같은 규칙)
+bool StreamServer::checkRawLag(Client *c)
+{
+    const quint64 lag = m_rawEnd > c->rawOffset ? m_rawEnd - c->rawOffset : 0;
+    if (lag <= m_rawLimit) {
+        // 건너뛴 뒤에도 절반 아래로 내려와야 따라잡은 것으로 본다
+        if (lag <= m_rawLimit / 2)
+            c->overSinceNs = 0;
+        return true;
+    }
+    const quint64 align = quint64(qMax(1, m_rawBlockAlign));
+    c->rawOffset += (lag - m_rawLimit / 2) / align * align;
+    ++c->dropped;
+    ++m_local.droppedPackets;
+    if (c->overSinceNs == 0)
+        c->overSinceNs = m_nowNs;
+    return m_nowNs - c->overSinceNs < qint64(m_kickSeconds * 1e9);
+}
+
+void StreamServer::connectUpstream()
+{
+    m_upstreamRetryNs = 0;
+    if (!m_upstream->connectToServer()) {
+        m_upstreamRetryNs = m_nowNs + kUpstreamRetryNs;
+        return;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLOUT;
+    ev.data.fd = m_upstream->socketDescriptor();
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+}
+
+void StreamServer::serviceUpstream(quint32 events)
+{
+    if (m_upstream->isConnecting()) {
+        if (!m_upstream->finishConnect()) {
+            dropUpstream();
+            return;
+        }
+        epoll_event ev;
+        memset(&ev, 0, sizeof ev);
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = m_upstream->socketDescriptor();
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, ev.data.fd, &ev);
+        return;
+    }
+    // 끊겼어도 받아 둔 패킷 (End 등) 은 먼저 넘긴다
+    QList<QByteArray> packets;
+    const bool ok = m_upstream->read(&packets) && !(events & EPOLLERR);
+    while (!packets.isEmpty())
+        relayPacket(packets.takeFirst());     // 참조를 하나로 두어 헤더를 고칠 때 복사하지 않게
+    if (m_rtp)
+        m_rtp->sendQueued();
+    if (!ok)
+        dropUpstream();
+}
+
+// 하위 클라이언트는 End 를 받고 기다린다. 다시 붙으면 상위가 Format 부터 보낸다
+void StreamServer::dropUpstream()
+{
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_upstream->socketDescriptor(), nullptr);
+    {
+        QMutexLocker lock(&m_mutex);
+        m_error = m_upstream->errorString();
+    }
+    m_upstream->close();
+    endRelay();
+    m_upstreamRetryNs = m_nowNs + kUpstreamRetryNs;
+}
+
+// 상위 패킷 하나. 오디오 패킷은 받은 버퍼 그대로 (sequence 만 이 서버 것으로) 공유한다
+void StreamServer::relayPacket(QByteArray packet)
+{
+    uchar *p = reinterpret_cast<uchar *>(packet.data());
+    const quint32 payload = qFromLittleEndian<quint32>(p + 8);
+    if (p[4] == StreamProtocol::Format) {
+        startRelay(packet);
+        return;
+    }
+    if (p[4] == StreamProtocol::End) {
+        endRelay();
+        return;
+    }
+    if (!m_relaying)
+        return;                 // Format 전에 온 오디오
+
+    StreamProtocol::writeHeader(p, StreamProtocol::Audio, payload, m_sequence++);
+    const qint64 firstFrame = qFromLittleEndian<qint64>(p + StreamProtocol::HeaderSize);
+    const qint64 presentationNs = qFromLittleEndian<qint64>(p + StreamProtocol::HeaderSize + 8);
+    const uchar *data = p + StreamProtocol::HeaderSize + StreamProtocol::AudioPrefixSize;
+    const int bytes = int(payload) - StreamProtocol::AudioPrefixSize;
+    const int frames = m_relayOpus
+            ? opus_packet_get_nb_samples(data, bytes, OpusStreamEncoder::SampleRate)
+            : bytes / (2 * m_relayChannels);
+
+    // 앞 단에서 쓴 시간만큼 여유가 줄어 있다. 이미 지났으면 하위 지터 버퍼가 버린다
+    const qint64 leadNs = presentationNs - m_nowNs;
+    if (leadNs < 0)
+        ++m_local.relayLate;
+    m_relayLeadNs = qMin(m_relayLeadNs, leadNs);
+
+    ++m_local.packets;
+    broadcast(packet);
+    if (frames <= 0)
+        return;                 // 깨진 Opus 패킷은 클라이언트에만 (손실로 처리됨)
+    if (m_rtp) {
+        if (!m_relayRtpStarted) {
+            m_rtp->startTrack(m_relayRate, m_relayChannels, m_relayOpus ? frames : 0);
+            m_relayRtpStarted = true;
+            QMutexLocker lock(&m_mutex);
+            m_sdp = m_rtp->sdp();
+        }
+        if (m_relayOpus)
+            m_rtp->pushEncoded(QByteArray(reinterpret_cast<const char *>(data), bytes), frames,
+                               presentationNs);
+        else
+            m_rtp->push(reinterpret_cast<const qint16 *>(data), frames, presentationNs);
+    }
+    // raw 클라이언트는 PCM 일 때만 (Opus 를 디코드하지 않는다)
+    if (m_rawClients > 0 && !m_relayOpus)
+        feedRaw(0, QByteArray(reinterpret_cast<const char *>(data), bytes));
+
+    QMutexLocker lock(&m_mutex);
+    m_position = firstFrame + frames;
+    m_positionNs = presentationNs + framesToNs(frames, m_relayRate);
+}
+
+void StreamServer::startRelay(const QByteArray &format)
+{
+    endRelay();
+    const uchar *p = reinterpret_cast<const uchar *>(format.constData()) + StreamProtocol::HeaderSize;
+    const quint32 payload = quint32(format.size() - StreamProtocol::HeaderSize);
+    m_relayRate = qFromLittleEndian<quint32>(p);
+    m_relayChannels = qFromLittleEndian<quint16>(p + 4);
+    m_relayOpus = payload >= StreamProtocol::FormatCodecPayloadSize
+            && qFromLittleEndian<quint32>(p + 16) == StreamProtocol::CodecOpus;
+    if (m_relayRate == 0 || m_relayChannels < 1)
+        return;                 // 하위 클라이언트가 거절할 포맷은 넘기지 않는다
+
+    m_formatPacket = format;
+    const quint64 pcmQueueBytes = qMax<quint64>(64 * 1024,
+            quint64(m_maxQueueSeconds * m_relayRate * m_relayChannels * sizeof(qint16)));
+    m_maxQueueBytes = m_relayOpus
+            ? qMax<quint64>(8 * 1024, quint64(m_maxQueueSeconds * kMaxOpusBytesPerSecond))
+            : pcmQueueBytes;
+    m_rawFd = -1;
+    m_rawEnd = 0;
+    m_rawHeader = rawWavHeader(WavFormat::TagPcm, m_relayChannels, m_relayRate, 16,
+                               m_relayChannels * 2);
+    m_rawBlockAlign = m_relayChannels * 2;
+    m_rawLimit = pcmQueueBytes;
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it)
+        it.value()->needFormat = true;
+    m_relayRtpStarted = false;
+    m_relaying = true;
+
+    QMutexLocker lock(&m_mutex);
+    m_playing = true;
+    m_position = 0;
+    m_positionNs = m_nowNs;
+    m_positionFloor = 0;
+    m_positionRate = m_relayRate;
+}
+
+void StreamServer::endRelay()
+{
+    if (!m_relaying)
+        return;
+    m_relaying = false;
+    broadcast(m_endPacket);
+    if (m_rtp)
+        m_rtp->flush();
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it) {
+        if (it.value()->raw)
+            it.value()->needFormat = true;
+    }
+    QMutexLocker lock(&m_mutex);
+    m_playing = false;
+    m_sdp.clear();
+}
+
+qint64 StreamServer::nextDeadlineNs() const
+{
+    qint64 deadline = m_lastPublishNs + kPublishNs;
+    if (m_source)
+        deadline = qMin(deadline, m_anchorNs + framesToNs(m_framesSent, m_source->sampleRate()));
+    if (m_acceptRetryNs)
+        deadline = qMin(deadline, m_acceptRetryNs);
+    if (m_upstream) {
+        deadline = qMin(deadline, m_upstream->nextClockNs());
+        if (m_upstreamRetryNs)
+            deadline = qMin(deadline, m_upstreamRetryNs);
+    }
+    return deadline;
+}
+
+// epoll_wait() 의 ms 타임아웃은 ms 로 올림되고 timer slack 까지 붙어 최대 1 ms 넘게
+// 늦는다. 다음 할 일 시각을 timerfd 에 절대 시각으로 걸고 epoll 은 무한정 기다린다.
+// 시각이 그대로면 다시 걸지 않는다 (패킷 사이에 다른 이벤트로 깨도 시스템 콜 없음).
+// 돌려주는 값은 epoll_wait() 타임아웃
+int StreamServer::armTimer(qint64 deadlineNs)
+{
+    if (deadlineNs <= m_nowNs)
+        return 0;
+    if (deadlineNs != m_timerNs) {
+        itimerspec its;
+        memset(&its, 0, sizeof its);
+        its.it_value.tv_sec = time_t(deadlineNs / 1000000000LL);
+        its.it_value.tv_nsec = long(deadlineNs % 1000000000LL);
+        if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &its, nullptr) != 0)
+            return int((deadlineNs - m_nowNs + 999999) / 1000000);
+        m_timerNs = deadlineNs;
+    }
+    return -1;
+}
+
+void StreamServer::publish()
+{
+    QList<ClientInfo> list;
+    list.reserve(m_clients.size());
+    for (QHash<int, Client *>::const_iterator it = m_clients.constBegin();
+         it != m_clients.constEnd(); ++it) {
+        const Client *c = it.value();
+        ClientInfo info;
+        info.id = c->id;
+        info.peer = c->peer;
+        info.bytesSent = c->bytesSent;
+        info.queuedBytes = c->queuedBytes;
+        if (c->raw && !c->needFormat && m_rawEnd > c->rawOffset)
+            info.queuedBytes += m_rawEnd - c->rawOffset;
+        info.droppedPackets = c->dropped;
+        info.raw = c->raw;
+        info.local = c->ring != nullptr;
+        if (c->ring)
+            info.queuedBytes += quint64(c->ring->capacity() - c->ring->freeBytes());
+        info.distanceMeters = c->distance;
+        info.delayMs = c->delayNs / 1e6;
+        list.append(info);
+    }
+    m_local.clients = m_clients.size();
+    m_local.sendLateP50Us = m_sendLate.percentileNs(0.5) / 1e3;
+    m_local.sendLateP99Us = m_sendLate.percentileNs(0.99) / 1e3;
+    m_local.sendLateP999Us = m_sendLate.percentileNs(0.999) / 1e3;
+    m_local.sendLateMaxUs = m_sendLate.maxNs() / 1e3;
+    if (m_rtp) {
+        m_local.rtpPackets = m_rtp->packetsSent();
+        m_local.rtpBytes = m_rtp->bytesSent();
+        m_local.rtpErrors = m_rtp->sendErrors();
+        m_local.rtpFecPackets = m_rtp->fecPacketsSent();
+    }
+    const OpusStreamEncoder::Stats opus = m_opus.stats();
+    m_local.opusPackets = opus.packets;
+    m_local.opusBytes = opus.bytes;
+    m_local.opusCpuPercent = opus.cpuPercent();
+    if (m_upstream) {
+        const RelayUpstream::Stats relay = m_upstream->stats();
+        m_local.upstreamConnected = m_upstream->isConnected();
+        m_local.relayPackets = relay.packets;
+        m_local.relayGaps = relay.gaps;
+        m_local.relayUnsynced = relay.unsynced;
+        m_local.relayHeadroomMs = m_relayLeadNs != LLONG_MAX ? m_relayLeadNs / 1e6 : 0.0;
+        m_relayLeadNs = LLONG_MAX;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_stats = m_local;
+    m_clientInfo.swap(list);
+    m_lastPublishNs = m_nowNs;
+}
+
+void StreamServer::run()
+{
+    epoll_event events[kMaxEvents];
+    m_local = Stats();
+    m_sendLate.reset();
+    m_timerNs = 0;
+    m_nowNs = StreamProtocol::clockNs();
+    m_lastPublishNs = m_nowNs;
+    handleCommands();   // listen() 전에 들어온 play()
+    if (m_upstream)
+        connectUpstream();
+
+    for (;;) {
+        const int n = epoll_wait(m_epollFd, events, kMaxEvents, armTimer(nextDeadlineNs()));
+        m_nowNs = StreamProtocol::clockNs();
+        if (n < 0 && errno != EINTR) {
+            QMutexLocker lock(&m_mutex);
+            m_error = QString::fromLocal8Bit(strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == m_wakeFd) {
+                handleCommands();
+                continue;
+            }
+            if (fd == m_timerFd) {
+                quint64 expirations;
+                ssize_t r = read(m_timerFd, &expirations, sizeof expirations);
+                Q_UNUSED(r);
+                m_timerNs = 0;
+                continue;
+            }
+            if (fd == m_listenFd || fd == m_rawListenFd) {
+                acceptClients(fd, fd == m_rawListenFd);
+                continue;
+            }
+            if (fd == m_localListenFd) {
+                acceptLocal();
+                continue;
+            }
+            if (fd == m_clockFd) {
+                answerClock();
+                continue;
+            }
+            if (m_upstream && fd == m_upstream->socketDescriptor()) {
+                serviceUpstream(events[i].events);
+                continue;
+            }
+            if (m_upstream && fd == m_upstream->clockDescriptor()) {
+                m_upstream->serviceClock(m_nowNs);
+                continue;
+            }
+            Client *c = m_clients.value(fd);
+            if (!c)
+                continue;   // 같은 배치에서 이미 끊긴 클라이언트
+            const quint32 ev = events[i].events;
+            bool ok = !(ev & (EPOLLERR | EPOLLHUP));
+            if (ok && (ev & (EPOLLIN | EPOLLRDHUP)))
+                ok = readClient(c);
+            if (ok && (ev & EPOLLOUT))
+                ok = flush(c);
+            if (!ok)
+                dropClient(c);
+        }
+
+        {
+            QMutexLocker lock(&m_mutex);
+            if (m_quit)
+                break;
+        }
+        if (m_acceptRetryNs && m_nowNs >= m_acceptRetryNs) {
+            pauseAccept(false);
+            m_acceptRetryNs = 0;
+        }
+        if (m_upstream) {
+            if (m_nowNs >= m_upstream->nextClockNs())
+                m_upstream->serviceClock(m_nowNs);
+            if (m_upstreamRetryNs && m_nowNs >= m_upstreamRetryNs)
+                connectUpstream();
+        }
+        pump();
+        if (m_nowNs - m_lastPublishNs >= kPublishNs)
+            publish();
+    }
+
+    endTrack(false);
+    if (m_upstream) {
+        if (m_upstream->socketDescriptor() >= 0)
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_upstream->socketDescriptor(), nullptr);
+        m_upstream->close();
+        endRelay();
+        m_upstreamRetryNs = 0;
+    }
+    while (!m_clients.isEmpty())
+        dropClient(m_clients.begin().value());
+    publish();
+}
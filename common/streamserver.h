@@ -0,0 +1,311 @@
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include "streamprotocol.h"
+#include "opusencoder.h"
+#include "timinghistogram.h"
+
+class AudioSource;
+class CachedAudioSource;
+class PcmCache;
+class ReadAhead;
+class RelayUpstream;
+class RtpSender;
+class ShmRing;
+
+// server2 의 스트리밍 엔진. 전용 스레드에서 epoll 하나로 accept / 송신 / 명령을
+// 모두 처리하고, 미디어 시간에 맞춰 packetMilliseconds 단위로 PCM 을 내보낸다.
+//
+// 패킷은 틱마다 한 번만 만들어지고 (QByteArray 암시적 공유) 클라이언트별 송신
+// 큐에는 참조만 쌓인다. 소켓이 막히면 EPOLLOUT 을 기다리고, 큐가 상한을 넘으면
+// 오래된 오디오 패킷부터 버리며, 너무 오래 못 따라오는 클라이언트는 끊는다.
+//
+// setMulticast() 를 켜면 같은 PCM 을 RTP 멀티캐스트로도 한 번씩만 내보낸다.
+//
+// 모든 오디오 패킷에는 재생 시각 (보낼 시각 + playoutDelay, 서버 시계) 이
+// 붙고, 같은 포트의 UDP 로 시계 동기 요청에 응답한다 (clocksync.h).
+//
+// setOpus() 를 켜면 스트림마다 한 번만 Opus 로 인코드하고, 그 패킷을 모든 TCP
+// 클라이언트와 RTP 가 같이 쓴다 (raw 포트는 그대로 PCM). Opus 가 못 받는 포맷
+// (48 kHz 초과, 3 채널 이상) 트랙은 PCM 으로 보낸다.
+//
+// setPcmCache() 를 주면 압축 포맷은 디코드한 PCM 을 캐시에서 읽어, 같은 트랙을
+// 다시 틀거나 되감을 때 NFS 에서 다시 읽고 디코드하지 않는다.
+//
+// 같은 호스트 클라이언트는 unix 소켓으로 붙어 공유 메모리 링 (shmring.h) 으로
+// 받는다. 패킷과 큐 / 드롭 / 끊기 규칙은 TCP 와 같고, 소켓 복사와 패킷마다의
+// 시스템 콜이 없다 (소비자가 잠들어 있을 때만 eventfd 로 깨운다).
+//
+// raw 포트 클라이언트는 프레이밍 없는 WAV 스트림을 받는다. 원본이 WAV 면 data
+// 청크를 sendfile() 로 페이지 캐시에서 소켓으로 바로 보내 샘플이 사용자 공간을
+// 지나지 않는다. 보내는 양은 같은 미디어 시계 (pump) 로 조절한다.
+//
+// 스피커 배치 (거리 / 보정) 는 피어 호스트 단위로 기억하고, 클라이언트마다 추가
+// 재생 지연을 Delay 패킷으로 따로 보낸다. 오디오 패킷은 그대로 공유한다.
+//
+// setUpstream() 을 주면 릴레이 (edge) 로 돈다. 파일 대신 상위 server2 의 스트림을
+// 받아 (relayupstream.h) 재생 시각만 이 호스트 시계로 옮겨 하위 클라이언트에
+// 그대로 내보낸다. 릴레이를 다시 릴레이할 수 있어 트리로 퍼뜨릴 수 있고, 모든
+// 단의 청취자가 원본 서버가 정한 같은 순간에 재생한다.
+class StreamServer : public QThread
+{
+    Q_OBJECT
+public:
+    struct ClientInfo {
+        int     id = 0;
+        QString peer;
+        quint64 bytesSent = 0;
+        quint64 queuedBytes = 0;
+        quint64 droppedPackets = 0;
+        bool    raw = false;
+        bool    local = false;        // 공유 메모리 링
+        double  distanceMeters = -1;  // 모르면 -1
+        double  delayMs = 0;          // 보낸 스피커 지연
+    };
+
+    struct Stats {
+        int     clients = 0;
+        quint64 accepted = 0;
+        quint64 packets = 0;          // 만든 오디오 패킷 (클라이언트 수와 무관)
+        quint64 bytesSent = 0;
+        quint64 droppedPackets = 0;   // 느린 클라이언트 큐에서 버린 패킷
+        quint64 kicked = 0;           // 못 따라와서 끊은 클라이언트
+        quint64 stalls = 0;           // 선읽기가 안 돼 타임라인을 멈춘 횟수
+        quint64 lateWakeups = 0;      // 패킷 2개 이상 늦게 깬 횟수
+        // 패킷을 실제로 만든 시각 - 미디어 시간상 보낼 시각 (엔진 시작부터 누적)
+        double  sendLateP50Us = 0;
+        double  sendLateP99Us = 0;
+        double  sendLateP999Us = 0;
+        double  sendLateMaxUs = 0;
+        quint64 rtpPackets = 0;
+        quint64 rtpBytes = 0;
+        quint64 rtpErrors = 0;
+        quint64 rtpFecPackets = 0;
+        quint64 clockRequests = 0;
+        quint64 zeroCopyBytes = 0;    // raw 클라이언트에 sendfile 로 보낸 바이트
+        quint64 sharedMemoryBytes = 0;    // 로컬 클라이언트 링에 쓴 바이트
+        quint64 opusPackets = 0;
+        quint64 opusBytes = 0;
+        double  opusCpuPercent = 0;   // 인코더 CPU (실시간 대비, 코어 하나 기준)
+        bool    upstreamConnected = false;
+        quint64 relayPackets = 0;     // 상위에서 받아 넘긴 오디오 패킷
+        quint64 relayGaps = 0;        // 상위에서 빠져 있던 패킷
+        quint64 relayUnsynced = 0;    // 시계가 맞기 전이라 버린 패킷
+        quint64 relayLate = 0;        // 받았을 때 이미 재생 시각이 지난 패킷
+        double  relayHeadroomMs = 0;  // 최근 받은 패킷의 재생 시각까지 남은 최소 여유
+
+        QString toString() const;
+    };
+
+    explicit StreamServer(QObject *parent = nullptr);
+    ~StreamServer();
+
+    // 소켓을 열고 엔진 스레드를 시작한다. address 가 비면 모든 인터페이스
+    bool listen(quint16 port = StreamProtocol::DefaultPort, const QString &address = QString());
+    void close();
+    QString errorString() const;
+
+    // 열린 소스를 넘겨받아 처음부터 내보낸다 (소유권 이동). stop() 은 즉시 정지
+    void play(AudioSource *source, const QString &path);
+    void stop();
+    // 재생 중인 트랙의 frame 으로 샘플 단위로 옮긴다. 네트워크 타임라인은 끊지 않아
+    // 모든 클라이언트가 끊김 없이 playoutDelay (+ 스피커 지연) 안에 새 위치를 듣는다
+    void seek(qint64 frame);
+    bool isPlaying() const;
+    // 지금 클라이언트에서 들리는 트랙 위치 (프레임). 보낸 위치에서 playout 만큼
+    // 뺀 값이라 seek 직후에는 새 위치가 들릴 때까지 seek 한 자리에 머문다
+    qint64 position() const;
+
+    // listen() 전에 설정
+    void setPacketMilliseconds(int ms);   // 기본 10ms
+    void setMaxQueueSeconds(double sec);  // 클라이언트 송신 큐 상한, 기본 2s
+    void setKickSeconds(double sec);      // 상한을 이만큼 계속 넘으면 끊음, 기본 5s
+    void setPlayoutDelay(int ms);         // 보낸 뒤 재생까지 여유 (클라이언트 버퍼), 기본 200ms
+    void setRawPort(quint16 port);        // raw PCM 포트, 기본 5701. 0 이면 열지 않음
+    // raw 포트의 WAV data 청크를 sendfile 로 보낸다 (기본). false 면 pread + send 로
+    // 사용자 공간 버퍼를 거친다 (비교 측정용 기준선)
+    void setZeroCopy(bool on);
+    // 같은 호스트 클라이언트용 unix 소켓 (공유 메모리 링). 기본은
+    // StreamProtocol::defaultLocalSocketPath(), 비면 열지 않음
+    void setLocalSocket(const QString &path);
+    QString localSocket() const { return m_localPath; }
+    // 디코드한 PCM 캐시 (소유하지 않음, 다른 곳과 같이 써도 됨). WAV 는 mmap 과
+    // sendfile 로 페이지 캐시에서 바로 보내므로 거치지 않는다
+    void setPcmCache(PcmCache *cache);
+    // 네트워크 스트림 코덱. bitsPerSecond 0 이면 PCM (기본). 클라이언트는 보내는
+    // 것이 없으므로 서버 단위 설정이다
+    void setOpus(int bitsPerSecond, double frameMs = 20, int complexity = 5);
+    // 릴레이 모드. host 가 비면 끈다. 켜면 play() / seek() 는 무시하고 재생 시각은
+    // 상위가 정한 것을 쓴다 (playoutDelay 대신 상위의 남은 여유). 코덱도 상위 그대로
+    bool setUpstream(const QString &host, quint16 port = StreamProtocol::DefaultPort);
+    QString upstream() const;
+    quint16 rawPort() const { return m_rawPort; }
+
+    // RTP 멀티캐스트 출력. 언제든 호출 가능, group 이 비면 끈다.
+    // packetMs 는 RTP 패킷 길이 (TCP 패킷 길이와 별개, MTU 안으로 잘림)
+    bool setMulticast(const QString &group, quint16 port, int ttl = 1, double packetMs = 5.0,
+                      const QString &interfaceAddress = QString());
+    QString multicastSdp() const;         // 재생 중인 트랙의 SDP (없으면 빈 문자열)
+    // RTP 손실 복구 (XOR FEC, port + 2). 다음 setMulticast() 부터 적용된다.
+    // overheadPercent 0 이면 끔. interleave 는 한꺼번에 잃어도 되살리는 연속 패킷 수
+    void setMulticastFec(double overheadPercent, int interleave = 1);
+
+    // 스피커 배치 (피어 호스트 단위, 재접속해도 유지). 청취 위치까지 거리가 다른
+    // 스피커의 소리가 동시에 도착하도록 가장 먼 스피커에 맞춰 나머지를 늦춘다.
+    //   지연 = (가장 먼 거리 - 거리) / 음속 + 보정
+    // 언제든 호출 가능. 클라이언트는 재생 중에도 끊김 없이 새 지연으로 옮겨 간다.
+    // raw 포트 클라이언트에는 적용되지 않는다 (지터 버퍼가 없음)
+    void setSpeakerDistance(const QString &host, double meters);   // 음수면 지움
+    void setSpeakerOffset(const QString &host, double ms);          // 측정한 보정
+    void setSpeedOfSound(double metersPerSecond);                   // 기본 343
+
+    QList<ClientInfo> clients() const;
+    Stats stats() const;
+
+signals:
+    void clientConnected(int id, const QString &peer);
+    void clientDisconnected(int id);
+    void trackFinished();
+
+protected:
+    void run() override;
+
+private:
+    struct Client;
+    struct Speaker {
+        double distance = -1;
+        double offsetMs = 0;
+    };
+
+    void wake();
+    void handleCommands();
+    void acceptClients(int listenFd, bool raw);
+    void acceptLocal();
+    void addClient(Client *c);
+    void answerClock();
+    void pauseAccept(bool paused);
+    bool readClient(Client *c);
+    void dropClient(Client *c, bool kicked = false);
+    bool enqueue(Client *c, const QByteArray &packet);
+    bool flush(Client *c);
+    bool flushRing(Client *c);
+    void setWantWrite(Client *c, bool on);
+    void startTrack(AudioSource *source, const QString &path);
+    void endTrack(bool notify);
+    void seekTrack(qint64 frame);
+    void pump();
+    bool sendPacket();
+    void sendOpus(const QList<OpusStreamEncoder::Packet> &packets);
+    void broadcast(const QByteArray &packet);
+    void feedRaw(quint64 from, const QByteArray &pcm);
+    bool checkRawLag(Client *c);
+    qint64 speakerDelayNs(const QString &host, double *distance) const;
+    bool sendDelay(Client *c);
+    void applyDelays();
+    void connectUpstream();
+    void serviceUpstream(quint32 events);
+    void dropUpstream();
+    void relayPacket(QByteArray packet);
+    void startRelay(const QByteArray &format);
+    void endRelay();
+    qint64 nextDeadlineNs() const;
+    int  armTimer(qint64 deadlineNs);
+    void publish();
+
+    // 스레드 간 공유 (m_mutex)
+    mutable QMutex m_mutex;
+    QString      m_error;
+    AudioSource *m_pendingSource;
+    QString      m_pendingPath;
+    bool         m_pendingPlay;
+    bool         m_pendingStop;
+    qint64       m_pendingSeek;       // -1 이면 없음
+    RtpSender   *m_pendingRtp;
+    bool         m_pendingRtpSet;
+    QString      m_sdp;
+    QHash<QString, Speaker> m_pendingSpeakers;
+    double       m_pendingSpeed;
+    bool         m_speakersChanged;
+    bool         m_quit;
+    bool         m_playing;
+    qint64       m_position;          // 다음에 보낼 트랙 프레임
+    qint64       m_positionNs;        // 그 프레임의 재생 시각
+    qint64       m_positionFloor;     // 마지막 seek 위치 (트랙 시작이면 0)
+    quint32      m_positionRate;
+    Stats        m_stats;
+    QList<ClientInfo> m_clientInfo;
+
+    // 설정
+    int    m_packetMs;
+    double m_maxQueueSeconds;
+    double m_kickSeconds;
+    qint64 m_playoutNs;
+    quint16 m_rawPort;
+    bool   m_zeroCopy;
+    QString m_localPath;
+    int    m_fecGroup;
+    int    m_fecInterleave;
+    PcmCache *m_pcmCache;
+    int    m_opusBitrate;
+    double m_opusFrameMs;
+    int    m_opusComplexity;
+    RelayUpstream *m_upstream;        // 릴레이 모드가 아니면 nullptr (엔진이 시작되면 엔진 전용)
+
+    // 엔진 스레드 전용
+    int m_listenFd;
+    int m_rawListenFd;
+    int m_localListenFd;
+    int m_clockFd;
+    int m_epollFd;
+    int m_wakeFd;
+    int m_timerFd;                    // 다음 할 일 시각 (timerfd, CLOCK_MONOTONIC 절대 시각)
+    qint64 m_timerNs;                 // m_timerFd 에 걸어 둔 시각 (0 = 안 걸림)
+    int m_nextId;
+    QHash<int, Client *> m_clients;   // fd -> client
+    int m_rawClients;
+    AudioSource *m_source;
+    CachedAudioSource *m_cached;      // m_source 가 캐시를 거치면 같은 것, 아니면 nullptr
+    ReadAhead   *m_readAhead;
+    bool         m_readAheadOn;
+    RtpSender   *m_rtp;
+    OpusStreamEncoder m_opus;         // 열려 있으면 이 트랙은 Opus
+    QByteArray   m_formatPacket;
+    QByteArray   m_endPacket;
+    QByteArray   m_rawHeader;         // raw 클라이언트용 WAV 헤더 (트랙마다)
+    int          m_rawFd;             // zero-copy 용 원본 파일 (WAV 가 아니면 -1)
+    quint64      m_rawEnd;            // 지금까지 보낼 때가 된 data 청크 끝 (파일 오프셋)
+    quint64      m_rawLimit;          // raw 클라이언트가 이보다 밀리면 건너뜀
+    int          m_rawBlockAlign;
+    QByteArray   m_rawCopy;           // setZeroCopy(false) 일 때 pread 버퍼
+    QVector<float> m_block;
+    quint32 m_sequence;
+    qint64  m_framesSent;             // 네트워크 타임라인 (seek 해도 이어짐)
+    qint64  m_trackFrame;             // 다음에 읽을 트랙 프레임
+    qint64  m_packetFrames;
+    quint64 m_packetBytes;            // 패킷 하나 분량의 원본 파일 바이트 (선읽기 확인용)
+    qint64  m_anchorNs;               // 프레임 0 을 보냈어야 하는 시각 (CLOCK_MONOTONIC)
+    quint64 m_maxQueueBytes;
+    qint64  m_nowNs;
+    qint64  m_acceptRetryNs;          // fd 가 모자라 accept 를 쉬는 중이면 재시도 시각
+    qint64  m_lastPublishNs;
+    Stats   m_local;
+    TimingHistogram m_sendLate;
+    QHash<QString, Speaker> m_speakers;   // 호스트 -> 배치
+    double  m_speedOfSound;
+    qint64  m_upstreamRetryNs;        // 상위에 다시 연결할 시각 (0 = 연결 중이거나 연결됨)
+    bool    m_relaying;               // 상위 Format 을 받았고 End 는 아직
+    quint32 m_relayRate;
+    int     m_relayChannels;
+    bool    m_relayOpus;
+    bool    m_relayRtpStarted;        // RTP 는 첫 오디오에서 (Opus 프레임 길이를 알고) 시작
+    qint64  m_relayLeadNs;            // 이번 publish 주기의 최소 여유
+};
+
+#endif // STREAMSERVER_H
@@ -0,0 +1,63 @@
+#include "timinghistogram.h"
+#include <cmath>
+#include <string.h>
+
+namespace {
+
+int bucketOf(quint64 us)
+{
+    if (us < quint64(TimingHistogram::SubBuckets))
+        return int(us);
+    const int octave = 63 - __builtin_clzll(us);          // 3 이상
+    if (octave - 3 >= TimingHistogram::Octaves)
+        return TimingHistogram::Buckets - 1;
+    const int sub = int(us >> (octave - 3)) - TimingHistogram::SubBuckets;
+    return TimingHistogram::SubBuckets + (octave - 3) * TimingHistogram::SubBuckets + sub;
+}
+
+// 칸의 위 경계 (µs, 포함하지 않음)
+quint64 upperBoundUs(int bucket)
+{
+    if (bucket < TimingHistogram::SubBuckets)
+        return quint64(bucket + 1);
+    const int shift = (bucket - TimingHistogram::SubBuckets) / TimingHistogram::SubBuckets;
+    const int sub = (bucket - TimingHistogram::SubBuckets) % TimingHistogram::SubBuckets;
+    return quint64(TimingHistogram::SubBuckets + sub + 1) << shift;
+}
+
+} // namespace
+
+TimingHistogram::TimingHistogram()
+{
+    reset();
+}
+
+void TimingHistogram::add(qint64 ns)
+{
+    if (ns < 0)
+        ns = 0;
+    ++m_buckets[bucketOf(quint64(ns) / 1000)];
+    ++m_count;
+    m_maxNs = qMax(m_maxNs, ns);
+}
+
+void TimingHistogram::reset()
+{
+    memset(m_buckets, 0, sizeof m_buckets);
+    m_count = 0;
+    m_maxNs = 0;
+}
+
+qint64 TimingHistogram::percentileNs(double fraction) const
+{
+    if (m_count == 0)
+        return 0;
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(fraction * double(m_count))));
+    quint64 seen = 0;
+    for (int i = 0; i < Buckets; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank)
+            return qMin(m_maxNs, qint64(upperBoundUs(i)) * 1000);
+    }
+    return m_maxNs;
+}
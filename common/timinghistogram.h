@@ -0,0 +1,35 @@
+#ifndef TIMINGHISTOGRAM_H
+#define TIMINGHISTOGRAM_H
+
+#include <QtGlobal>
+
+// 시간 오차 히스토그램 (ns 로 넣고 µs 해상도로 센다). 1 µs 미만~8 µs 는 1 µs
+// 간격, 그 위로는 2배 구간마다 8칸이라 어느 값이든 오차가 1/8 이하다. 고정
+// 크기라 엔진 스레드에서 할당 없이 넣고, 99.9 퍼센타일도 표본을 모두 들고
+// 있지 않고 구한다.
+class TimingHistogram
+{
+public:
+    enum {
+        SubBuckets = 8,
+        Octaves    = 22,          // 8 µs ~ 33 s
+        Buckets    = SubBuckets + Octaves * SubBuckets
+    };
+
+    TimingHistogram();
+
+    void add(qint64 ns);          // 음수는 0 으로
+    void reset();
+
+    quint64 count() const { return m_count; }
+    qint64  maxNs() const { return m_maxNs; }
+    // fraction (0.99, 0.999 ...) 의 값이 들어 있는 칸의 위 경계 (최댓값보다 크지 않게)
+    qint64  percentileNs(double fraction) const;
+
+private:
+    quint64 m_buckets[Buckets];
+    quint64 m_count;
+    qint64  m_maxNs;
+};
+
+#endif // TIMINGHISTOGRAM_H
@@ -0,0 +1,37 @@
+#ifndef VORBISSOURCE_H
+#define VORBISSOURCE_H
+
+#include "audiosource.h"
+#include <vorbis/vorbisfile.h>
+
+// libvorbisfile 기반 Ogg Vorbis 소스.
+// ov_read_float 가 돌려주는 채널별 버퍼를 호출자 버퍼로 바로 인터리브한다.
+// seek() 는 ov_pcm_seek (granule position 이분 탐색, 샘플 단위 정확).
+class VorbisSource : public AudioSource
+{
+public:
+    VorbisSource();
+    ~VorbisSource();
+
+    bool open(const QString &path) override;
+    void close() override;
+    bool isOpen() const override { return m_open; }
+    QString errorString() const override { return m_error; }
+    const AudioInfo &info() const override { return m_info; }
+
+    qint64  position() const override { return m_pos; }
+    quint64 bytePosition() const override;
+    bool    seek(qint64 frame) override;
+    qint64  readFloat(float *dst, qint64 maxFrames) override;
+
+private:
+    OggVorbis_File m_vf;
+    bool      m_open;
+    AudioInfo m_info;
+    qint64    m_pos;
+    QString   m_error;
+
+    Q_DISABLE_COPY(VorbisSource)
+};
+
+#endif // VORBISSOURCE_H
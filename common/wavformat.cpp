@@ -0,0 +1,271 @@
+#include "wavformat.h"
+#include <QIODevice>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const quint32 kSize32Unknown = 0xFFFFFFFFu;
+
+// KSDATAFORMAT_SUBTYPE_xxx GUID 에서 포맷 코드(앞 2바이트)를 뺀 나머지
+const uchar kSubtypeTail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+    0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+inline bool isId(const uchar *p, const char *id) { return memcmp(p, id, 4) == 0; }
+
+} // namespace
+
+WavFormat::SampleType WavFormat::sampleType() const
+{
+    const int container = containerBits();
+    switch (subFormat) {
+    case TagPcm:
+        return (container >= 8 && container <= 32 && bitsPerSample <= container)
+                ? IntType : UnknownType;
+    case TagIeeeFloat:
+        return ((container == 32 || container == 64) && bitsPerSample == container)
+                ? FloatType : UnknownType;
+    default:
+        return UnknownType;
+    }
+}
+
+void WavParser::reset(qint64 fileSize)
+{
+    m_state = RiffHeader;
+    m_status = NeedData;
+    m_fileSize = fileSize;
+    m_offset = 0;
+    m_chunkSize = 0;
+    m_chunkBody = 0;
+    m_haveFmt = false;
+    m_haveDs64 = false;
+    m_ds64DataSize = 0;
+    m_tableCount = 0;
+    m_format = WavFormat();
+    m_error = "";
+}
+
+int WavParser::bytesWanted() const
+{
+    switch (m_state) {
+    case RiffHeader:  return 12;
+    case ChunkHeader: return 8;
+    case FmtBody:     return int(qMin<quint64>(m_chunkSize, 40));
+    case Ds64Body:    return int(qMin<quint64>(m_chunkSize, MaxWanted));
+    }
+    return 0;
+}
+
+WavParser::Status WavParser::fail(const char *why)
+{
+    m_error = why;
+    m_status = Error;
+    return m_status;
+}
+
+WavParser::Status WavParser::parse(const uchar *p, qint64 len)
+{
+    if (m_status != NeedData)
+        return m_status;
+
+    const quint64 want = quint64(bytesWanted());
+    if (m_fileSize >= 0
+            && (m_offset > quint64(m_fileSize) || want > quint64(m_fileSize) - m_offset)) {
+        if (m_state != ChunkHeader)
+            return fail("truncated header");
+        return fail(m_haveFmt ? "data chunk not found" : "fmt chunk not found");
+    }
+    if (len < qint64(want))
+        return NeedData;
+
+    switch (m_state) {
+    case RiffHeader:
+        if (!isId(p + 8, "WAVE"))
+            return fail("not a WAVE file");
+        if (isId(p, "RF64") || isId(p, "BW64"))
+            m_format.rf64 = true;
+        else if (!isId(p, "RIFF"))
+            return fail("not a RIFF file");
+        m_offset = 12;
+        m_state = ChunkHeader;
+        return NeedData;
+
+    case ChunkHeader: {
+        const quint32 size32 = qFromLittleEndian<quint32>(p + 4);
+        m_chunkBody = m_offset + 8;
+        m_chunkSize = resolveSize(p, size32);
+
+        if (isId(p, "ds64")) {
+            // RF64 의 첫 청크여야 한다
+            if (!m_format.rf64 || m_haveDs64 || m_haveFmt || m_chunkSize < 28)
+                return fail("misplaced ds64 chunk");
+            m_state = Ds64Body;
+            m_offset = m_chunkBody;
+        } else if (isId(p, "fmt ")) {
+            if (m_chunkSize < 16)
+                return fail("fmt chunk too small");
+            m_state = FmtBody;
+            m_offset = m_chunkBody;
+        } else if (isId(p, "data")) {
+            if (!m_haveFmt)
+                return fail("data chunk before fmt chunk");
+            if (m_format.rf64 && size32 == kSize32Unknown && !m_haveDs64)
+                return fail("RF64 without ds64 chunk");
+            quint64 size = m_chunkSize;
+            // 녹음 중이던 파일처럼 크기가 비어 있거나 파일보다 크면 실제 있는 만큼만
+            if (m_fileSize >= 0) {
+                const quint64 avail = m_chunkBody <= quint64(m_fileSize)
+                        ? quint64(m_fileSize) - m_chunkBody : 0;
+                if (size32 == kSize32Unknown && !m_format.rf64)
+                    size = avail;
+                size = qMin(size, avail);
+            }
+            m_format.dataOffset = m_chunkBody;
+            m_format.dataSize = size;
+            m_offset = m_chunkBody;
+            m_status = Done;
+        } else {
+            skipChunk();   // LIST, fact, bext, JUNK ... 본문은 읽지 않는다
+        }
+        return m_status;
+    }
+
+    case FmtBody:
+        if (!parseFmt(p))
+            return m_status;
+        skipChunk();
+        return NeedData;
+
+    case Ds64Body:
+        parseDs64(p);
+        skipChunk();
+        return NeedData;
+    }
+    return fail("internal parser state");
+}
+
+// RF64 에서 32bit 크기가 0xFFFFFFFF 면 ds64 에 적힌 64bit 값을 쓴다
+quint64 WavParser::resolveSize(const uchar *id, quint32 size32) const
+{
+    if (size32 != kSize32Unknown || !m_haveDs64)
+        return size32;
+    if (isId(id, "data"))
+        return m_ds64DataSize;
+    for (int i = 0; i < m_tableCount; ++i) {
+        if (memcmp(m_table[i].id, id, 4) == 0)
+            return m_table[i].size;
+    }
+    return size32;
+}
+
+void WavParser::skipChunk()
+{
+    // 청크는 짝수 바이트로 패딩된다. 말도 안 되는 크기는 오버플로 대신 끝으로 보낸다
+    const quint64 maxOffset = ~quint64(0) - MaxWanted;
+    if (m_chunkSize >= maxOffset - m_chunkBody)
+        m_offset = maxOffset;
+    else
+        m_offset = m_chunkBody + m_chunkSize + (m_chunkSize & 1);
+    m_state = ChunkHeader;
+}
+
+bool WavParser::parseFmt(const uchar *p)
+{
+    WavFormat &f = m_format;
+    f.formatTag     = qFromLittleEndian<quint16>(p);
+    f.channels      = qFromLittleEndian<quint16>(p + 2);
+    f.sampleRate    = qFromLittleEndian<quint32>(p + 4);
+    f.byteRate      = qFromLittleEndian<quint32>(p + 8);
+    f.blockAlign    = qFromLittleEndian<quint16>(p + 12);
+    f.bitsPerSample = qFromLittleEndian<quint16>(p + 14);
+    f.validBitsPerSample = f.bitsPerSample;
+    f.subFormat     = f.formatTag;
+    f.channelMask   = 0;
+
+    if (f.formatTag == WavFormat::TagExtensible) {
+        if (m_chunkSize < 40 || qFromLittleEndian<quint16>(p + 16) < 22) {
+            fail("short WAVE_FORMAT_EXTENSIBLE fmt chunk");
+            return false;
+        }
+        const quint16 valid = qFromLittleEndian<quint16>(p + 18);
+        if (valid != 0 && valid <= f.bitsPerSample)
+            f.validBitsPerSample = valid;
+        f.channelMask = qFromLittleEndian<quint32>(p + 20);
+        // 표준 KSDATAFORMAT GUID 가 아니면 (앰비소닉 등) 모르는 포맷으로 둔다
+        f.subFormat = memcmp(p + 26, kSubtypeTail, sizeof kSubtypeTail) == 0
+                ? qFromLittleEndian<quint16>(p + 24) : 0;
+    }
+
+    if (f.channels == 0 || f.sampleRate == 0 || f.blockAlign == 0) {
+        fail("invalid fmt chunk");
+        return false;
+    }
+    // 읽는 쪽은 샘플을 컨테이너 폭 (blockAlign / channels) 으로 걷는다. 12/20bit 처럼
+    // 바이트 단위가 아닌 PCM 도 컨테이너에 들어가기만 하면 된다. 컨테이너가 bits 보다
+    // 좁으면 blockAlign 이 틀린 것
+    if (f.bitsPerSample == 0 || f.containerBits() < 8
+            || f.bitsPerSample > f.containerBits()) {
+        fail("invalid fmt chunk block alignment");
+        return false;
+    }
+    m_haveFmt = true;
+    return true;
+}
+
+void WavParser::parseDs64(const uchar *p)
+{
+    // riffSize(8) dataSize(8) sampleCount(8) tableLength(4) table[]{id(4) size(8)}
+    m_ds64DataSize = qFromLittleEndian<quint64>(p + 8);
+    const quint32 tableLength = qFromLittleEndian<quint32>(p + 24);
+    const int have = (bytesWanted() - 28) / 12;
+    m_tableCount = int(qMin<quint64>(qMin<quint64>(tableLength, quint64(have)), 4));
+    for (int i = 0; i < m_tableCount; ++i) {
+        memcpy(m_table[i].id, p + 28 + i * 12, 4);
+        m_table[i].size = qFromLittleEndian<quint64>(p + 32 + i * 12);
+    }
+    m_haveDs64 = true;
+}
+
+bool parseWavHeader(QIODevice *dev, WavFormat *fmt, QString *error)
+{
+    WavParser parser(dev->isSequential() ? -1 : dev->size());
+    uchar buf[WavParser::MaxWanted];
+    WavParser::Status st = parser.parse(buf, 0);
+    while (st == WavParser::NeedData) {
+        const int want = parser.bytesWanted();
+        if (!dev->seek(qint64(parser.offset()))
+                || dev->read(reinterpret_cast<char *>(buf), want) != want) {
+            if (error) *error = "truncated header";
+            return false;
+        }
+        st = parser.parse(buf, want);
+        if (st == WavParser::NeedData)
+            st = parser.parse(buf, 0);   // 다음 위치 경계 검사
+    }
+    if (st == WavParser::Error) {
+        if (error) *error = QString::fromLatin1(parser.errorString());
+        return false;
+    }
+    *fmt = parser.format();
+    return true;
+}
+
+bool parseWavHeader(const uchar *data, qint64 size, WavFormat *fmt, QString *error)
+{
+    WavParser parser(size);
+    WavParser::Status st = WavParser::NeedData;
+    while (st == WavParser::NeedData) {
+        // parse() 가 경계 검사를 하므로 offset 이 size 를 넘으면 len 0 으로 끝난다
+        const quint64 off = qMin<quint64>(parser.offset(), quint64(size));
+        st = parser.parse(data + off, size - qint64(off));
+    }
+    if (st == WavParser::Error) {
+        if (error) *error = QString::fromLatin1(parser.errorString());
+        return false;
+    }
+    *fmt = parser.format();
+    return true;
+}
@@ -0,0 +1,98 @@
+#ifndef WAVFORMAT_H
+#define WAVFORMAT_H
+
+#include <QtGlobal>
+#include <QString>
+
+class QIODevice;
+
+// fmt 청크 + data 청크 위치. 크기는 전부 64bit (RF64/BW64 대응)
+struct WavFormat
+{
+    enum Tag {
+        TagPcm        = 0x0001,
+        TagIeeeFloat  = 0x0003,
+        TagALaw       = 0x0006,
+        TagMuLaw      = 0x0007,
+        TagExtensible = 0xFFFE
+    };
+    enum SampleType { UnknownType, IntType, FloatType };
+
+    quint16 formatTag = 0;       // fmt 에 적힌 그대로 (EXTENSIBLE 포함)
+    quint16 subFormat = 0;       // EXTENSIBLE 이면 GUID 앞 2바이트, 아니면 formatTag
+    quint16 channels = 0;
+    quint32 sampleRate = 0;
+    quint32 byteRate = 0;
+    quint16 blockAlign = 0;
+    quint16 bitsPerSample = 0;
+    quint16 validBitsPerSample = 0;
+    quint32 channelMask = 0;
+    bool    rf64 = false;        // RF64 / BW64 컨테이너
+    quint64 dataOffset = 0;      // 파일 기준 data 청크 본문 시작
+    quint64 dataSize = 0;        // 실제 파일에 있는 만큼으로 잘라낸 값
+
+    SampleType sampleType() const;
+    // 샘플 하나가 차지하는 비트. 12/20bit PCM 은 16/24bit 컨테이너에 왼쪽 정렬로
+    // 들어 있고 폭은 blockAlign 이 정한다
+    int containerBits() const { return channels ? blockAlign / channels * 8 : 0; }
+    quint64 frameCount() const { return blockAlign ? dataSize / blockAlign : 0; }
+    double  durationSeconds() const
+    { return sampleRate ? double(frameCount()) / sampleRate : 0.0; }
+};
+
+// RIFF/WAVE, RF64, BW64 청크 파서.
+// 힙 할당 없이 상태만 들고 있고, 호출자가 offset() 위치의 바이트를
+// bytesWanted() 만큼 넘겨 주면 한 단계씩 진행한다. 모르는 청크는
+// 읽지 않고 offset 만 건너뛴다 (파일 크기와 무관하게 청크 수에 비례).
+class WavParser
+{
+public:
+    enum Status { NeedData, Done, Error };
+
+    // 내부 버퍼가 이 크기를 넘는 요청은 하지 않는다
+    enum { MaxWanted = 96 };
+
+    explicit WavParser(qint64 fileSize = -1) { reset(fileSize); }
+    void reset(qint64 fileSize = -1);
+
+    // data 는 offset() 위치부터의 바이트. len < bytesWanted() 면 진행하지 않는다.
+    // (len 0 으로 부르면 파일 크기 경계 검사만 한다)
+    Status parse(const uchar *data, qint64 len);
+
+    quint64 offset() const { return m_offset; }
+    int     bytesWanted() const;
+    Status  status() const { return m_status; }
+    const WavFormat &format() const { return m_format; }
+    const char *errorString() const { return m_error; }
+
+private:
+    enum State { RiffHeader, ChunkHeader, FmtBody, Ds64Body };
+
+    Status fail(const char *why);
+    bool   parseFmt(const uchar *p);
+    void   parseDs64(const uchar *p);
+    quint64 resolveSize(const uchar *id, quint32 size32) const;
+    void   skipChunk();
+
+    struct TableEntry { char id[4]; quint64 size; };
+
+    State     m_state;
+    Status    m_status;
+    qint64    m_fileSize;
+    quint64   m_offset;
+    quint64   m_chunkSize;       // 현재 청크 본문 크기
+    quint64   m_chunkBody;       // 현재 청크 본문 시작
+    bool      m_haveFmt;
+    bool      m_haveDs64;
+    quint64   m_ds64DataSize;
+    TableEntry m_table[4];       // ds64 테이블 중 앞쪽 몇 개만 기억
+    int       m_tableCount;
+    WavFormat m_format;
+    const char *m_error;
+};
+
+// 편의 함수: QIODevice(보통 QFile) / 메모리 블록에서 헤더를 끝까지 파싱
+bool parseWavHeader(QIODevice *dev, WavFormat *fmt, QString *error = nullptr);
+bool parseWavHeader(const uchar *data, qint64 size, WavFormat *fmt, QString *error = nullptr);
+
+#endif // WAVFORMAT_H
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# 디코더 / Opus 인코더 속도 측정 (한 코어에서 실시간 몇 배인지)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = decodebench
+TEMPLATE = app
+
+
+SOURCES += main.cpp
+
+include(../common/common.pri)
+
+include(../common/streaming.pri)
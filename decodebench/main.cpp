@@ -0,0 +1,454 @@
+// main.cpp
+//
+// 디코더 속도 측정. 파일마다 처음부터 끝까지 readFloat 로 디코드하면서 그 스레드의
+// CPU 시간만 재고 (한 코어에 고정), 실시간 몇 배 / 프레임/s / 입력·출력 MB/s 를 낸다.
+// 첫 회는 페이지 캐시를 데우는 용도라 --passes 중 가장 빠른 회를 쓴다.
+//
+// --seeks 는 임의 위치로 seek 한 결과를 처음부터 이어서 디코드한 결과와 비교한다
+// (seek 비용과 샘플 단위 정확도).
+//
+//   decodebench /mnt/nfs/a.wav /mnt/nfs/a.flac
+//   decodebench --cpu 2 --block 1024 --s16 --json r.json *.flac
+//   decodebench --rate 44100 --seeks 50 a.opus       (Opus 리샘플 경로)
+//
+// --encode 는 디코드 대신 서버의 Opus 인코더 (OpusStreamEncoder) 를 잰다. 파일을 먼저
+// 메모리로 디코드해 두고 (시간에 넣지 않음) 엔진처럼 패킷 길이만큼씩 넣는다.
+// 기본값은 server2d 의 opus-kbps 권장값 / opus-frame-ms / opus-complexity 와 같다.
+//
+//   decodebench --encode --cpu 2 a.flac b.wav       (128 kbit/s, 20 ms, complexity 5)
+//   decodebench --encode --kbps 64 --frame-ms 10 a.flac
+#include "audiosource.h"
+#include "opusencoder.h"
+#include "opussource.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <sched.h>
+#include <time.h>
+
+namespace {
+
+qint64 threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+qint64 wallNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+struct Options {
+    qint64 block = 4096;          // readFloat 한 번에 요청하는 프레임
+    int    passes = 3;
+    bool   s16 = false;           // 재생 경로처럼 S16 변환까지
+    quint32 rate = 0;             // Opus 출력 레이트, 0 이면 기본 (48k)
+    int    seeks = 0;
+    bool   encode = false;        // 디코드 대신 Opus 인코드
+    int    kbps = 128;
+    double frameMs = 20;
+    int    complexity = 5;
+    int    packetMs = 10;         // 엔진이 한 번에 넘기는 양 (server2d 의 packet-ms)
+};
+
+struct Result {
+    QString path;
+    AudioInfo info;
+    qint64 frames = 0;
+    double cpuSeconds = 0;        // 가장 빠른 회
+    double wallSeconds = 0;       // 그 회의 벽시계
+    int    seeks = 0;
+    double seekMs = 0;            // seek + 블록 하나 디코드, 평균 CPU 시간
+    double seekMaxError = 0;      // 이어서 디코드한 것과의 최대 샘플 차이
+    quint64 packets = 0;          // --encode: 만든 Opus 패킷
+    double encodeKbps = 0;        // --encode: 실제 비트레이트
+    QString error;
+
+    double audioSeconds() const { return info.sampleRate ? double(frames) / info.sampleRate : 0; }
+    double realtime() const { return cpuSeconds > 0 ? audioSeconds() / cpuSeconds : 0; }
+    double cpuPercent() const { return audioSeconds() > 0 ? 100.0 * cpuSeconds / audioSeconds() : 0; }
+    double framesPerSecond() const { return cpuSeconds > 0 ? frames / cpuSeconds : 0; }
+    double inputMBps() const { return cpuSeconds > 0 ? info.dataSize / cpuSeconds / 1e6 : 0; }
+    double outputMBps() const
+    { return cpuSeconds > 0 ? double(frames) * info.channels * sizeof(float) / cpuSeconds / 1e6 : 0; }
+};
+
+AudioSource *openSource(const QString &path, const Options &opt, QString *error)
+{
+    AudioSource *src = createAudioSource(path);
+    if (!src) {
+        *error = "unknown format";
+        return nullptr;
+    }
+    if (OpusSource *opus = dynamic_cast<OpusSource *>(src)) {
+        if (opt.rate)
+            opus->setOutputRate(opt.rate);
+    }
+    if (!src->open(path)) {
+        *error = src->errorString();
+        delete src;
+        return nullptr;
+    }
+    return src;
+}
+
+// 한 회: 열고, 끝까지 디코드하고, 닫는다. open 은 시간에 넣지 않는다
+bool decodeOnce(const QString &path, const Options &opt, Result *r, qint64 *cpuNs, qint64 *wall)
+{
+    QScopedPointer<AudioSource> src(openSource(path, opt, &r->error));
+    if (!src)
+        return false;
+    r->info = src->info();
+    const int ch = src->channels();
+    QVector<float> buf(int(opt.block * ch));
+    QVector<qint16> pcm(opt.s16 ? buf.size() : 0);
+
+    qint64 frames = 0;
+    const qint64 cpu0 = threadCpuNs();
+    const qint64 wall0 = wallNs();
+    for (;;) {
+        const qint64 got = src->readFloat(buf.data(), opt.block);
+        if (got < 0) {
+            r->error = src->errorString();
+            return false;
+        }
+        if (got == 0)
+            break;
+        if (opt.s16)
+            floatToS16(buf.constData(), pcm.data(), got * ch);
+        frames += got;
+    }
+    *cpuNs = threadCpuNs() - cpu0;
+    *wall = wallNs() - wall0;
+    r->frames = frames;
+    return true;
+}
+
+// 한 회: 디코드해 둔 PCM 을 엔진처럼 packetMs 씩 인코더에 넣는다. 리샘플 (44.1 kHz
+// 등) 을 포함한 push / flush 전체의 CPU 시간을 잰다 (서버가 스트림마다 내는 비용)
+bool encodeOnce(const QVector<float> &pcm, const Options &opt, Result *r, qint64 *cpuNs, qint64 *wall)
+{
+    const int ch = r->info.channels;
+    OpusStreamEncoder enc;
+    enc.setBitrate(opt.kbps * 1000);
+    enc.setFrameMilliseconds(opt.frameMs);
+    enc.setComplexity(opt.complexity);
+    if (!enc.open(r->info.sampleRate, ch)) {
+        r->error = enc.errorString();
+        return false;
+    }
+    const qint64 chunk = qMax<qint64>(1, qint64(r->info.sampleRate) * opt.packetMs / 1000);
+    const qint64 total = pcm.size() / ch;
+    QList<OpusStreamEncoder::Packet> packets;
+    quint64 count = 0, bytes = 0;
+
+    const qint64 cpu0 = threadCpuNs();
+    const qint64 wall0 = wallNs();
+    for (qint64 pos = 0; pos < total; pos += chunk) {
+        enc.push(pcm.constData() + pos * ch, qMin(chunk, total - pos), 0, &packets);
+        // 서버는 패킷을 보내고 버린다. 쌓이지 않게 바로 비운다
+        for (const OpusStreamEncoder::Packet &p : packets)
+            bytes += quint64(p.data.size());
+        count += quint64(packets.size());
+        packets.clear();
+    }
+    enc.flush(&packets);
+    *cpuNs = threadCpuNs() - cpu0;
+    *wall = wallNs() - wall0;
+    for (const OpusStreamEncoder::Packet &p : packets)
+        bytes += quint64(p.data.size());
+    count += quint64(packets.size());
+
+    r->frames = total;
+    r->packets = count;
+    r->encodeKbps = total > 0 ? bytes * 8.0 * r->info.sampleRate / total / 1000.0 : 0;
+    return true;
+}
+
+// --encode: 파일 전체를 원래 레이트의 float 로 디코드해 둔다
+bool decodeAll(const QString &path, const Options &opt, Result *r, QVector<float> *pcm)
+{
+    Options plain = opt;
+    plain.rate = 0;
+    QScopedPointer<AudioSource> src(openSource(path, plain, &r->error));
+    if (!src)
+        return false;
+    r->info = src->info();
+    if (!OpusStreamEncoder::supports(r->info.sampleRate, r->info.channels)) {
+        r->error = QString("opus encoder does not take %1 Hz / %2 ch")
+                   .arg(r->info.sampleRate).arg(r->info.channels);
+        return false;
+    }
+    const int ch = src->channels();
+    if (src->frameCount() > 0)
+        pcm->reserve(int((src->frameCount() + opt.block) * ch));
+    for (;;) {
+        const int used = pcm->size();
+        pcm->resize(int(used + opt.block * ch));
+        const qint64 got = src->readFloat(pcm->data() + used, opt.block);
+        pcm->resize(int(used + qMax<qint64>(0, got) * ch));
+        if (got < 0) {
+            r->error = src->errorString();
+            return false;
+        }
+        if (got == 0)
+            break;
+    }
+    return true;
+}
+
+// 정렬한 임의 위치마다: 한 소스는 거기까지 이어서 디코드하고, 다른 소스는 seek 한 뒤
+// 블록 하나씩 읽어 비교한다. seek 쪽 CPU 시간만 잰다
+bool checkSeeks(const QString &path, const Options &opt, Result *r)
+{
+    QScopedPointer<AudioSource> linear(openSource(path, opt, &r->error));
+    QScopedPointer<AudioSource> seeker(openSource(path, opt, &r->error));
+    if (!linear || !seeker)
+        return false;
+    const int ch = linear->channels();
+    const qint64 total = linear->frameCount();
+    if (total <= opt.block)
+        return true;
+
+    std::mt19937_64 rng(1);
+    QVector<qint64> targets;
+    for (int i = 0; i < opt.seeks; ++i)
+        targets.append(qint64(rng() % quint64(total - opt.block)));
+    std::sort(targets.begin(), targets.end());
+
+    QVector<float> a(int(opt.block * ch)), b(a.size());
+    qint64 seekNs = 0;
+    for (qint64 target : targets) {
+        if (linear->position() > target)
+            continue;   // 앞 위치의 비교 블록과 겹친다
+        while (linear->position() < target) {
+            const qint64 got = linear->readFloat(a.data(), qMin(opt.block, target - linear->position()));
+            if (got <= 0) {
+                r->error = "short decode before seek target";
+                return false;
+            }
+        }
+        const qint64 got = linear->readFloat(a.data(), opt.block);
+
+        const qint64 cpu0 = threadCpuNs();
+        if (!seeker->seek(target)) {
+            r->error = seeker->errorString();
+            return false;
+        }
+        qint64 have = 0;
+        while (have < got) {
+            const qint64 n = seeker->readFloat(b.data() + have * ch, got - have);
+            if (n <= 0)
+                break;
+            have += n;
+        }
+        seekNs += threadCpuNs() - cpu0;
+
+        if (have != got) {
+            r->error = QString("seek to %1: %2 frames instead of %3").arg(target).arg(have).arg(got);
+            return false;
+        }
+        for (int i = 0; i < int(got * ch); ++i)
+            r->seekMaxError = qMax(r->seekMaxError, double(std::fabs(a[i] - b[i])));
+        ++r->seeks;
+    }
+    r->seekMs = r->seeks ? seekNs / 1e6 / r->seeks : 0;
+    return true;
+}
+
+Result bench(const QString &path, const Options &opt)
+{
+    Result r;
+    r.path = path;
+    QVector<float> pcm;
+    if (opt.encode && !decodeAll(path, opt, &r, &pcm))
+        return r;
+    qint64 best = -1;
+    for (int pass = 0; pass < opt.passes; ++pass) {
+        qint64 cpu = 0, wall = 0;
+        if (opt.encode ? !encodeOnce(pcm, opt, &r, &cpu, &wall)
+                       : !decodeOnce(path, opt, &r, &cpu, &wall))
+            return r;
+        if (best < 0 || cpu < best) {
+            best = cpu;
+            r.cpuSeconds = cpu / 1e9;
+            r.wallSeconds = wall / 1e9;
+        }
+    }
+    if (opt.seeks > 0 && !opt.encode)
+        checkSeeks(path, opt, &r);
+    return r;
+}
+
+QJsonObject toJson(const Result &r)
+{
+    QJsonObject o;
+    o["path"] = r.path;
+    if (!r.error.isEmpty()) {
+        o["error"] = r.error;
+        return o;
+    }
+    o["codec"] = r.info.codec;
+    o["sampleRate"] = double(r.info.sampleRate);
+    o["channels"] = r.info.channels;
+    o["bitsPerSample"] = r.info.bitsPerSample;
+    o["frames"] = double(r.frames);
+    o["audioSeconds"] = r.audioSeconds();
+    o["cpuSeconds"] = r.cpuSeconds;
+    o["wallSeconds"] = r.wallSeconds;
+    o["realtime"] = r.realtime();
+    o["framesPerSecond"] = r.framesPerSecond();
+    o["inputMBps"] = r.inputMBps();
+    o["outputMBps"] = r.outputMBps();
+    if (r.packets) {
+        o["cpuPercent"] = r.cpuPercent();
+        o["packets"] = double(r.packets);
+        o["kbps"] = r.encodeKbps;
+    }
+    if (r.seeks) {
+        o["seeks"] = r.seeks;
+        o["seekMs"] = r.seekMs;
+        o["seekMaxError"] = r.seekMaxError;
+    }
+    return o;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("decodebench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Single-core decode speed of the AudioSource decoders.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Audio files to decode.", "file...");
+    QCommandLineOption cpuOpt("cpu", "Pin to this CPU (default: the one we start on).", "n");
+    QCommandLineOption blockOpt("block", "Frames per readFloat call (default 4096).", "n", "4096");
+    QCommandLineOption passesOpt("passes", "Decode each file n times, report the fastest (default 3).",
+                                 "n", "3");
+    QCommandLineOption s16Opt("s16", "Also convert to 16-bit PCM like the playback path.");
+    QCommandLineOption rateOpt("rate", "Opus output rate (default 48000; others resample).", "hz");
+    QCommandLineOption seeksOpt("seeks",
+            "Seek to n random positions and compare with a continuous decode.", "n", "0");
+    QCommandLineOption encodeOpt("encode",
+            "Time the streaming Opus encoder on the decoded audio instead of decoding.");
+    QCommandLineOption kbpsOpt("kbps", "--encode bitrate in kbit/s (default 128).", "kbps", "128");
+    QCommandLineOption frameMsOpt("frame-ms", "--encode Opus frame length (default 20).", "ms", "20");
+    QCommandLineOption complexityOpt("complexity", "--encode complexity 0..10 (default 5).", "n", "5");
+    QCommandLineOption jsonOpt("json", "Write per-file results as JSON.", "file");
+    parser.addOption(cpuOpt);
+    parser.addOption(blockOpt);
+    parser.addOption(passesOpt);
+    parser.addOption(s16Opt);
+    parser.addOption(rateOpt);
+    parser.addOption(seeksOpt);
+    parser.addOption(encodeOpt);
+    parser.addOption(kbpsOpt);
+    parser.addOption(frameMsOpt);
+    parser.addOption(complexityOpt);
+    parser.addOption(jsonOpt);
+    parser.process(app);
+
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty())
+        parser.showHelp(1);
+
+    Options opt;
+    opt.block = qMax(1, parser.value(blockOpt).toInt());
+    opt.passes = qMax(1, parser.value(passesOpt).toInt());
+    opt.s16 = parser.isSet(s16Opt);
+    opt.rate = parser.value(rateOpt).toUInt();
+    opt.seeks = qMax(0, parser.value(seeksOpt).toInt());
+    opt.encode = parser.isSet(encodeOpt);
+    opt.kbps = qBound(6, parser.value(kbpsOpt).toInt(), 510);
+    opt.frameMs = parser.value(frameMsOpt).toDouble();
+    opt.complexity = qBound(0, parser.value(complexityOpt).toInt(), 10);
+
+    // 실시간 배수는 한 코어 기준이다. 스케줄러가 옮기지 못하게 고정
+    const int cpu = parser.isSet(cpuOpt) ? parser.value(cpuOpt).toInt() : sched_getcpu();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof set, &set) != 0)
+        QTextStream(stderr) << "cannot pin to cpu " << cpu << Qt::endl;
+
+    QTextStream out(stdout);
+    if (opt.encode)
+        out << QString("cpu %1, opus %2 kbit/s, %3 ms frames, complexity %4, %5 ms pushes, best of %6")
+               .arg(cpu).arg(opt.kbps).arg(opt.frameMs).arg(opt.complexity).arg(opt.packetMs)
+               .arg(opt.passes) << Qt::endl;
+    else
+        out << QString("cpu %1, block %2 frames, best of %3%4")
+               .arg(cpu).arg(opt.block).arg(opt.passes).arg(opt.s16 ? ", with S16 conversion" : "")
+            << Qt::endl;
+
+    QJsonArray results;
+    int failed = 0;
+    for (const QString &path : files) {
+        const Result r = bench(path, opt);
+        results.append(toJson(r));
+        if (!r.error.isEmpty()) {
+            out << path << ": " << r.error << Qt::endl;
+            ++failed;
+            continue;
+        }
+        if (opt.encode) {
+            // 코어 하나로 실시간 스트림 몇 개를 인코드할 수 있는지가 곧 realtime 배수
+            out << QString("%1  %2 Hz %3 ch  %4 s audio in %5 s cpu  x%6 realtime  "
+                           "%7% of a core  %8 packets  %9 kbit/s")
+                   .arg(path).arg(r.info.sampleRate).arg(r.info.channels)
+                   .arg(r.audioSeconds(), 0, 'f', 1).arg(r.cpuSeconds, 0, 'f', 3)
+                   .arg(r.realtime(), 0, 'f', 1).arg(r.cpuPercent(), 0, 'f', 2)
+                   .arg(r.packets).arg(r.encodeKbps, 0, 'f', 1) << Qt::endl;
+            continue;
+        }
+        out << QString("%1  %2 %3 Hz %4 ch  %5 s audio in %6 s cpu  x%7 realtime  "
+                       "%8 Mframes/s  in %9 MB/s  out %10 MB/s")
+               .arg(path).arg(r.info.codec).arg(r.info.sampleRate).arg(r.info.channels)
+               .arg(r.audioSeconds(), 0, 'f', 1).arg(r.cpuSeconds, 0, 'f', 3)
+               .arg(r.realtime(), 0, 'f', 1).arg(r.framesPerSecond() / 1e6, 0, 'f', 2)
+               .arg(r.inputMBps(), 0, 'f', 1).arg(r.outputMBps(), 0, 'f', 1) << Qt::endl;
+        if (r.seeks)
+            out << QString("    %1 seeks  %2 ms each  max error %3")
+                   .arg(r.seeks).arg(r.seekMs, 0, 'f', 2).arg(r.seekMaxError, 0, 'g', 3) << Qt::endl;
+    }
+
+    if (parser.isSet(jsonOpt)) {
+        QJsonObject root;
+        root["cpu"] = cpu;
+        root["block"] = double(opt.block);
+        root["passes"] = opt.passes;
+        root["s16"] = opt.s16;
+        root["rate"] = double(opt.rate);
+        if (opt.encode) {
+            root["encode"] = true;
+            root["kbps"] = opt.kbps;
+            root["frameMs"] = opt.frameMs;
+            root["complexity"] = opt.complexity;
+            root["packetMs"] = opt.packetMs;
+        }
+        root["files"] = results;
+        QFile f(parser.value(jsonOpt));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+    return failed ? 1 : 0;
+}
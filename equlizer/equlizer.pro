@@ -24,3 +24,5 @@ HEADERS  += mainwindow.h \
 
 FORMS    += mainwindow.ui
 
+include(../common/common.pri)
+
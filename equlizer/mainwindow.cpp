@@ -33,16 +33,21 @@ QVector<std::complex<double>> MainWindow::fft(const QVector<std::complex<double>
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
       m_timer(new QTimer(this)),
+      m_wav(nullptr),
+      m_readAhead(new ReadAhead(this)),
       m_playProc(nullptr),
-      m_dataPos(0),
-      m_dataSize(0),
       m_fftSize(1024)
 {
     setMinimumSize(600, 300);
     m_levels.resize( m_fftSize/2 );
-    if (!openWav("/mnt/nfs/test_contents/test.wav")) {
-        qFatal("WAV open failed");
+    if (!openAudio("/mnt/nfs/test_contents/test.wav")) {
+        qFatal("Audio open failed");
     }
+    // GUI 스레드가 NFS 에서 블록되지 않도록 재생 위치 앞 4초를 미리 읽어 둔다
+    const AudioInfo &info = m_source->info();
+    m_readAhead->setAheadSeconds(4.0);
+    m_readAhead->open(m_sourcePath, info.dataOffset, info.dataSize,
+                      quint32(info.bytesPerSecond()));
     m_button = new QPushButton("Sync", this);
     connect(m_button, &QPushButton::clicked, m_button, &QPushButton::hide);
 
@@ -56,11 +61,16 @@ MainWindow::MainWindow(QWidget *parent)
     // 동기 실행(결과 코드가 필요 없으면 execute, 필요하면 반환값 체크)
     QProcess::execute(amixerProg, amixerArgs);
 
-    // WAV 파일 재생
+    // 디코드한 PCM 을 stdin 으로 재생 (WAV/FLAC 공통)
     QString aplayProg = "./aplay";
     QStringList aplayArgs;
     aplayArgs << "-Dhw:0,0"
-              << "/mnt/nfs/test_contents/test.wav";
+              << "-t" << "raw" << "-f" << "S16_LE"
+              << "-c" << QString::number(m_source->channels())
+              << "-r" << QString::number(m_source->sampleRate())
+              // 장치 버퍼를 미리 써 두는 양만큼 잡아 GUI 스레드가 늦어도 끊기지 않게
+              << "-B" << QString::number(kLeadMs * 1000)
+              << "-";
     // 비동기 실행(앱이 블록되지 않고 바로 리턴)
     m_playProc->start(aplayProg, aplayArgs);
 
@@ -71,12 +81,24 @@ MainWindow::MainWindow(QWidget *parent)
 
     // ——— 10FPS용 계산 ———
     // 1/10초마다 읽을 샘플 수
-    m_samplesPerFrame = int(double(m_sampleRate) / 10.0);
-    // 링버퍼 초기화
-    m_fftBuffer.reserve(m_fftSize);
+    m_samplesPerFrame = int(double(m_source->sampleRate()) / 10.0);
+    m_tickBytes = quint64(info.bytesPerSecond() / 10.0);
+    m_rate = m_source->sampleRate();
+    m_leadFrames = qint64(m_rate) * kLeadMs / 1000;
+    m_framesWritten = 0;
+    m_stallFrames = 0;
+    m_eof = false;
+    // 틱마다 쓰는 블록 버퍼는 여기서 한 번만 할당
+    m_block.resize(m_samplesPerFrame * m_source->channels());
+    m_pcm.resize(m_block.size());
+    // 미리 써 둔 구간 + FFT 윈도우를 담는 모노 링 버퍼
+    m_history.resize(int(m_leadFrames) + 2 * m_samplesPerFrame + m_fftSize);
+    m_fftBuffer.resize(m_fftSize);
 
     connect(m_timer, &QTimer::timeout, this, &MainWindow::onTimer);
+    m_clock.start();
     m_timer->start(100);
+    onTimer();   // 첫 kLeadMs 를 바로 채운다
 }
 
 MainWindow::~MainWindow()
@@ -87,13 +109,19 @@ MainWindow::~MainWindow()
         m_playProc->terminate();
         m_playProc->waitForFinished();
     }
-    m_file.close();
+    if (m_source)
+        m_source->close();
 }
-bool MainWindow::openWav(const QString &path)
+bool MainWindow::openAudio(const QString &path)
 {
-    m_file.setFileName(path);
-    if (!m_file.open(QIODevice::ReadOnly)) return false;
-    readHeader();
+    // 확장자/매직으로 WAV(mmap) 또는 FLAC 디코더 선택
+    m_source.reset(createAudioSource(path));
+    if (!m_source || !m_source->open(path)) return false;
+    m_sourcePath = path;
+    // 16bit WAV 는 매핑된 페이지를 그대로 aplay 에 쓴다 (패딩/정렬이 안 맞으면 peek 가 빈 span)
+    m_wav = dynamic_cast<MappedWavSource *>(m_source.data());
+    if (m_wav && m_wav->peek<qint16>(0, 1).isEmpty())
+        m_wav = nullptr;
     return true;
 }
 
@@ -110,77 +138,90 @@ void MainWindow::resizeEvent(QResizeEvent *event)
     QMainWindow::resizeEvent(event);
 }
 
-void MainWindow::readHeader()
-{
-    QDataStream in(&m_file);
-    in.setByteOrder(QDataStream::LittleEndian);
-
-    char riff[4];
-    in.readRawData(riff,4);            // "RIFF"
-    quint32 chunkSize; in >> chunkSize;
-    char wave[4]; in.readRawData(wave,4); // "WAVE"
-
-    // fmt subchunk
-    char fmt[4]; in.readRawData(fmt,4);    // "fmt "
-    quint32 subSize; in >> subSize;        // usually 16
-    quint16 audioFormat; in >> audioFormat; // PCM = 1
-    in >> m_channels;
-    in >> m_sampleRate;
-    quint32 byteRate; in >> byteRate;
-    quint16 blockAlign; in >> blockAlign;
-    in >> m_bitsPerSample;
-    // skip any extra fmt bytes
-    if (subSize > 16) m_file.skip(subSize - 16);
-
-    // data subchunk
-    char dataTag[4];
-    in.readRawData(dataTag,4);         // "data"
-    in >> m_dataSize;
-    m_dataPos = m_file.pos();
-}
-
+// 재생 시계 (m_clock) 보다 kLeadMs 앞까지 aplay 에 써 둔다. 틱이 늦거나 FFT /
+// 다시 그리기가 오래 걸리거나 선읽기가 잠깐 막혀도 그동안은 장치 버퍼가 소리를
+// 잇고, 데이터가 오면 밀린 블록을 모두 채운다. 이퀄라이저는 지금 들리는 위치를 그린다
 void MainWindow::onTimer()
 {
-    const int bytesPerSample = m_bitsPerSample/8;
-    const int chunkBytes    = m_samplesPerFrame * bytesPerSample * m_channels;
-    QByteArray buf = m_file.read(chunkBytes);
-
-    if (buf.size() < chunkBytes) {
-        // 파일 끝: 더 이상 처리하지 않고 종료
+    qint64 playhead = m_clock.elapsed() * m_rate / 1000 - m_stallFrames;
+    if (m_eof && playhead >= m_framesWritten) {
         m_timer->stop();
-        if (m_playProc) {
-            m_playProc->closeWriteChannel();
-            m_playProc->waitForFinished();
-        }
-        m_file.close();
         return;
     }
+    if (!m_eof && m_framesWritten < playhead) {
+        // kLeadMs 넘게 막혀 aplay 버퍼까지 비었다: 소리는 여기서 멈췄다가 다음에 쓰는
+        // 블록부터 이어지므로 재생 시계도 그만큼 미뤄 화면과 소리를 맞춘다
+        m_stallFrames += playhead - m_framesWritten;
+        playhead = m_framesWritten;
+    }
+    while (!m_eof && m_framesWritten < playhead + m_leadFrames) {
+        if (!writeBlock())
+            break;
+    }
+    updateSpectrum(qMin(playhead, m_framesWritten));
+}
 
-    // 1) aplay 프로세스에 똑같은 버퍼 쓰기 → 정확히 이 타이밍의 오디오 출력
-    m_playProc->write(buf);
-
-    // (2) 읽은 샘플을 FFT 링 버퍼에 추가 (모노 변환)
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
-        int offset = i * m_channels * bytesPerSample;
-        // 16bit PCM 가정
-        const char *p = buf.constData() + offset;
-        qint16 sample = *reinterpret_cast<const qint16*>(p);
-        double norm = double(sample) / 32768.0;
-        // push back, 버퍼가 너무 크면 앞에서 pop
-        m_fftBuffer.push_back({norm, 0.0});
-        if (m_fftBuffer.size() > quint32(m_fftSize))
-            m_fftBuffer.pop_front();
+// 블록 하나를 읽어 aplay 에 쓰고 모노 링 버퍼에 남긴다. 준비가 안 됐거나 끝이면 false
+bool MainWindow::writeBlock()
+{
+    // I/O 스레드가 아직 못 읽어 온 구간이면 블록하지 말고 다음 틱에 (aplay 버퍼가 버틴다)
+    const quint64 off = m_source->bytePosition();
+    m_readAhead->setPlayhead(off);
+    if (!m_readAhead->isReady(off, m_tickBytes))
+        return false;
+
+    // 16bit WAV 는 매핑된 페이지를 가리키는 span (변환/복사 없음), 나머지는
+    // float 로 디코드한 뒤 S16 으로 바꾼다
+    const int ch = m_source->channels();
+    const qint16 *pcm;
+    qint64 got;
+    if (m_wav) {
+        const SampleSpan<qint16> span = m_wav->read<qint16>(m_samplesPerFrame);
+        pcm = span.data;
+        got = span.frames;
+    } else {
+        got = m_source->readFloat(m_block.data(), m_samplesPerFrame);
+        pcm = m_pcm.constData();
     }
 
-    // (3) 충분히 쌓였으면 FFT 수행
-    if (m_fftBuffer.size() == quint32(m_fftSize)) {
-        auto spectrum = fft(m_fftBuffer);
-        int half = spectrum.size() / 2;
-        for (int i = 0; i < half; ++i) {
-            m_levels[i] = std::abs(spectrum[i]) / half;
+    if (got > 0) {
+        if (!m_wav)
+            floatToS16(m_block.constData(), m_pcm.data(), got * ch);
+        m_playProc->write(reinterpret_cast<const char*>(pcm), got * ch * qint64(sizeof(qint16)));
+        // 첫 채널만 FFT 용으로 남긴다
+        for (qint64 i = 0; i < got; ++i) {
+            m_history[int((m_framesWritten + i) % m_history.size())] =
+                    m_wav ? pcm[i * ch] / 32768.0f : m_block[int(i * ch)];
         }
-        update();  // paintEvent 트리거
+        m_framesWritten += got;
+    }
+    if (got < m_samplesPerFrame) {
+        // 파일 끝: 남은 것은 aplay 가 버퍼를 비우며 재생하고, 타이머는 그때까지 그린다
+        m_eof = true;
+        if (m_playProc)
+            m_playProc->closeWriteChannel();
+        m_readAhead->close();
+        m_source->close();
+        return false;
+    }
+    return true;
+}
+
+// frame 바로 앞 m_fftSize 프레임으로 스펙트럼을 다시 계산한다
+void MainWindow::updateSpectrum(qint64 frame)
+{
+    if (frame < m_fftSize)
+        return;
+    const qint64 from = frame - m_fftSize;
+    for (int i = 0; i < m_fftSize; ++i)
+        m_fftBuffer[i] = { m_history[int((from + i) % m_history.size())], 0.0 };
+
+    auto spectrum = fft(m_fftBuffer);
+    int half = spectrum.size() / 2;
+    for (int i = 0; i < half; ++i) {
+        m_levels[i] = std::abs(spectrum[i]) / half;
     }
+    update();  // paintEvent 트리거
 }
 
 void MainWindow::paintEvent(QPaintEvent *)
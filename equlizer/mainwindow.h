@@ -2,12 +2,16 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QVector>
-#include <QFile>
 #include <complex>
 #include <QProcess>
 #include <QPushButton>
+#include <QScopedPointer>
+#include "audiosource.h"
+#include "mappedwavsource.h"
+#include "readahead.h"
 
 class MainWindow : public QMainWindow
 {
@@ -24,19 +28,29 @@ private slots:
     void onTimer();
 
 private:
-    bool openWav(const QString &path);
-    void readHeader();
+    enum { kLeadMs = 1000 };   // 재생 시계보다 앞서 aplay 에 써 두는 양
+    bool openAudio(const QString &path);
+    bool writeBlock();
+    void updateSpectrum(qint64 frame);
     QVector<std::complex<double>> fft(const QVector<std::complex<double>> &in);
 
     QTimer *m_timer;
-    QFile  m_file;
-    quint32 m_dataPos;
-    quint32 m_dataSize;
-    quint16 m_channels;
-    quint32 m_sampleRate;
-    quint16 m_bitsPerSample;
+    QScopedPointer<AudioSource> m_source;   // WAV(mmap) / FLAC 디코더
+    MappedWavSource *m_wav;     // 16bit WAV 면 m_source 와 같은 것 (span 경로), 아니면 nullptr
+    QString     m_sourcePath;
+    ReadAhead  *m_readAhead;    // NFS 선읽기 I/O 스레드
     QVector<std::complex<double>> m_fftBuffer;
     int       m_samplesPerFrame;
+    quint64   m_tickBytes;          // 한 틱에 필요한 파일 바이트 (선읽기 확인용)
+    QElapsedTimer m_clock;          // 재생 시작부터 흐른 시간
+    quint32   m_rate;
+    qint64    m_leadFrames;
+    qint64    m_framesWritten;      // aplay 에 쓴 프레임
+    qint64    m_stallFrames;        // aplay 버퍼가 비어 소리가 멈췄던 만큼 시계를 미룬 양
+    bool      m_eof;
+    QVector<float>  m_history;      // 최근에 쓴 첫 채널 (링, m_framesWritten 기준)
+    QVector<float>  m_block;        // 디코드된 float 블록 (span 경로가 아닐 때)
+    QVector<qint16> m_pcm;          // aplay 로 보낼 16bit PCM (span 경로가 아닐 때)
     QPushButton *m_button;
 
     QVector<double> m_levels;    // 이퀄라이저 바 높이
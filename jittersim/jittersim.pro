@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# JitterBuffer 시뮬레이션 (drift / 지터 / 손실을 넣고 통계를 낸다)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = jittersim
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+        ../common/jitterbuffer.cpp \
+        ../common/resampler.cpp
+
+HEADERS  += ../common/jitterbuffer.h \
+        ../common/resampler.h
+
+INCLUDEPATH += ../common
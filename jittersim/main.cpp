@@ -0,0 +1,254 @@
+// main.cpp
+//
+// JitterBuffer 시뮬레이션. 가상 시계 위에서 송신 시계 drift, 네트워크 지터, 손실을
+// 넣은 패킷 흐름을 push 하고 출력 장치처럼 주기마다 pull 한 뒤, 뒤쪽 절반 (수렴
+// 뒤) 의 리샘플 비율 / 깊이 / 제어 오차와 지연·손실·은닉 카운터를 낸다.
+// 비율은 송신 drift 를 따라가야 하므로 (ppm 오차가 작아야) 이것이 주 지표다.
+//
+//   jittersim                                   (기본: drift 0,100,300 x 지터 2,10,30 x 손실 0,2)
+//   jittersim --drift 250 --jitter 20 --loss 1 --mode sync --seconds 600
+#include "jitterbuffer.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+const quint32 kRate = 48000;
+const int     kChannels = 2;
+const qint64  kBaseDelayNs = 1000000;       // 지터 없는 네트워크 지연
+const qint64  kOutputLatencyNs = 5000000;   // pull 부터 스피커까지
+
+struct Options {
+    int    packetMs = 10;
+    int    period = 256;                    // pull 한 번의 프레임
+    double seconds = 120;
+    int    playoutMs = 200;                 // 동기 모드 재생 지연
+    quint64 seed = 1;
+};
+
+struct Scenario {
+    double driftPpm = 0;                    // 송신 시계가 빠른 정도
+    double jitterMs = 0;                    // 추가 지연 0..jitterMs 균등 분포
+    double lossPercent = 0;
+    bool   sync = false;                    // 패킷에 재생 시각을 넣는다
+};
+
+struct Outcome {
+    quint64 sent = 0;
+    quint64 dropped = 0;                    // 일부러 버린 패킷
+    double  ratioPpm = 0;                   // 뒤쪽 절반 평균
+    double  depthMs = 0;
+    double  maxErrorMs = 0;                 // 뒤쪽 절반 |제어 오차| 최대
+    JitterBuffer::Stats stats;              // 끝났을 때
+
+    double ratioErrorPpm(const Scenario &s) const { return ratioPpm - s.driftPpm; }
+};
+
+struct Packet {
+    qint64 arrivalNs;
+    qint64 sendNs;
+    qint64 firstFrame;
+};
+
+Outcome simulate(const Scenario &sc, const Options &opt)
+{
+    Outcome out;
+    std::mt19937_64 rng(opt.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    const int frames = int(kRate) * opt.packetMs / 1000;
+    QVector<qint16> pcm(frames * kChannels);
+    for (int i = 0; i < frames; ++i) {
+        const qint16 v = qint16(8000 * std::sin(2 * M_PI * 440.0 * i / kRate));
+        pcm[i * kChannels] = pcm[i * kChannels + 1] = v;
+    }
+
+    // 송신 시계는 로컬 시계보다 (1 + drift) 배 빠르다: 프레임 f 는 f / (rate * (1 + d)) 에 나간다
+    const double senderRate = kRate * (1.0 + sc.driftPpm * 1e-6);
+    const qint64 packets = qint64(opt.seconds * 1000 / opt.packetMs);
+    QVector<Packet> flow;
+    flow.reserve(int(packets));
+    for (qint64 k = 0; k < packets; ++k) {
+        const qint64 first = k * frames;
+        const qint64 sendNs = qint64(first * 1e9 / senderRate);
+        ++out.sent;
+        if (uniform(rng) * 100.0 < sc.lossPercent) {
+            ++out.dropped;
+            continue;
+        }
+        const qint64 arrival = sendNs + kBaseDelayNs + qint64(uniform(rng) * sc.jitterMs * 1e6);
+        flow.append({ arrival, sendNs, first });
+    }
+    std::stable_sort(flow.begin(), flow.end(),
+                     [](const Packet &a, const Packet &b) { return a.arrivalNs < b.arrivalNs; });
+
+    JitterBuffer buffer;
+    buffer.setFormat(kRate, kChannels);
+    QVector<float> dst(opt.period * kChannels);
+
+    const qint64 pulls = qint64(opt.seconds * kRate / opt.period);
+    int next = 0;
+    qint64 samples = 0;
+    for (qint64 n = 0; n < pulls; ++n) {
+        const qint64 nowNs = qint64(double(n) * opt.period * 1e9 / kRate);
+        for (; next < flow.size() && flow.at(next).arrivalNs <= nowNs; ++next) {
+            const Packet &p = flow.at(next);
+            const qint64 pres = sc.sync ? p.sendNs + qint64(opt.playoutMs) * 1000000LL : -1;
+            buffer.push(p.firstFrame, pcm.constData(), frames, p.arrivalNs, pres);
+        }
+        buffer.pull(dst.data(), opt.period, nowNs + kOutputLatencyNs);
+
+        // 뒤쪽 절반의 pull 마다 (적응 모드의 비율은 패킷 단위로 출렁이므로 평균)
+        if (n >= pulls / 2) {
+            const JitterBuffer::Stats s = buffer.stats();
+            out.ratioPpm += s.ratioPpm;
+            out.depthMs += s.depthMs;
+            out.maxErrorMs = qMax(out.maxErrorMs, std::fabs(s.errorMs));
+            ++samples;
+        }
+    }
+    if (samples) {
+        out.ratioPpm /= samples;
+        out.depthMs /= samples;
+    }
+    out.stats = buffer.stats();
+    return out;
+}
+
+QVector<double> parseList(const QString &text)
+{
+    QVector<double> v;
+    for (const QString &s : text.split(','))
+        v.append(s.toDouble());
+    return v;
+}
+
+QJsonObject toJson(const Scenario &sc, const Outcome &o)
+{
+    QJsonObject j;
+    j["mode"] = sc.sync ? "sync" : "adaptive";
+    j["driftPpm"] = sc.driftPpm;
+    j["jitterMs"] = sc.jitterMs;
+    j["lossPercent"] = sc.lossPercent;
+    j["sent"] = double(o.sent);
+    j["dropped"] = double(o.dropped);
+    j["ratioPpm"] = o.ratioPpm;
+    j["ratioErrorPpm"] = o.ratioErrorPpm(sc);
+    j["depthMs"] = o.depthMs;
+    j["maxErrorMs"] = o.maxErrorMs;
+    j["targetMs"] = o.stats.targetMs;
+    j["measuredJitterMs"] = o.stats.jitterMs;
+    j["latePackets"] = double(o.stats.latePackets);
+    j["reordered"] = double(o.stats.reordered);
+    j["lostFrames"] = double(o.stats.lostFrames);
+    j["concealedFrames"] = double(o.stats.concealedFrames);
+    j["underruns"] = double(o.stats.underruns);
+    j["resyncs"] = double(o.stats.resyncs);
+    return j;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("jittersim");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("JitterBuffer simulation with injected drift, jitter and loss.");
+    parser.addHelpOption();
+    QCommandLineOption driftOpt("drift", "Sender clock drift in ppm, comma separated.", "list",
+                                "0,100,300");
+    QCommandLineOption jitterOpt("jitter", "Extra network delay 0..n ms, comma separated.", "list",
+                                 "2,10,30");
+    QCommandLineOption lossOpt("loss", "Packet loss in percent, comma separated.", "list", "0,2");
+    QCommandLineOption modeOpt("mode", "sync, adaptive or both (default both).", "mode", "both");
+    QCommandLineOption secondsOpt("seconds", "Simulated length (default 120).", "sec", "120");
+    QCommandLineOption packetOpt("packet-ms", "Packet length (default 10).", "ms", "10");
+    QCommandLineOption periodOpt("period", "Frames per pull (default 256).", "n", "256");
+    QCommandLineOption seedOpt("seed", "Random seed (default 1).", "n", "1");
+    QCommandLineOption jsonOpt("json", "Write results as JSON.", "file");
+    parser.addOption(driftOpt);
+    parser.addOption(jitterOpt);
+    parser.addOption(lossOpt);
+    parser.addOption(modeOpt);
+    parser.addOption(secondsOpt);
+    parser.addOption(packetOpt);
+    parser.addOption(periodOpt);
+    parser.addOption(seedOpt);
+    parser.addOption(jsonOpt);
+    parser.process(app);
+
+    Options opt;
+    opt.seconds = qMax(2.0, parser.value(secondsOpt).toDouble());
+    opt.packetMs = qBound(1, parser.value(packetOpt).toInt(), 100);
+    opt.period = qBound(16, parser.value(periodOpt).toInt(), 8192);
+    opt.seed = parser.value(seedOpt).toULongLong();
+
+    const QString mode = parser.value(modeOpt);
+    QVector<bool> modes;
+    if (mode != "adaptive")
+        modes.append(true);
+    if (mode != "sync")
+        modes.append(false);
+
+    QTextStream out(stdout);
+    out << QString("%1 s, %2 ms packets, %3-frame pulls, ratio/depth/error averaged over the last half")
+           .arg(opt.seconds).arg(opt.packetMs).arg(opt.period) << Qt::endl;
+    out << "mode      drift  jitter  loss |  ratio ppm (err) | depth ms  target |error| ms"
+           " |  late  lost %  conceal %  underruns  resyncs" << Qt::endl;
+
+    QJsonArray results;
+    for (bool sync : modes) {
+        for (double drift : parseList(parser.value(driftOpt))) {
+            for (double jitter : parseList(parser.value(jitterOpt))) {
+                for (double loss : parseList(parser.value(lossOpt))) {
+                    Scenario sc;
+                    sc.sync = sync;
+                    sc.driftPpm = drift;
+                    sc.jitterMs = jitter;
+                    sc.lossPercent = loss;
+                    const Outcome o = simulate(sc, opt);
+                    const double total = opt.seconds * kRate;
+                    const JitterBuffer::Stats &s = o.stats;
+                    out << QString("%1 %2 %3 %4 | %5 (%6) | %7 %8 %9 | %10 %11 %12 %13 %14")
+                           .arg(sync ? "sync    " : "adaptive")
+                           .arg(drift, 6, 'f', 0).arg(jitter, 7, 'f', 1).arg(loss, 5, 'f', 1)
+                           .arg(o.ratioPpm, 10, 'f', 1).arg(o.ratioErrorPpm(sc), 6, 'f', 1)
+                           .arg(o.depthMs, 8, 'f', 1).arg(s.targetMs, 7, 'f', 1)
+                           .arg(o.maxErrorMs, 9, 'f', 2)
+                           .arg(s.latePackets, 5)
+                           .arg(100.0 * s.lostFrames / total, 7, 'f', 2)
+                           .arg(100.0 * s.concealedFrames / total, 10, 'f', 2)
+                           .arg(s.underruns, 10).arg(s.resyncs, 8) << Qt::endl;
+                    results.append(toJson(sc, o));
+                }
+            }
+        }
+    }
+
+    if (parser.isSet(jsonOpt)) {
+        QJsonObject root;
+        root["seconds"] = opt.seconds;
+        root["packetMs"] = opt.packetMs;
+        root["period"] = opt.period;
+        root["seed"] = double(opt.seed);
+        root["results"] = results;
+        QFile f(parser.value(jsonOpt));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+    return 0;
+}
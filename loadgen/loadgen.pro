@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# server2 부하 시험용 헤드리스 클라이언트 생성기
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = loadgen
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+        loadworker.cpp \
+        relayprobe.cpp \
+        rtpprobe.cpp \
+        syscallcounter.cpp \
+        transportbench.cpp
+
+HEADERS  += loadworker.h \
+        relayprobe.h \
+        rtpprobe.h \
+        syscallcounter.h \
+        transportbench.h
+
+include(../common/common.pri)
+
+include(../common/streaming.pri)
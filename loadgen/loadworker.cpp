@@ -0,0 +1,313 @@
+#include "loadworker.h"
+#include "streamprotocol.h"
+#include <cmath>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+namespace {
+
+const int kMaxEvents   = 256;
+const int kReadChunk   = 64 * 1024;
+const int kRawHeader   = 44;
+
+} // namespace
+
+struct LoadWorker::Client
+{
+    int     slot = 0;                 // m_results 위치
+    int     fd = -1;
+    qint64  dueNs = 0;                // 접속할 시각
+    bool    connecting = false;
+    bool    done = false;
+    qint64  startNs = 0;
+    qint64  connectedNs = 0;
+    qint64  lastArrivalNs = 0;
+
+    QByteArray in;                    // 처리 못 한 수신 데이터 (raw 는 헤더만)
+    int     inUsed = 0;
+    quint32 rate = 0;
+    quint64 byteRate = 0;             // raw 헤더의 byteRate
+    quint64 rawData = 0;              // 헤더 뒤로 받은 바이트
+    bool    haveSeq = false;
+    quint32 lastSeq = 0;
+    bool    haveTransit = false;
+    qint64  lastTransitNs = 0;
+    double  jitterNs = 0;
+};
+
+LoadWorker::LoadWorker(const QString &host, quint16 port, bool raw,
+                       const QVector<int> &indices, qint64 startNs, double rampPerSecond,
+                       qint64 endNs)
+    : m_host(host),
+      m_port(port),
+      m_raw(raw),
+      m_startNs(startNs),
+      m_ramp(qMax(1.0, rampPerSecond)),
+      m_endNs(endNs),
+      m_epollFd(-1)
+{
+    m_results.resize(indices.size());
+    for (int i = 0; i < indices.size(); ++i) {
+        Client *c = new Client;
+        c->slot = i;
+        c->dueNs = startNs + qint64(indices.at(i) / m_ramp * 1e9);
+        m_clients.append(c);
+        m_results[i].index = indices.at(i);
+    }
+}
+
+LoadWorker::~LoadWorker()
+{
+    wait();
+    qDeleteAll(m_clients);
+}
+
+void LoadWorker::startConnect(Client *c, qint64 nowNs)
+{
+    ClientResult &r = m_results[c->slot];
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(m_port);
+    if (inet_pton(AF_INET, m_host.toLatin1().constData(), &sa.sin_addr) != 1) {
+        r.error = "invalid host";
+        c->done = true;
+        return;
+    }
+    c->startNs = nowNs;
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) {
+        r.error = QString::fromLocal8Bit(strerror(errno));
+        c->done = true;
+        return;
+    }
+    if (::connect(c->fd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0
+            && errno != EINPROGRESS) {
+        r.error = QString::fromLocal8Bit(strerror(errno));
+        finish(c, nowNs);
+        return;
+    }
+    c->connecting = true;
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLOUT | EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = c;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, c->fd, &ev);
+}
+
+bool LoadWorker::onConnected(Client *c, qint64 nowNs)
+{
+    ClientResult &r = m_results[c->slot];
+    int err = 0;
+    socklen_t len = sizeof err;
+    getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+        r.error = QString::fromLocal8Bit(strerror(err));
+        return false;
+    }
+    c->connecting = false;
+    c->connectedNs = nowNs;
+    r.connected = true;
+    r.connectMs = (nowNs - c->startNs) / 1e6;
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = c;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, c->fd, &ev);
+    return true;
+}
+
+void LoadWorker::arrival(Client *c, qint64 nowNs, qint64 mediaNs)
+{
+    ClientResult &r = m_results[c->slot];
+    ++r.packets;
+    if (r.startupMs < 0)
+        r.startupMs = (nowNs - c->startNs) / 1e6;
+    else
+        r.maxGapMs = qMax(r.maxGapMs, (nowNs - c->lastArrivalNs) / 1e6);
+    c->lastArrivalNs = nowNs;
+
+    // RFC 3550 6.4.1
+    const qint64 transit = nowNs - mediaNs;
+    if (c->haveTransit)
+        c->jitterNs += (std::fabs(double(transit - c->lastTransitNs)) - c->jitterNs) / 16.0;
+    c->lastTransitNs = transit;
+    c->haveTransit = true;
+    r.jitterMs = c->jitterNs / 1e6;
+}
+
+// 처리한 바이트 수, 프로토콜 오류면 -1
+int LoadWorker::parseFramed(Client *c, const uchar *p, int len, qint64 nowNs)
+{
+    ClientResult &r = m_results[c->slot];
+    int pos = 0;
+    while (len - pos >= StreamProtocol::HeaderSize) {
+        StreamProtocol::Header h;
+        if (!StreamProtocol::readHeader(p + pos, &h)) {
+            r.error = "protocol error";
+            return -1;
+        }
+        const qint64 total = qint64(h.headerSize) + h.payloadSize;
+        if (len - pos < total)
+            break;
+        const uchar *payload = p + pos + h.headerSize;
+        if (h.type == StreamProtocol::Format && h.payloadSize >= StreamProtocol::FormatPayloadSize) {
+            c->rate = qFromLittleEndian<quint32>(payload);
+            c->haveTransit = false;       // 새 트랙은 미디어 시각이 0 부터
+            c->haveSeq = false;
+        } else if (h.type == StreamProtocol::Audio && c->rate
+                   && h.payloadSize >= StreamProtocol::AudioPrefixSize) {
+            if (c->haveSeq && h.sequence != c->lastSeq + 1)
+                r.sequenceGaps += h.sequence - c->lastSeq - 1;
+            c->haveSeq = true;
+            c->lastSeq = h.sequence;
+            const qint64 frame = qFromLittleEndian<qint64>(payload);
+            arrival(c, nowNs, qint64(double(frame) * 1e9 / c->rate));
+        }
+        pos += int(total);
+    }
+    return pos;
+}
+
+// raw 는 트랙 경계를 모르므로 첫 헤더 뒤는 모두 PCM 으로 본다
+void LoadWorker::parseRaw(Client *c, const char *data, qint64 n, qint64 nowNs)
+{
+    if (c->inUsed < kRawHeader) {
+        const int take = int(qMin<qint64>(n, kRawHeader - c->inUsed));
+        memcpy(c->in.data() + c->inUsed, data, size_t(take));
+        c->inUsed += take;
+        data += take;
+        n -= take;
+        if (c->inUsed == kRawHeader)
+            c->byteRate = qFromLittleEndian<quint32>(
+                        reinterpret_cast<const uchar *>(c->in.constData()) + 28);
+    }
+    if (n <= 0 || c->byteRate == 0)
+        return;
+    arrival(c, nowNs, qint64(double(c->rawData) * 1e9 / c->byteRate));
+    c->rawData += quint64(n);
+}
+
+bool LoadWorker::readClient(Client *c, qint64 nowNs)
+{
+    ClientResult &r = m_results[c->slot];
+    // 수신은 스레드 공용 버퍼로 받고, 클라이언트에는 잘린 패킷 조각만 남긴다
+    // (클라이언트 수천 개에서도 메모리가 패킷 크기 수준)
+    static thread_local char buf[kReadChunk];
+    for (;;) {
+        const ssize_t n = recv(c->fd, buf, sizeof buf, MSG_DONTWAIT);
+        if (n == 0) {
+            r.closedByServer = true;
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            r.error = QString::fromLocal8Bit(strerror(errno));
+            return false;
+        }
+        r.bytes += quint64(n);
+        if (m_raw) {
+            parseRaw(c, buf, n, nowNs);
+            continue;
+        }
+
+        const uchar *p = reinterpret_cast<const uchar *>(buf);
+        int len = int(n);
+        if (c->inUsed > 0) {
+            if (c->in.size() < c->inUsed + len)
+                c->in.resize(c->inUsed + len);
+            memcpy(c->in.data() + c->inUsed, buf, size_t(len));
+            c->inUsed += len;
+            p = reinterpret_cast<const uchar *>(c->in.constData());
+            len = c->inUsed;
+        }
+        const int used = parseFramed(c, p, len, nowNs);
+        if (used < 0)
+            return false;
+        const int rest = len - used;
+        if (rest > 0) {
+            if (c->in.size() < rest)
+                c->in.resize(rest);
+            memmove(c->in.data(), p + used, size_t(rest));
+        }
+        c->inUsed = rest;
+    }
+}
+
+void LoadWorker::finish(Client *c, qint64 nowNs)
+{
+    if (c->done)
+        return;
+    c->done = true;
+    if (c->fd >= 0) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+        ::close(c->fd);
+        c->fd = -1;
+    }
+    ClientResult &r = m_results[c->slot];
+    if (c->startNs == 0 && r.error.isEmpty())
+        r.error = "not started";      // 램프가 측정 시간보다 길다
+    if (r.connected && nowNs > c->connectedNs)
+        r.kbps = double(r.bytes) * 8.0 / 1000.0 / ((nowNs - c->connectedNs) / 1e9);
+    c->in = QByteArray();
+}
+
+void LoadWorker::run()
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0)
+        return;
+    for (int i = 0; i < m_clients.size(); ++i) {
+        if (m_raw)
+            m_clients.at(i)->in.resize(kRawHeader);
+    }
+
+    epoll_event events[kMaxEvents];
+    int next = 0;
+    qint64 now = StreamProtocol::clockNs();
+    while (now < m_endNs) {
+        while (next < m_clients.size() && m_clients.at(next)->dueNs <= now)
+            startConnect(m_clients.at(next++), now);
+
+        qint64 deadline = m_endNs;
+        if (next < m_clients.size())
+            deadline = qMin(deadline, m_clients.at(next)->dueNs);
+        const int timeoutMs = int(qBound<qint64>(0, (deadline - now + 999999) / 1000000, 100));
+        const int n = epoll_wait(m_epollFd, events, kMaxEvents, timeoutMs);
+        now = StreamProtocol::clockNs();
+        for (int i = 0; i < n; ++i) {
+            Client *c = static_cast<Client *>(events[i].data.ptr);
+            if (c->done)
+                continue;
+            const quint32 ev = events[i].events;
+            bool ok = true;
+            if (c->connecting) {
+                if (ev & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                    ok = onConnected(c, now);
+                if (!ok) {
+                    finish(c, now);
+                    continue;
+                }
+            }
+            if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                ok = readClient(c, now);
+            if (!ok)
+                finish(c, now);
+        }
+    }
+
+    for (int i = 0; i < m_clients.size(); ++i)
+        finish(m_clients.at(i), now);
+    ::close(m_epollFd);
+    m_epollFd = -1;
+}
@@ -0,0 +1,68 @@
+#ifndef LOADWORKER_H
+#define LOADWORKER_H
+
+#include <QThread>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+
+// 클라이언트 하나의 측정 결과
+struct ClientResult
+{
+    int     index = 0;
+    bool    connected = false;
+    bool    closedByServer = false;   // 끝나기 전에 서버가 끊음 (kick 등)
+    double  connectMs = -1;           // connect() 완료까지
+    double  startupMs = -1;           // connect 시작부터 첫 오디오까지
+    quint64 bytes = 0;
+    quint64 packets = 0;              // 오디오 패킷 (raw 면 recv 횟수)
+    quint64 sequenceGaps = 0;         // 서버 큐에서 버려진 오디오 패킷
+    double  jitterMs = 0;             // RFC 3550 도착 지터
+    double  maxGapMs = 0;             // 가장 긴 도착 간격
+    double  kbps = 0;                 // 연결 구간 평균 수신 속도
+    QString error;
+};
+
+// 시뮬레이션 클라이언트 여러 개를 epoll 하나로 돌리는 스레드.
+// 오디오는 디코드하지 않고 헤더만 보고 도착 시각을 잰다. 도착 시각과
+// 미디어 시각 (firstFrame / rate, raw 는 받은 바이트 / byteRate) 의 차이로
+// 지터를 계산하므로 서버의 페이싱 흔들림과 네트워크 지연 변화가 모두 잡힌다.
+class LoadWorker : public QThread
+{
+public:
+    // index 번째 클라이언트는 startNs + index / rampPerSecond 에 접속한다
+    LoadWorker(const QString &host, quint16 port, bool raw,
+               const QVector<int> &indices, qint64 startNs, double rampPerSecond,
+               qint64 endNs);
+    ~LoadWorker();
+
+    QVector<ClientResult> results() const { return m_results; }
+
+protected:
+    void run() override;
+
+private:
+    struct Client;
+
+    void startConnect(Client *c, qint64 nowNs);
+    bool onConnected(Client *c, qint64 nowNs);
+    bool readClient(Client *c, qint64 nowNs);
+    int  parseFramed(Client *c, const uchar *p, int len, qint64 nowNs);
+    void parseRaw(Client *c, const char *data, qint64 n, qint64 nowNs);
+    void arrival(Client *c, qint64 nowNs, qint64 mediaNs);
+    void finish(Client *c, qint64 nowNs);
+
+    QString m_host;
+    quint16 m_port;
+    bool    m_raw;
+    qint64  m_startNs;
+    double  m_ramp;
+    qint64  m_endNs;
+    QVector<Client *> m_clients;
+    QVector<ClientResult> m_results;
+    int     m_epollFd;
+
+    Q_DISABLE_COPY(LoadWorker)
+};
+
+#endif // LOADWORKER_H
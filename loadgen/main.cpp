@@ -0,0 +1,1112 @@
+// main.cpp
+//
+// server2 스트리밍 엔진 부하 시험. localhost 로 시뮬레이션 클라이언트 N 개를
+// 붙여 클라이언트별 수신 속도 / 도착 지터 / 시작 지연과 서버 CPU / RSS 를 재고
+// JSON / CSV 로 남긴다 (용량 회귀 추적용).
+//
+//   loadgen -n 500 --duration 30 --serve /mnt/nfs/test.wav --json r.json --csv r.csv
+//   loadgen -n 200 --server-pid $(pidof server2)          (이미 떠 있는 서버, CPU / 시스템 콜 수)
+//   loadgen -n 200 --raw ...                              (raw WAV 포트)
+//   loadgen -n 200 --raw --copy --serve test.wav          (sendfile 대신 read+send 기준선)
+//   loadgen --rtp 127.0.0.1:5004 --loss 5 --burst 3 --fec 25 --serve test.wav
+//                                                         (RTP 손실 / FEC 복구)
+//   loadgen --rtp 239.255.0.1:5004 --receivers 1,16,64 --loss 0 --serve test.wav
+//                                                         (수신자 수별 서버 CPU)
+//   loadgen --transport-bench shm,tcp,udp --packets 20000 (같은 호스트 전송 비교)
+//   loadgen --sync -n 8                                   (클라이언트 간 재생 시각 skew)
+//   loadgen --relay-chain 3 --serve test.wav              (릴레이 단마다 재생 시각 오차)
+#include "loadworker.h"
+#include "relayprobe.h"
+#include "rtpprobe.h"
+#include "syscallcounter.h"
+#include "transportbench.h"
+#include "streamclient.h"
+#include "streamserver.h"
+#include "streamprotocol.h"
+#include "audiosource.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+
+#include <signal.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+namespace {
+
+enum { SyncRampRate = 48000 };
+
+volatile sig_atomic_t g_stop = 0;
+
+void onStopSignal(int)
+{
+    g_stop = 1;
+}
+
+struct RtpTarget {
+    QString group;                    // 비면 RTP 를 보내지 않음
+    quint16 port = 5004;
+    double  fecPercent = 0;
+    int     fecInterleave = 1;
+};
+
+// --serve: 자식 프로세스에서 엔진만 돌린다. 트랙이 끝나면 처음부터 다시.
+// listen 이 끝나면 readyFd 에 한 바이트 쓴다
+int serveFile(const QString &path, quint16 port, quint16 rawPort, bool zeroCopy,
+              const RtpTarget &rtp, int readyFd)
+{
+    signal(SIGTERM, onStopSignal);
+    signal(SIGINT, onStopSignal);
+    StreamServer server;
+    server.setRawPort(rawPort);
+    server.setZeroCopy(zeroCopy);
+    // 기본 로컬 소켓은 돌고 있는 server2/server2d 가 쓰고 있을 수 있다
+    server.setLocalSocket(QString());
+    if (!rtp.group.isEmpty()) {
+        server.setMulticastFec(rtp.fecPercent, rtp.fecInterleave);
+        if (!server.setMulticast(rtp.group, rtp.port)) {
+            QTextStream(stderr) << "serve: " << server.errorString() << Qt::endl;
+            return 1;
+        }
+    }
+    if (!server.listen(port, "127.0.0.1")) {
+        QTextStream(stderr) << "serve: " << server.errorString() << Qt::endl;
+        return 1;
+    }
+    const char ok = 1;
+    if (write(readyFd, &ok, 1) != 1)
+        return 1;
+    ::close(readyFd);
+
+    while (!g_stop) {
+        if (!server.isPlaying()) {
+            AudioSource *src = createAudioSource(path);
+            if (!src || !src->open(path)) {
+                QTextStream(stderr) << "serve: cannot open " << path << Qt::endl;
+                delete src;
+                return 1;
+            }
+            server.play(src, path);
+            for (int i = 0; i < 100 && !server.isPlaying() && !g_stop; ++i)
+                usleep(10000);
+        }
+        usleep(50000);
+    }
+    server.close();
+    return 0;
+}
+
+// --relay-chain: 자식 프로세스에서 127.0.0.1:upstreamPort 를 릴레이한다.
+// raw 포트와 로컬 소켓은 체인끼리 겹치므로 끈다
+int serveRelay(quint16 upstreamPort, quint16 port, int readyFd)
+{
+    signal(SIGTERM, onStopSignal);
+    signal(SIGINT, onStopSignal);
+    StreamServer server;
+    server.setRawPort(0);
+    server.setLocalSocket(QString());
+    if (!server.setUpstream("127.0.0.1", upstreamPort) || !server.listen(port, "127.0.0.1")) {
+        QTextStream(stderr) << "relay " << port << ": " << server.errorString() << Qt::endl;
+        return 1;
+    }
+    const char ok = 1;
+    if (write(readyFd, &ok, 1) != 1)
+        return 1;
+    ::close(readyFd);
+    while (!g_stop)
+        usleep(50000);
+    server.close();
+    return 0;
+}
+
+// fork 해서 자식에서 run(readyFd) 를 돌린다. 자식이 준비를 알리면 pid, 아니면 0
+template <typename Run>
+pid_t startChild(Run run)
+{
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0)
+        return 0;
+    const pid_t child = fork();
+    if (child == 0) {
+        ::close(pipeFds[0]);
+        _exit(run(pipeFds[1]));
+    }
+    ::close(pipeFds[1]);
+    pollfd p = { pipeFds[0], POLLIN, 0 };
+    char ready = 0;
+    const bool ok = child > 0 && poll(&p, 1, 5000) == 1 && read(pipeFds[0], &ready, 1) == 1;
+    ::close(pipeFds[0]);
+    if (!ok) {
+        if (child > 0) {
+            kill(child, SIGKILL);
+            waitpid(child, nullptr, 0);
+        }
+        return 0;
+    }
+    return child;
+}
+
+void stopChildren(const QVector<pid_t> &children)
+{
+    for (pid_t pid : children)
+        kill(pid, SIGTERM);
+    for (pid_t pid : children)
+        waitpid(pid, nullptr, 0);
+}
+
+struct ProcSample {
+    bool   ok = false;
+    double cpuSeconds = 0;        // utime + stime
+    qint64 rssKb = 0;
+};
+
+ProcSample sampleProcess(qint64 pid)
+{
+    ProcSample s;
+    QFile stat(QString("/proc/%1/stat").arg(pid));
+    if (!stat.open(QIODevice::ReadOnly))
+        return s;
+    // comm 에 공백이 있을 수 있으므로 마지막 ')' 뒤부터 센다 (state 가 3번 필드)
+    const QByteArray line = stat.readAll();
+    const QList<QByteArray> f = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    if (f.size() < 13)
+        return s;
+    const double tick = double(sysconf(_SC_CLK_TCK));
+    s.cpuSeconds = (f.at(11).toDouble() + f.at(12).toDouble()) / tick;   // utime, stime
+
+    QFile status(QString("/proc/%1/status").arg(pid));
+    if (status.open(QIODevice::ReadOnly)) {
+        while (!status.atEnd()) {
+            const QByteArray l = status.readLine();
+            if (l.startsWith("VmRSS:")) {
+                s.rssKb = l.mid(6).trimmed().split(' ').first().toLongLong();
+                break;
+            }
+        }
+    }
+    s.ok = true;
+    return s;
+}
+
+struct Dist {
+    double min = 0, avg = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;
+};
+
+Dist distribution(QVector<double> v)
+{
+    Dist d;
+    if (v.isEmpty())
+        return d;
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (double x : v)
+        sum += x;
+    const auto pct = [&v](double p) { return v.at(qMin(v.size() - 1, int(p * v.size()))); };
+    d.min = v.first();
+    d.max = v.last();
+    d.avg = sum / v.size();
+    d.p50 = pct(0.50);
+    d.p95 = pct(0.95);
+    d.p99 = pct(0.99);
+    return d;
+}
+
+QJsonObject toJson(const Dist &d)
+{
+    QJsonObject o;
+    o["min"] = d.min;
+    o["avg"] = d.avg;
+    o["p50"] = d.p50;
+    o["p95"] = d.p95;
+    o["p99"] = d.p99;
+    o["max"] = d.max;
+    return o;
+}
+
+QString toText(const Dist &d)
+{
+    return QString("avg %1  p50 %2  p95 %3  p99 %4  max %5")
+            .arg(d.avg, 0, 'f', 2).arg(d.p50, 0, 'f', 2).arg(d.p95, 0, 'f', 2)
+            .arg(d.p99, 0, 'f', 2).arg(d.max, 0, 'f', 2);
+}
+
+// --rtp --receivers: 손실 없이 받기만 하는 수신 프로세스 count 개. 멀티캐스트 그룹에
+// 가입한 뒤 준비를 알리고, SIGTERM 을 받으면 받은 미디어 패킷 수를 resultFd 로 돌려준다
+QVector<pid_t> startReceivers(const RtpTarget &rtp, int count, QVector<int> *resultFds)
+{
+    QVector<pid_t> children;
+    for (int i = 0; i < count; ++i) {
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0)
+            break;
+        const pid_t pid = startChild([&](int readyFd) {
+            ::close(pipeFds[0]);
+            signal(SIGTERM, onStopSignal);
+            RtpProbe probe(0, 1, quint32(i + 2));
+            QString error;
+            if (!probe.open(rtp.group, rtp.port, &error))
+                return 1;
+            const char ok = 1;
+            if (write(readyFd, &ok, 1) != 1)
+                return 1;
+            while (!g_stop)
+                probe.run(StreamProtocol::clockNs() + 100 * 1000000LL);
+            const quint64 received = probe.result().received;
+            return write(pipeFds[1], &received, sizeof received) == sizeof received ? 0 : 1;
+        });
+        ::close(pipeFds[1]);
+        if (!pid) {
+            ::close(pipeFds[0]);
+            break;
+        }
+        children.append(pid);
+        resultFds->append(pipeFds[0]);
+    }
+    return children;
+}
+
+// --rtp: 손실을 흉내 내며 RTP 를 받고 FEC 복구율 / 비용을 낸다. receivers 가 여럿이면
+// 단계마다 수신 프로세스 수를 바꿔 서버 CPU 를 잰다 (멀티캐스트라 평평해야 한다)
+int runRtpProbe(const RtpTarget &rtp, double duration, double loss, double burst,
+                const QVector<int> &receivers, qint64 serverPid, const QString &jsonPath,
+                QTextStream &out)
+{
+    out << QString("rtp %1:%2 (fec %3), simulated loss %4% in bursts of %5, %6 s")
+           .arg(rtp.group).arg(rtp.port).arg(rtp.port + 2)
+           .arg(loss).arg(burst).arg(duration) << Qt::endl;
+
+    RtpProbeResult r;
+    double serverCpu = -1.0;
+    QJsonArray stages;
+    for (int count : receivers) {
+        // 수신 프로세스가 모두 가입한 뒤부터 잰다 (소켓을 물려주지 않게 먼저 fork)
+        QVector<int> resultFds;
+        const QVector<pid_t> children = startReceivers(rtp, count - 1, &resultFds);
+        if (children.size() != count - 1)
+            QTextStream(stderr) << "rtp: only " << children.size() + 1 << " receivers started" << Qt::endl;
+        RtpProbe probe(loss, burst);
+        QString error;
+        if (!probe.open(rtp.group, rtp.port, &error)) {
+            QTextStream(stderr) << "rtp: " << error << Qt::endl;
+            stopChildren(children);
+            for (int fd : resultFds)
+                ::close(fd);
+            return 1;
+        }
+
+        const ProcSample first = serverPid ? sampleProcess(serverPid) : ProcSample();
+        const qint64 startNs = StreamProtocol::clockNs();
+        probe.run(startNs + qint64(duration * 1e9));
+        const ProcSample last = serverPid ? sampleProcess(serverPid) : ProcSample();
+        const double elapsed = (StreamProtocol::clockNs() - startNs) / 1e9;
+        stopChildren(children);
+
+        r = probe.result();
+        QVector<double> packets;
+        packets.append(double(r.received));
+        for (int fd : resultFds) {
+            quint64 received = 0;
+            if (read(fd, &received, sizeof received) == sizeof received)
+                packets.append(double(received));
+            ::close(fd);
+        }
+        const Dist perReceiver = distribution(packets);
+        serverCpu = first.ok && last.ok
+                ? 100.0 * (last.cpuSeconds - first.cpuSeconds) / elapsed : -1.0;
+        if (receivers.size() > 1 || count > 1)
+            out << QString("receivers %1: server cpu %2%, media packets per receiver min %3 max %4")
+                   .arg(packets.size()).arg(serverCpu, 0, 'f', 2)
+                   .arg(perReceiver.min, 0, 'f', 0).arg(perReceiver.max, 0, 'f', 0) << Qt::endl;
+
+        QJsonObject o;
+        o["receivers"] = packets.size();
+        o["serverCpuPercent"] = serverCpu;
+        o["mediaPackets"] = toJson(perReceiver);
+        stages.append(o);
+    }
+
+    // FEC 결과는 마지막 단계의 손실 시험 수신기 것
+    const Dist latency = distribution(r.recoveryMs);
+    const double lost = double(r.dropped + r.networkLost);
+    const double recoveryRate = lost > 0 ? 100.0 * (lost - r.residualLost) / lost : 100.0;
+    const double overhead = r.mediaBytes ? 100.0 * r.fecBytes / r.mediaBytes : 0.0;
+    const double expected = double(r.received + r.networkLost);
+    const double residual = expected > 0 ? 100.0 * r.residualLost / expected : 0.0;
+
+    out << QString("media %1 packets, fec %2 packets (overhead %3%)")
+           .arg(r.received).arg(r.fecReceived).arg(overhead, 0, 'f', 1) << Qt::endl;
+    out << QString("lost %1 (simulated %2, network %3, fec lost %4), recovered %5, residual %6 (%7%)")
+           .arg(lost).arg(r.dropped).arg(r.networkLost).arg(r.fecDropped)
+           .arg(r.recovered).arg(r.residualLost).arg(residual, 0, 'f', 3) << Qt::endl;
+    out << QString("recovery rate %1%, decoder %2 ns/packet")
+           .arg(recoveryRate, 0, 'f', 1).arg(r.decoderNsPerPacket, 0, 'f', 0) << Qt::endl;
+    out << "recovery ms      " << toText(latency) << Qt::endl;
+    if (serverCpu >= 0)
+        out << QString("server cpu %1%").arg(serverCpu, 0, 'f', 1) << Qt::endl;
+
+    if (!jsonPath.isEmpty()) {
+        QJsonObject root;
+        root["group"] = rtp.group;
+        root["port"] = rtp.port;
+        root["duration"] = duration;
+        root["lossPercent"] = loss;
+        root["burst"] = burst;
+        root["mediaPackets"] = double(r.received);
+        root["fecPackets"] = double(r.fecReceived);
+        root["overheadPercent"] = overhead;
+        root["dropped"] = double(r.dropped);
+        root["fecDropped"] = double(r.fecDropped);
+        root["networkLost"] = double(r.networkLost);
+        root["recovered"] = double(r.recovered);
+        root["residualLost"] = double(r.residualLost);
+        root["residualPercent"] = residual;
+        root["recoveryRate"] = recoveryRate;
+        root["decoderNsPerPacket"] = r.decoderNsPerPacket;
+        root["recoveryMs"] = toJson(latency);
+        root["serverCpuPercent"] = serverCpu;
+        root["stages"] = stages;
+        QFile f(jsonPath);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+    return 0;
+}
+
+// --sync 가 서버에 틀게 하는 램프. 샘플 값이 곧 프레임 번호 (mod 65536) 라서 출력
+// 샘플만 보고도 원본의 몇 번째 샘플인지 (리샘플된 사이 값이면 소수점까지) 안다
+bool writeRampWav(const QString &path, quint32 rate, qint64 frames)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    uchar h[44];
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(quint32(36 + frames * 2), h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);
+    qToLittleEndian<quint16>(1, h + 20);          // PCM
+    qToLittleEndian<quint16>(1, h + 22);          // 모노
+    qToLittleEndian<quint32>(rate, h + 24);
+    qToLittleEndian<quint32>(rate * 2, h + 28);
+    qToLittleEndian<quint16>(2, h + 32);
+    qToLittleEndian<quint16>(16, h + 34);
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(quint32(frames * 2), h + 40);
+    if (f.write(reinterpret_cast<const char *>(h), sizeof h) != sizeof h)
+        return false;
+    QVector<qint16> block(65536);
+    for (int i = 0; i < block.size(); ++i)
+        qToLittleEndian<qint16>(qint16(i - 32768), reinterpret_cast<uchar *>(block.data() + i));
+    for (qint64 done = 0; done < frames; done += block.size()) {
+        const qint64 n = qMin<qint64>(block.size(), frames - done) * 2;
+        if (f.write(reinterpret_cast<const char *>(block.constData()), n) != n)
+            return false;
+    }
+    return true;
+}
+
+// a - b 를 램프 주기 안에서 [-32768, 32768) 로
+double rampDiff(double a, double b)
+{
+    double d = std::fmod(a - b, 65536.0);
+    if (d >= 32768)
+        d -= 65536;
+    else if (d < -32768)
+        d += 65536;
+    return d;
+}
+
+// 출력 블록의 첫 프레임이 램프의 몇 번째 샘플인지. 샘플마다 (값 - 출력 위치) 의
+// 중앙값이라 램프가 한 바퀴 도는 자리 (보간이 튐) 는 무시된다
+double rampPosition(const float *p, int frames)
+{
+    QVector<double> d;
+    const double ref = p[0] * 32768.0 + 32768.0;
+    for (int k = 0; k < frames; ++k)
+        d.append(rampDiff(p[k] * 32768.0 + 32768.0 - k, ref));
+    std::nth_element(d.begin(), d.begin() + d.size() / 2, d.end());
+    return ref + d[d.size() / 2];
+}
+
+// --sync: 스트림 클라이언트 (StreamClient + 지터 버퍼) n 개를 한 서버에 붙이고, 오디오
+// 장치처럼 10ms 마다 모두 같은 재생 시각으로 pull 한다. 서버는 램프를 틀므로 그 시각에
+// 각자 원본의 어느 샘플을 내보내는지 알 수 있고, 클라이언트 사이 최대 - 최소가 방
+// 사이에 실제로 벌어질 재생 시각 차이 (skew) 다. 시계 동기 오차와 지터 버퍼의 재생
+// 속도 제어 오차가 모두 들어간다
+int runSyncProbe(const QString &host, quint16 port, int clients, double duration,
+                 qint64 serverPid, const QString &jsonPath, QTextStream &out)
+{
+    const quint32 rate = SyncRampRate;
+    const int block = int(rate / 100);
+    const qint64 blockNs = 10 * 1000000LL;
+    const qint64 outputLatencyNs = 20 * 1000000LL;    // pull 한 블록이 스피커로 나가기까지
+    const qint64 settleNs = 2 * 1000000000LL;          // 동기 후 제어 루프가 자리 잡는 시간
+
+    QVector<StreamClient *> streams;
+    for (int i = 0; i < clients; ++i) {
+        StreamClient *c = new StreamClient;
+        c->connectToServer(host, port);
+        streams.append(c);
+    }
+    out << QString("%1 stream clients -> %2:%3, %4 s").arg(clients).arg(host).arg(port)
+           .arg(duration) << Qt::endl;
+
+    const qint64 startNs = StreamProtocol::clockNs();
+    const qint64 endNs = startNs + qint64(duration * 1e9);
+    qint64 syncedNs = -1;
+    QVector<float> buf(block);
+    QVector<quint64> concealed(clients, 0);
+    QVector<double> skewUs, deviationUs, offsetSpreadUs, ratioPpm;
+    quint64 skipped = 0;
+    SyscallCounter syscalls(serverPid);
+    quint64 firstSyscalls = 0;
+    qint64 measureNs = -1;
+    for (qint64 tick = startNs; ; tick += blockNs) {
+        qint64 now = StreamProtocol::clockNs();
+        if (tick > now)
+            usleep(useconds_t((tick - now) / 1000));
+        now = StreamProtocol::clockNs();
+        if (now >= endNs)
+            break;
+
+        // 모든 클라이언트가 같은 장치 시각으로 꺼낸다 (장치 시계는 모두 이 호스트 시계)
+        const qint64 playNs = tick + outputLatencyNs;
+        bool synced = true;
+        QVector<double> position;
+        for (int i = 0; i < streams.size(); ++i) {
+            StreamClient *c = streams[i];
+            c->read(buf.data(), block, playNs);
+            const JitterBuffer::Stats st = c->stats();
+            synced = synced && c->isClockSynced() && st.synced && c->channels() == 1;
+            // 채운 무음 (손실 / 끊김) 이 섞인 블록은 램프가 아니다
+            const bool clean = st.concealedFrames == concealed[i];
+            concealed[i] = st.concealedFrames;
+            if (clean)
+                position.append(rampPosition(buf.constData(), block));
+        }
+        if (!synced)
+            continue;
+        if (syncedNs < 0)
+            syncedNs = now;
+        if (now < syncedNs + settleNs)
+            continue;
+        if (measureNs < 0) {
+            measureNs = now;
+            firstSyscalls = syscalls.count();
+        }
+        if (position.size() != streams.size()) {
+            ++skipped;
+            continue;
+        }
+
+        QVector<double> rel;
+        for (double p : position)
+            rel.append(rampDiff(p, position[0]));
+        QVector<double> sorted = rel;
+        std::sort(sorted.begin(), sorted.end());
+        const double median = sorted[sorted.size() / 2];
+        skewUs.append((sorted.last() - sorted.first()) * 1e6 / rate);
+        for (double r : rel)
+            deviationUs.append(qAbs(r - median) * 1e6 / rate);
+
+        qint64 lo = 0, hi = 0;
+        for (int i = 0; i < streams.size(); ++i) {
+            const qint64 off = streams[i]->clockOffsetNs();
+            lo = i ? qMin(lo, off) : off;
+            hi = i ? qMax(hi, off) : off;
+            ratioPpm.append(qAbs(streams[i]->stats().ratioPpm));
+        }
+        offsetSpreadUs.append((hi - lo) / 1e3);
+    }
+    const quint64 lastSyscalls = syscalls.count();
+    const double measuredSeconds = measureNs >= 0 ? (StreamProtocol::clockNs() - measureNs) / 1e9 : 0;
+    for (StreamClient *c : streams)
+        c->disconnectFromServer();
+    qDeleteAll(streams);
+
+    if (skewUs.isEmpty()) {
+        QTextStream(stderr) << "sync: clients did not synchronise within the test "
+                               "(is the server playing the ramp?)" << Qt::endl;
+        return 1;
+    }
+    const Dist skew = distribution(skewUs);
+    const Dist deviation = distribution(deviationUs);
+    const Dist offsetSpread = distribution(offsetSpreadUs);
+    const Dist ratio = distribution(ratioPpm);
+    out << QString("all synced after %1 ms, measured %2 s (%3 blocks skipped for concealment)")
+           .arg((syncedNs - startNs) / 1e6, 0, 'f', 0).arg(measuredSeconds, 0, 'f', 1)
+           .arg(skipped) << Qt::endl;
+    out << "playout skew us  " << toText(skew) << Qt::endl;
+    out << "|vs median| us   " << toText(deviation) << Qt::endl;
+    out << "clock spread us  " << toText(offsetSpread) << Qt::endl;
+    out << "|ratio| ppm      " << toText(ratio) << Qt::endl;
+    const double syscallRate = syscalls.isValid() && measuredSeconds > 0
+            ? (lastSyscalls - firstSyscalls) / measuredSeconds : -1.0;
+    if (syscallRate >= 0)
+        out << QString("server syscalls %1/s (%2)").arg(syscallRate, 0, 'f', 0)
+               .arg(syscalls.source()) << Qt::endl;
+
+    if (!jsonPath.isEmpty()) {
+        QJsonObject root;
+        root["clients"] = clients;
+        root["duration"] = duration;
+        root["syncedMs"] = (syncedNs - startNs) / 1e6;
+        root["skippedBlocks"] = double(skipped);
+        root["skewUs"] = toJson(skew);
+        root["deviationUs"] = toJson(deviation);
+        root["clockSpreadUs"] = toJson(offsetSpread);
+        root["ratioPpm"] = toJson(ratio);
+        root["serverSyscallsPerSecond"] = syscallRate;
+        root["syscallSource"] = syscalls.source();
+        QFile f(jsonPath);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+    return 0;
+}
+
+// --relay-chain: 원본 서버 뒤에 릴레이 hops 개를 줄줄이 물리고 (port, port + 1, ...)
+// 단마다 같은 패킷의 재생 시각이 원본과 얼마나 어긋나는지, 여유가 얼마나 남는지 잰다
+int runRelayChain(const QString &path, quint16 port, int hops, double duration,
+                  const QString &jsonPath, QTextStream &out)
+{
+    QVector<pid_t> children;
+    QVector<quint16> ports;
+    const pid_t origin = startChild([&](int readyFd) {
+        return serveFile(path, port, 0, true, RtpTarget(), readyFd);
+    });
+    if (!origin) {
+        QTextStream(stderr) << "relay-chain: embedded server did not start" << Qt::endl;
+        return 1;
+    }
+    children.append(origin);
+    ports.append(port);
+    for (int i = 1; i <= hops; ++i) {
+        const quint16 upstream = ports.last();
+        const quint16 hopPort = quint16(port + i);
+        const pid_t relay = startChild([&](int readyFd) {
+            return serveRelay(upstream, hopPort, readyFd);
+        });
+        if (!relay) {
+            QTextStream(stderr) << "relay-chain: relay on port " << hopPort << " did not start"
+                                << Qt::endl;
+            stopChildren(children);
+            return 1;
+        }
+        children.append(relay);
+        ports.append(hopPort);
+    }
+
+    RelayProbe probe;
+    QString error;
+    if (!probe.open(ports, &error)) {
+        QTextStream(stderr) << "relay-chain: " << error << Qt::endl;
+        stopChildren(children);
+        return 1;
+    }
+    out << QString("%1 relays behind 127.0.0.1:%2, %3 s").arg(hops).arg(port).arg(duration)
+        << Qt::endl;
+
+    QVector<ProcSample> first;
+    for (pid_t pid : children)
+        first.append(sampleProcess(pid));
+    const qint64 startNs = StreamProtocol::clockNs();
+    probe.run(startNs + qint64(duration * 1e9));
+    const double elapsed = (StreamProtocol::clockNs() - startNs) / 1e9;
+    QVector<ProcSample> last;
+    for (pid_t pid : children)
+        last.append(sampleProcess(pid));
+    stopChildren(children);
+
+    const QVector<RelayHopResult> results = probe.results();
+    QJsonArray list;
+    bool ok = true;
+    for (int i = 0; i < results.size(); ++i) {
+        const RelayHopResult &r = results.at(i);
+        QVector<double> absError;
+        double bias = 0;
+        for (double e : r.errorUs) {
+            absError.append(qAbs(e));
+            bias += e;
+        }
+        if (!r.errorUs.isEmpty())
+            bias /= r.errorUs.size();
+        const Dist error = distribution(absError);
+        const Dist delay = distribution(r.delayMs);
+        const Dist headroom = distribution(r.headroomMs);
+        const double cpu = first.at(i).ok && last.at(i).ok
+                ? 100.0 * (last.at(i).cpuSeconds - first.at(i).cpuSeconds) / elapsed : -1.0;
+        ok = ok && r.packets > 0;
+
+        out << QString("hop %1 (port %2%3): %4 packets, %5 unmatched, first after %6 ms, cpu %7%")
+               .arg(i).arg(r.port).arg(i ? "" : ", origin").arg(r.packets).arg(r.unmatched)
+               .arg(r.firstPacketMs, 0, 'f', 0).arg(cpu, 0, 'f', 1) << Qt::endl;
+        if (i > 0) {
+            out << QString("  |error| us      %1  (bias %2)").arg(toText(error)).arg(bias, 0, 'f', 1)
+                << Qt::endl;
+            out << "  delay ms        " << toText(delay) << Qt::endl;
+        }
+        out << "  headroom ms     min " << QString::number(headroom.min, 'f', 2) << "  "
+            << toText(headroom) << Qt::endl;
+
+        QJsonObject o;
+        o["hop"] = i;
+        o["port"] = r.port;
+        o["packets"] = double(r.packets);
+        o["unmatched"] = double(r.unmatched);
+        o["firstPacketMs"] = r.firstPacketMs;
+        o["cpuPercent"] = cpu;
+        o["headroomMs"] = toJson(headroom);
+        if (i > 0) {
+            o["errorUs"] = toJson(error);
+            o["biasUs"] = bias;
+            o["delayMs"] = toJson(delay);
+        }
+        list.append(o);
+    }
+
+    if (!jsonPath.isEmpty()) {
+        QJsonObject root;
+        root["hops"] = hops;
+        root["duration"] = duration;
+        root["chain"] = list;
+        QFile f(jsonPath);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+    if (!ok)
+        QTextStream(stderr) << "relay-chain: some hops received no audio" << Qt::endl;
+    return ok ? 0 : 2;
+}
+
+// --transport-bench: 전송마다 같은 패킷 흐름을 보내고 지연 / 보내기·받기 CPU 를 비교
+int runTransportBench(const QStringList &names, int packets, int bytes, int intervalUs,
+                      const QString &jsonPath, QTextStream &out)
+{
+    out << QString("%1 packets of %2 bytes every %3 us").arg(packets).arg(bytes).arg(intervalUs)
+        << Qt::endl;
+    QJsonArray results;
+    for (const QString &name : names) {
+        TransportBench::Transport transport;
+        if (!TransportBench::parseTransport(name, &transport)) {
+            QTextStream(stderr) << "transport-bench: unknown transport " << name << Qt::endl;
+            return 1;
+        }
+        TransportBench bench;
+        QString error;
+        if (!bench.open(transport, bytes, &error)) {
+            QTextStream(stderr) << name << ": " << error << Qt::endl;
+            return 1;
+        }
+        bench.run(packets, intervalUs);
+
+        const TransportBenchResult r = bench.result();
+        const Dist latency = distribution(r.latencyUs);
+        out << QString("%1  sent %2  received %3%4  send %5 us  recv %6 us per packet")
+               .arg(name, -3).arg(r.sent).arg(r.received)
+               .arg(r.ringFull ? QString("  ring full %1").arg(r.ringFull) : QString())
+               .arg(r.sendUsPerPacket, 0, 'f', 2).arg(r.recvUsPerPacket, 0, 'f', 2) << Qt::endl;
+        out << "     latency us  " << toText(latency) << Qt::endl;
+
+        QJsonObject o;
+        o["transport"] = name;
+        o["sent"] = double(r.sent);
+        o["received"] = double(r.received);
+        o["ringFull"] = double(r.ringFull);
+        o["sendUsPerPacket"] = r.sendUsPerPacket;
+        o["recvUsPerPacket"] = r.recvUsPerPacket;
+        o["latencyUs"] = toJson(latency);
+        results.append(o);
+    }
+
+    if (!jsonPath.isEmpty()) {
+        QJsonObject root;
+        root["packets"] = packets;
+        root["packetBytes"] = bytes;
+        root["intervalUs"] = intervalUs;
+        root["transports"] = results;
+        QFile f(jsonPath);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+    return 0;
+}
+
+void raiseFileLimit()
+{
+    rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("loadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Simulated listeners for the server2 streaming engine.");
+    parser.addHelpOption();
+    QCommandLineOption clientsOpt(QStringList() << "n" << "clients", "Number of clients (default 100).", "n", "100");
+    QCommandLineOption hostOpt("host", "Server address (default 127.0.0.1).", "addr", "127.0.0.1");
+    QCommandLineOption portOpt("port", "Server port (default 5700, or 5701 with --raw).", "port");
+    QCommandLineOption rawOpt("raw", "Connect to the raw WAV port instead of the framed stream.");
+    QCommandLineOption threadsOpt("threads", "Client threads (default: CPU count).", "n");
+    QCommandLineOption durationOpt("duration", "Test length in seconds (default 30).", "sec", "30");
+    QCommandLineOption rampOpt("ramp", "New connections per second (default 200).", "n", "200");
+    QCommandLineOption pidOpt("server-pid", "Sample CPU/RSS/syscalls of this server process.", "pid");
+    QCommandLineOption serveOpt("serve", "Start an embedded server playing <file> in a loop.", "file");
+    QCommandLineOption copyOpt("copy",
+            "Embedded server sends raw WAV with pread()+send() instead of sendfile() (baseline).");
+    QCommandLineOption jsonOpt("json", "Write summary and per-client results as JSON.", "file");
+    QCommandLineOption csvOpt("csv", "Write per-client results as CSV.", "file");
+    QCommandLineOption rtpOpt("rtp",
+            "Receive RTP on <group:port> (FEC on port + 2) and measure FEC recovery "
+            "instead of running TCP clients.", "group:port");
+    QCommandLineOption lossOpt("loss", "Simulated RTP loss in percent (default 5).", "percent", "5");
+    QCommandLineOption receiversOpt("receivers",
+            "RTP receiver processes, or a list to step through (e.g. 1,16,64) reporting server "
+            "CPU for each (default 1). Needs a multicast group.", "n[,n...]", "1");
+    QCommandLineOption burstOpt("burst", "Mean length of a loss burst in packets (default 3).", "n", "3");
+    QCommandLineOption fecOpt("fec", "FEC overhead of the embedded server in percent (default 25).",
+                              "percent", "25");
+    QCommandLineOption fecInterleaveOpt("fec-interleave",
+            "FEC interleave of the embedded server (default 4).", "n", "4");
+    QCommandLineOption syncOpt("sync",
+            "Run -n stream clients against an embedded server playing a ramp and report "
+            "how far apart they play the same sample.");
+    QCommandLineOption relayChainOpt("relay-chain",
+            "Chain <n> relays behind the embedded server (--serve) on consecutive ports and "
+            "report per-hop presentation-time error.", "n");
+    QCommandLineOption transportOpt("transport-bench",
+            "Compare same-host transports (shm, tcp, udp) instead of running clients.",
+            "list");
+    QCommandLineOption packetsOpt("packets", "Packets per transport (default 20000).", "n", "20000");
+    QCommandLineOption packetBytesOpt("packet-bytes", "Packet size (default 1952).", "n", "1952");
+    QCommandLineOption intervalOpt("interval-us", "Send interval (default 250).", "us", "250");
+    parser.addOption(clientsOpt);
+    parser.addOption(hostOpt);
+    parser.addOption(portOpt);
+    parser.addOption(rawOpt);
+    parser.addOption(threadsOpt);
+    parser.addOption(durationOpt);
+    parser.addOption(rampOpt);
+    parser.addOption(pidOpt);
+    parser.addOption(serveOpt);
+    parser.addOption(copyOpt);
+    parser.addOption(jsonOpt);
+    parser.addOption(csvOpt);
+    parser.addOption(rtpOpt);
+    parser.addOption(lossOpt);
+    parser.addOption(burstOpt);
+    parser.addOption(receiversOpt);
+    parser.addOption(fecOpt);
+    parser.addOption(fecInterleaveOpt);
+    parser.addOption(syncOpt);
+    parser.addOption(relayChainOpt);
+    parser.addOption(transportOpt);
+    parser.addOption(packetsOpt);
+    parser.addOption(packetBytesOpt);
+    parser.addOption(intervalOpt);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    if (parser.isSet(transportOpt)) {
+        return runTransportBench(parser.value(transportOpt).split(','),
+                                 qMax(1, parser.value(packetsOpt).toInt()),
+                                 qBound(16, parser.value(packetBytesOpt).toInt(), 65000),
+                                 qMax(1, parser.value(intervalOpt).toInt()),
+                                 parser.value(jsonOpt), out);
+    }
+    const int clients = qMax(1, parser.value(clientsOpt).toInt());
+    const bool raw = parser.isSet(rawOpt);
+    const QString host = parser.value(hostOpt);
+    const quint16 port = parser.isSet(portOpt)
+            ? quint16(parser.value(portOpt).toUInt())
+            : quint16(raw ? StreamProtocol::DefaultRawPort : StreamProtocol::DefaultPort);
+    const int threads = qBound(1, parser.isSet(threadsOpt) ? parser.value(threadsOpt).toInt()
+                                                           : QThread::idealThreadCount(), clients);
+    const double duration = qMax(1.0, parser.value(durationOpt).toDouble());
+    const double ramp = qMax(1.0, parser.value(rampOpt).toDouble());
+    raiseFileLimit();
+
+    RtpTarget rtp;
+    if (parser.isSet(rtpOpt)) {
+        const QStringList dest = parser.value(rtpOpt).split(':');
+        rtp.group = dest.at(0);
+        if (dest.size() > 1)
+            rtp.port = quint16(dest.at(1).toUInt());
+        rtp.fecPercent = parser.value(fecOpt).toDouble();
+        rtp.fecInterleave = parser.value(fecInterleaveOpt).toInt();
+    }
+
+    if (parser.isSet(relayChainOpt)) {
+        if (!parser.isSet(serveOpt)) {
+            QTextStream(stderr) << "relay-chain: needs --serve <file> for the origin" << Qt::endl;
+            return 1;
+        }
+        return runRelayChain(parser.value(serveOpt), raw ? quint16(StreamProtocol::DefaultPort) : port,
+                             qBound(1, parser.value(relayChainOpt).toInt(), 32), duration,
+                             parser.value(jsonOpt), out);
+    }
+
+    if (parser.isSet(syncOpt)) {
+        // 재생 위치를 출력 샘플에서 읽으려면 서버가 램프를 틀어야 한다 (동기 시간 여유 포함)
+        const QString ramp = QDir::temp().filePath(QString("loadgen-ramp-%1.wav").arg(getpid()));
+        const quint16 syncPort = raw ? quint16(StreamProtocol::DefaultPort) : port;
+        if (!writeRampWav(ramp, SyncRampRate, qint64((duration + 30) * SyncRampRate))) {
+            QTextStream(stderr) << "sync: cannot write " << ramp << Qt::endl;
+            return 1;
+        }
+        const pid_t server = startChild([&](int readyFd) {
+            return serveFile(ramp, syncPort, 0, true, RtpTarget(), readyFd);
+        });
+        int rc = 1;
+        if (server) {
+            rc = runSyncProbe("127.0.0.1", syncPort, clients, duration, server,
+                              parser.value(jsonOpt), out);
+            stopChildren(QVector<pid_t>() << server);
+        } else {
+            QTextStream(stderr) << "embedded server did not start" << Qt::endl;
+        }
+        QFile::remove(ramp);
+        return rc;
+    }
+
+    qint64 serverPid = parser.isSet(pidOpt) ? parser.value(pidOpt).toLongLong() : 0;
+    pid_t child = 0;
+    if (parser.isSet(serveOpt)) {
+        // 서버를 따로 재려면 프로세스를 나눠야 한다 (스레드를 만들기 전에 fork)
+        const quint16 framedPort = raw ? StreamProtocol::DefaultPort : port;
+        const quint16 rawPort = raw ? port : StreamProtocol::DefaultRawPort;
+        child = startChild([&](int readyFd) {
+            return serveFile(parser.value(serveOpt), framedPort, rawPort,
+                             !parser.isSet(copyOpt), rtp, readyFd);
+        });
+        if (!child) {
+            QTextStream(stderr) << "embedded server did not start" << Qt::endl;
+            return 1;
+        }
+        serverPid = child;
+    }
+
+    if (!rtp.group.isEmpty()) {
+        QVector<int> receivers;
+        for (const QString &n : parser.value(receiversOpt).split(','))
+            receivers.append(qBound(1, n.toInt(), 1000));
+        const int rc = runRtpProbe(rtp, duration, parser.value(lossOpt).toDouble(),
+                                   parser.value(burstOpt).toDouble(), receivers, serverPid,
+                                   parser.value(jsonOpt), out);
+        if (child > 0) {
+            kill(child, SIGTERM);
+            waitpid(child, nullptr, 0);
+        }
+        return rc;
+    }
+
+
+    out << QString("%1 %2 clients -> %3:%4, %5 threads, %6 s, ramp %7/s")
+           .arg(clients).arg(raw ? "raw" : "framed").arg(host).arg(port)
+           .arg(threads).arg(duration).arg(ramp) << Qt::endl;
+
+    // 클라이언트를 스레드에 번갈아 나눈다 (접속 순서가 스레드 사이에 고르게)
+    const qint64 startNs = StreamProtocol::clockNs() + 100 * 1000000LL;
+    const qint64 endNs = startNs + qint64(duration * 1e9);
+    QVector<LoadWorker *> workers;
+    for (int t = 0; t < threads; ++t) {
+        QVector<int> indices;
+        for (int i = t; i < clients; i += threads)
+            indices.append(i);
+        workers.append(new LoadWorker(host, port, raw, indices, startNs, ramp, endNs));
+    }
+    for (LoadWorker *w : workers)
+        w->start();
+
+    // 서버 CPU / RSS / 시스템 콜 수는 250ms 마다
+    ProcSample first, last;
+    qint64 peakRssKb = 0;
+    double firstNs = 0, lastNs = 0;
+    SyscallCounter syscalls(serverPid);
+    quint64 firstSyscalls = 0, lastSyscalls = 0;
+    while (StreamProtocol::clockNs() < endNs) {
+        usleep(250000);
+        if (!serverPid)
+            continue;
+        const ProcSample s = sampleProcess(serverPid);
+        if (!s.ok)
+            continue;
+        const quint64 calls = syscalls.count();
+        if (!first.ok) {
+            first = s;
+            firstNs = StreamProtocol::clockNs();
+            firstSyscalls = calls;
+        }
+        last = s;
+        lastNs = StreamProtocol::clockNs();
+        lastSyscalls = calls;
+        peakRssKb = qMax(peakRssKb, s.rssKb);
+    }
+
+    QVector<ClientResult> results(clients);
+    for (LoadWorker *w : workers) {
+        w->wait();
+        for (const ClientResult &r : w->results())
+            results[r.index] = r;
+        delete w;
+    }
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, nullptr, 0);
+    }
+
+    // 요약
+    int connected = 0, closed = 0, failed = 0;
+    quint64 gaps = 0;
+    QVector<double> kbps, jitter, startup, maxGap;
+    for (const ClientResult &r : results) {
+        if (!r.connected) {
+            ++failed;
+            continue;
+        }
+        ++connected;
+        if (r.closedByServer)
+            ++closed;
+        gaps += r.sequenceGaps;
+        kbps.append(r.kbps);
+        jitter.append(r.jitterMs);
+        maxGap.append(r.maxGapMs);
+        if (r.startupMs >= 0)
+            startup.append(r.startupMs);
+    }
+    const Dist kbpsD = distribution(kbps), jitterD = distribution(jitter);
+    const Dist startupD = distribution(startup), gapD = distribution(maxGap);
+    const double cpuSeconds = last.cpuSeconds - first.cpuSeconds;
+    const double cpuPercent = lastNs > firstNs ? 100.0 * cpuSeconds / ((lastNs - firstNs) / 1e9) : 0.0;
+    // 스트림 하나가 코어 하나의 몇 % 를 쓰는지 (sendfile / --copy 비교 지표)
+    const double cpuPerStream = connected > 0 ? cpuPercent / connected : 0.0;
+    const double syscallRate = syscalls.isValid() && lastNs > firstNs
+            ? (lastSyscalls - firstSyscalls) / ((lastNs - firstNs) / 1e9) : -1.0;
+
+    out << QString("connected %1, failed %2, closed by server %3, dropped packets %4")
+           .arg(connected).arg(failed).arg(closed).arg(gaps) << Qt::endl;
+    out << "throughput kbps  " << toText(kbpsD) << Qt::endl;
+    out << "jitter ms        " << toText(jitterD) << Qt::endl;
+    out << "startup ms       " << toText(startupD) << Qt::endl;
+    out << "max gap ms       " << toText(gapD) << Qt::endl;
+    if (first.ok)
+        out << QString("server cpu %1% (%2 s), peak rss %3 MB")
+               .arg(cpuPercent, 0, 'f', 1).arg(cpuSeconds, 0, 'f', 2)
+               .arg(peakRssKb / 1024.0, 0, 'f', 1) << Qt::endl;
+    if (first.ok && connected > 0)
+        out << QString("server cpu per stream %1% (%2)")
+               .arg(cpuPerStream, 0, 'f', 3)
+               .arg(!raw ? "framed" : parser.isSet(copyOpt) ? "read+send" : "sendfile") << Qt::endl;
+    if (syscallRate >= 0 && connected > 0)
+        out << QString("server syscalls %1/s (%2 per client, %3)")
+               .arg(syscallRate, 0, 'f', 0).arg(syscallRate / connected, 0, 'f', 1)
+               .arg(syscalls.source()) << Qt::endl;
+
+    if (parser.isSet(jsonOpt)) {
+        QJsonObject config;
+        config["clients"] = clients;
+        config["mode"] = raw ? "raw" : "framed";
+        config["host"] = host;
+        config["port"] = port;
+        config["threads"] = threads;
+        config["duration"] = duration;
+        config["ramp"] = ramp;
+        config["zeroCopy"] = !parser.isSet(copyOpt);
+
+        QJsonObject server;
+        server["pid"] = serverPid;
+        server["sampled"] = first.ok;
+        server["cpuSeconds"] = cpuSeconds;
+        server["cpuPercent"] = cpuPercent;
+        server["cpuPercentPerStream"] = cpuPerStream;
+        server["peakRssKb"] = peakRssKb;
+        server["syscallsPerSecond"] = syscallRate;
+        server["syscallSource"] = syscalls.source();
+
+        QJsonObject summary;
+        summary["connected"] = connected;
+        summary["failed"] = failed;
+        summary["closedByServer"] = closed;
+        summary["sequenceGaps"] = double(gaps);
+        summary["throughputKbps"] = toJson(kbpsD);
+        summary["jitterMs"] = toJson(jitterD);
+        summary["startupMs"] = toJson(startupD);
+        summary["maxGapMs"] = toJson(gapD);
+
+        QJsonArray list;
+        for (const ClientResult &r : results) {
+            QJsonObject o;
+            o["index"] = r.index;
+            o["connected"] = r.connected;
+            o["closedByServer"] = r.closedByServer;
+            o["connectMs"] = r.connectMs;
+            o["startupMs"] = r.startupMs;
+            o["bytes"] = double(r.bytes);
+            o["packets"] = double(r.packets);
+            o["sequenceGaps"] = double(r.sequenceGaps);
+            o["jitterMs"] = r.jitterMs;
+            o["maxGapMs"] = r.maxGapMs;
+            o["kbps"] = r.kbps;
+            if (!r.error.isEmpty())
+                o["error"] = r.error;
+            list.append(o);
+        }
+
+        QJsonObject root;
+        root["config"] = config;
+        root["server"] = server;
+        root["summary"] = summary;
+        root["clients"] = list;
+        QFile f(parser.value(jsonOpt));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            QTextStream(stderr) << "json: " << f.errorString() << Qt::endl;
+        else
+            f.write(QJsonDocument(root).toJson());
+    }
+
+    if (parser.isSet(csvOpt)) {
+        QFile f(parser.value(csvOpt));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            QTextStream(stderr) << "csv: " << f.errorString() << Qt::endl;
+        } else {
+            QTextStream csv(&f);
+            csv << "index,connected,closed_by_server,connect_ms,startup_ms,bytes,packets,"
+                   "sequence_gaps,jitter_ms,max_gap_ms,kbps,error\n";
+            for (const ClientResult &r : results) {
+                csv << r.index << ',' << int(r.connected) << ',' << int(r.closedByServer) << ','
+                    << r.connectMs << ',' << r.startupMs << ',' << r.bytes << ',' << r.packets << ','
+                    << r.sequenceGaps << ',' << r.jitterMs << ',' << r.maxGapMs << ',' << r.kbps << ','
+                    << r.error << '\n';
+            }
+        }
+    }
+    return failed == 0 ? 0 : 2;
+}
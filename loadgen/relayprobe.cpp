@@ -0,0 +1,167 @@
+#include "relayprobe.h"
+#include "streamprotocol.h"
+#include <QtEndian>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+
+const qint64 kKeepNs = 5 * 1000000000LL;      // 원본 패킷 보관 (체인 지연보다 충분히 길게)
+const qint64 kPruneNs = 1000000000LL;
+
+} // namespace
+
+RelayProbe::RelayProbe()
+    : m_startNs(0)
+{
+}
+
+RelayProbe::~RelayProbe()
+{
+    for (const Hop &h : m_hops) {
+        if (h.fd >= 0)
+            ::close(h.fd);
+    }
+}
+
+bool RelayProbe::open(const QVector<quint16> &ports, QString *error)
+{
+    for (quint16 port : ports) {
+        sockaddr_in sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        Hop hop;
+        hop.fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (hop.fd < 0 || ::connect(hop.fd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0) {
+            *error = QString("Port %1: %2").arg(port).arg(QString::fromLocal8Bit(strerror(errno)));
+            if (hop.fd >= 0)
+                ::close(hop.fd);
+            return false;
+        }
+        hop.in.resize(64 * 1024);
+        m_hops.append(hop);
+        RelayHopResult r;
+        r.port = port;
+        m_results.append(r);
+    }
+    return true;
+}
+
+void RelayProbe::run(qint64 endNs)
+{
+    QVector<pollfd> fds;
+    for (const Hop &h : m_hops)
+        fds.append({ h.fd, POLLIN, 0 });
+    m_startNs = StreamProtocol::clockNs();
+    qint64 nextPruneNs = m_startNs + kPruneNs;
+    for (;;) {
+        qint64 now = StreamProtocol::clockNs();
+        if (now >= endNs)
+            break;
+        poll(fds.data(), nfds_t(fds.size()), int((endNs - now + 999999) / 1000000));
+        now = StreamProtocol::clockNs();
+        // 원본부터 읽어야 같은 poll 에서 온 릴레이 패킷이 원본을 찾는다
+        for (int i = 0; i < fds.size(); ++i) {
+            if (fds[i].fd >= 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                    && !readHop(i, now))
+                fds[i].fd = -1;   // 끊긴 단은 그대로 두고 나머지를 계속 잰다
+        }
+        if (now >= nextPruneNs) {
+            prune(now);
+            nextPruneNs = now + kPruneNs;
+        }
+    }
+}
+
+bool RelayProbe::readHop(int index, qint64 nowNs)
+{
+    Hop &h = m_hops[index];
+    for (;;) {
+        if (h.in.size() - h.inUsed < 16 * 1024)
+            h.in.resize(h.in.size() * 2);
+        const ssize_t n = recv(h.fd, h.in.data() + h.inUsed, size_t(h.in.size() - h.inUsed),
+                               MSG_DONTWAIT);
+        if (n == 0)
+            return false;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        h.inUsed += int(n);
+        const int used = parse(index, reinterpret_cast<const uchar *>(h.in.constData()),
+                               h.inUsed, nowNs);
+        if (used < 0)
+            return false;
+        h.inUsed -= used;
+        if (h.inUsed > 0)
+            memmove(h.in.data(), h.in.constData() + used, size_t(h.inUsed));
+    }
+}
+
+// 처리한 바이트 수, 프로토콜 오류면 -1
+int RelayProbe::parse(int index, const uchar *p, int len, qint64 nowNs)
+{
+    int pos = 0;
+    while (len - pos >= StreamProtocol::HeaderSize) {
+        StreamProtocol::Header h;
+        if (!StreamProtocol::readHeader(p + pos, &h))
+            return -1;
+        const qint64 total = qint64(h.headerSize) + h.payloadSize;
+        if (len - pos < total)
+            break;
+        const uchar *payload = p + pos + h.headerSize;
+        if (h.type == StreamProtocol::Format) {
+            m_hops[index].format = true;
+            if (index == 0)
+                m_origin.clear();     // 새 트랙은 firstFrame 이 0 부터
+        } else if (h.type == StreamProtocol::End) {
+            m_hops[index].format = false;
+        } else if (h.type == StreamProtocol::Audio && m_hops[index].format
+                   && h.payloadSize >= StreamProtocol::AudioPrefixSize) {
+            audio(index, qFromLittleEndian<qint64>(payload),
+                  qFromLittleEndian<qint64>(payload + 8), nowNs);
+        }
+        pos += int(total);
+    }
+    return pos;
+}
+
+void RelayProbe::audio(int index, qint64 firstFrame, qint64 presentationNs, qint64 nowNs)
+{
+    RelayHopResult &r = m_results[index];
+    ++r.packets;
+    if (r.firstPacketMs < 0)
+        r.firstPacketMs = (nowNs - m_startNs) / 1e6;
+    r.headroomMs.append((presentationNs - nowNs) / 1e6);
+    if (index == 0) {
+        m_origin.insert(firstFrame, { presentationNs, nowNs });
+        return;
+    }
+    // 원본이 트랙을 다시 시작한 뒤에 온 이전 트랙 꼬리는 짝이 없다
+    const QHash<qint64, Origin>::const_iterator it = m_origin.constFind(firstFrame);
+    if (it == m_origin.constEnd() || it->arrivalNs > nowNs) {
+        ++r.unmatched;
+        return;
+    }
+    r.errorUs.append((presentationNs - it->presentationNs) / 1e3);
+    r.delayMs.append((nowNs - it->arrivalNs) / 1e6);
+}
+
+void RelayProbe::prune(qint64 nowNs)
+{
+    for (QHash<qint64, Origin>::iterator it = m_origin.begin(); it != m_origin.end(); ) {
+        if (nowNs - it->arrivalNs > kKeepNs)
+            it = m_origin.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef RELAYPROBE_H
+#define RELAYPROBE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// 릴레이 체인 시험. 원본 서버와 그 뒤에 줄줄이 물린 릴레이마다 프레임 스트림
+// 클라이언트를 하나씩 붙여, 같은 오디오 패킷 (firstFrame) 이 단마다 어떤 재생
+// 시각 (presentationNs) 으로 나오는지 원본과 비교한다. 모두 같은 호스트라 시계가
+// 같으므로 차이가 그대로 릴레이 시계 동기의 누적 오차다 (단마다 청취자가
+// 원본보다 먼저 / 늦게 울리는 양).
+struct RelayHopResult
+{
+    quint16 port = 0;
+    quint64 packets = 0;              // 받은 오디오 패킷
+    quint64 unmatched = 0;            // 원본에서 못 찾은 패킷 (연결 직후 등)
+    double  firstPacketMs = -1;       // 시작부터 첫 오디오까지 (상위 연결 / 시계 동기 포함)
+    QVector<double> errorUs;          // 이 단 재생 시각 - 원본 재생 시각
+    QVector<double> delayMs;          // 이 단 도착 - 원본 도착 (전달 지연 누적)
+    QVector<double> headroomMs;       // 재생 시각 - 도착 (남은 playout 여유)
+};
+
+class RelayProbe
+{
+public:
+    RelayProbe();
+    ~RelayProbe();
+
+    // ports[0] 이 원본, 나머지가 체인 순서대로의 릴레이 (127.0.0.1)
+    bool open(const QVector<quint16> &ports, QString *error);
+    void run(qint64 endNs);
+    QVector<RelayHopResult> results() const { return m_results; }
+
+private:
+    struct Hop {
+        int        fd = -1;
+        QByteArray in;
+        int        inUsed = 0;
+        bool       format = false;
+    };
+    struct Origin {
+        qint64 presentationNs;
+        qint64 arrivalNs;
+    };
+
+    bool readHop(int index, qint64 nowNs);
+    int  parse(int index, const uchar *p, int len, qint64 nowNs);
+    void audio(int index, qint64 firstFrame, qint64 presentationNs, qint64 nowNs);
+    void prune(qint64 nowNs);
+
+    QVector<Hop> m_hops;
+    QHash<qint64, Origin> m_origin;   // 원본의 firstFrame -> 시각 (몇 초만 보관)
+    qint64 m_startNs;
+    QVector<RelayHopResult> m_results;
+
+    Q_DISABLE_COPY(RelayProbe)
+};
+
+#endif // RELAYPROBE_H
@@ -0,0 +1,198 @@
+#include "rtpprobe.h"
+#include "streamprotocol.h"
+#include <QtEndian>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+
+// group:port 를 받는 UDP 소켓. 멀티캐스트 주소면 가입한다
+int bindSocket(const QString &group, quint16 port, QString *error)
+{
+    in_addr addr;
+    if (inet_pton(AF_INET, group.toLatin1().constData(), &addr) != 1) {
+        *error = QString("Invalid RTP address: %1").arg(group);
+        return -1;
+    }
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        *error = QString::fromLocal8Bit(strerror(errno));
+        return -1;
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    const int rcvbuf = 4 * 1024 * 1024;     // 측정 중에 커널에서 버려지지 않게
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+
+    const bool multicast = IN_MULTICAST(ntohl(addr.s_addr));
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = multicast ? addr.s_addr : htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0) {
+        *error = QString("Port %1: %2").arg(port).arg(QString::fromLocal8Bit(strerror(errno)));
+        ::close(fd);
+        return -1;
+    }
+    if (multicast) {
+        ip_mreq mreq;
+        mreq.imr_multiaddr = addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof mreq) != 0) {
+            *error = QString::fromLocal8Bit(strerror(errno));
+            ::close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+} // namespace
+
+RtpProbe::RtpProbe(double lossPercent, double burstLength, quint32 seed)
+    : m_goodToBad(0),
+      m_badToGood(1),
+      m_bad(false),
+      m_random(0x9E3779B97F4A7C15ULL ^ seed),
+      m_mediaFd(-1),
+      m_fecFd(-1),
+      m_haveSeq(false),
+      m_firstSeq(0),
+      m_highSeq(0),
+      m_dropNs(65536, -1),
+      m_decoderNs(0)
+{
+    // 정상 상태의 손실률이 loss, 나쁜 상태에 머무는 평균 길이가 burst 가 되도록
+    const double p = qBound(0.0, lossPercent / 100.0, 0.95);
+    m_badToGood = 1.0 / qMax(1.0, burstLength);
+    m_goodToBad = p * m_badToGood / (1.0 - p);
+}
+
+RtpProbe::~RtpProbe()
+{
+    if (m_mediaFd >= 0)
+        ::close(m_mediaFd);
+    if (m_fecFd >= 0)
+        ::close(m_fecFd);
+}
+
+bool RtpProbe::open(const QString &group, quint16 port, QString *error)
+{
+    m_mediaFd = bindSocket(group, port, error);
+    if (m_mediaFd < 0)
+        return false;
+    m_fecFd = bindSocket(group, quint16(port + 2), error);
+    return m_fecFd >= 0;
+}
+
+bool RtpProbe::drop()
+{
+    // xorshift64
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 7;
+    m_random ^= m_random << 17;
+    const double u = double(m_random >> 11) / double(1ULL << 53);
+    const bool lost = m_bad;
+    m_bad = m_bad ? u >= m_badToGood : u < m_goodToBad;
+    return lost;
+}
+
+void RtpProbe::run(qint64 endNs)
+{
+    for (;;) {
+        const qint64 nowNs = StreamProtocol::clockNs();
+        if (nowNs >= endNs)
+            break;
+        pollfd fds[2] = { { m_mediaFd, POLLIN, 0 }, { m_fecFd, POLLIN, 0 } };
+        const int timeoutMs = int(qMin<qint64>(100, (endNs - nowNs) / 1000000 + 1));
+        if (poll(fds, 2, timeoutMs) < 0 && errno != EINTR)
+            break;
+        if (fds[0].revents & POLLIN)
+            readSocket(m_mediaFd, false);
+        if (fds[1].revents & POLLIN)
+            readSocket(m_fecFd, true);
+    }
+
+    const qint64 expected = m_haveSeq ? m_highSeq - m_firstSeq + 1 : 0;
+    const qint64 delivered = qint64(m_result.received - m_result.dropped + m_result.recovered);
+    m_result.networkLost = quint64(qMax<qint64>(0, expected - qint64(m_result.received)));
+    m_result.residualLost = quint64(qMax<qint64>(0, expected - delivered));
+    const quint64 packets = m_result.received + m_result.fecReceived;
+    m_result.decoderNsPerPacket = packets ? double(m_decoderNs) / packets : 0.0;
+}
+
+void RtpProbe::readSocket(int fd, bool fec)
+{
+    uchar buf[2048];
+    for (;;) {
+        const ssize_t n = recv(fd, buf, sizeof buf, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        const qint64 nowNs = StreamProtocol::clockNs();
+        if (!fec) {
+            media(buf, int(n), nowNs);
+            continue;
+        }
+        ++m_result.fecReceived;
+        m_result.fecBytes += quint64(n);
+        if (drop()) {
+            ++m_result.fecDropped;
+            continue;
+        }
+        const qint64 t0 = StreamProtocol::clockNs();
+        m_decoder.addFec(buf, int(n));
+        m_decoderNs += StreamProtocol::clockNs() - t0;
+        collect(nowNs);
+    }
+}
+
+// 늦게 온 미디어 패킷으로도 기다리던 FEC 가 풀릴 수 있어 양쪽에서 부른다
+void RtpProbe::collect(qint64 nowNs)
+{
+    QByteArray packet;
+    while (m_decoder.takeRecovered(&packet)) {
+        const quint16 seq = qFromBigEndian<quint16>(
+                    reinterpret_cast<const uchar *>(packet.constData()) + 2);
+        ++m_result.recovered;
+        if (m_dropNs[seq] >= 0) {
+            m_result.recoveryMs.append((nowNs - m_dropNs[seq]) / 1e6);
+            m_dropNs[seq] = -1;
+        }
+    }
+}
+
+void RtpProbe::media(const uchar *p, int size, qint64 nowNs)
+{
+    if (size < RtpFecEncoder::RtpHeaderSize)
+        return;
+    const quint16 seq = qFromBigEndian<quint16>(p + 2);
+    if (!m_haveSeq) {
+        m_firstSeq = m_highSeq = seq;
+        m_haveSeq = true;
+    }
+    const qint64 ext = m_highSeq + qint16(quint16(seq - quint16(m_highSeq)));
+    m_highSeq = qMax(m_highSeq, ext);
+    ++m_result.received;
+    m_result.mediaBytes += quint64(size);
+
+    if (drop()) {
+        ++m_result.dropped;
+        m_dropNs[seq] = nowNs;
+        return;
+    }
+    m_dropNs[seq] = -1;
+    const qint64 t0 = StreamProtocol::clockNs();
+    m_decoder.addMedia(p, size);
+    m_decoderNs += StreamProtocol::clockNs() - t0;
+    collect(nowNs);
+}
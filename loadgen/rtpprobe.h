@@ -0,0 +1,59 @@
+#ifndef RTPPROBE_H
+#define RTPPROBE_H
+
+#include <QVector>
+#include <QString>
+#include "rtpfec.h"
+
+// RTP 수신 손실 시험. 미디어 포트와 FEC 포트 (port + 2) 를 받으면서 Wi-Fi 처럼
+// 몰려서 잃는 손실 (Gilbert 모델: 평균 loss, 평균 burst 길이) 을 일부러 만들고
+// RtpFecDecoder 가 얼마나 되살리는지, 그 비용 (CPU, 지연) 은 얼마인지 잰다.
+struct RtpProbeResult
+{
+    quint64 received = 0;             // 도착한 미디어 패킷 (버리기 전)
+    quint64 fecReceived = 0;
+    quint64 dropped = 0;              // 일부러 버린 미디어 패킷
+    quint64 fecDropped = 0;
+    quint64 recovered = 0;
+    quint64 networkLost = 0;          // 시험과 무관하게 오지 않은 패킷 (seq 빈틈)
+    quint64 residualLost = 0;         // 복구 후에도 없는 패킷
+    quint64 mediaBytes = 0;
+    quint64 fecBytes = 0;
+    double  decoderNsPerPacket = 0;   // 디코더에서 보낸 시간 / 받은 패킷 (순수 계산이라 CPU 와 같음)
+    QVector<double> recoveryMs;       // 원본이 도착했을 시각부터 복구까지
+};
+
+class RtpProbe
+{
+public:
+    RtpProbe(double lossPercent, double burstLength, quint32 seed = 1);
+    ~RtpProbe();
+
+    bool open(const QString &group, quint16 port, QString *error);
+    void run(qint64 endNs);
+    RtpProbeResult result() const { return m_result; }
+
+private:
+    bool drop();
+    void readSocket(int fd, bool fec);
+    void media(const uchar *p, int size, qint64 nowNs);
+    void collect(qint64 nowNs);
+
+    double  m_goodToBad;
+    double  m_badToGood;
+    bool    m_bad;
+    quint64 m_random;
+    int     m_mediaFd;
+    int     m_fecFd;
+    RtpFecDecoder m_decoder;
+    bool    m_haveSeq;
+    qint64  m_firstSeq;               // 확장 seq
+    qint64  m_highSeq;
+    QVector<qint64> m_dropNs;         // seq % 65536 -> 버린 시각 (-1 이면 없음)
+    qint64  m_decoderNs;
+    RtpProbeResult m_result;
+
+    Q_DISABLE_COPY(RtpProbe)
+};
+
+#endif // RTPPROBE_H
@@ -0,0 +1,93 @@
+#include "syscallcounter.h"
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+namespace {
+
+// tracefs 는 배포판마다 붙는 자리가 다르다
+qint64 sysEnterId()
+{
+    static const char *const paths[] = {
+        "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+    };
+    for (const char *path : paths) {
+        QFile f(path);
+        if (f.open(QIODevice::ReadOnly))
+            return f.readAll().trimmed().toLongLong();
+    }
+    return -1;
+}
+
+} // namespace
+
+SyscallCounter::SyscallCounter(qint64 pid)
+    : m_pid(pid)
+{
+    if (openPerf()) {
+        m_source = "perf";
+        return;
+    }
+    if (QFile(QString("/proc/%1/io").arg(pid)).open(QIODevice::ReadOnly))
+        m_source = "proc-io";
+}
+
+SyscallCounter::~SyscallCounter()
+{
+    for (int fd : m_fds)
+        ::close(fd);
+}
+
+bool SyscallCounter::openPerf()
+{
+    const qint64 id = sysEnterId();
+    if (id < 0)
+        return false;
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof attr;
+    attr.config = quint64(id);
+    const QStringList tasks = QDir(QString("/proc/%1/task").arg(m_pid))
+            .entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &tid : tasks) {
+        const int fd = int(syscall(SYS_perf_event_open, &attr, tid.toInt(), -1, -1,
+                                   PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0) {
+            for (int open : m_fds)
+                ::close(open);
+            m_fds.clear();
+            return false;
+        }
+        m_fds.append(fd);
+    }
+    return !m_fds.isEmpty();
+}
+
+quint64 SyscallCounter::count() const
+{
+    quint64 total = 0;
+    if (!m_fds.isEmpty()) {
+        for (int fd : m_fds) {
+            quint64 n = 0;
+            if (read(fd, &n, sizeof n) == sizeof n)
+                total += n;
+        }
+        return total;
+    }
+    QFile io(QString("/proc/%1/io").arg(m_pid));
+    if (!io.open(QIODevice::ReadOnly))
+        return 0;
+    while (!io.atEnd()) {
+        const QByteArray l = io.readLine();
+        if (l.startsWith("syscr:") || l.startsWith("syscw:"))
+            total += l.mid(6).trimmed().toULongLong();
+    }
+    return total;
+}
@@ -0,0 +1,32 @@
+#ifndef SYSCALLCOUNTER_H
+#define SYSCALLCOUNTER_H
+
+#include <QString>
+#include <QVector>
+
+// 다른 프로세스 (서버) 의 시스템 콜 수. raw_syscalls:sys_enter 트레이스포인트를
+// perf 로 스레드마다 열어 센다 (tracefs 와 perf_event_paranoid 권한 필요). 안 되면
+// /proc/<pid>/io 의 syscr + syscw 로 대신한다. 이쪽은 read / write 계열만 세고
+// send* / recv* / sendmmsg 는 빠지므로 source() 로 어느 쪽인지 같이 낼 것.
+// 스레드는 만들 때의 것만 센다 (서버가 준비된 뒤에 만들 것)
+class SyscallCounter
+{
+public:
+    explicit SyscallCounter(qint64 pid);
+    ~SyscallCounter();
+
+    bool isValid() const { return !m_source.isEmpty(); }
+    QString source() const { return m_source; }   // "perf", "proc-io" 또는 빈 문자열
+    quint64 count() const;
+
+private:
+    bool openPerf();
+
+    qint64 m_pid;
+    QVector<int> m_fds;
+    QString m_source;
+
+    Q_DISABLE_COPY(SyscallCounter)
+};
+
+#endif // SYSCALLCOUNTER_H
@@ -0,0 +1,293 @@
+#include "transportbench.h"
+#include "streamprotocol.h"
+#include <QByteArray>
+#include <QThread>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace {
+
+const int kRingBytes = 1024 * 1024;
+const int kIdleMs = 1000;         // 이만큼 아무것도 안 오면 받기를 끝낸다
+
+qint64 threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+QString systemError(const char *what)
+{
+    return QString("%1: %2").arg(QString::fromLatin1(what))
+            .arg(QString::fromLocal8Bit(strerror(errno)));
+}
+
+sockaddr_in loopback(quint16 port)
+{
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return sa;
+}
+
+// 127.0.0.1 의 빈 포트에 묶고 그 포트를 돌려준다
+int bindLoopback(int type, quint16 *port)
+{
+    const int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    sockaddr_in sa = loopback(0);
+    socklen_t len = sizeof sa;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&sa), sizeof sa) != 0
+            || getsockname(fd, reinterpret_cast<sockaddr *>(&sa), &len) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    *port = ntohs(sa.sin_port);
+    return fd;
+}
+
+} // namespace
+
+class TransportBench::Reader : public QThread
+{
+public:
+    explicit Reader(TransportBench *bench) : m_bench(bench) {}
+
+protected:
+    void run() override { m_bench->receive(); }
+
+private:
+    TransportBench *m_bench;
+};
+
+TransportBench::TransportBench()
+    : m_transport(Shm),
+      m_bytes(0),
+      m_expected(0),
+      m_sendFd(-1),
+      m_recvFd(-1)
+{
+}
+
+TransportBench::~TransportBench()
+{
+    close();
+}
+
+bool TransportBench::parseTransport(const QString &name, Transport *transport)
+{
+    if (name == "shm")
+        *transport = Shm;
+    else if (name == "tcp")
+        *transport = Tcp;
+    else if (name == "udp")
+        *transport = Udp;
+    else
+        return false;
+    return true;
+}
+
+void TransportBench::close()
+{
+    m_writer.close();
+    m_reader.close();
+    if (m_sendFd >= 0)
+        ::close(m_sendFd);
+    if (m_recvFd >= 0)
+        ::close(m_recvFd);
+    m_sendFd = m_recvFd = -1;
+}
+
+bool TransportBench::open(Transport transport, int packetBytes, QString *error)
+{
+    close();
+    m_transport = transport;
+    m_bytes = qMax(int(2 * sizeof(qint64)), packetBytes);
+    m_result = TransportBenchResult();
+
+    switch (transport) {
+    case Shm: {
+        // 서버와 같은 방법: fd 는 unix 소켓으로 넘기고 소켓은 그 뒤로 쓰지 않는다
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+            *error = systemError("socketpair");
+            return false;
+        }
+        const bool ok = m_writer.create(kRingBytes) && m_writer.sendTo(sv[0])
+                && m_reader.attach(sv[1]);
+        ::close(sv[0]);
+        ::close(sv[1]);
+        if (!ok) {
+            *error = !m_writer.errorString().isEmpty() ? m_writer.errorString()
+                                                      : m_reader.errorString();
+            return false;
+        }
+        return true;
+    }
+    case Tcp: {
+        // 서버처럼 accept 한 쪽이 보내고 (TCP_NODELAY), 클라이언트가 받는다
+        quint16 port = 0;
+        const int listener = bindLoopback(SOCK_STREAM, &port);
+        if (listener < 0 || listen(listener, 1) != 0) {
+            *error = systemError("tcp listen");
+            if (listener >= 0)
+                ::close(listener);
+            return false;
+        }
+        m_recvFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const sockaddr_in sa = loopback(port);
+        if (m_recvFd < 0
+                || ::connect(m_recvFd, reinterpret_cast<const sockaddr *>(&sa), sizeof sa) != 0
+                || (m_sendFd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)) < 0) {
+            *error = systemError("tcp connect");
+            ::close(listener);
+            close();
+            return false;
+        }
+        ::close(listener);
+        const int one = 1;
+        setsockopt(m_sendFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        return true;
+    }
+    case Udp: {
+        quint16 port = 0;
+        m_recvFd = bindLoopback(SOCK_DGRAM, &port);
+        m_sendFd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        const sockaddr_in sa = loopback(port);
+        if (m_recvFd < 0 || m_sendFd < 0
+                || ::connect(m_sendFd, reinterpret_cast<const sockaddr *>(&sa), sizeof sa) != 0) {
+            *error = systemError("udp");
+            close();
+            return false;
+        }
+        const int rcvbuf = 4 * 1024 * 1024;     // 측정 중에 커널에서 버려지지 않게
+        setsockopt(m_recvFd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+        return true;
+    }
+    }
+    return false;
+}
+
+bool TransportBench::send(const char *data)
+{
+    if (m_transport == Shm) {
+        // 엔진처럼 write 로 넣고 notify 는 받는 쪽이 잠들어 있을 때만 시스템 콜
+        if (!m_writer.write(data, m_bytes)) {
+            ++m_result.ringFull;
+            return false;
+        }
+        m_writer.notify();
+        return true;
+    }
+    ssize_t n;
+    do {
+        n = ::send(m_sendFd, data, size_t(m_bytes), MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == m_bytes;
+}
+
+void TransportBench::run(int packets, int intervalUs)
+{
+    m_expected = quint64(qMax(0, packets));
+    Reader reader(this);
+    reader.start();
+
+    QByteArray packet(m_bytes, '\0');
+    qint64 sendNs = 0;
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int i = 0; i < packets; ++i) {
+        next.tv_nsec += long(intervalUs) * 1000;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            ++next.tv_sec;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) {}
+
+        const qint64 seq = i;
+        const qint64 now = StreamProtocol::clockNs();
+        memcpy(packet.data(), &now, sizeof now);
+        memcpy(packet.data() + sizeof now, &seq, sizeof seq);
+        const qint64 cpu0 = threadCpuNs();
+        if (send(packet.constData()))
+            ++m_result.sent;
+        sendNs += threadCpuNs() - cpu0;
+    }
+    reader.wait();
+    if (packets > 0)
+        m_result.sendUsPerPacket = sendNs / 1e3 / packets;
+}
+
+void TransportBench::received(const uchar *packet, qint64 nowNs)
+{
+    qint64 sentNs;
+    memcpy(&sentNs, packet, sizeof sentNs);
+    m_result.latencyUs.append((nowNs - sentNs) / 1e3);
+    ++m_result.received;
+}
+
+// 받는 스레드. 모두 받았거나 kIdleMs 동안 조용하면 끝
+void TransportBench::receive()
+{
+    m_result.latencyUs.reserve(int(m_expected));
+    const qint64 cpu0 = threadCpuNs();
+    QByteArray buf(m_transport == Tcp ? 64 * 1024 : m_bytes, '\0');
+    int have = 0;                         // tcp: buf 에 남은 조각
+
+    while (m_result.received < m_expected) {
+        if (m_transport == Shm) {
+            // 링 안의 패킷을 복사 없이 읽는다. 비었으면 eventfd 로 잔다
+            int size = 0;
+            const uchar *p = m_reader.peek(&size);
+            if (size >= m_bytes) {
+                const qint64 now = StreamProtocol::clockNs();
+                const int n = size / m_bytes;
+                for (int i = 0; i < n; ++i)
+                    received(p + i * m_bytes, now);
+                m_reader.consume(n * m_bytes);
+                continue;
+            }
+            if (!m_reader.prepareWait())
+                continue;
+            pollfd pfd = { m_reader.eventFd(), POLLIN, 0 };
+            if (poll(&pfd, 1, kIdleMs) <= 0)
+                break;
+            m_reader.clearEvent();
+            continue;
+        }
+
+        pollfd pfd = { m_recvFd, POLLIN, 0 };
+        if (poll(&pfd, 1, kIdleMs) <= 0)
+            break;
+        const ssize_t n = recv(m_recvFd, buf.data() + have, size_t(buf.size() - have), 0);
+        if (n <= 0)
+            break;
+        const qint64 now = StreamProtocol::clockNs();
+        if (m_transport == Udp) {
+            if (n == m_bytes)
+                received(reinterpret_cast<const uchar *>(buf.constData()), now);
+            continue;
+        }
+        // tcp 는 바이트 흐름이라 패킷 경계를 직접 나눈다
+        have += int(n);
+        int off = 0;
+        for (; have - off >= m_bytes; off += m_bytes)
+            received(reinterpret_cast<const uchar *>(buf.constData()) + off, now);
+        memmove(buf.data(), buf.constData() + off, size_t(have - off));
+        have -= off;
+    }
+    if (m_result.received)
+        m_result.recvUsPerPacket = (threadCpuNs() - cpu0) / 1e3 / m_result.received;
+}
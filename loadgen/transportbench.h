@@ -0,0 +1,58 @@
+#ifndef TRANSPORTBENCH_H
+#define TRANSPORTBENCH_H
+
+#include <QVector>
+#include <QString>
+#include "shmring.h"
+
+// 같은 호스트 전송 비교 (--transport-bench). 보내는 쪽은 주기마다 패킷 앞에 송신
+// 시각을 넣어 보내고, 받는 스레드는 패킷을 본 시각과의 차이로 지연을 잰다.
+// shm 은 서버 엔진과 같은 ShmRing (write + notify / peek + consume, 잠들 때만
+// eventfd), tcp / udp 는 루프백 소켓이다. CPU 는 스레드 CPU 시계로 재고,
+// 보내는 쪽은 보내는 호출만, 받는 쪽은 깨어나는 비용까지 모두 센다.
+struct TransportBenchResult
+{
+    quint64 sent = 0;
+    quint64 received = 0;
+    quint64 ringFull = 0;             // shm: 링에 자리가 없어 못 보낸 패킷
+    double  sendUsPerPacket = 0;
+    double  recvUsPerPacket = 0;
+    QVector<double> latencyUs;        // 송신 시각 -> 받는 쪽이 패킷을 본 시각
+};
+
+class TransportBench
+{
+public:
+    enum Transport { Shm, Tcp, Udp };
+
+    TransportBench();
+    ~TransportBench();
+
+    static bool parseTransport(const QString &name, Transport *transport);
+
+    bool open(Transport transport, int packetBytes, QString *error);
+    // packets 개를 intervalUs 마다 보내고 받는 스레드가 끝날 때까지 기다린다
+    void run(int packets, int intervalUs);
+    TransportBenchResult result() const { return m_result; }
+
+private:
+    class Reader;
+
+    bool send(const char *data);
+    void receive();
+    void received(const uchar *packet, qint64 nowNs);
+    void close();
+
+    Transport m_transport;
+    int       m_bytes;
+    quint64   m_expected;
+    ShmRing   m_writer;
+    ShmRing   m_reader;
+    int       m_sendFd;
+    int       m_recvFd;
+    TransportBenchResult m_result;
+
+    Q_DISABLE_COPY(TransportBench)
+};
+
+#endif // TRANSPORTBENCH_H
@@ -3,6 +3,8 @@
 
 #include <QSlider>
 #include <QMouseEvent>
+#include <QStyle>
+#include <QStyleOptionSlider>
 
 class ClickableSlider : public QSlider {
     Q_OBJECT
@@ -11,16 +13,25 @@ public:
         : QSlider(orientation, parent) {}
 
 protected:
+    // 손잡이 밖을 누르면 그 자리로 손잡이를 옮긴 뒤 QSlider 에 넘긴다. 손잡이를
+    // 잡은 것과 같아져 그대로 끌 수 있고, 놓을 때 sliderReleased 가 한 번 나온다
     void mousePressEvent(QMouseEvent *ev) override {
-        if (orientation() == Qt::Horizontal) {
-            // 클릭 위치 기준으로 값 계산
-            int x = ev->x();
-            int w = width();
-            double ratio = static_cast<double>(x) / w;
-            int newVal = minimum() + static_cast<int>(ratio * (maximum() - minimum()));
-            setValue(newVal);
-            emit sliderMoved(newVal);         // 드래그 시그널처럼
-            emit sliderPressed();             // 옵션
+        if (orientation() == Qt::Horizontal && ev->button() == Qt::LeftButton) {
+            QStyleOptionSlider opt;
+            initStyleOption(&opt);
+            const QRect groove = style()->subControlRect(QStyle::CC_Slider, &opt,
+                                                         QStyle::SC_SliderGroove, this);
+            const QRect handle = style()->subControlRect(QStyle::CC_Slider, &opt,
+                                                         QStyle::SC_SliderHandle, this);
+            if (!handle.contains(ev->pos())) {
+                // 클릭 위치 기준으로 값 계산 (손잡이 폭 반영)
+                int newVal = QStyle::sliderValueFromPosition(
+                            minimum(), maximum(),
+                            ev->x() - groove.x() - handle.width() / 2,
+                            groove.width() - handle.width(), opt.upsideDown);
+                setValue(newVal);
+                emit sliderMoved(newVal);     // 드래그 시그널처럼
+            }
         }
         QSlider::mousePressEvent(ev);
     }
@@ -0,0 +1,456 @@
+#include "librarymodel.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QList>
+#include <algorithm>
+#include "audiosource.h"
+
+namespace {
+
+const int kMaxQueued = 256;         // 헤더 읽기 요청 상한 (빨리 넘긴 행은 버린다)
+const int kMaxRuns   = 256;         // 바뀐 구간이 이보다 많으면 그냥 리셋
+
+// 목록과 검색에 쓰는 이름: 라이브러리 루트 아래 상대 경로
+QStringRef displayPath(const QString &root, const LibraryEntry &e)
+{
+    if (!root.isEmpty() && e.path.startsWith(root) && e.path.size() > root.size()
+            && e.path.at(root.size()) == '/')
+        return e.path.midRef(root.size() + 1);
+    return e.path.midRef(0);
+}
+
+QString formatDuration(double seconds)
+{
+    const qint64 s = qint64(seconds + 0.5);
+    return QString("%1:%2").arg(s / 60, 2, 10, QChar('0')).arg(s % 60, 2, 10, QChar('0'));
+}
+
+} // namespace
+
+// 보이는 행의 헤더를 읽는 스레드. 요청은 나중 것부터 (지금 화면에 있는 행),
+// 결과는 모아 두었다가 큐 호출 한 번으로 모델에 알린다.
+class MetadataLoader : public QThread
+{
+public:
+    struct Result {
+        QString   path;
+        bool      ok = false;
+        bool      dropped = false;   // 읽지 않고 버린 요청 (다시 보이면 또 요청)
+        AudioInfo info;
+    };
+
+    explicit MetadataLoader(QObject *model)
+        : QThread(model), m_model(model), m_stop(false) {}
+
+    void request(const QString &path)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_queue.append(path);
+        if (m_queue.size() > kMaxQueued) {
+            Result r;
+            r.path = m_queue.takeFirst();
+            r.dropped = true;
+            deliver(r);
+        }
+        m_wake.wakeOne();
+    }
+
+    QList<Result> take()
+    {
+        QMutexLocker lock(&m_mutex);
+        QList<Result> out;
+        out.swap(m_results);
+        return out;
+    }
+
+    void stop()
+    {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_stop = true;
+            m_wake.wakeOne();
+        }
+        wait();
+    }
+
+protected:
+    void run() override
+    {
+        QMutexLocker lock(&m_mutex);
+        for (;;) {
+            while (m_queue.isEmpty() && !m_stop)
+                m_wake.wait(&m_mutex);
+            if (m_stop)
+                return;
+            Result r;
+            r.path = m_queue.takeLast();
+            lock.unlock();
+            r.ok = probeAudioFile(r.path, &r.info);
+            lock.relock();
+            deliver(r);
+        }
+    }
+
+private:
+    // m_mutex 를 쥐고 부른다
+    void deliver(const Result &r)
+    {
+        const bool first = m_results.isEmpty();
+        m_results.append(r);
+        if (first)
+            QMetaObject::invokeMethod(m_model, "onMetadataLoaded", Qt::QueuedConnection);
+    }
+
+    QObject       *m_model;
+    QMutex         m_mutex;
+    QWaitCondition m_wake;
+    QStringList    m_queue;
+    QList<Result>  m_results;
+    bool           m_stop;
+};
+
+// 검색 색인은 100만 항목에 1초 남짓 걸려 GUI 스레드 밖에서 만든다
+class SearchBuilder : public QThread
+{
+public:
+    explicit SearchBuilder(QObject *parent) : QThread(parent), m_generation(0) {}
+    ~SearchBuilder() { cancel(); }
+
+    void build(const LibraryIndex &library, int generation)
+    {
+        cancel();
+        m_library = library;
+        m_generation = generation;
+        m_cancel.store(0);
+        start(QThread::LowPriority);
+    }
+
+    void cancel()
+    {
+        m_cancel.store(1);
+        wait();
+    }
+
+    // 끝난 뒤에만 부른다
+    int generation() const { return m_generation; }
+    TrackSearch result() const { return m_search; }
+
+protected:
+    void run() override
+    {
+        const QVector<LibraryEntry> &entries = m_library.entries();
+        const QString root = m_library.root();
+        int bytes = 0;
+        for (const LibraryEntry &e : entries)
+            bytes += e.path.size() + 1;
+        m_search.clear();
+        m_search.reserve(entries.size(), bytes);
+        for (int i = 0; i < entries.size(); ++i) {
+            if ((i & 4095) == 0 && m_cancel.load())
+                break;
+            m_search.add(displayPath(root, entries.at(i)).toString());
+        }
+        m_library = LibraryIndex();     // 모델이 고칠 때 복사되지 않게 놓아 준다
+    }
+
+private:
+    LibraryIndex m_library;
+    TrackSearch  m_search;
+    int          m_generation;
+    QAtomicInt   m_cancel;
+};
+
+// updateLibrary 가 구간마다 알리는 동안 뷰가 보는 행: [0, splitNew) 는 새 목록,
+// 그 뒤는 옛 목록의 splitOld 번째 행부터
+struct LibraryModel::Splice
+{
+    LibraryIndex library;
+    QVector<int> rows;
+    bool filtered = false;
+    int  count = 0;                 // 옛 행 수
+    int  splitNew = 0;
+    int  splitOld = 0;
+
+    int entryAt(int row) const { return filtered ? rows.at(row) : row; }
+};
+
+// ---------------------------------------------------------------------------
+
+LibraryModel::LibraryModel(QObject *parent)
+    : QAbstractListModel(parent),
+      m_searchReady(false),
+      m_generation(0),
+      m_filtered(false),
+      m_loader(new MetadataLoader(this)),
+      m_builder(new SearchBuilder(this)),
+      m_thumbnailer(new Thumbnailer(this)),
+      m_splice(nullptr)
+{
+    connect(m_builder, &QThread::finished, this, &LibraryModel::onSearchBuilt);
+    connect(m_thumbnailer, &Thumbnailer::ready, this, &LibraryModel::onThumbnailsReady);
+    m_loader->start(QThread::LowPriority);
+}
+
+LibraryModel::~LibraryModel()
+{
+    m_loader->stop();
+    m_builder->cancel();
+}
+
+void LibraryModel::setLibrary(const LibraryIndex &library)
+{
+    beginResetModel();
+    m_library = library;
+    m_requested.clear();
+    m_searchReady = false;
+    m_filtered = false;
+    m_rows.clear();
+    ++m_generation;
+    applyFilter();
+    endResetModel();
+    m_builder->build(m_library, m_generation);
+}
+
+void LibraryModel::updateLibrary(const LibraryIndex &library)
+{
+    Splice old;
+    old.library = m_library;
+    old.rows = m_rows;
+    old.filtered = m_filtered;
+    old.count = rowCount();
+
+    m_library = library;
+    m_requested.clear();
+    m_searchReady = false;
+    m_filtered = false;
+    m_rows.clear();
+    ++m_generation;
+    applyFilter();
+    const int count = rowCount();
+
+    // 둘 다 경로 순이므로 맞춰 보며 연속된 추가 / 삭제 구간을 모은다
+    struct Run { bool insert; int row; int old; int count; };
+    QVector<Run> runs;
+    QVector<int> changed;
+    const QVector<LibraryEntry> &entries = m_library.entries();
+    const QVector<LibraryEntry> &oldEntries = old.library.entries();
+    int p = 0, q = 0;
+    while ((p < count || q < old.count) && runs.size() <= kMaxRuns) {
+        const LibraryEntry *n = p < count ? &entries.at(entryAt(p)) : nullptr;
+        const LibraryEntry *o = q < old.count ? &oldEntries.at(old.entryAt(q)) : nullptr;
+        if (n && o && n->path == o->path) {
+            if (n->size != o->size || n->mtimeNs != o->mtimeNs || n->frameCount != o->frameCount)
+                changed.append(p);
+            ++p;
+            ++q;
+            continue;
+        }
+        const bool insert = !o || (n && n->path < o->path);
+        if (!runs.isEmpty() && runs.last().insert == insert
+                && runs.last().row + (insert ? runs.last().count : 0) == p
+                && runs.last().old + (insert ? 0 : runs.last().count) == q)
+            ++runs.last().count;
+        else
+            runs.append(Run{insert, p, q, 1});
+        if (insert)
+            ++p;
+        else
+            ++q;
+    }
+
+    m_splice = &old;                    // 알리기 전까지 뷰에는 옛 행이 보인다
+    if (runs.size() > kMaxRuns) {
+        beginResetModel();
+        m_splice = nullptr;
+        endResetModel();
+    } else {
+        for (const Run &r : runs) {
+            old.splitNew = r.row;
+            old.splitOld = r.old;
+            if (r.insert) {
+                beginInsertRows(QModelIndex(), r.row, r.row + r.count - 1);
+                old.splitNew += r.count;
+                endInsertRows();
+            } else {
+                beginRemoveRows(QModelIndex(), r.row, r.row + r.count - 1);
+                old.splitOld += r.count;
+                endRemoveRows();
+            }
+        }
+        m_splice = nullptr;
+        for (int k = 0; k < changed.size();) {
+            int last = k;
+            while (last + 1 < changed.size() && changed.at(last + 1) == changed.at(last) + 1)
+                ++last;
+            emit dataChanged(index(changed.at(k)), index(changed.at(last)));
+            k = last + 1;
+        }
+    }
+    m_builder->build(m_library, m_generation);
+}
+
+const LibraryEntry &LibraryModel::rowEntry(int row) const
+{
+    if (m_splice && row >= m_splice->splitNew) {
+        const int old = row - m_splice->splitNew + m_splice->splitOld;
+        return m_splice->library.entries().at(m_splice->entryAt(old));
+    }
+    return m_library.entries().at(entryAt(row));
+}
+
+const LibraryEntry *LibraryModel::entry(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return nullptr;
+    return &rowEntry(index.row());
+}
+
+void LibraryModel::setFilter(const QString &text)
+{
+    if (text == m_filter)
+        return;
+    m_filter = text;
+    beginResetModel();
+    applyFilter();
+    endResetModel();
+}
+
+// 앞 필터에 글자를 더 친 경우는 이전 결과 안에서만 확인한다
+void LibraryModel::applyFilter()
+{
+    if (m_filter.isEmpty()) {
+        m_filtered = false;
+        m_rows.clear();
+        m_applied.clear();
+        return;
+    }
+    const bool refine = m_filtered && m_filter.contains(m_applied, Qt::CaseInsensitive);
+    if (m_searchReady) {
+        m_rows = refine ? m_search.refine(m_filter, m_rows) : m_search.find(m_filter);
+    } else {
+        // 검색 색인을 만드는 동안 (목록을 바꾼 직후) 은 그냥 훑는다
+        const QString root = m_library.root();
+        const QVector<LibraryEntry> &entries = m_library.entries();
+        const int n = refine ? m_rows.size() : entries.size();
+        QVector<int> rows;
+        for (int k = 0; k < n; ++k) {
+            const int i = refine ? m_rows.at(k) : k;
+            if (displayPath(root, entries.at(i)).contains(m_filter, Qt::CaseInsensitive))
+                rows.append(i);
+        }
+        m_rows = rows;
+    }
+    m_filtered = true;
+    m_applied = m_filter;
+}
+
+int LibraryModel::rowOf(int entry) const
+{
+    if (!m_filtered)
+        return entry;
+    const QVector<int>::const_iterator it = std::lower_bound(m_rows.constBegin(), m_rows.constEnd(), entry);
+    return (it != m_rows.constEnd() && *it == entry) ? int(it - m_rows.constBegin()) : -1;
+}
+
+int LibraryModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    if (m_splice)
+        return m_splice->splitNew + m_splice->count - m_splice->splitOld;
+    return m_filtered ? m_rows.size() : m_library.size();
+}
+
+QVariant LibraryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return QVariant();
+    const LibraryEntry &e = rowEntry(index.row());
+    switch (role) {
+    case Qt::DisplayRole: {
+        const QString name = displayPath(m_library.root(), e).toString();
+        if (e.codec.isEmpty() && !m_splice)
+            requestMetadata(entryAt(index.row()));
+        if (e.frameCount <= 0)
+            return name + "  [--:--]";
+        return name + "  [" + formatDuration(e.durationSeconds()) + ']';
+    }
+    case Qt::ToolTipRole:
+        if (e.codec.isEmpty())
+            return e.path;
+        return QString("%1\n%2, %3 Hz, %4 ch").arg(e.path).arg(e.codec)
+                .arg(e.sampleRate).arg(e.channels);
+    case PathRole:
+        return e.path;
+    case ThumbnailRole:
+        return m_thumbnailer->find(e);
+    default:
+        return QVariant();
+    }
+}
+
+// 한 목록에서 항목마다 한 번만 (못 읽은 파일을 계속 다시 읽지 않게)
+void LibraryModel::requestMetadata(int entry) const
+{
+    if (m_requested.contains(entry))
+        return;
+    m_requested.insert(entry);
+    m_loader->request(m_library.entries().at(entry).path);
+}
+
+void LibraryModel::onMetadataLoaded()
+{
+    const QList<MetadataLoader::Result> results = m_loader->take();
+    for (const MetadataLoader::Result &r : results) {
+        const int i = m_library.indexOf(r.path);
+        if (i < 0)
+            continue;                   // 그 사이에 목록이 바뀜
+        if (r.dropped) {
+            m_requested.remove(i);
+            continue;
+        }
+        if (!r.ok)
+            continue;
+        m_library.setMetadata(i, r.info);
+        const int row = rowOf(i);
+        if (row >= 0)
+            emit dataChanged(index(row), index(row));
+    }
+}
+
+// 보이는 행부터, 다음에 보일 아래쪽 반 화면까지. 지나간 행의 일은 Thumbnailer 가 버린다
+void LibraryModel::setVisibleRows(int first, int last)
+{
+    QVector<LibraryEntry> wanted;
+    const int count = rowCount();
+    if (m_splice || count == 0 || first < 0 || last < first) {
+        m_thumbnailer->request(wanted);
+        return;
+    }
+    first = qMin(first, count - 1);
+    last = qMin(last + (last - first + 1) / 2, count - 1);
+    wanted.reserve(last - first + 1);
+    for (int row = first; row <= last; ++row)
+        wanted.append(rowEntry(row));
+    m_thumbnailer->request(wanted);
+}
+
+void LibraryModel::onThumbnailsReady(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        const int i = m_library.indexOf(path);
+        const int row = i < 0 ? -1 : rowOf(i);
+        if (row >= 0)
+            emit dataChanged(index(row), index(row), QVector<int>() << ThumbnailRole);
+    }
+}
+
+void LibraryModel::onSearchBuilt()
+{
+    if (m_searchReady || m_builder->isRunning() || m_builder->generation() != m_generation)
+        return;                         // 취소된 것 (새로 만드는 중)
+    m_search = m_builder->result();
+    m_searchReady = true;
+}
@@ -0,0 +1,79 @@
+#ifndef LIBRARYMODEL_H
+#define LIBRARYMODEL_H
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QVector>
+#include "libraryindex.h"
+#include "tracksearch.h"
+#include "thumbnailer.h"
+
+class MetadataLoader;
+class SearchBuilder;
+
+// 라이브러리 색인을 그대로 보여 주는 목록 모델 (QListView + uniformItemSizes 용).
+// 항목마다 객체를 만들지 않고 data() 가 불릴 때 (보이는 행만) 글자를 만든다.
+// 색인에 헤더 정보가 없는 파일은 보일 때 뒤 스레드가 읽어 재생 시간을 채운다.
+// 필터는 TrackSearch 로 찾고, 앞 필터에 글자를 더 치면 이전 결과 안에서만 찾는다.
+// 파형 썸네일은 뷰가 setVisibleRows 로 알려 준 행만 만든다.
+class LibraryModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum {
+        PathRole = Qt::UserRole + 1,
+        ThumbnailRole                  // QByteArray, Thumbnailer::Columns 개의 (min, max)
+    };
+
+    explicit LibraryModel(QObject *parent = nullptr);
+    ~LibraryModel();
+
+    void setLibrary(const LibraryIndex &library);   // 통째로 바꾼다 (검색 색인은 뒤에서)
+    // 다시 훑은 결과로 바꾼다. 더해지고 빠진 행을 연속 구간마다 한 번씩 알리므로
+    // 스크롤 위치와 선택이 그대로 남는다
+    void updateLibrary(const LibraryIndex &library);
+    const LibraryIndex &library() const { return m_library; }
+    const LibraryEntry *entry(const QModelIndex &index) const;
+
+    void setFilter(const QString &text);            // 대소문자 무시 부분 문자열
+    QString filter() const { return m_filter; }
+
+    // 화면에 보이는 행: 이 행들 (과 그 아래 조금) 의 썸네일만 만든다
+    void setVisibleRows(int first, int last);
+    Thumbnailer *thumbnailer() const { return m_thumbnailer; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private slots:
+    void onMetadataLoaded();
+    void onSearchBuilt();
+    void onThumbnailsReady(const QStringList &paths);
+
+private:
+    struct Splice;
+
+    int entryAt(int row) const { return m_filtered ? m_rows.at(row) : row; }
+    const LibraryEntry &rowEntry(int row) const;
+    int rowOf(int entry) const;                     // 필터에 걸러졌으면 -1
+    void applyFilter();
+    void requestMetadata(int entry) const;
+
+    LibraryIndex m_library;
+    TrackSearch  m_search;
+    bool         m_searchReady;    // 지금 m_library 로 만든 검색 색인인지
+    int          m_generation;     // setLibrary 마다 하나씩
+    QString      m_filter;
+    QString      m_applied;        // m_rows 를 만든 필터
+    bool         m_filtered;
+    QVector<int> m_rows;           // 필터에 걸린 항목 (색인 순서)
+    mutable QSet<int> m_requested; // 헤더를 읽으라고 이미 보낸 항목
+    MetadataLoader *m_loader;
+    SearchBuilder  *m_builder;
+    Thumbnailer    *m_thumbnailer;
+    const Splice   *m_splice;      // updateLibrary 가 알리는 동안만
+
+    Q_DISABLE_COPY(LibraryModel)
+};
+
+#endif // LIBRARYMODEL_H
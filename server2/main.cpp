@@ -1,10 +1,75 @@
 // main.cpp
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption multicastOpt("multicast",
+            "Also send RTP (L16) to <group:port>, e.g. 239.255.0.1:5004.", "group:port");
+    QCommandLineOption ttlOpt("ttl", "Multicast TTL (default 1).", "n", "1");
+    QCommandLineOption rtpMsOpt("rtp-ms", "RTP packet duration in ms (default 5).", "ms", "5");
+    QCommandLineOption ifaceOpt("multicast-if", "Local interface address for multicast.", "addr");
+    QCommandLineOption fecOpt("fec",
+            "RTP FEC overhead in percent, sent to port + 2 (default 0 = off).", "percent", "0");
+    QCommandLineOption fecInterleaveOpt("fec-interleave",
+            "Consecutive RTP packets a burst may lose and still be recovered (default 4).", "n", "4");
+    QCommandLineOption rawPortOpt("raw-port",
+            "Raw WAV stream port, 0 to disable (default 5701).", "port", "5701");
+    QCommandLineOption localOpt("local-socket",
+            "Unix socket for same-host clients over shared memory, empty to disable "
+            "(default /tmp/server2-stream.sock).", "path",
+            StreamProtocol::defaultLocalSocketPath());
+    QCommandLineOption daemonOpt("daemon",
+            "Control a running server2d instead of streaming in-process.");
+    QCommandLineOption controlOpt("control",
+            "server2d control socket (implies --daemon, default /tmp/server2d.sock).", "path");
+    parser.addOption(multicastOpt);
+    parser.addOption(ttlOpt);
+    parser.addOption(rtpMsOpt);
+    parser.addOption(ifaceOpt);
+    parser.addOption(fecOpt);
+    parser.addOption(fecInterleaveOpt);
+    parser.addOption(rawPortOpt);
+    parser.addOption(localOpt);
+    parser.addOption(daemonOpt);
+    parser.addOption(controlOpt);
+    parser.process(app);
+
+    // 데몬 모드: 엔진 옵션은 server2d 쪽 설정을 따른다
+    if (parser.isSet(daemonOpt) || parser.isSet(controlOpt)) {
+        ControlClient control;
+        const QString path = parser.isSet(controlOpt) ? parser.value(controlOpt)
+                                                      : ControlProtocol::defaultSocketPath();
+        if (!control.connectToServer(path)) {
+            qCritical() << "server2d:" << control.errorString();
+            return 1;
+        }
+        MainWindow w(&control);
+        w.startStreaming();
+        w.show();
+        return app.exec();
+    }
+
     MainWindow w;
+    if (parser.isSet(multicastOpt)) {
+        const QStringList dest = parser.value(multicastOpt).split(':');
+        const quint16 port = dest.size() > 1 ? quint16(dest.at(1).toUInt()) : 5004;
+        w.streamServer()->setMulticastFec(parser.value(fecOpt).toDouble(),
+                                          parser.value(fecInterleaveOpt).toInt());
+        if (!w.streamServer()->setMulticast(dest.at(0), port,
+                                            parser.value(ttlOpt).toInt(),
+                                            parser.value(rtpMsOpt).toDouble(),
+                                            parser.value(ifaceOpt)))
+            qWarning() << "multicast:" << w.streamServer()->errorString();
+    }
+    w.streamServer()->setRawPort(quint16(parser.value(rawPortOpt).toUInt()));
+    w.streamServer()->setLocalSocket(parser.value(localOpt));
+    w.startStreaming();
     w.show();
     return app.exec();
 }
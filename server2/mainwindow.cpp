@@ -3,33 +3,93 @@
 #include <QFileInfoList>
 #include <QApplication>
 #include <QFile>
+#include <QStatusBar>
+#include <QJsonArray>
+#include <QScrollBar>
+#include "audiosource.h"
 
-static quint32 readUInt32(QDataStream &in) {
-    quint32 val;
-    in >> val;
-    return val;
+namespace {
+
+const int kSliderSteps = 1000;      // 긴 트랙도 초 단위 이하로 옮길 수 있게
+const int kProgressMs  = 50;        // 위치 표시 갱신 주기
+const int kFilterMs    = 80;        // 필터 입력이 멈춘 뒤 이만큼 지나면 거름
+const int kVisibleMs   = 30;        // 스크롤 중 썸네일 요청 간격
+
+QString formatTime(qint64 seconds)
+{
+    return QString("%1:%2").arg(seconds / 60, 2, 10, QChar('0'))
+                           .arg(seconds % 60, 2, 10, QChar('0'));
 }
 
-MainWindow::MainWindow(QWidget *parent)
+} // namespace
+
+MainWindow::MainWindow(ControlClient *control, QWidget *parent)
     : QMainWindow(parent),
-      listWidget(new QListWidget(this)),
+      listView(new QListView(this)),
+      filterEdit(new QLineEdit(this)),
+      filterTimer(new QTimer(this)),
+      visibleTimer(new QTimer(this)),
       stacked(new QStackedWidget(this)),
       titleLabel(new QLabel(this)),
       progressSlider(new ClickableSlider(Qt::Horizontal, this)),
       timeLabel(new QLabel("00:00 / 00:00", this)),
       backButton(new QPushButton("Back", this)),
       timer(new QTimer(this)),
-      currentPosition(0),
-      totalDuration(0)
+      currentFrame(0),
+      totalFrames(0),
+      sampleRate(0),
+      statusPending(false),
+      server(control ? nullptr : new StreamServer(this)),
+      control(control),
+      clientCount(0),
+      libraryPath("/mnt/nfs"),
+      indexPath(LibraryIndex::defaultPath()),
+      thumbnailPath(Thumbnailer::defaultPath(indexPath)),
+      libraryModel(new LibraryModel(this)),
+      scanner(new LibraryScanner(this)),
+      watcher(new LibraryWatcher(this)),
+      rescanPending(false)
 {
     // List page setup
     listPage = new QWidget(this);
     QVBoxLayout *listLayout = new QVBoxLayout(listPage);
     listLayout->addWidget(new QLabel("WAV Files", this));
-    listLayout->addWidget(listWidget);
+    listLayout->addWidget(filterEdit);
+    listLayout->addWidget(listView);
+    filterEdit->setPlaceholderText("Filter");
+    filterEdit->setClearButtonEnabled(true);
+    // 100만 항목도 보이는 행만 그리도록 높이를 한 번만 잰다
+    listView->setModel(libraryModel);
+    listView->setUniformItemSizes(true);
+    listView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    listView->setItemDelegate(new TrackDelegate(listView));
+    // 보이는 행이 바뀌는 모든 경우 (스크롤, 창 크기, 필터, 다시 훑기)
+    visibleTimer->setSingleShot(true);
+    visibleTimer->setInterval(kVisibleMs);
+    connect(visibleTimer, &QTimer::timeout, this, &MainWindow::updateVisibleRows);
+    connect(listView->verticalScrollBar(), &QScrollBar::valueChanged,
+            visibleTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(listView->verticalScrollBar(), &QScrollBar::rangeChanged,
+            visibleTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(libraryModel, &QAbstractItemModel::modelReset,
+            visibleTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(libraryModel, &QAbstractItemModel::rowsInserted,
+            visibleTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(libraryModel, &QAbstractItemModel::rowsRemoved,
+            visibleTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    filterTimer->setSingleShot(true);
+    filterTimer->setInterval(kFilterMs);
+    connect(filterEdit, &QLineEdit::textChanged,
+            filterTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(filterTimer, &QTimer::timeout, this, &MainWindow::onFilterChanged);
+    // 헤더는 목록에 보일 때 모델이 읽으므로 스캔은 stat 만 한다
+    scanner->setProbeFiles(false);
+    scanner->setIndexFile(indexPath);
+    connect(scanner, &QThread::finished, this, &MainWindow::onScanFinished);
+    connect(watcher, &LibraryWatcher::changed, this, &MainWindow::rescanLibrary);
     loadWavList();
-    connect(listWidget, &QListWidget::itemDoubleClicked,
-            this, &MainWindow::onFileDoubleClicked);
+    connect(listView, &QListView::doubleClicked,
+            this, &MainWindow::onTrackActivated);
 
     // Play page setup
     playPage = new QWidget(this);
@@ -41,11 +101,15 @@ MainWindow::MainWindow(QWidget *parent)
     btnLayout->addWidget(backButton);
     btnLayout->addStretch();
     playLayout->addLayout(btnLayout);
-    progressSlider->setRange(0, 100);
+    progressSlider->setRange(0, kSliderSteps);
+    timer->setInterval(kProgressMs);
     connect(timer, &QTimer::timeout, this, &MainWindow::updateProgress);
     connect(backButton, &QPushButton::clicked, this, &MainWindow::onBackClicked);
+    // 끄는 동안은 시간만 미리 보여 주고, 놓을 때 (클릭 포함) 한 번 seek
     connect(progressSlider, &QSlider::sliderMoved,
             this, &MainWindow::onSliderMoved);
+    connect(progressSlider, &QSlider::sliderReleased,
+            this, &MainWindow::onSliderReleased);
 
     // Stacked widget
     stacked->addWidget(listPage);
@@ -59,20 +123,23 @@ MainWindow::MainWindow(QWidget *parent)
 
     // — B/C/D 구역을 세로로 쌓을 컨테이너 —
     QFrame *frameB = new QFrame; frameB->setFrameShape(QFrame::Box);
-    QLabel *lblB = new QLabel("Client1 Connected/Disconnected", frameB);
+    QLabel *lblB = new QLabel("Client1 Disconnected", frameB);
     QVBoxLayout *layB = new QVBoxLayout(frameB);
     layB->addWidget(lblB, 0, Qt::AlignCenter);
 
     QFrame *frameC = new QFrame; frameC->setFrameShape(QFrame::Box);
-    QLabel *lblC = new QLabel("Client2 Connected/Disconnected", frameC);
+    QLabel *lblC = new QLabel("Client2 Disconnected", frameC);
     QVBoxLayout *layC = new QVBoxLayout(frameC);
     layC->addWidget(lblC, 0, Qt::AlignCenter);
 
     QFrame *frameD = new QFrame; frameD->setFrameShape(QFrame::Box);
-    QLabel *lblD = new QLabel("Client3 Connected/Disconnected", frameD);
+    QLabel *lblD = new QLabel("Client3 Disconnected", frameD);
     QVBoxLayout *layD = new QVBoxLayout(frameD);
     layD->addWidget(lblD, 0, Qt::AlignCenter);
 
+    clientLabels[0] = lblB; clientLabels[1] = lblC; clientLabels[2] = lblD;
+    clientIds[0] = clientIds[1] = clientIds[2] = 0;
+
     QWidget *rightWidget = new QWidget;
     QVBoxLayout *rightLayout = new QVBoxLayout(rightWidget);
     rightLayout->setSpacing(0);
@@ -91,136 +158,269 @@ MainWindow::MainWindow(QWidget *parent)
 
     setCentralWidget(central);
     setWindowTitle("WAV Streamer");
+
+    // — 스트리밍 엔진 (별도 스레드, 시그널은 큐로 GUI 스레드에 전달) —
+    if (server) {
+        connect(server, &StreamServer::clientConnected,
+                this, &MainWindow::onClientConnected);
+        connect(server, &StreamServer::clientDisconnected,
+                this, &MainWindow::onClientDisconnected);
+        connect(server, &StreamServer::trackFinished,
+                this, &MainWindow::onTrackFinished);
+    } else {
+        // — 데몬 모드: 같은 패널을 제어 소켓 이벤트로 갱신 —
+        connect(control, &ControlClient::replyReceived,
+                this, &MainWindow::onControlReply);
+        connect(control, &ControlClient::eventReceived,
+                this, &MainWindow::onControlEvent);
+        connect(control, &ControlClient::disconnected,
+                this, &MainWindow::onControlDisconnected);
+    }
 }
 
-MainWindow::~MainWindow() {}
+// 엔진 설정 (멀티캐스트, raw 포트 등) 을 마친 뒤 main 에서 부른다
+bool MainWindow::startStreaming(quint16 port)
+{
+    if (control) {
+        // 지금 붙어 있는 클라이언트로 패널을 채우고 이후는 이벤트로
+        control->sendCommand("subscribe");
+        control->sendCommand("clients");
+        statusBar()->showMessage("Connected to server2d (" + control->socketPath() + ")");
+        return true;
+    }
+    server->setPcmCache(&pcmCache);
+    if (!server->listen(port)) {
+        statusBar()->showMessage("Stream server: " + server->errorString());
+        return false;
+    }
+    statusBar()->showMessage(server->rawPort()
+                             ? QString("Listening on port %1 (raw PCM %2)").arg(port).arg(server->rawPort())
+                             : QString("Listening on port %1").arg(port));
+    return true;
+}
 
+MainWindow::~MainWindow() {
+    if (server)
+        server->close();
+    // 이번에 읽은 재생 시간도 다음 실행 때 쓰도록 저장
+    scanner->cancel();
+    scanner->wait();
+    library.mergeMetadata(libraryModel->library());
+    library.save(indexPath);
+    libraryModel->thumbnailer()->save(thumbnailPath, library);
+}
+
+// 저장해 둔 색인으로 목록을 바로 채우고, 바뀐 것만 뒤에서 다시 훑는다
 void MainWindow::loadWavList() {
-    // QDir::homePath() returns the user's home directory
-    QString path = "/mnt/nfs";
-    QDir dir(path);
-    QStringList filters {"*.wav"};
-    QFileInfoList files = dir.entryInfoList(filters, QDir::Files);
-    for (auto &fi : files) {
-        listWidget->addItem(fi.absoluteFilePath());
-    }
-}
-
-int MainWindow::getWavDuration(const QString &filePath) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly))
-        return 0;
-    QDataStream in(&file);
-    in.setByteOrder(QDataStream::LittleEndian);
-
-    // 1) RIFF 헤더 지나치기
-    in.skipRawData(12);  // "RIFF"+size+"WAVE"
-
-    // 2) fmt 청크 찾기
-    char chunkId[4];
-    quint32 chunkSize;
-    quint16 audioFormat, numChannels, blockAlign, bitsPerSample;
-    quint32 sampleRate, byteRate;
-    while (!file.atEnd()) {
-        in.readRawData(chunkId, 4);
-        chunkSize = readUInt32(in);
-        QString id = QString::fromLatin1(chunkId, 4);
-        if (id == "fmt ") {
-            in >> audioFormat    // 포맷 코드
-               >> numChannels   // 채널 수
-               >> sampleRate    // 샘플레이트
-               >> byteRate ;
-            // 다음 두 값 읽기 (blockAlign, bitsPerSample)
-            in >> blockAlign
-               >> bitsPerSample;
-            // fmt 청크의 남은 바이트(예: fmtSize>16) 스킵
-            int remain = int(chunkSize) - 16;
-            if (remain > 0)
-                in.skipRawData(remain);
-            break;
-        } else {
-            // 다른 청크면 건너뛰기
-            in.skipRawData(chunkSize);
-        }
-    }
+    library.load(indexPath);
+    library.setRoot(libraryPath);
+    libraryModel->thumbnailer()->load(thumbnailPath);
+    libraryModel->setLibrary(library);
+    scanner->scan(libraryPath, library);
+    watcher->start(libraryPath, library);
+}
 
-    // 3) data 청크 찾기
-    quint32 dataSize = 0;
-    while (!file.atEnd()) {
-        in.readRawData(chunkId, 4);
-        chunkSize = readUInt32(in);
-        if (QString::fromLatin1(chunkId,4) == "data") {
-            dataSize = chunkSize;
-            break;
-        }
-        in.skipRawData(chunkSize);
+// 감시가 알린 디렉터리는 다시 읽고, 나머지는 디렉터리 mtime 만 확인한다
+void MainWindow::rescanLibrary() {
+    if (scanner->isRunning()) {
+        rescanPending = true;
+        return;
     }
-    file.close();
+    rescanPending = false;
+    scanner->scan(libraryPath, library, watcher->takeDirty());
+}
 
-    if (sampleRate == 0 || blockAlign == 0)
-        return 0;
+void MainWindow::onFilterChanged() {
+    libraryModel->setFilter(filterEdit->text());
+}
 
-    // 4) 재생 시간 계산
-    double sampleCount = double(dataSize) / blockAlign;
-    double durationSec = sampleCount / sampleRate;
-    return int(durationSec + 0.5);  // 반올림 후 정수 반환
+// 보이는 첫 행과 끝 행 (목록이 화면보다 짧으면 마지막 행까지)
+void MainWindow::updateVisibleRows() {
+    const QRect area = listView->viewport()->rect();
+    const QModelIndex first = listView->indexAt(area.topLeft());
+    if (!first.isValid()) {
+        libraryModel->setVisibleRows(-1, -1);
+        return;
+    }
+    const QModelIndex last = listView->indexAt(QPoint(area.left(), area.bottom()));
+    const int lastRow = last.isValid() ? last.row() : libraryModel->rowCount() - 1;
+    libraryModel->setVisibleRows(first.row(), lastRow);
 }
 
-void MainWindow::onFileDoubleClicked(QListWidgetItem *item) {
-    QString filePath = item->text();
-    totalDuration = getWavDuration(filePath);
-    currentPosition = 0;
+void MainWindow::onScanFinished() {
+    // 색인 파일은 스캔 스레드가 이미 썼다
+    const LibraryScanner::Stats st = scanner->stats();
+    library = scanner->result();
+    watcher->update(library);
+    if (st.modified()) {
+        library.mergeMetadata(libraryModel->library());   // 스캔하는 동안 읽은 재생 시간
+        libraryModel->updateLibrary(library);
+    }
+    const QString error = scanner->saveError();
+    if (!error.isEmpty())
+        statusBar()->showMessage("Library index: " + error);
+    else if (st.modified())
+        statusBar()->showMessage(QString("Library: %1 tracks (%2)")
+                                 .arg(library.size()).arg(st.toString()), 5000);
+    if (rescanPending)
+        rescanLibrary();
+}
+
+void MainWindow::onTrackActivated(const QModelIndex &index) {
+    const LibraryEntry *entry = libraryModel->entry(index);
+    if (!entry)
+        return;
+    const QString filePath = entry->path;
+    // 헤더를 이미 읽었으면 파일을 열지 않는다. 아니면 공용 파서로 헤더만 읽음
+    if (!entry->codec.isEmpty()) {
+        sampleRate = entry->sampleRate;
+        totalFrames = qMax<qint64>(0, entry->frameCount);
+    } else {
+        AudioInfo info;
+        probeAudioFile(filePath, &info);
+        sampleRate = info.sampleRate;
+        totalFrames = qMax<qint64>(0, info.frameCount);
+    }
     titleLabel->setText(QFileInfo(filePath).fileName());
-    progressSlider->setValue(0);
-    int m = totalDuration / 60;
-    int s = totalDuration % 60;
-    timeLabel->setText(QString("00:00 / %1:%2")
-                       .arg(m, 2, 10, QChar('0'))
-                       .arg(s, 2, 10, QChar('0')));
+    showPosition(0);
     stacked->setCurrentWidget(playPage);
-    if (totalDuration > 0)
-        timer->start(1000);
+
+    // 엔진에 넘기면 접속한 모든 클라이언트로 스트리밍 시작
+    if (control) {
+        control->sendCommand("play", filePath);   // 실패는 onControlReply 에서
+        timer->start();
+        return;
+    }
+    AudioSource *source = createAudioSource(filePath);
+    if (source && source->open(filePath)) {
+        server->play(source, filePath);
+    } else {
+        statusBar()->showMessage("Cannot open " + filePath);
+        delete source;
+        return;
+    }
+    timer->start();
 }
 
+// 엔진이 지금 클라이언트에서 들리는 샘플 위치를 알려 준다 (데몬은 status 로)
 void MainWindow::updateProgress() {
-    if (currentPosition < totalDuration) {
-        ++currentPosition;
-        int pct = (currentPosition * 100) / totalDuration;
-        progressSlider->setValue(pct);
-        int cm = currentPosition / 60;
-        int cs = currentPosition % 60;
-        int tm = totalDuration / 60;
-        int ts = totalDuration % 60;
-        timeLabel->setText(
-            QString("%1:%2 / %3:%4")
-            .arg(cm, 2, 10, QChar('0'))
-            .arg(cs, 2, 10, QChar('0'))
-            .arg(tm, 2, 10, QChar('0'))
-            .arg(ts, 2, 10, QChar('0')));
-    } else {
-        timer->stop();
+    if (control) {
+        if (!statusPending)
+            statusPending = control->sendCommand("status");
+        return;
     }
+    showPosition(server->position());
+}
+
+void MainWindow::showPosition(qint64 frame) {
+    currentFrame = frame;
+    if (totalFrames > 0 && !progressSlider->isSliderDown())
+        progressSlider->setValue(int(qMin(frame, totalFrames) * kSliderSteps / totalFrames));
+    const qint64 rate = qMax<quint32>(1, sampleRate);
+    timeLabel->setText(formatTime(frame / rate) + " / " + formatTime(totalFrames / rate));
 }
 
 void MainWindow::onBackClicked() {
     timer->stop();
+    if (control)
+        control->sendCommand("stop");
+    else
+        server->stop();
     stacked->setCurrentWidget(listPage);
 }
 
-// **슬라이더 이동 시 currentPosition 갱신 및 화면 업데이트**
-void MainWindow::onSliderMoved(int percent) {
-    if (totalDuration <= 0) return;
-    // percent(0–100) → 초 단위 위치
-    currentPosition = percent * totalDuration / 100;
-    // 시간 문자열 갱신
-    int cm = currentPosition / 60;
-    int cs = currentPosition % 60;
-    int tm = totalDuration / 60;
-    int ts = totalDuration % 60;
-    timeLabel->setText(
-        QString("%1:%2 / %3:%4")
-        .arg(cm, 2, 10, QChar('0'))
-        .arg(cs, 2, 10, QChar('0'))
-        .arg(tm, 2, 10, QChar('0'))
-        .arg(ts, 2, 10, QChar('0')));
+// 끄는 중: 놓으면 갈 위치의 시간만 보여 준다
+void MainWindow::onSliderMoved(int value) {
+    if (totalFrames <= 0 || !sampleRate) return;
+    const qint64 rate = sampleRate;
+    const qint64 frame = totalFrames * value / kSliderSteps;
+    timeLabel->setText(formatTime(frame / rate) + " / " + formatTime(totalFrames / rate));
+}
+
+// 샘플 단위 seek. 엔진은 타임라인을 끊지 않고 다음 패킷부터 새 위치를 보낸다
+void MainWindow::onSliderReleased() {
+    if (totalFrames <= 0 || !sampleRate || !timer->isActive()) return;
+    const qint64 frame = totalFrames * progressSlider->value() / kSliderSteps;
+    if (control)
+        control->sendCommand("seek", QString::number(double(frame) / sampleRate, 'f', 6));
+    else
+        server->seek(frame);
+    showPosition(frame);
+}
+
+void MainWindow::onTrackFinished() {
+    timer->stop();
+    showPosition(totalFrames);
+}
+
+void MainWindow::onClientConnected(int id, const QString &peer) {
+    // 빈 패널이 있으면 거기에 표시 (세 개를 넘는 클라이언트는 상태바 숫자로만)
+    for (int i = 0; i < 3; ++i) {
+        if (clientIds[i] == 0) {
+            clientIds[i] = id;
+            clientLabels[i]->setText(QString("Client%1 Connected\n%2").arg(i + 1).arg(peer));
+            break;
+        }
+    }
+    statusBar()->showMessage(QString("%1 client(s) connected").arg(++clientCount));
+}
+
+void MainWindow::onClientDisconnected(int id) {
+    for (int i = 0; i < 3; ++i) {
+        if (clientIds[i] == id) {
+            clientIds[i] = 0;
+            clientLabels[i]->setText(QString("Client%1 Disconnected").arg(i + 1));
+            break;
+        }
+    }
+    statusBar()->showMessage(QString("%1 client(s) connected").arg(--clientCount));
+}
+
+void MainWindow::onControlReply(const QString &command, const QJsonObject &reply) {
+    // status 응답 (updateProgress 가 보낸 것): 실패해도 다음 틱에 다시 묻는다
+    if (command == "status")
+        statusPending = false;
+    if (!reply.value("ok").toBool()) {
+        statusBar()->showMessage("server2d: " + reply.value("error").toString());
+        return;
+    }
+    if (command == "status") {
+        if (timer->isActive() && reply.value("playing").toBool())
+            showPosition(qint64(reply.value("positionFrames").toDouble()));
+        return;
+    }
+    if (!reply.value("clients").isArray())
+        return;
+    // clients 응답: 패널을 지금 목록으로 다시 채운다 (subscribe 직후 이벤트와 겹쳐도 맞게)
+    for (int i = 0; i < 3; ++i) {
+        clientIds[i] = 0;
+        clientLabels[i]->setText(QString("Client%1 Disconnected").arg(i + 1));
+    }
+    clientCount = 0;
+    const QJsonArray list = reply.value("clients").toArray();
+    for (const QJsonValue &v : list) {
+        const QJsonObject c = v.toObject();
+        onClientConnected(c.value("id").toInt(), c.value("peer").toString());
+    }
+}
+
+void MainWindow::onControlEvent(const QJsonObject &event) {
+    const QString name = event.value("event").toString();
+    if (name == "clientConnected")
+        onClientConnected(event.value("id").toInt(), event.value("peer").toString());
+    else if (name == "clientDisconnected")
+        onClientDisconnected(event.value("id").toInt());
+    else if (name == "trackFinished")
+        onTrackFinished();
+}
+
+void MainWindow::onControlDisconnected() {
+    timer->stop();
+    statusPending = false;
+    for (int i = 0; i < 3; ++i) {
+        clientIds[i] = 0;
+        clientLabels[i]->setText(QString("Client%1 Disconnected").arg(i + 1));
+    }
+    clientCount = 0;
+    statusBar()->showMessage("Lost connection to server2d: " + control->errorString());
 }
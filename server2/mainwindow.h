@@ -2,7 +2,8 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QListWidget>
+#include <QListView>
+#include <QLineEdit>
 #include <QStackedWidget>
 #include <QLabel>
 #include <QSlider>
@@ -15,25 +16,50 @@
 #include <QVBoxLayout>
 #include <QFrame>
 #include "clickableslider.h"
+#include "streamserver.h"
+#include "controlclient.h"
+#include "libraryindex.h"
+#include "librarymodel.h"
+#include "librarywatcher.h"
+#include "pcmcache.h"
+#include "trackdelegate.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // control 을 주면 엔진을 띄우지 않고 server2d 에 명령만 보낸다
+    explicit MainWindow(ControlClient *control = nullptr, QWidget *parent = nullptr);
     ~MainWindow();
 
+    StreamServer *streamServer() const { return server; }   // 데몬 모드면 nullptr
+    bool startStreaming(quint16 port = StreamProtocol::DefaultPort);
+
 private slots:
-    void onFileDoubleClicked(QListWidgetItem *item);
+    void onTrackActivated(const QModelIndex &index);
+    void onFilterChanged();
+    void updateVisibleRows();
     void updateProgress();
     void onBackClicked();
-    void onSliderMoved(int percent);
+    void onSliderMoved(int value);
+    void onSliderReleased();
+    void onTrackFinished();
+    void onClientConnected(int id, const QString &peer);
+    void onClientDisconnected(int id);
+    void onControlReply(const QString &command, const QJsonObject &reply);
+    void onControlEvent(const QJsonObject &event);
+    void onControlDisconnected();
+    void onScanFinished();
+    void rescanLibrary();
 
 private:
     ClickableSlider *progressSlider;
     void loadWavList();
-    int getWavDuration(const QString &filePath);
+    void showPosition(qint64 frame);
 
-    QListWidget *listWidget;
+    QListView *listView;
+    QLineEdit *filterEdit;
+    QTimer *filterTimer;       // 칠 때마다가 아니라 잠깐 멈췄을 때 거른다
+    QTimer *visibleTimer;      // 스크롤이 멈칫할 때 보이는 행의 썸네일을 요청
     QStackedWidget *stacked;
     QWidget *listPage;
     QWidget *playPage;
@@ -42,9 +68,29 @@ private:
     QLabel *titleLabel;
     QLabel *timeLabel;
     QPushButton *backButton;
-    QTimer *timer;
-    int currentPosition;
-    int totalDuration; // seconds
+    QTimer *timer;             // 위치 표시 갱신 (엔진 위치를 읽음)
+    qint64 currentFrame;
+    qint64 totalFrames;        // 모르면 0
+    quint32 sampleRate;
+    bool statusPending;        // 데몬 모드: status 응답을 기다리는 중
+
+    // streaming
+    StreamServer *server;
+    PcmCache pcmCache;         // 같은 트랙을 다시 틀면 디코드한 PCM 을 그대로 쓴다
+    ControlClient *control;
+    QLabel *clientLabels[3];   // Client1~3 패널
+    int clientIds[3];          // 패널에 표시 중인 클라이언트 id (0 = 비어 있음)
+    int clientCount;
+
+    // library
+    QString libraryPath;
+    QString indexPath;
+    QString thumbnailPath;
+    LibraryIndex library;      // 마지막 스캔 결과 (저장하는 것)
+    LibraryModel *libraryModel; // 목록에 보이는 것 (재생 시간은 보일 때 읽음)
+    LibraryScanner *scanner;
+    LibraryWatcher *watcher;   // 새 녹음이 생기면 그 디렉터리만 다시 읽게 한다
+    bool rescanPending;        // 스캔 중에 또 바뀜
 };
 
 #endif // MAINWINDOW_H
@@ -13,9 +13,20 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        mainwindow.cpp
+        mainwindow.cpp \
+        librarymodel.cpp \
+        tracksearch.cpp \
+        thumbnailer.cpp
 
 HEADERS  += mainwindow.h \
-          clickableslider.h
+          clickableslider.h \
+          librarymodel.h \
+          tracksearch.h \
+          thumbnailer.h \
+          trackdelegate.h
 
 FORMS    += mainwindow.ui
+
+include(../common/common.pri)
+
+include(../common/streaming.pri)
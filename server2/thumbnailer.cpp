@@ -0,0 +1,322 @@
+#include "thumbnailer.h"
+#include "audiosource.h"
+#include <QAtomicInt>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <math.h>
+
+namespace {
+
+const quint32 kMagic   = 0x5753544e;   // "WSTN"
+const quint32 kVersion = 1;
+const qint64  kWindowFrames = 8192;    // 열마다 읽는 양 (48 kHz 에서 170 ms)
+const qint64  kMinThumbBytes = 4 + 8 + 8 + 4;   // path, size, mtime, peaks 가 모두 빈 레코드
+
+struct Peak {
+    float lo = 0;
+    float hi = 0;
+};
+
+void minMax(const float *p, qint64 n, Peak *peak)
+{
+    float lo = peak->lo, hi = peak->hi;
+    for (qint64 i = 0; i < n; ++i) {
+        lo = qMin(lo, p[i]);
+        hi = qMax(hi, p[i]);
+    }
+    peak->lo = lo;
+    peak->hi = hi;
+}
+
+inline char toByte(float v)
+{
+    return char(qBound(-127, int(lroundf(v * 127.0f)), 127));
+}
+
+// 긴 파일은 열마다 그 자리로 seek 해 창 하나만 읽는다 (NFS 에서 수십 MB 를 다
+// 읽지 않게). 짧거나 길이를 모르는 파일은 끝까지 읽어 창마다 모은 뒤 열로 합친다
+bool makePeaks(const QString &path, const QAtomicInt &cancel, QByteArray *out)
+{
+    QScopedPointer<AudioSource> src(createAudioSource(path));
+    if (!src || !src->open(path) || src->channels() <= 0)
+        return false;
+    const int channels = src->channels();
+    const qint64 frames = src->frameCount();
+    const int columns = Thumbnailer::Columns;
+    QVector<float> buf(int(kWindowFrames * channels));
+    QVector<Peak> peaks(columns);
+
+    if (frames > columns * kWindowFrames * 2) {
+        for (int c = 0; c < columns; ++c) {
+            if (cancel.load())
+                return false;
+            if (!src->seek(frames * c / columns))
+                return false;
+            const qint64 got = src->readFloat(buf.data(), kWindowFrames);
+            if (got < 0)
+                return false;
+            minMax(buf.constData(), got * channels, &peaks[c]);
+        }
+    } else {
+        QVector<Peak> windows;
+        for (;;) {
+            if (cancel.load())
+                return false;
+            const qint64 got = src->readFloat(buf.data(), kWindowFrames);
+            if (got < 0)
+                return false;
+            if (got == 0)
+                break;
+            Peak p;
+            minMax(buf.constData(), got * channels, &p);
+            windows.append(p);
+        }
+        const int n = windows.size();
+        for (int c = 0; c < columns && n > 0; ++c) {
+            const int first = c * n / columns;
+            const int last = qMax(first + 1, (c + 1) * n / columns);
+            for (int i = first; i < last; ++i) {
+                peaks[c].lo = qMin(peaks[c].lo, windows.at(i).lo);
+                peaks[c].hi = qMax(peaks[c].hi, windows.at(i).hi);
+            }
+        }
+    }
+    out->resize(2 * columns);
+    for (int c = 0; c < columns; ++c) {
+        (*out)[2 * c] = toByte(peaks.at(c).lo);
+        (*out)[2 * c + 1] = toByte(peaks.at(c).hi);
+    }
+    return true;
+}
+
+} // namespace
+
+class ThumbnailWorker : public QThread
+{
+public:
+    explicit ThumbnailWorker(Thumbnailer *owner) : m_owner(owner) {}
+
+    QString    current;        // 만들고 있는 파일 (m_owner->m_mutex)
+    QAtomicInt cancel;
+
+protected:
+    void run() override { m_owner->work(this); }
+
+private:
+    Thumbnailer *m_owner;
+};
+
+// ---------------------------------------------------------------------------
+
+Thumbnailer::Thumbnailer(QObject *parent)
+    : QObject(parent),
+      m_threads(2),
+      m_stop(false)
+{
+}
+
+Thumbnailer::~Thumbnailer()
+{
+    stopWorkers();
+}
+
+void Thumbnailer::setThreads(int n)
+{
+    m_threads = qBound(1, n, 16);
+}
+
+QString Thumbnailer::defaultPath(const QString &indexFile)
+{
+    return QFileInfo(indexFile).absolutePath() + "/thumbnails.cache";
+}
+
+QByteArray Thumbnailer::find(const LibraryEntry &entry) const
+{
+    const QHash<QString, Thumb>::const_iterator it = m_cache.constFind(entry.path);
+    if (it == m_cache.constEnd() || it->size != entry.size || it->mtimeNs != entry.mtimeNs)
+        return QByteArray();
+    return it->peaks;
+}
+
+void Thumbnailer::request(const QVector<LibraryEntry> &wanted)
+{
+    QList<Job> jobs;
+    QSet<QString> paths;
+    for (const LibraryEntry &e : wanted) {
+        const QHash<QString, Thumb>::const_iterator it = m_cache.constFind(e.path);
+        if (it != m_cache.constEnd() && it->size == e.size && it->mtimeNs == e.mtimeNs)
+            continue;               // 있거나 이미 실패한 파일
+        Job job;
+        job.path = e.path;
+        job.size = e.size;
+        job.mtimeNs = e.mtimeNs;
+        paths.insert(e.path);
+        jobs.append(job);
+    }
+
+    QMutexLocker lock(&m_mutex);
+    // 만들고 있는 것은 큐에 다시 넣지 않고, 더 안 보이는 것은 멈춘다
+    for (ThumbnailWorker *w : m_workers) {
+        if (w->current.isEmpty())
+            continue;
+        if (paths.contains(w->current)) {
+            for (int i = 0; i < jobs.size(); ++i) {
+                if (jobs.at(i).path == w->current) {
+                    jobs.removeAt(i);
+                    break;
+                }
+            }
+        } else {
+            w->cancel.store(1);
+        }
+    }
+    m_queue = jobs;
+    if (m_queue.isEmpty())
+        return;
+    while (m_workers.size() < m_threads) {
+        ThumbnailWorker *w = new ThumbnailWorker(this);
+        w->start(QThread::LowPriority);
+        m_workers.append(w);
+    }
+    m_wake.wakeAll();
+}
+
+void Thumbnailer::work(ThumbnailWorker *w)
+{
+    QMutexLocker lock(&m_mutex);
+    for (;;) {
+        while (m_queue.isEmpty() && !m_stop)
+            m_wake.wait(&m_mutex);
+        if (m_stop)
+            return;
+        Job job = m_queue.takeFirst();
+        w->current = job.path;
+        w->cancel.store(0);
+        lock.unlock();
+        job.ok = makePeaks(job.path, w->cancel, &job.peaks);
+        lock.relock();
+        w->current.clear();
+        job.cancelled = w->cancel.load() != 0;
+        const bool first = m_done.isEmpty();
+        m_done.append(job);
+        if (first)
+            QMetaObject::invokeMethod(this, "onFinished", Qt::QueuedConnection);
+    }
+}
+
+void Thumbnailer::stopWorkers()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        m_queue.clear();
+        for (ThumbnailWorker *w : m_workers)
+            w->cancel.store(1);
+        m_wake.wakeAll();
+    }
+    for (ThumbnailWorker *w : m_workers) {
+        w->wait();
+        delete w;
+    }
+    m_workers.clear();
+}
+
+void Thumbnailer::onFinished()
+{
+    QList<Job> done;
+    {
+        QMutexLocker lock(&m_mutex);
+        done.swap(m_done);
+    }
+    QStringList paths;
+    for (const Job &job : done) {
+        if (job.cancelled) {
+            ++m_stats.cancelled;
+            continue;
+        }
+        Thumb t;
+        t.size = job.size;
+        t.mtimeNs = job.mtimeNs;
+        if (job.ok) {
+            t.peaks = job.peaks;
+            ++m_stats.made;
+            paths.append(job.path);
+        } else {
+            ++m_stats.failed;
+        }
+        m_cache.insert(job.path, t);
+    }
+    if (!paths.isEmpty())
+        emit ready(paths);
+}
+
+bool Thumbnailer::load(const QString &file, QString *error)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = f.errorString();
+        return false;
+    }
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version != kVersion) {
+        if (error)
+            *error = QString("%1: not a thumbnail cache").arg(file);
+        return false;
+    }
+    QHash<QString, Thumb> cache;
+    // 개수는 파일에 적힌 값이라 믿지 않고 파일 크기로 상한을 건다
+    cache.reserve(int(qMin<qint64>(count, f.size() / kMinThumbBytes)));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Thumb t;
+        in >> path >> t.size >> t.mtimeNs >> t.peaks;
+        if (t.peaks.size() == 2 * Columns)
+            cache.insert(path, t);
+    }
+    if (in.status() != QDataStream::Ok) {
+        if (error)
+            *error = QString("%1: truncated").arg(file);
+        return false;
+    }
+    m_cache.swap(cache);
+    return true;
+}
+
+bool Thumbnailer::save(const QString &file, const LibraryIndex &library, QString *error) const
+{
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    QSaveFile f(file);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = f.errorString();
+        return false;
+    }
+    QVector<const LibraryEntry *> keep;
+    for (QHash<QString, Thumb>::const_iterator it = m_cache.constBegin(); it != m_cache.constEnd(); ++it) {
+        const LibraryEntry *e = library.find(it.key());
+        if (e && !it->peaks.isEmpty() && e->size == it->size && e->mtimeNs == it->mtimeNs)
+            keep.append(e);
+    }
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << kMagic << kVersion << quint32(keep.size());
+    for (const LibraryEntry *e : keep) {
+        const Thumb t = m_cache.value(e->path);
+        out << e->path << t.size << t.mtimeNs << t.peaks;
+    }
+    if (!f.commit()) {
+        if (error)
+            *error = f.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef THUMBNAILER_H
+#define THUMBNAILER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "libraryindex.h"
+
+class ThumbnailWorker;
+
+// 트랙 목록 행에 그리는 작은 파형. 열 Columns 개마다 min / max 를 -127..127 로
+// (트랙당 128 바이트). 만드는 일은 작은 스레드 풀이 하고, request() 로 지금 보이는
+// 행만 남기므로 스크롤해서 지나간 행의 일은 큐에서 빠지거나 도중에 그만둔다.
+// 결과는 파일 크기 / mtime 과 함께 캐시 파일에 저장한다 (파일이 바뀌면 다시 만듦).
+// request / find / load / save 는 GUI 스레드에서만 부른다.
+class Thumbnailer : public QObject
+{
+    Q_OBJECT
+public:
+    enum { Columns = 64 };
+
+    struct Stats {
+        int made = 0;
+        int failed = 0;          // 디코드 실패 (이번 실행에서는 다시 하지 않음)
+        int cancelled = 0;       // 만들다가 보이지 않게 돼 그만둔 것
+    };
+
+    explicit Thumbnailer(QObject *parent = nullptr);
+    ~Thumbnailer();
+
+    void setThreads(int n);      // 기본 2 (NFS 읽기와 디코드를 겹칠 만큼)
+
+    // 없거나 파일이 바뀌었으면 빈 배열
+    QByteArray find(const LibraryEntry &entry) const;
+
+    // 앞의 것부터 만든다. 목록에 없는 일은 버리거나 멈춘다
+    void request(const QVector<LibraryEntry> &wanted);
+    Stats stats() const { return m_stats; }
+
+    bool load(const QString &file, QString *error = nullptr);
+    // library 에 그대로 있는 파일의 것만 쓴다 (지워진 트랙은 캐시에서도 빠진다)
+    bool save(const QString &file, const LibraryIndex &library, QString *error = nullptr) const;
+
+    static QString defaultPath(const QString &indexFile);   // 색인 파일 옆 thumbnails.cache
+
+signals:
+    void ready(const QStringList &paths);
+
+private slots:
+    void onFinished();
+
+private:
+    friend class ThumbnailWorker;
+
+    struct Thumb {
+        qint64     size = 0;
+        qint64     mtimeNs = 0;
+        QByteArray peaks;        // 비었으면 만들지 못한 파일
+    };
+    struct Job {
+        QString path;
+        qint64  size = 0;
+        qint64  mtimeNs = 0;
+        bool    ok = false;
+        bool    cancelled = false;
+        QByteArray peaks;
+    };
+
+    void work(ThumbnailWorker *w);
+    void stopWorkers();
+
+    QHash<QString, Thumb> m_cache;           // GUI 스레드만
+    Stats m_stats;
+    int   m_threads;
+
+    QMutex m_mutex;                          // 아래는 일꾼과 같이 쓴다
+    QWaitCondition m_wake;
+    QList<Job> m_queue;
+    QList<Job> m_done;
+    QList<ThumbnailWorker *> m_workers;
+    bool  m_stop;
+
+    Q_DISABLE_COPY(Thumbnailer)
+};
+
+#endif // THUMBNAILER_H
@@ -0,0 +1,55 @@
+#ifndef TRACKDELEGATE_H
+#define TRACKDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QPainter>
+#include "librarymodel.h"
+
+// 트랙 목록 한 행: 왼쪽은 이름과 재생 시간, 오른쪽 끝에 파형 썸네일.
+// 썸네일이 아직 없으면 그 자리는 비워 둔다 (다 되면 모델이 dataChanged 로 다시 그리게 함)
+class TrackDelegate : public QStyledItemDelegate {
+public:
+    enum { ThumbWidth = 2 * Thumbnailer::Columns, Margin = 6 };
+
+    explicit TrackDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override {
+        QStyleOptionViewItem text(option);
+        text.rect.setRight(option.rect.right() - ThumbWidth - Margin);
+        QStyledItemDelegate::paint(painter, text, index);
+
+        const QRect area(text.rect.right() + 1, option.rect.top(),
+                         option.rect.right() - text.rect.right(), option.rect.height());
+        const bool selected = option.state & QStyle::State_Selected;
+        if (selected)
+            painter->fillRect(area, option.palette.highlight());
+        const QByteArray peaks = index.data(LibraryModel::ThumbnailRole).toByteArray();
+        if (peaks.size() != 2 * Thumbnailer::Columns)
+            return;
+
+        const QRect wave = area.adjusted(Margin, 2, 0, -2);
+        const double mid = wave.top() + wave.height() / 2.0;
+        const double scale = wave.height() / 254.0;
+        const double step = double(wave.width()) / Thumbnailer::Columns;
+        painter->save();
+        painter->setPen(selected ? option.palette.highlightedText().color()
+                                 : option.palette.text().color());
+        for (int c = 0; c < Thumbnailer::Columns; ++c) {
+            const int x = wave.left() + int(c * step);
+            const int top = int(mid - qint8(peaks.at(2 * c + 1)) * scale);
+            const int bottom = int(mid - qint8(peaks.at(2 * c)) * scale);
+            painter->drawLine(x, top, x, qMax(top, bottom));
+        }
+        painter->restore();
+    }
+
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override {
+        QSize size = QStyledItemDelegate::sizeHint(option, index);
+        size.setWidth(size.width() + ThumbWidth + Margin);
+        size.setHeight(qMax(size.height(), 18));   // 파형이 보일 만큼
+        return size;
+    }
+};
+
+#endif // TRACKDELEGATE_H
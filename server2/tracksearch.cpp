@@ -0,0 +1,175 @@
+#include "tracksearch.h"
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+inline quint32 trigram(const char *p)
+{
+    return quint32(uchar(p[0])) << 16 | quint32(uchar(p[1])) << 8 | uchar(p[2]);
+}
+
+// 키에 흔히 나오는 바이트 -> 0..62, 나머지는 63 (표에 없음)
+struct CharClass {
+    uchar code[256];
+    CharClass()
+    {
+        memset(code, 63, sizeof code);
+        const char common[] = "abcdefghijklmnopqrstuvwxyz0123456789 _-./()[]&',+#!~";
+        for (int i = 0; common[i]; ++i)
+            code[uchar(common[i])] = uchar(i);
+    }
+};
+const CharClass kClass;
+
+void appendVarint(QByteArray *out, quint32 v)
+{
+    while (v >= 0x80) {
+        out->append(char(v | 0x80));
+        v >>= 7;
+    }
+    out->append(char(v));
+}
+
+} // namespace
+
+TrackSearch::TrackSearch()
+    : m_direct(1 << DirectBits)
+{
+    m_offsets.append(0);
+}
+
+TrackSearch::Posting *TrackSearch::posting(const char *p)
+{
+    const uint a = kClass.code[uchar(p[0])], b = kClass.code[uchar(p[1])], c = kClass.code[uchar(p[2])];
+    if ((a | b | c) < 63)
+        return &m_direct[int(a << 12 | b << 6 | c)];
+    return &m_postings[trigram(p)];
+}
+
+const TrackSearch::Posting *TrackSearch::posting(const char *p) const
+{
+    const uint a = kClass.code[uchar(p[0])], b = kClass.code[uchar(p[1])], c = kClass.code[uchar(p[2])];
+    if ((a | b | c) < 63)
+        return &m_direct.at(int(a << 12 | b << 6 | c));
+    const QHash<quint32, Posting>::const_iterator it = m_postings.constFind(trigram(p));
+    return it == m_postings.constEnd() ? nullptr : &it.value();
+}
+
+void TrackSearch::clear()
+{
+    m_text.clear();
+    m_offsets.clear();
+    m_offsets.append(0);
+    m_direct = QVector<Posting>(1 << DirectBits);
+    m_postings.clear();
+}
+
+void TrackSearch::reserve(int keys, int bytes)
+{
+    m_text.reserve(bytes);
+    m_offsets.reserve(keys + 1);
+}
+
+void TrackSearch::add(const QString &key)
+{
+    const int id = size();
+    const QByteArray k = key.toLower().toUtf8();
+    m_text.append(k);
+    m_text.append('\0');
+    m_offsets.append(m_text.size());
+
+    // 한 키 안에서 같은 trigram 은 한 번만 (last 로 거른다)
+    const int n = k.size() - 2;
+    if (n <= 0)
+        return;
+    QVarLengthArray<Posting *, 128> grams;
+    for (int i = 0; i < n; ++i)
+        grams.append(posting(k.constData() + i));
+    for (Posting *p : grams) {
+        if (p->last == id)
+            continue;
+        appendVarint(&p->ids, quint32(id - p->last));
+        p->last = id;
+        ++p->count;
+    }
+}
+
+bool TrackSearch::contains(int id, const QByteArray &needle) const
+{
+    const char *key = m_text.constData() + m_offsets.at(id);
+    const size_t len = size_t(m_offsets.at(id + 1) - m_offsets.at(id) - 1);
+    return memmem(key, len, needle.constData(), size_t(needle.size())) != nullptr;
+}
+
+// 짧은 질의: 버퍼 전체에서 찾고 위치를 항목 번호로 바꾼다
+QVector<int> TrackSearch::scan(const QByteArray &needle) const
+{
+    QVector<int> out;
+    const char *base = m_text.constData();
+    const char *p = base;
+    const char *end = base + m_text.size();
+    while (p < end) {
+        const void *hit = memmem(p, size_t(end - p), needle.constData(), size_t(needle.size()));
+        if (!hit)
+            break;
+        const int pos = int(static_cast<const char *>(hit) - base);
+        const int id = int(std::upper_bound(m_offsets.constBegin(), m_offsets.constEnd(), pos)
+                           - m_offsets.constBegin()) - 1;
+        out.append(id);
+        p = base + m_offsets.at(id + 1);   // 같은 항목의 다음 위치는 건너뜀
+    }
+    return out;
+}
+
+QVector<int> TrackSearch::find(const QString &query) const
+{
+    const QByteArray needle = query.toLower().toUtf8();
+    if (needle.isEmpty()) {
+        QVector<int> all(size());
+        for (int i = 0; i < all.size(); ++i)
+            all[i] = i;
+        return all;
+    }
+    if (needle.size() < 3)
+        return scan(needle);
+
+    // 가장 드문 trigram 의 목록이 후보. 하나라도 없으면 결과도 없다
+    const Posting *best = nullptr;
+    for (int i = 0; i + 3 <= needle.size(); ++i) {
+        const Posting *p = posting(needle.constData() + i);
+        if (!p || p->count == 0)
+            return QVector<int>();
+        if (!best || p->count < best->count)
+            best = p;
+    }
+    QVector<int> out;
+    const uchar *p = reinterpret_cast<const uchar *>(best->ids.constData());
+    const uchar *end = p + best->ids.size();
+    int id = -1;
+    while (p < end) {
+        quint32 delta = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            delta |= quint32(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        delta |= quint32(*p++) << shift;
+        id += int(delta);
+        // 질의가 trigram 하나면 확인할 필요 없음
+        if (needle.size() == 3 || contains(id, needle))
+            out.append(id);
+    }
+    return out;
+}
+
+QVector<int> TrackSearch::refine(const QString &query, const QVector<int> &within) const
+{
+    const QByteArray needle = query.toLower().toUtf8();
+    QVector<int> out;
+    for (int id : within) {
+        if (contains(id, needle))
+            out.append(id);
+    }
+    return out;
+}
@@ -0,0 +1,52 @@
+#ifndef TRACKSEARCH_H
+#define TRACKSEARCH_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVarLengthArray>
+#include <QVector>
+
+// 트랙 목록의 부분 문자열 검색 (대소문자 무시).
+//
+// 키를 소문자 UTF-8 로 버퍼 하나에 이어 붙이고, 3바이트 조각 (trigram) 마다
+// 그 조각이 들어 있는 항목 번호를 차이값 varint 로 적어 둔다 (100만 항목에
+// 수십 MB). 흔한 문자만으로 된 trigram 은 해시 대신 표에서 바로 찾아 100만 항목도
+// 빨리 만든다. 찾을 때는 질의의 trigram 중 목록이 가장 짧은 것 하나만 풀어 후보를
+// 만들고 실제 문자열로 확인한다. 3바이트보다 짧은 질의는 버퍼를 memmem 으로 훑는다.
+// 앞 질의에 글자를 더 친 경우는 refine() 으로 이전 결과 안에서만 확인한다.
+class TrackSearch
+{
+public:
+    TrackSearch();
+
+    void clear();
+    void reserve(int keys, int bytes);
+    void add(const QString &key);          // 항목 번호는 add 한 순서 (0 부터)
+    int  size() const { return m_offsets.size() - 1; }
+
+    // 오름차순 항목 번호
+    QVector<int> find(const QString &query) const;
+    QVector<int> refine(const QString &query, const QVector<int> &within) const;
+
+private:
+    struct Posting {
+        QByteArray ids;                    // varint (앞 번호와의 차이)
+        int        count = 0;
+        int        last = -1;
+    };
+
+    enum { DirectBits = 18 };              // 흔한 문자 3개짜리 trigram 은 표에서 바로
+
+    Posting *posting(const char *p);
+    const Posting *posting(const char *p) const;
+    bool contains(int id, const QByteArray &needle) const;
+    QVector<int> scan(const QByteArray &needle) const;
+
+    QByteArray m_text;                     // 키들을 '\0' 으로 이어 붙임
+    QVector<int> m_offsets;                // 항목 i 는 [m_offsets[i], m_offsets[i + 1] - 1)
+    QVector<Posting> m_direct;             // 소문자 / 숫자 / 흔한 기호로만 된 trigram
+    QHash<quint32, Posting> m_postings;    // 나머지 (한글 등 UTF-8 바이트가 섞인 것)
+};
+
+#endif // TRACKSEARCH_H
@@ -0,0 +1,469 @@
+// daemon.cpp
+#include "daemon.h"
+#include "streamserver.h"
+#include "controlserver.h"
+#include "audiosource.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QSettings>
+#include <QStringList>
+
+bool DaemonConfig::load(const QString &path, QString *error)
+{
+    if (!QFileInfo(path).isReadable()) {
+        if (error)
+            *error = QString("Cannot read %1").arg(path);
+        return false;
+    }
+    QSettings s(path, QSettings::IniFormat);
+    if (s.status() != QSettings::NoError) {
+        if (error)
+            *error = QString("Malformed config %1").arg(path);
+        return false;
+    }
+    port            = quint16(s.value("stream/port", port).toUInt());
+    address         = s.value("stream/address", address).toString();
+    rawPort         = quint16(s.value("stream/raw-port", rawPort).toUInt());
+    localSocket     = s.value("stream/local-socket", localSocket).toString();
+    packetMs        = s.value("stream/packet-ms", packetMs).toInt();
+    playoutDelayMs  = s.value("stream/playout-delay-ms", playoutDelayMs).toInt();
+    maxQueueSeconds = s.value("stream/max-queue-seconds", maxQueueSeconds).toDouble();
+    kickSeconds     = s.value("stream/kick-seconds", kickSeconds).toDouble();
+    pcmCacheMb      = s.value("stream/pcm-cache-mb", pcmCacheMb).toInt();
+    opusKbps        = s.value("stream/opus-kbps", opusKbps).toInt();
+    opusFrameMs     = s.value("stream/opus-frame-ms", opusFrameMs).toDouble();
+    opusComplexity  = s.value("stream/opus-complexity", opusComplexity).toInt();
+    upstream        = s.value("stream/upstream", upstream).toString();
+
+    multicast          = s.value("multicast/destination", multicast).toString();
+    multicastTtl       = s.value("multicast/ttl", multicastTtl).toInt();
+    rtpMs              = s.value("multicast/rtp-ms", rtpMs).toDouble();
+    multicastInterface = s.value("multicast/interface", multicastInterface).toString();
+    fecPercent         = s.value("multicast/fec-overhead", fecPercent).toDouble();
+    fecInterleave      = s.value("multicast/fec-interleave", fecInterleave).toInt();
+
+    controlSocket = s.value("control/socket", controlSocket).toString();
+    rawPortSet       = rawPortSet || s.contains("stream/raw-port");
+    localSocketSet   = localSocketSet || s.contains("stream/local-socket");
+    controlSocketSet = controlSocketSet || s.contains("control/socket");
+    library       = s.value("library/path", library).toString();
+    libraryIndex  = s.value("library/index", libraryIndex).toString();
+    scanThreads   = s.value("library/scan-threads", scanThreads).toInt();
+    watchLibrary  = s.value("library/watch", watchLibrary).toBool();
+    pollSeconds   = s.value("library/poll-seconds", pollSeconds).toInt();
+
+    s.beginGroup("distance");
+    for (const QString &host : s.childKeys())
+        distances.insert(host, s.value(host).toDouble());
+    s.endGroup();
+    s.beginGroup("delay");
+    for (const QString &host : s.childKeys())
+        offsets.insert(host, s.value(host).toDouble());
+    s.endGroup();
+    return true;
+}
+
+void DaemonConfig::applyRelayDefaults()
+{
+    if (upstream.isEmpty())
+        return;
+    if (!rawPortSet)
+        rawPort = 0;
+    if (!localSocketSet)
+        localSocket = QString("/tmp/server2-stream-%1.sock").arg(port);
+    if (!controlSocketSet)
+        controlSocket = QString("/tmp/server2d-%1.sock").arg(port);
+}
+
+Daemon::Daemon(const DaemonConfig &config, QObject *parent)
+    : QObject(parent),
+      m_config(config),
+      m_server(new StreamServer(this)),
+      m_control(new ControlServer(this)),
+      m_trackRate(0),
+      m_trackFrames(-1),
+      m_scanner(new LibraryScanner(this)),
+      m_watcher(new LibraryWatcher(this)),
+      m_rescanPending(false)
+{
+    connect(m_control, &ControlServer::request, this, &Daemon::onRequest);
+    connect(m_server, &StreamServer::clientConnected, this, &Daemon::onClientConnected);
+    connect(m_server, &StreamServer::clientDisconnected, this, &Daemon::onClientDisconnected);
+    connect(m_server, &StreamServer::trackFinished, this, &Daemon::onTrackFinished);
+    connect(m_scanner, &QThread::finished, this, &Daemon::onScanFinished);
+    connect(m_watcher, &LibraryWatcher::changed, this, &Daemon::rescanLibrary);
+}
+
+Daemon::~Daemon()
+{
+    stop();
+}
+
+bool Daemon::start()
+{
+    m_server->setPacketMilliseconds(m_config.packetMs);
+    m_server->setPlayoutDelay(m_config.playoutDelayMs);
+    m_server->setMaxQueueSeconds(m_config.maxQueueSeconds);
+    m_server->setKickSeconds(m_config.kickSeconds);
+    m_server->setRawPort(m_config.rawPort);
+    m_server->setLocalSocket(m_config.localSocket);
+    m_pcmCache.setCapacity(qint64(qMax(0, m_config.pcmCacheMb)) * 1024 * 1024);
+    m_server->setPcmCache(&m_pcmCache);
+    m_server->setOpus(qMax(0, m_config.opusKbps) * 1000, m_config.opusFrameMs,
+                      m_config.opusComplexity);
+    m_server->setMulticastFec(m_config.fecPercent, m_config.fecInterleave);
+    if (!m_config.upstream.isEmpty()) {
+        const QStringList up = m_config.upstream.split(':');
+        const quint16 upPort = up.size() > 1 ? quint16(up.at(1).toUInt())
+                                             : quint16(StreamProtocol::DefaultPort);
+        if (!m_server->setUpstream(up.at(0), upPort)) {
+            m_error = "upstream: " + m_server->errorString();
+            return false;
+        }
+    }
+    for (auto it = m_config.distances.constBegin(); it != m_config.distances.constEnd(); ++it)
+        m_server->setSpeakerDistance(it.key(), it.value());
+    for (auto it = m_config.offsets.constBegin(); it != m_config.offsets.constEnd(); ++it)
+        m_server->setSpeakerOffset(it.key(), it.value());
+    if (!m_config.multicast.isEmpty()) {
+        const QJsonObject r = setMulticast(m_config.multicast);
+        if (!r.value("ok").toBool()) {
+            m_error = "multicast: " + r.value("error").toString();
+            return false;
+        }
+    }
+    if (!m_server->listen(m_config.port, m_config.address)) {
+        m_error = m_server->errorString();
+        return false;
+    }
+    if (!m_control->listen(m_config.controlSocket)) {
+        m_error = m_control->errorString();
+        m_server->close();
+        return false;
+    }
+    // 저장해 둔 색인으로 list 에 바로 답하고, 바뀐 것만 뒤에서 다시 훑는다
+    m_library.load(indexPath());
+    m_library.setRoot(QDir(m_config.library).absolutePath());
+    m_scanner->setThreads(m_config.scanThreads);
+    m_scanner->setIndexFile(indexPath());
+    m_scanner->scan(m_config.library, m_library);
+    if (m_config.watchLibrary) {
+        m_watcher->setPollSeconds(m_config.pollSeconds);
+        if (m_watcher->start(m_config.library, m_library) == LibraryWatcher::Polling)
+            qWarning("library: polling every %d s (%s)", m_config.pollSeconds,
+                     qPrintable(m_watcher->pollReason()));
+    }
+    return true;
+}
+
+void Daemon::stop()
+{
+    m_watcher->stop();
+    m_scanner->cancel();
+    m_scanner->wait();
+    m_control->close();
+    m_server->close();
+}
+
+void Daemon::onRequest(int connection, const QString &command, const QString &argument)
+{
+    QJsonObject r;
+    if (command == "ping") {
+        r = ControlProtocol::ok();
+    } else if (command == "status") {
+        r = status();
+    } else if (command == "clients") {
+        r = clients();
+    } else if (command == "list") {
+        r = list();
+    } else if (!m_config.upstream.isEmpty()
+               && (command == "play" || command == "stop" || command == "seek")) {
+        r = ControlProtocol::error(QString("Relaying %1; control playback there")
+                                   .arg(m_server->upstream()));
+    } else if (command == "play") {
+        r = play(argument);
+    } else if (command == "stop") {
+        m_server->stop();
+        m_track.clear();
+        m_control->publish(ControlProtocol::event("stopped"));
+        r = ControlProtocol::ok();
+    } else if (command == "seek") {
+        r = seek(argument);
+    } else if (command == "multicast") {
+        r = setMulticast(argument);
+    } else if (command == "distance" || command == "delay") {
+        r = setSpeaker(command, argument);
+    } else if (command == "rescan") {
+        r = rescan();
+    } else if (command == "shutdown") {
+        r = ControlProtocol::ok();
+        emit shutdownRequested();
+    } else {
+        r = ControlProtocol::error(QString("Unknown command: %1").arg(command));
+    }
+    m_control->reply(connection, r);
+}
+
+QJsonObject Daemon::play(const QString &path)
+{
+    if (path.isEmpty())
+        return ControlProtocol::error("play needs a file path");
+    AudioSource *source = createAudioSource(path);
+    if (!source)
+        return ControlProtocol::error(QString("Unsupported file: %1").arg(path));
+    if (!source->open(path)) {
+        const QString message = source->errorString();
+        delete source;
+        return ControlProtocol::error(QString("Cannot open %1: %2").arg(path).arg(message));
+    }
+    m_track = path;
+    m_trackRate = source->sampleRate();
+    m_trackFrames = source->frameCount();
+    m_server->play(source, path);
+
+    QJsonObject e = ControlProtocol::event("playing");
+    e["track"] = path;
+    m_control->publish(e);
+    QJsonObject r = ControlProtocol::ok();
+    r["track"] = path;
+    return r;
+}
+
+// 초 단위 (소수 가능). 샘플 단위로 맞춰 모든 클라이언트에 playout 지연 안에 반영된다
+QJsonObject Daemon::seek(const QString &argument)
+{
+    bool ok = false;
+    const double seconds = argument.toDouble(&ok);
+    if (!ok || seconds < 0)
+        return ControlProtocol::error("usage: seek <seconds>");
+    if (!m_server->isPlaying() || !m_trackRate)
+        return ControlProtocol::error("Not playing");
+    qint64 frame = qint64(seconds * m_trackRate + 0.5);
+    if (m_trackFrames >= 0)
+        frame = qMin(frame, m_trackFrames);
+    m_server->seek(frame);
+
+    QJsonObject e = ControlProtocol::event("seeked");
+    e["positionSeconds"] = double(frame) / m_trackRate;
+    m_control->publish(e);
+    QJsonObject r = ControlProtocol::ok();
+    r["positionFrames"] = double(frame);
+    return r;
+}
+
+QJsonObject Daemon::setMulticast(const QString &destination)
+{
+    if (destination.isEmpty() || destination == "off") {
+        m_server->setMulticast(QString(), 0);
+        return ControlProtocol::ok();
+    }
+    const QStringList dest = destination.split(':');
+    const quint16 port = dest.size() > 1 ? quint16(dest.at(1).toUInt()) : 5004;
+    if (!m_server->setMulticast(dest.at(0), port, m_config.multicastTtl, m_config.rtpMs,
+                                m_config.multicastInterface))
+        return ControlProtocol::error(m_server->errorString());
+    QJsonObject r = ControlProtocol::ok();
+    r["sdp"] = m_server->multicastSdp();
+    return r;
+}
+
+// 대상은 클라이언트 id 나 호스트. 배치는 호스트에 붙으므로 재접속해도 유지된다
+QJsonObject Daemon::setSpeaker(const QString &command, const QString &argument)
+{
+    const QStringList args = argument.simplified().split(' ');
+    if (args.size() != 2)
+        return ControlProtocol::error(QString("usage: %1 <id|host> <value>").arg(command));
+    QString host = args.at(0);
+    bool isId = false;
+    const int id = host.toInt(&isId);
+    if (isId) {
+        host.clear();
+        for (const StreamServer::ClientInfo &c : m_server->clients()) {
+            if (c.id == id)
+                host = c.peer.left(c.peer.lastIndexOf(':'));
+        }
+        if (host.isEmpty())
+            return ControlProtocol::error(QString("No client %1").arg(id));
+    }
+
+    bool ok = true;
+    const double value = args.at(1) == "off" ? -1.0 : args.at(1).toDouble(&ok);
+    if (!ok)
+        return ControlProtocol::error(QString("Bad number: %1").arg(args.at(1)));
+    if (command == "distance")
+        m_server->setSpeakerDistance(host, value);
+    else
+        m_server->setSpeakerOffset(host, qMax(-1000.0, qMin(value, 1000.0)));
+
+    QJsonObject r = ControlProtocol::ok();
+    r["host"] = host;
+    return r;
+}
+
+QJsonObject Daemon::status() const
+{
+    const StreamServer::Stats s = m_server->stats();
+    const bool playing = m_server->isPlaying();
+    const qint64 position = m_server->position();
+
+    QJsonObject stats;
+    stats["accepted"] = double(s.accepted);
+    stats["packets"] = double(s.packets);
+    stats["bytesSent"] = double(s.bytesSent);
+    stats["droppedPackets"] = double(s.droppedPackets);
+    stats["kicked"] = double(s.kicked);
+    stats["stalls"] = double(s.stalls);
+    stats["lateWakeups"] = double(s.lateWakeups);
+    QJsonObject late;
+    late["p50Us"] = s.sendLateP50Us;
+    late["p99Us"] = s.sendLateP99Us;
+    late["p999Us"] = s.sendLateP999Us;
+    late["maxUs"] = s.sendLateMaxUs;
+    stats["sendLate"] = late;
+    stats["rtpPackets"] = double(s.rtpPackets);
+    stats["rtpErrors"] = double(s.rtpErrors);
+    stats["rtpFecPackets"] = double(s.rtpFecPackets);
+    stats["clockRequests"] = double(s.clockRequests);
+    stats["zeroCopyBytes"] = double(s.zeroCopyBytes);
+    stats["sharedMemoryBytes"] = double(s.sharedMemoryBytes);
+    stats["opusPackets"] = double(s.opusPackets);
+    stats["opusBytes"] = double(s.opusBytes);
+    stats["opusCpuPercent"] = s.opusCpuPercent;
+    if (!m_config.upstream.isEmpty()) {
+        QJsonObject relay;
+        relay["connected"] = s.upstreamConnected;
+        relay["packets"] = double(s.relayPackets);
+        relay["gaps"] = double(s.relayGaps);
+        relay["unsynced"] = double(s.relayUnsynced);
+        relay["late"] = double(s.relayLate);
+        relay["headroomMs"] = s.relayHeadroomMs;
+        stats["relay"] = relay;
+    }
+
+    const PcmCache::Stats c = m_pcmCache.stats();
+    QJsonObject cache;
+    cache["hits"] = double(c.hits);
+    cache["misses"] = double(c.misses);
+    cache["evictions"] = double(c.evictions);
+    cache["bytes"] = double(c.bytes);
+    cache["segments"] = c.segments;
+    stats["pcmCache"] = cache;
+
+    QJsonObject r = ControlProtocol::ok();
+    r["playing"] = playing;
+    r["track"] = playing ? m_track : QString();
+    r["positionFrames"] = double(position);
+    if (playing && m_trackRate) {
+        r["positionSeconds"] = double(position) / m_trackRate;
+        r["durationSeconds"] = m_trackFrames > 0 ? double(m_trackFrames) / m_trackRate : 0.0;
+    }
+    r["clients"] = s.clients;
+    r["port"] = m_config.port;
+    r["rawPort"] = m_server->rawPort();
+    r["localSocket"] = m_server->localSocket();
+    r["upstream"] = m_server->upstream();
+    r["stats"] = stats;
+    return r;
+}
+
+QJsonObject Daemon::clients() const
+{
+    QJsonArray list;
+    for (const StreamServer::ClientInfo &c : m_server->clients()) {
+        QJsonObject o;
+        o["id"] = c.id;
+        o["peer"] = c.peer;
+        o["raw"] = c.raw;
+        o["local"] = c.local;
+        o["bytesSent"] = double(c.bytesSent);
+        o["queuedBytes"] = double(c.queuedBytes);
+        o["droppedPackets"] = double(c.droppedPackets);
+        o["distance"] = c.distanceMeters;
+        o["delayMs"] = c.delayMs;
+        list.append(o);
+    }
+    QJsonObject r = ControlProtocol::ok();
+    r["clients"] = list;
+    return r;
+}
+
+QJsonObject Daemon::list() const
+{
+    QJsonArray files;
+    for (const LibraryEntry &e : m_library.entries())
+        files.append(e.path);
+    QJsonObject r = ControlProtocol::ok();
+    r["library"] = m_config.library;
+    r["files"] = files;
+    r["scanning"] = m_scanner->isRunning();
+    return r;
+}
+
+QJsonObject Daemon::rescan()
+{
+    rescanLibrary();
+    QJsonObject r = ControlProtocol::ok();
+    r["scanning"] = true;
+    return r;
+}
+
+QString Daemon::indexPath() const
+{
+    return m_config.libraryIndex.isEmpty() ? LibraryIndex::defaultPath() : m_config.libraryIndex;
+}
+
+// 감시가 알린 디렉터리는 다시 읽고, 나머지는 디렉터리 mtime 만 확인한다.
+// 이미 돌고 있으면 끝난 뒤에 한 번 더
+void Daemon::rescanLibrary()
+{
+    if (m_scanner->isRunning()) {
+        m_rescanPending = true;
+        return;
+    }
+    m_rescanPending = false;
+    m_scanner->scan(m_config.library, m_library, m_watcher->takeDirty());
+}
+
+void Daemon::onScanFinished()
+{
+    // 색인 파일은 스캔 스레드가 이미 썼다
+    const LibraryScanner::Stats st = m_scanner->stats();
+    m_library = m_scanner->result();
+    m_watcher->update(m_library);
+    const QString error = m_scanner->saveError();
+    if (!error.isEmpty())
+        qWarning("library index: %s", qPrintable(error));
+    if (m_rescanPending)
+        rescanLibrary();
+    if (!st.modified())
+        return;
+    QJsonObject e = ControlProtocol::event("libraryChanged");
+    e["tracks"] = m_library.size();
+    e["added"] = st.added;
+    e["changed"] = st.changed;
+    e["removed"] = st.removed;
+    m_control->publish(e);
+}
+
+void Daemon::onClientConnected(int id, const QString &peer)
+{
+    QJsonObject e = ControlProtocol::event("clientConnected");
+    e["id"] = id;
+    e["peer"] = peer;
+    m_control->publish(e);
+}
+
+void Daemon::onClientDisconnected(int id)
+{
+    QJsonObject e = ControlProtocol::event("clientDisconnected");
+    e["id"] = id;
+    m_control->publish(e);
+}
+
+void Daemon::onTrackFinished()
+{
+    QJsonObject e = ControlProtocol::event("trackFinished");
+    e["track"] = m_track;
+    m_control->publish(e);
+}
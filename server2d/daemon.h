@@ -0,0 +1,116 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QJsonObject>
+#include "streamprotocol.h"
+#include "controlprotocol.h"
+#include "libraryindex.h"
+#include "librarywatcher.h"
+#include "pcmcache.h"
+
+class StreamServer;
+class ControlServer;
+
+// server2d 설정. 파일 (INI) 을 먼저 읽고 명령줄 값으로 덮어쓴다
+struct DaemonConfig
+{
+    quint16 port = StreamProtocol::DefaultPort;
+    QString address;                  // 비면 모든 인터페이스
+    quint16 rawPort = StreamProtocol::DefaultRawPort;
+    QString localSocket = StreamProtocol::defaultLocalSocketPath();   // 비면 끔 (공유 메모리)
+    int     packetMs = 10;
+    int     playoutDelayMs = 200;
+    double  maxQueueSeconds = 2.0;
+    double  kickSeconds = 5.0;
+    int     pcmCacheMb = 256;         // 디코드한 PCM 캐시 (압축 포맷), 0 이면 끔
+    int     opusKbps = 0;             // 네트워크 스트림을 Opus 로 (TCP / RTP), 0 이면 PCM
+    double  opusFrameMs = 20;
+    int     opusComplexity = 5;
+    QString upstream;                 // host[:port], 있으면 릴레이 (상위 server2 스트림을 다시 내보냄)
+
+    QString multicast;                // group:port, 비면 끔
+    int     multicastTtl = 1;
+    double  rtpMs = 5.0;
+    QString multicastInterface;
+    double  fecPercent = 0;           // RTP FEC 오버헤드, 0 이면 끔
+    int     fecInterleave = 4;
+
+    QString controlSocket = ControlProtocol::defaultSocketPath();
+    QString library = "/mnt/nfs";
+    QString libraryIndex;             // 비면 캐시 디렉터리의 library.index
+    int     scanThreads = 8;
+    bool    watchLibrary = true;      // 바뀌면 바로 다시 읽음 (NFS 는 폴링)
+    int     pollSeconds = 10;
+
+    // 스피커 배치 (호스트 -> m / ms)
+    QHash<QString, double> distances;
+    QHash<QString, double> offsets;
+
+    // 파일 / 명령줄에 직접 적었는지 (릴레이 기본값은 안 적은 것만 바꾼다)
+    bool rawPortSet = false;
+    bool localSocketSet = false;
+    bool controlSocketSet = false;
+
+    bool load(const QString &path, QString *error);
+    // 릴레이는 같은 호스트에 여러 개 (또는 원본과 같이) 띄우므로 고정 기본값이 겹친다.
+    // 직접 정하지 않았으면 raw 포트는 끄고, 로컬 / 제어 소켓은 스트림 포트를 붙인 경로로
+    void applyRelayDefaults();
+};
+
+// GUI 없는 server2. 스트리밍 엔진을 돌리고 제어 소켓으로 명령을 받는다.
+// start() 는 저장해 둔 라이브러리 색인을 읽어 list 에 바로 답하고, 스캔 스레드
+// (기본 8개) 로 바뀐 디렉터리만 다시 훑으며, watchLibrary 면 감시를 시작한다
+// (inotify, NFS 는 폴링).
+class Daemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Daemon(const DaemonConfig &config, QObject *parent = nullptr);
+    ~Daemon();
+
+    bool start();
+    void stop();
+    QString errorString() const { return m_error; }
+
+signals:
+    void shutdownRequested();
+
+private slots:
+    void onRequest(int connection, const QString &command, const QString &argument);
+    void onClientConnected(int id, const QString &peer);
+    void onClientDisconnected(int id);
+    void onTrackFinished();
+    void onScanFinished();
+
+private:
+    QJsonObject play(const QString &path);
+    QJsonObject seek(const QString &argument);
+    QJsonObject setMulticast(const QString &destination);
+    QJsonObject setSpeaker(const QString &command, const QString &argument);
+    QJsonObject status() const;
+    QJsonObject clients() const;
+    QJsonObject list() const;
+    QJsonObject rescan();
+    void rescanLibrary();
+    QString indexPath() const;
+
+    DaemonConfig   m_config;
+    StreamServer  *m_server;
+    ControlServer *m_control;
+    PcmCache       m_pcmCache;        // 다시 튼 트랙은 디코드하지 않는다
+    QString        m_error;
+    QString        m_track;
+    quint32        m_trackRate;
+    qint64         m_trackFrames;
+    LibraryIndex   m_library;
+    LibraryScanner *m_scanner;
+    LibraryWatcher *m_watcher;
+    bool           m_rescanPending;
+
+    Q_DISABLE_COPY(Daemon)
+};
+
+#endif // DAEMON_H
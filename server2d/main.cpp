@@ -0,0 +1,149 @@
+// main.cpp
+//
+// server2d: 화면 없는 랙 장비용 server2. 설정 파일 (INI) + 명령줄로 띄우고
+// 로컬 제어 소켓으로 조종한다 (controlprotocol.h). systemd 등에서 포그라운드로 돌린다.
+//
+//   server2d --config /etc/server2d.conf
+//   echo "play /mnt/nfs/a.wav" | socat - UNIX-CONNECT:/tmp/server2d.sock
+//   server2d --relay 10.0.0.1 --control /tmp/edge.sock     (다른 방 / 건물의 edge)
+//   server2d --relay 127.0.0.1 --port 5710    (같은 호스트의 둘째 단, 제어 /tmp/server2d-5710.sock)
+#include "daemon.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTextStream>
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+
+int main(int argc, char *argv[])
+{
+    // SIGTERM / SIGINT 은 signalfd 로 이벤트 루프에서 받는다.
+    // 엔진 스레드가 생기기 전에 막아야 모든 스레드에 적용된다
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("server2d");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless server2 streaming daemon.");
+    parser.addHelpOption();
+    QCommandLineOption configOpt("config", "Config file (default /etc/server2d.conf if present).", "file");
+    QCommandLineOption portOpt("port", "Stream port (default 5700).", "port");
+    QCommandLineOption addressOpt("address", "Listen address (default: all interfaces).", "addr");
+    QCommandLineOption rawPortOpt("raw-port", "Raw WAV stream port, 0 to disable (default 5701).", "port");
+    QCommandLineOption localOpt("local-socket",
+            "Unix socket for same-host clients over shared memory, empty to disable "
+            "(default /tmp/server2-stream.sock).", "path");
+    QCommandLineOption multicastOpt("multicast",
+            "Also send RTP (L16, or Opus with --opus) to <group:port>, e.g. 239.255.0.1:5004.",
+            "group:port");
+    QCommandLineOption ttlOpt("ttl", "Multicast TTL (default 1).", "n");
+    QCommandLineOption rtpMsOpt("rtp-ms", "RTP packet duration in ms (default 5).", "ms");
+    QCommandLineOption ifaceOpt("multicast-if", "Local interface address for multicast.", "addr");
+    QCommandLineOption fecOpt("fec", "RTP FEC overhead in percent, sent to port + 2 (0 = off).", "percent");
+    QCommandLineOption fecInterleaveOpt("fec-interleave",
+            "Consecutive RTP packets a burst may lose and still be recovered (default 4).", "n");
+    QCommandLineOption opusOpt("opus", "Stream Opus at this bitrate in kbit/s instead of PCM (0 = PCM).",
+            "kbps");
+    QCommandLineOption relayOpt("relay",
+            "Relay the stream of another server2 instead of playing files (edge node). "
+            "Unless given, the raw port is off and the local / control sockets "
+            "get the stream port appended.",
+            "host[:port]");
+    QCommandLineOption controlOpt("control", "Control socket path (default /tmp/server2d.sock).", "path");
+    QCommandLineOption libraryOpt("library", "Media directory for the list command (default /mnt/nfs).", "dir");
+    parser.addOption(configOpt);
+    parser.addOption(portOpt);
+    parser.addOption(addressOpt);
+    parser.addOption(rawPortOpt);
+    parser.addOption(localOpt);
+    parser.addOption(multicastOpt);
+    parser.addOption(ttlOpt);
+    parser.addOption(rtpMsOpt);
+    parser.addOption(ifaceOpt);
+    parser.addOption(fecOpt);
+    parser.addOption(fecInterleaveOpt);
+    parser.addOption(opusOpt);
+    parser.addOption(relayOpt);
+    parser.addOption(controlOpt);
+    parser.addOption(libraryOpt);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    DaemonConfig config;
+    const QString configPath = parser.isSet(configOpt) ? parser.value(configOpt)
+                                                       : QString("/etc/server2d.conf");
+    if (parser.isSet(configOpt) || QFileInfo(configPath).exists()) {
+        QString error;
+        if (!config.load(configPath, &error)) {
+            err << "server2d: " << error << Qt::endl;
+            return 1;
+        }
+    }
+    if (parser.isSet(portOpt))
+        config.port = quint16(parser.value(portOpt).toUInt());
+    if (parser.isSet(addressOpt))
+        config.address = parser.value(addressOpt);
+    if (parser.isSet(rawPortOpt)) {
+        config.rawPort = quint16(parser.value(rawPortOpt).toUInt());
+        config.rawPortSet = true;
+    }
+    if (parser.isSet(localOpt)) {
+        config.localSocket = parser.value(localOpt);
+        config.localSocketSet = true;
+    }
+    if (parser.isSet(multicastOpt))
+        config.multicast = parser.value(multicastOpt);
+    if (parser.isSet(ttlOpt))
+        config.multicastTtl = parser.value(ttlOpt).toInt();
+    if (parser.isSet(rtpMsOpt))
+        config.rtpMs = parser.value(rtpMsOpt).toDouble();
+    if (parser.isSet(ifaceOpt))
+        config.multicastInterface = parser.value(ifaceOpt);
+    if (parser.isSet(fecOpt))
+        config.fecPercent = parser.value(fecOpt).toDouble();
+    if (parser.isSet(fecInterleaveOpt))
+        config.fecInterleave = parser.value(fecInterleaveOpt).toInt();
+    if (parser.isSet(opusOpt))
+        config.opusKbps = parser.value(opusOpt).toInt();
+    if (parser.isSet(relayOpt))
+        config.upstream = parser.value(relayOpt);
+    if (parser.isSet(controlOpt)) {
+        config.controlSocket = parser.value(controlOpt);
+        config.controlSocketSet = true;
+    }
+    if (parser.isSet(libraryOpt))
+        config.library = parser.value(libraryOpt);
+    config.applyRelayDefaults();
+
+    Daemon daemon(config);
+    if (!daemon.start()) {
+        err << "server2d: " << daemon.errorString() << Qt::endl;
+        return 1;
+    }
+    QObject::connect(&daemon, &Daemon::shutdownRequested, &app, &QCoreApplication::quit,
+                     Qt::QueuedConnection);
+
+    const int sigFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    QSocketNotifier sigNotifier(sigFd, QSocketNotifier::Read);
+    QObject::connect(&sigNotifier, SIGNAL(activated(int)), &app, SLOT(quit()));
+
+    err << QString("server2d: stream port %1%2%3%4, control %5")
+           .arg(config.port)
+           .arg(config.rawPort ? QString(", raw %1").arg(config.rawPort) : QString())
+           .arg(config.localSocket.isEmpty() ? QString() : QString(", local %1").arg(config.localSocket))
+           .arg(config.upstream.isEmpty() ? QString() : QString(", relaying %1").arg(config.upstream))
+           .arg(config.controlSocket) << Qt::endl;
+    const int rc = app.exec();
+    daemon.stop();
+    ::close(sigFd);
+    return rc;
+}
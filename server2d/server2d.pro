@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# server2 헤드리스 데몬 (위젯 없음, 제어 소켓으로 조종)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = server2d
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+           daemon.cpp
+
+HEADERS += daemon.h
+
+include(../common/common.pri)
+
+include(../common/streaming.pri)
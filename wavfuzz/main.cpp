@@ -0,0 +1,288 @@
+// main.cpp
+//
+// WAV 헤더 파서 (WavParser) 와 MappedWavSource 퍼저. 입력 하나를 메모리 / QIODevice
+// 두 경로로 파싱해 결과가 같은지, 받아들인 헤더가 읽기 쪽 가정 (blockAlign, data
+// 범위) 을 지키는지 보고, memfd 에 써서 MappedWavSource 로 끝까지 읽는다.
+// 가정이 깨지면 abort() 해서 sanitizer / libFuzzer 가 입력을 남기게 한다.
+//
+//   wavfuzz                       내장 시드를 변이해 20만 번
+//   wavfuzz -n 1000000 -seed 7 a.wav b.wav   파일을 시드로
+//   wavfuzz -replay crash.wav     입력 하나만 실행
+//
+// qmake CONFIG+=libfuzzer 로 빌드하면 main() 대신 libFuzzer 진입점만 남는다.
+#include "wavformat.h"
+#include "mappedwavsource.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <QtEndian>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace {
+
+int g_memFd = -1;
+
+void check(bool ok, const char *what)
+{
+    if (!ok) {
+        fprintf(stderr, "wavfuzz: %s\n", what);
+        abort();
+    }
+}
+
+// 받아들인 포맷이 MappedWavSource 등 읽는 쪽의 가정을 지키는지
+void checkFormat(const WavFormat &f, qint64 size)
+{
+    check(f.channels > 0 && f.sampleRate > 0, "zero channels / rate accepted");
+    check(f.bitsPerSample > 0 && f.containerBits() >= 8, "empty sample container accepted");
+    check(f.bitsPerSample <= f.containerBits(), "samples wider than their container accepted");
+    check(int(f.blockAlign) >= int(f.channels) * (f.containerBits() / 8),
+          "blockAlign smaller than one frame accepted");
+    check(f.dataOffset <= quint64(size), "data offset past end of file");
+    check(f.dataSize <= quint64(size) - f.dataOffset, "data chunk past end of file");
+    check(f.frameCount() * f.blockAlign <= f.dataSize, "frames past end of data");
+}
+
+template <typename T>
+void touchLast(const SampleSpan<T> &span)
+{
+    if (span.isEmpty())
+        return;
+    volatile T sink = span.at(span.frames - 1, span.channels - 1);
+    Q_UNUSED(sink);
+}
+
+void readAll(const uchar *data, qint64 size)
+{
+    if (ftruncate(g_memFd, 0) != 0 || pwrite(g_memFd, data, size_t(size), 0) != size)
+        return;
+    MappedWavSource src;
+    if (!src.open(QString("/proc/self/fd/%1").arg(g_memFd)))
+        return;
+    const AudioInfo &info = src.info();
+    QVector<float> buf(4096 * info.channels);
+    qint64 total = 0;
+    for (;;) {
+        const qint64 n = src.readFloat(buf.data(), 4096);
+        if (n <= 0)
+            break;
+        total += n;
+    }
+    check(total == info.frameCount, "readFloat frame count mismatch");
+    // 끝 프레임을 가리키는 span 의 마지막 샘플까지 실제로 만진다
+    if (info.frameCount > 0) {
+        const qint64 last = info.frameCount - 1;
+        touchLast(src.peek<quint8>(last, 1));
+        touchLast(src.peek<qint16>(last, 1));
+        touchLast(src.peek<qint32>(last, 1));
+        check(src.seek(info.frameCount / 2) && src.seek(info.frameCount), "seek in range failed");
+        check(src.readFloat(buf.data(), 1) == 0, "read past the end");
+    }
+}
+
+void fuzzOne(const uchar *data, qint64 size)
+{
+    WavFormat mem;
+    const bool memOk = parseWavHeader(data, size, &mem);
+
+    QByteArray copy = QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(size));
+    QBuffer buffer(&copy);
+    buffer.open(QIODevice::ReadOnly);
+    WavFormat dev;
+    const bool devOk = parseWavHeader(&buffer, &dev);
+    check(memOk == devOk, "memory and QIODevice parsers disagree");
+    if (!memOk)
+        return;
+    check(mem.dataOffset == dev.dataOffset && mem.dataSize == dev.dataSize
+          && mem.blockAlign == dev.blockAlign, "memory and QIODevice formats differ");
+    checkFormat(mem, size);
+    if (mem.sampleType() != WavFormat::UnknownType)
+        readAll(data, size);
+}
+
+bool setUp()
+{
+    g_memFd = memfd_create("wavfuzz", MFD_CLOEXEC);
+    return g_memFd >= 0;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (g_memFd < 0 && !setUp())
+        return 0;
+    fuzzOne(data, qint64(size));
+    return 0;
+}
+
+#ifndef WAVFUZZ_LIBFUZZER
+
+namespace {
+
+// 내장 시드: 흔한 헤더 모양 몇 가지 (data 는 짧게)
+QByteArray makeWav(quint16 tag, quint16 channels, quint16 bits, bool rf64, bool extensible)
+{
+    const quint16 align = quint16(channels * bits / 8);
+    const int frames = 37;
+    QByteArray fmt(extensible ? 40 : 16, '\0');
+    uchar *f = reinterpret_cast<uchar *>(fmt.data());
+    qToLittleEndian<quint16>(extensible ? quint16(WavFormat::TagExtensible) : tag, f);
+    qToLittleEndian<quint16>(channels, f + 2);
+    qToLittleEndian<quint32>(48000, f + 4);
+    qToLittleEndian<quint32>(48000u * align, f + 8);
+    qToLittleEndian<quint16>(align, f + 12);
+    qToLittleEndian<quint16>(bits, f + 14);
+    if (extensible) {
+        static const uchar tail[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                        0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+        qToLittleEndian<quint16>(22, f + 16);
+        qToLittleEndian<quint16>(bits, f + 18);
+        qToLittleEndian<quint32>(3, f + 20);
+        qToLittleEndian<quint16>(tag, f + 24);
+        memcpy(f + 26, tail, sizeof tail);
+    }
+    QByteArray data(frames * align, '\0');
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = char(i * 31);
+
+    QByteArray out;
+    auto chunk = [&out](const char *id, const QByteArray &body, quint32 size) {
+        out.append(id, 4);
+        uchar len[4];
+        qToLittleEndian<quint32>(size, len);
+        out.append(reinterpret_cast<const char *>(len), 4);
+        out.append(body);
+        if (body.size() & 1)
+            out.append('\0');
+    };
+    out.append(rf64 ? "RF64" : "RIFF", 4);
+    out.append(4, '\xff');
+    out.append("WAVE", 4);
+    if (rf64) {
+        QByteArray ds64(28, '\0');
+        qToLittleEndian<quint64>(quint64(data.size()), reinterpret_cast<uchar *>(ds64.data()) + 8);
+        chunk("ds64", ds64, 28);
+    }
+    chunk("fmt ", fmt, quint32(fmt.size()));
+    chunk("LIST", QByteArray(6, 'x'), 6);
+    chunk("data", data, rf64 ? 0xFFFFFFFFu : quint32(data.size()));
+    return out;
+}
+
+QList<QByteArray> builtinSeeds()
+{
+    return QList<QByteArray>()
+            << makeWav(WavFormat::TagPcm, 2, 16, false, false)
+            << makeWav(WavFormat::TagPcm, 1, 8, false, false)
+            << makeWav(WavFormat::TagPcm, 2, 24, false, true)
+            << makeWav(WavFormat::TagPcm, 6, 32, true, true)
+            << makeWav(WavFormat::TagIeeeFloat, 2, 32, false, false)
+            << makeWav(WavFormat::TagIeeeFloat, 1, 64, true, false);
+}
+
+// 헤더 필드를 겨냥한 변이 (흔한 경계값 / 바이트 뒤집기 / 자르기 / 늘리기)
+QByteArray mutate(const QByteArray &seed, std::mt19937 &rng)
+{
+    static const quint32 edges[] = { 0, 1, 2, 3, 4, 7, 8, 16, 0x7F, 0x80, 0xFF, 0x100,
+                                     0x7FFF, 0x8000, 0xFFFF, 0x10000, 0x7FFFFFFF,
+                                     0x80000000u, 0xFFFFFFFEu, 0xFFFFFFFFu };
+    QByteArray in = seed;
+    const int rounds = 1 + int(rng() % 4);
+    for (int r = 0; r < rounds && !in.isEmpty(); ++r) {
+        // 대부분 헤더 (앞 128 바이트) 를 건드린다
+        const int span = qMin(in.size(), rng() % 8 ? 128 : in.size());
+        const int at = int(rng() % quint32(span));
+        uchar *p = reinterpret_cast<uchar *>(in.data());
+        switch (rng() % 6) {
+        case 0:
+            p[at] ^= uchar(1u << (rng() % 8));
+            break;
+        case 1:
+            p[at] = uchar(rng());
+            break;
+        case 2:
+            if (at + 2 <= in.size())
+                qToLittleEndian<quint16>(quint16(edges[rng() % (sizeof edges / sizeof *edges)]),
+                                         p + at);
+            break;
+        case 3:
+            if (at + 4 <= in.size())
+                qToLittleEndian<quint32>(edges[rng() % (sizeof edges / sizeof *edges)], p + at);
+            break;
+        case 4:
+            in.truncate(int(rng() % quint32(in.size() + 1)));
+            break;
+        case 5:
+            in.append(QByteArray(int(rng() % 64), char(rng())));
+            break;
+        }
+    }
+    return in;
+}
+
+void run(const QByteArray &input)
+{
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.constData()),
+                           size_t(input.size()));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    qint64 iterations = 200000;
+    quint32 seed = 1;
+    QList<QByteArray> seeds;
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            iterations = QByteArray(argv[++i]).toLongLong();
+        } else if (arg == "-seed" && i + 1 < argc) {
+            seed = QByteArray(argv[++i]).toUInt();
+        } else if (arg == "-replay" && i + 1 < argc) {
+            QFile f(QString::fromLocal8Bit(argv[++i]));
+            if (!f.open(QIODevice::ReadOnly)) {
+                fprintf(stderr, "wavfuzz: cannot read %s\n", argv[i]);
+                return 1;
+            }
+            run(f.readAll());
+            return 0;
+        } else {
+            QFile f(QString::fromLocal8Bit(argv[i]));
+            if (!f.open(QIODevice::ReadOnly)) {
+                fprintf(stderr, "wavfuzz: cannot read %s\n", argv[i]);
+                return 1;
+            }
+            // 큰 파일은 헤더 쪽만
+            seeds << f.read(64 * 1024);
+        }
+    }
+    if (seeds.isEmpty())
+        seeds = builtinSeeds();
+
+    std::mt19937 rng(seed);
+    for (const QByteArray &s : seeds)
+        run(s);
+    qint64 accepted = 0;
+    for (qint64 i = 0; i < iterations; ++i) {
+        const QByteArray input = mutate(seeds.at(int(rng() % quint32(seeds.size()))), rng);
+        WavFormat fmt;
+        accepted += parseWavHeader(reinterpret_cast<const uchar *>(input.constData()),
+                                   input.size(), &fmt) ? 1 : 0;
+        run(input);
+    }
+    printf("%lld inputs, %lld accepted headers, no findings\n",
+           static_cast<long long>(iterations), static_cast<long long>(accepted));
+    return 0;
+}
+
+#endif // WAVFUZZ_LIBFUZZER
@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# WAV 헤더 파서 / MappedWavSource 퍼저
+#
+#   qmake && make                      내장 변이기 (ASan)
+#   qmake -spec linux-clang CONFIG+=libfuzzer && make    libFuzzer
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += console sanitizer sanitize_address sanitize_undefined
+CONFIG   -= app_bundle
+
+TARGET = wavfuzz
+TEMPLATE = app
+
+libfuzzer {
+    DEFINES += WAVFUZZ_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer
+    QMAKE_LFLAGS += -fsanitize=fuzzer
+}
+
+
+SOURCES += main.cpp \
+        ../common/wavformat.cpp \
+        ../common/mappedwavsource.cpp
+
+HEADERS  += ../common/wavformat.h \
+        ../common/mappedwavsource.h \
+        ../common/audiosource.h
+
+INCLUDEPATH += ../common